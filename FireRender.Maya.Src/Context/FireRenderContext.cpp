@@ -41,20 +41,23 @@ limitations under the License.
 #include <fstream>
 
 #include "FireRenderThread.h"
+#include "ParallelUtils.h"
+#include "PixelConversion.h"
+#include "ImageCache.h"
 #include "FireRenderMaterialSwatchRender.h"
 #include "CompositeWrapper.h"
+#include "StartupContextChecker.h"
+#include "Tracing.h"
 #include <InstancerMASH.h>
 
+#include <chrono>
 #include <deque>
+#include <set>
 
 #ifdef WIN32 // alembic support is disabled on MAC until alembic build issue on MAC is resolved
 #include "FireRenderGPUCache.h"
 #endif
 
-#ifdef OPTIMIZATION_CLOCK
-	#include <chrono>
-#endif
-
 using namespace RPR;
 using namespace FireMaya;
 
@@ -68,20 +71,25 @@ std::map<FireRenderContext*,FireRenderContext::Lock::frcinfo> FireRenderContext:
 #include "FireRenderIBL.h"
 #include <maya/MFnRenderLayer.h>
 
-#ifdef OPTIMIZATION_CLOCK
-	int FireRenderContext::timeInInnerAddPolygon;
-	int FireRenderContext::overallAddPolygon;
-	int FireRenderContext::overallCreateMeshEx;
-	unsigned long long FireRenderContext::timeGetDataFromMaya;
-	unsigned long long FireRenderContext::translateData;
-	int FireRenderContext::inTranslateMesh;
-	int FireRenderContext::inGetFaceMaterials;
-	int FireRenderContext::getTessellatedObj;
-	int FireRenderContext::deleteNodes;
-#endif
-
 int FireRenderContext::INCORRECT_PLUGIN_ID = -1;
 
+namespace
+{
+	// async denoiser counters (all contexts)
+	std::atomic<unsigned long long> s_denoiseSubmitted(0);
+	std::atomic<unsigned long long> s_denoiseCompleted(0);
+	std::atomic<unsigned long long> s_denoiseDropped(0);
+	std::atomic<unsigned long long> s_denoiseSetupTotalUs(0);
+	std::atomic<unsigned long long> s_denoiseLatencyTotalUs(0);
+	std::atomic<unsigned long long> s_denoiseLatencyMaxUs(0);
+	std::atomic<unsigned long long> s_denoiseLatencyCount(0);
+
+	unsigned long long MicrosecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
 FireRenderContext::FireRenderContext() :
 	m_width(0),
 	m_height(0),
@@ -106,7 +114,12 @@ FireRenderContext::FireRenderContext() :
 	m_cameraDirty(true),
 	m_denoiserChanged(false),
 	m_denoiserFilter(nullptr),
-	m_upscalerFilter(nullptr),
+	m_denoiseBusy(false),
+	m_denoiseExit(false),
+	m_denoiseGeneration(0),
+	m_denoisedFrameReady(false),
+	m_denoisedFrameWidth(0),
+	m_denoisedFrameHeight(0),
 	m_shadowColor{ 0.0f, 0.0f, 0.0f },
 	m_shadowTransparency(0),
 	m_shadowWeight(1),
@@ -133,8 +146,9 @@ FireRenderContext::~FireRenderContext()
 	// Unsubscribe from all callbacks.
 	removeCallbacks();
 
+	StopDenoiseThread();
+
 	m_denoiserFilter.reset();
-	m_upscalerFilter.reset();
 }
 
 int FireRenderContext::initializeContext()
@@ -430,6 +444,12 @@ bool FireRenderContext::buildScene(bool isViewport, bool glViewport, bool freshe
 	MAIN_THREAD_ONLY;
 	DebugPrint("FireRenderContext::buildScene()");
 
+	// startup check keeps running in background after plugin load, first render waits for it
+	if (!StartupContextChecker::IsRprSupported())
+	{
+		return false;
+	}
+
 	m_globals.readFromCurrentScene();
 
 	// Backdoor for enabling aovs in IPR/Viewport
@@ -478,6 +498,10 @@ bool FireRenderContext::buildScene(bool isViewport, bool glViewport, bool freshe
 		}
 
 		GetScope().CreateScene();
+
+		// textures are decoded on the worker pool while scene objects are being created
+		FireMaya::ImageCache::PrefetchTasks prefetchTasks = PrefetchTextures();
+
 		updateLimitsFromGlobalData(m_globals);
 		setupContextContourMode(m_globals, createFlags);
 		setupContextHybridParams(m_globals); 
@@ -516,6 +540,9 @@ bool FireRenderContext::buildScene(bool isViewport, bool glViewport, bool freshe
 		BuildLateinitObjects();
 
 		attachCallbacks();
+
+		// translation of materials should only find prefetched images in the cache
+		FireMaya::ImageCache::WaitForPrefetch(prefetchTasks);
 	}
 
 	if(freshen)
@@ -524,6 +551,89 @@ bool FireRenderContext::buildScene(bool isViewport, bool glViewport, bool freshe
 	return true;
 }
 
+FireMaya::ImageCache::PrefetchTasks FireRenderContext::PrefetchTextures()
+{
+	MAIN_THREAD_ONLY;
+
+	std::vector<FireMaya::ImagePrefetchRequest> requests;
+	std::set<std::string> collected;
+
+	const char* shaderPlugNames[] = { "surfaceShader", "volumeShader", "displacementShader" };
+
+	for (MItDependencyNodes itShadingEngine(MFn::kShadingEngine); !itShadingEngine.isDone(); itShadingEngine.next())
+	{
+		MFnDependencyNode shadingEngine(itShadingEngine.thisNode());
+
+		for (const char* plugName : shaderPlugNames)
+		{
+			// walking from the shader plugs only, upstream of the shading engine itself are all the assigned meshes
+			MPlug shaderPlug = shadingEngine.findPlug(plugName, false);
+			if (shaderPlug.isNull())
+				continue;
+
+			MPlugArray connections;
+			shaderPlug.connectedTo(connections, true, false);
+
+			if (connections.length() == 0)
+				continue;
+
+			MStatus status;
+			MItDependencyGraph itNetwork(
+				connections[0].node(),
+				MFn::kInvalid,
+				MItDependencyGraph::kUpstream,
+				MItDependencyGraph::kDepthFirst,
+				MItDependencyGraph::kNodeLevel,
+				&status);
+
+			if (status != MStatus::kSuccess)
+				continue;
+
+			for (; !itNetwork.isDone(); itNetwork.next())
+			{
+				MObject node = itNetwork.currentItem();
+				MFnDependencyNode fnNode(node);
+
+				MString texturePath;
+				MString colorSpace;
+
+				if (node.hasFn(MFn::kFileTexture))
+				{
+					// UDIM tiles and image sequences are resolved with MEL by the file node converter
+					const int fileNodeUdimMode = 3;
+					if (fnNode.findPlug("uvTilingMode", false).asInt() == fileNodeUdimMode ||
+						fnNode.findPlug("useFrameExtension", false).asBool())
+						continue;
+
+					texturePath = fnNode.findPlug("computedFileTextureNamePattern", false).asString();
+
+					MPlug colorSpacePlug = fnNode.findPlug("colorSpace", false);
+					if (!colorSpacePlug.isNull())
+						colorSpace = colorSpacePlug.asString();
+				}
+				else if (fnNode.typeId() == FireMaya::TypeId::FireRenderTexture)
+				{
+					texturePath = fnNode.findPlug("filename", false).asString();
+				}
+
+				if (texturePath.length() == 0)
+					continue;
+
+				FireMaya::ImagePrefetchRequest request;
+				request.path = ProcessEnvVarsInFilePath<std::string, char>(texturePath.asChar());
+				request.colorSpace = colorSpace.asUTF8();
+
+				if (collected.insert(request.path + "|" + request.colorSpace).second)
+					requests.push_back(request);
+			}
+		}
+	}
+
+	DebugPrint("FireRenderContext::PrefetchTextures(): %zu textures", requests.size());
+
+	return FireMaya::ImageCache::Instance().Prefetch(requests);
+}
+
 static const std::vector<int> g_denoiserAovs = { 
 	RPR_AOV_SHADING_NORMAL, 
 	RPR_AOV_WORLD_COORDINATE,
@@ -613,29 +723,27 @@ MString GetModelPath()
 	return modelsFolder;
 }
 
-bool FireRenderContext::setupUpscalerForViewport(RV_PIXEL* data)
+// Created on RPR thread, input data is read by Run so the buffer is filled by the denoiser job
+static std::shared_ptr<ImageFilter> CreateViewportUpscaler(rpr_context context, RV_PIXEL* data,
+	std::uint32_t width, std::uint32_t height, const std::string& modelsFolder)
 {
-	std::uint32_t width = (std::uint32_t) m_pixelBuffers[RPR_AOV_COLOR].width();
-	std::uint32_t height = (std::uint32_t) m_pixelBuffers[RPR_AOV_COLOR].height();
-
 	size_t rifImageSize = sizeof(RV_PIXEL) * width * height;
 
-	// setup upscaler
-	m_upscalerFilter = std::shared_ptr<ImageFilter>(new ImageFilter(
-		context(),
+	std::shared_ptr<ImageFilter> upscaler(new ImageFilter(
+		context,
 		2 * width,
 		2 * height,
-		GetModelPath().asChar()
+		modelsFolder.c_str()
 	));
 
-	m_upscalerFilter->CreateFilter(RifFilterType::Upscaler, /*parameter is ignored for upscaler creation*/ false);
+	upscaler->CreateFilter(RifFilterType::Upscaler, /*parameter is ignored for upscaler creation*/ false);
 
-	m_upscalerFilter->SetInputOverrideSize(width, height);
-	m_upscalerFilter->AddInput(RifColor, (float*) data, rifImageSize, 0.0f);
+	upscaler->SetInputOverrideSize(width, height);
+	upscaler->AddInput(RifColor, (float*) data, rifImageSize, 0.0f);
 
-	m_upscalerFilter->AttachFilter();
+	upscaler->AttachFilter();
 
-	return true;
+	return upscaler;
 }
 
 
@@ -980,6 +1088,9 @@ void FireRenderContext::cleanScene()
 		LOCKMUTEX(this);
 		removeCallbacks();
 
+		// running denoiser job uses the context
+		StopDenoiseThread();
+
 		// Remove shapes first (It is connected with issue in Hybrid. We should clean up all meshes first before deleting lights)
 		FireRenderObjectMap::iterator it = m_sceneObjects.begin();
 
@@ -1028,6 +1139,13 @@ void FireRenderContext::cleanScene()
 		}
 
 		m_sceneObjects.clear();
+		m_geometryShapes.clear();
+
+		{
+			std::lock_guard<std::mutex> lock(m_stateHashMutex);
+			m_stateHashParts.clear();
+			m_stateHashSum = 0;
+		}
 
 		m_camera.clear();
 		m_defaultLight.Reset();
@@ -1079,6 +1197,11 @@ void FireRenderContext::initSwatchScene()
 {
 	DebugPrint("FireRenderContext::buildSwatchScene(...)");
 
+	if (!StartupContextChecker::IsRprSupported())
+	{
+		throw RPR_ERROR_UNSUPPORTED;
+	}
+
 	auto createFlags = FireMaya::Options::GetContextDeviceFlags();
 
 	rpr_int res;
@@ -1143,6 +1266,7 @@ void FireRenderContext::UpdateCompletionCriteriaForSwatch()
 void FireRenderContext::render(bool lock)
 {
 	RPR_THREAD_ONLY;
+	RPR_TRACE_ZONE("FireRenderContext::render");
 	LOCKMUTEX((lock ? this : nullptr));
 
 	auto context = scope.Context();
@@ -1213,7 +1337,9 @@ void FireRenderContext::render(bool lock)
 
 	TriggerProgressCallback(progressData);
 
-	if (m_useRegion)
+	if (m_renderPass)
+		m_renderPass(context);
+	else if (m_useRegion)
 		context.RenderTile(m_region.left, m_region.right+1, m_height - m_region.top - 1, m_height - m_region.bottom);
 	else
 		context.Render();
@@ -1248,6 +1374,7 @@ void FireRenderContext::setSamplesPerUpdate(int samplesPerUpdate)
 void FireRenderContext::saveToFile(MString& filePath, const ImageFileDescription& imgDescription)
 {
 	RPR_THREAD_ONLY;
+	RPR_TRACE_ZONE_DETAIL("FireRenderContext::saveToFile", filePath.asUTF8());
 	DebugPrint("FireRenderContext::saveToFile(...)");
 	float* data = new float[m_width * m_height * 4];
 
@@ -1275,17 +1402,7 @@ void FireRenderContext::saveToFile(MString& filePath, const ImageFileDescription
 	}
 	else
 	{
-		float* tmpBuffer = new float[m_width * m_height * 4];
-		memcpy(&tmpBuffer[0], &data[0], sizeof(float) * m_width * m_height * 4);
-		for (unsigned int y = 0; y < (m_height); y++)
-		{
-			memcpy(
-				&data[y * m_width * 4],
-				&tmpBuffer[(m_height - y - 1) * m_width * 4],
-				sizeof(float) * m_width * 4
-			);
-		}
-		delete[] tmpBuffer;
+		FireMaya::PixelConversion::FlipRows(&data[0], sizeof(float) * m_width * 4, m_height);
 
 		MStatus status;
 		//save 24bit with MImage
@@ -1440,6 +1557,9 @@ bool FireRenderContext::createContextEtc(rpr_creation_flags creation_flags, bool
 			return false;
 		}
 
+		// job of the previous context has to finish before the context is replaced
+		StopDenoiseThread();
+
 		scope.Init(handle, destroyMaterialSystemOnDelete, createScene);
 
 #ifdef _DEBUG
@@ -1689,7 +1809,9 @@ void FireRenderContext::DebugDumpDenoiseSourceAOV(const std::string& pathToFile)
 #endif
 
 std::vector<float> FireRenderContext::GetDenoisedData(bool& result)
-{	
+{
+	RPR_TRACE_ZONE("FireRenderContext::GetDenoisedData");
+
 #ifdef _DEBUG
 #ifdef DUMP_FRAMEBUFF
 	const std::string pathToFile = "C://debug//fb//";
@@ -1747,34 +1869,35 @@ RV_PIXEL* FireRenderContext::GetAOVData(const ReadFrameBufferRequestParams& para
 	return data;
 }
 
-void FireRenderContext::ReadOpacityAOV(const ReadFrameBufferRequestParams& params)
+const RV_PIXEL* FireRenderContext::ReadOpacityFrameBuffer(const ReadFrameBufferRequestParams& params)
 {
 	// No need to merge opacity for any FB other then color
 	if (!params.mergeOpacity || params.aov != RPR_AOV_COLOR)
-		return;
+		return nullptr;
 
 	rpr_framebuffer opacityFrameBuffer = frameBufferAOV_Resolved(RPR_AOV_OPACITY);
 	if (opacityFrameBuffer == nullptr)
-		return;
+		return nullptr;
 
 	size_t dataSize = (sizeof(RV_PIXEL) * params.PixelCount());
 
-	m_opacityData.resize(params.PixelCount());
+	m_opacityTempData.resize(params.PixelCount());
 
-	if (params.UseTempData())
-	{
-		m_opacityTempData.resize(params.PixelCount());
+	rpr_int frstatus = rprFrameBufferGetInfo(opacityFrameBuffer, RPR_FRAMEBUFFER_DATA, dataSize, m_opacityTempData.get(), nullptr);
+	checkStatus(frstatus);
 
-		rpr_int frstatus = rprFrameBufferGetInfo(opacityFrameBuffer, RPR_FRAMEBUFFER_DATA, dataSize, m_opacityTempData.get(), nullptr);
-		checkStatus(frstatus);
+	return m_opacityTempData.get();
+}
 
-		copyPixels(m_opacityData.get(), m_opacityTempData.get(), params.width, params.height, params.region);
-	}
-	else
-	{
-		rpr_int frstatus = rprFrameBufferGetInfo(opacityFrameBuffer, RPR_FRAMEBUFFER_DATA, dataSize, m_opacityData.get(), nullptr);
-		checkStatus(frstatus);
-	}
+void FireRenderContext::ReadOpacityAOV(const ReadFrameBufferRequestParams& params)
+{
+	const RV_PIXEL* opacity = ReadOpacityFrameBuffer(params);
+	if (opacity == nullptr)
+		return;
+
+	m_opacityData.resize(params.PixelCount());
+
+	copyPixels(m_opacityData.get(), opacity, params.width, params.height, params.region);
 }
 
 void FireRenderContext::CombineOpacity(int aov, RV_PIXEL* pixels, unsigned int area)
@@ -1811,6 +1934,7 @@ RV_PIXEL* FireRenderContext::readFrameBufferSimple(ReadFrameBufferRequestParams&
 void FireRenderContext::readFrameBuffer(ReadFrameBufferRequestParams& params)
 {
 	RPR_THREAD_ONLY;
+	RPR_TRACE_ZONE("FireRenderContext::readFrameBuffer");
 
 	RV_PIXEL* data = readFrameBufferSimple(params);
 
@@ -1819,22 +1943,15 @@ void FireRenderContext::readFrameBuffer(ReadFrameBufferRequestParams& params)
 		return;
 	}
 
-	// Read opacity AOV if needed
-	ReadOpacityAOV(params);
+	// Read opacity AOV if needed, it's merged into alpha while the region is copied
+	const RV_PIXEL* opacity = ReadOpacityFrameBuffer(params);
 
 	// Copy the region from the temporary
 	// buffer into supplied pixel memory.
 	// _TODO Investigate if "|| IsDenoiserCreated()" is really necessary?  
-	if (params.UseTempData() || (IsDenoiserCreated()))
-	{
-		copyPixels(params.pixels, data, params.width, params.height, params.region);
-	}
-
-	//combine (Opacity to Alpha)
-	// No need to merge opacity for any FB other then color
-	if (params.mergeOpacity)
+	if (params.UseTempData() || (IsDenoiserCreated()) || (opacity != nullptr))
 	{
-		CombineOpacity(params.aov, params.pixels, params.region.getArea());
+		copyPixels(params.pixels, data, params.width, params.height, params.region, opacity);
 	}
 }
 
@@ -1843,23 +1960,48 @@ void generateBitmapImage(unsigned char *image, int height, int width, int pitch,
 #endif
 
 // -----------------------------------------------------------------------------
-void FireRenderContext::copyPixels(RV_PIXEL* dest, RV_PIXEL* source,
+void FireRenderContext::copyPixels(RV_PIXEL* dest, const RV_PIXEL* source,
 	unsigned int sourceWidth, unsigned int sourceHeight,
-	const RenderRegion& region) const
+	const RenderRegion& region, const RV_PIXEL* alphaSource) const
 {
 	RPR_THREAD_ONLY;
 	// Get region dimensions.
 	unsigned int regionWidth = region.getWidth();
 	unsigned int regionHeight = region.getHeight();
 
-	for (unsigned int y = 0; y < regionHeight; y++)
+	// Whole image is copied in place when the region covers it, skip it unless alpha has to be merged
+	if ((dest == source) && (alphaSource == nullptr))
+		return;
+
+	auto copyRows = [=](size_t begin, size_t end)
 	{
-		unsigned int destIndex = y * regionWidth;
-				
-		unsigned int sourceIndex = 
-			(sourceHeight - (region.top - y) - 1) * sourceWidth + region.left;
+		for (size_t y = begin; y < end; y++)
+		{
+			size_t destIndex = y * regionWidth;
 
-		memcpy(&dest[destIndex], &source[sourceIndex], sizeof(RV_PIXEL) * regionWidth);
+			size_t sourceIndex =
+				(sourceHeight - (region.top - y) - 1) * size_t(sourceWidth) + region.left;
+
+			FireMaya::PixelConversion::CopyRGBA(
+				reinterpret_cast<const float*>(&source[sourceIndex]),
+				alphaSource ? reinterpret_cast<const float*>(&alphaSource[sourceIndex]) : nullptr,
+				reinterpret_cast<float*>(&dest[destIndex]),
+				regionWidth);
+		}
+	};
+
+	// Small regions are copied faster than workers wake up, large ones are split into ~1MB chunks
+	const size_t parallelCopyMinPixels = 256 * 1024;
+	size_t regionArea = size_t(regionWidth) * regionHeight;
+
+	if (regionArea < parallelCopyMinPixels)
+	{
+		copyRows(0, regionHeight);
+	}
+	else
+	{
+		size_t rowsPerChunk = (65536 + regionWidth - 1) / regionWidth;
+		FireMaya::WorkerPool::Instance().ParallelForRange(regionHeight, rowsPerChunk, copyRows);
 	}
 
 #ifdef _DEBUG
@@ -1906,13 +2048,8 @@ void FireRenderContext::combineWithOpacity(RV_PIXEL* pixels, unsigned int size,
 {
 	if (opacityPixels != NULL)
 	{
-		float alpha = 0.0f;
-		for (unsigned int i = 0; i < size; i++)
-		{
-			alpha = opacityPixels[i].r;
-
-			pixels[i].a = alpha;
-		}
+		float* data = reinterpret_cast<float*>(pixels);
+		FireMaya::PixelConversion::CopyRGBA(data, reinterpret_cast<const float*>(opacityPixels), data, size);
 	}
 }
 
@@ -1974,9 +2111,14 @@ void FireRenderContext::RemoveRenderObject(const MObject& ob)
 					Dynamic cast is needed to type check
 				*/
 				FireRenderMesh* mesh = dynamic_cast<FireRenderMesh*>(frNode);
+				if (mesh != nullptr)
+				{
+					RemoveGeometryShapes(mesh);
+				}
 
 				// remove object from scene
 				frNode->detachFromScene();
+				RemoveFromStateHash(frNode);
 				it = m_sceneObjects.erase(it);
 				setDirty();
 
@@ -2000,6 +2142,7 @@ void FireRenderContext::RefreshInstances()
 			if (!dagPath.isValid())
 			{
 				frNode->detachFromScene();
+				RemoveFromStateHash(frNode);
 				it = m_sceneObjects.erase(it);
 				setDirty();
 				continue;
@@ -2157,14 +2300,42 @@ void FireRenderContext::updateFromGlobals(bool applyLock)
 {
 	MAIN_THREAD_ONLY;
 
-	if (m_tonemappingChanged)
+	if (!m_tonemappingChanged && !m_globalsChanged)
+		return;
+
+    if (applyLock)
+    {
+        LOCKFORUPDATE(this);
+    }
+
+	std::set<std::string> changedGlobals;
 	{
-        if (applyLock)
-        {
-            LOCKFORUPDATE(this);
-        }
+		AutoMutexLock lock(m_dirtyMutex);
+		changedGlobals.swap(m_changedGlobals);
+	}
+
+	float viewportHairDensity = m_globals.viewportHairDensity;
 
+	// only attributes reported by globals callback are read; everything is read if changes are unknown
+	if (changedGlobals.empty())
 		m_globals.readFromCurrentScene();
+	else
+		m_globals.readFromCurrentScene(changedGlobals);
+
+	{
+		MSelectionList slist;
+		MObject globalsNode;
+		slist.add("RadeonProRenderGlobals");
+		slist.getDependNode(0, globalsNode);
+
+		HashValue globalsHash = FireRenderObject::GetNetworkHash(globalsNode);
+
+		std::lock_guard<std::mutex> lock(m_stateHashMutex);
+		m_globalsHash = globalsHash;
+	}
+
+	if (m_tonemappingChanged)
+	{
 		updateTonemapping(m_globals);
 
 		m_tonemappingChanged = false;
@@ -2173,24 +2344,101 @@ void FireRenderContext::updateFromGlobals(bool applyLock)
 	if (!m_globalsChanged)
 		return;
 
-    if (applyLock)
-    {
-        LOCKFORUPDATE(this);
-    }
-    
-	auto createFlags = FireMaya::Options::GetContextDeviceFlags(m_RenderType);
+	// hair strands are reduced only in viewport
+	if ((viewportHairDensity != m_globals.viewportHairDensity) && (GetRenderType() == RenderType::ViewportRender))
+	{
+		for (const auto& it : m_sceneObjects)
+		{
+			if (auto frHair = dynamic_cast<FireRenderHair*>(it.second.get()))
+			{
+				frHair->setDirty();
+			}
+		}
+	}
 
-	m_globals.readFromCurrentScene();
-	setupContextContourMode(m_globals, createFlags);
-	setupContextHybridParams(m_globals);
-	setupContextAirVolume(m_globals);
-	setupContextPostSceneCreation(m_globals);
-	setupContextCryptomatteSettings(m_globals);
+	// context parameters are set up again only for groups of changed attributes
+	bool updateAll = changedGlobals.empty();
+	bool contourChanged = updateAll;
+	bool hybridParamsChanged = updateAll;
+	bool airVolumeChanged = updateAll;
+	bool postSceneParamsChanged = updateAll;
+	bool cryptomatteChanged = updateAll;
+	bool limitsChanged = updateAll;
+	bool motionBlurChanged = updateAll;
+	bool cameraTypeChanged = updateAll;
+
+	for (const std::string& name : changedGlobals)
+	{
+		MString attributeName = name.c_str();
 
-	updateLimitsFromGlobalData(m_globals);
-	updateMotionBlurParameters(m_globals);
+		// tonemapping and denoiser are updated separately, hair density is handled above
+		if (FireRenderGlobalsData::isTonemapping(attributeName) || FireRenderGlobalsData::isDenoiser(attributeName) || (name == "hairDensityViewport"))
+			continue;
 
-	m_camera.setType(m_globals.cameraType);
+		if (FireRenderGlobalsData::IsContour(attributeName))
+		{
+			contourChanged = true;
+			postSceneParamsChanged |= (name == "contourIsEnabled");
+		}
+		else if (FireRenderGlobalsData::IsHybridParam(attributeName))
+		{
+			hybridParamsChanged = true;
+			postSceneParamsChanged |= (name == "reservoirSampling") || (name == "finalRender_reservoirSampling");
+		}
+		else if (FireRenderGlobalsData::IsAirVolume(attributeName))
+		{
+			airVolumeChanged = true;
+		}
+		else if (FireRenderGlobalsData::IsCryptomatte(attributeName))
+		{
+			cryptomatteChanged = true;
+		}
+		else if (FireRenderGlobalsData::IsCompletionCriteria(attributeName))
+		{
+			limitsChanged = true;
+			postSceneParamsChanged |= (name.find("MinIterations") != std::string::npos);
+		}
+		else if (FireRenderGlobalsData::IsMotionBlur(attributeName) || (name == "motionBlurViewport") || (name == "motionSamples"))
+		{
+			motionBlurChanged = true;
+			postSceneParamsChanged |= (name == "velocityAOVMotionBlur");
+		}
+		else if (name == "cameraType")
+		{
+			cameraTypeChanged = true;
+		}
+		else
+		{
+			postSceneParamsChanged = true;
+		}
+	}
+
+	if (contourChanged)
+	{
+		auto createFlags = FireMaya::Options::GetContextDeviceFlags(m_RenderType);
+		setupContextContourMode(m_globals, createFlags);
+	}
+
+	if (hybridParamsChanged)
+		setupContextHybridParams(m_globals);
+
+	if (airVolumeChanged)
+		setupContextAirVolume(m_globals);
+
+	if (postSceneParamsChanged)
+		setupContextPostSceneCreation(m_globals);
+
+	if (cryptomatteChanged)
+		setupContextCryptomatteSettings(m_globals);
+
+	if (limitsChanged)
+		updateLimitsFromGlobalData(m_globals);
+
+	if (motionBlurChanged)
+		updateMotionBlurParameters(m_globals);
+
+	if (cameraTypeChanged)
+		m_camera.setType(m_globals.cameraType);
 
 	m_globalsChanged = false;
 }
@@ -2238,6 +2486,8 @@ void FireRenderContext::globalsChangedCallback(MNodeMessage::AttributeMessage ms
 	{
 		AutoMutexLock lock(frContext->m_dirtyMutex);
 
+		frContext->m_changedGlobals.insert(FireRenderGlobalsData::GetAttributeName(plug));
+
 		bool restartRender = false;
 		if (FireRenderGlobalsData::isTonemapping(plug.name()))
 		{
@@ -2589,6 +2839,7 @@ FireRenderSky* FireRenderContext::CreateSky(const MDagPath& dagPath)
 void FireRenderContext::setDirty()
 {
 	m_dirty = true;
+	FireRenderThread::Wake();
 }
 
 
@@ -2622,6 +2873,7 @@ void FireRenderContext::setDirtyObject(FireRenderObject* obj)
 	if (obj == &m_camera)
 	{
 		m_cameraDirty = true;
+		FireRenderThread::Wake();
 		return;
 	}
 
@@ -2650,23 +2902,185 @@ void FireRenderContext::setDirtyObject(FireRenderObject* obj)
 			m_dirtyObjects[obj] = ptr;
 		}
 	}
+
+	// IPR picks dirty objects up on the render thread
+	FireRenderThread::Wake();
 }
 
-HashValue FireRenderContext::GetStateHash()
+void FireRenderContext::setDirtyAllObjects()
+{
+	{
+		AutoMutexLock lock(m_dirtyMutex);
+
+		for (const auto& it : m_sceneObjects)
+		{
+			if (it.second)
+				m_dirtyObjects[it.second.get()] = it.second;
+		}
+	}
+
+	m_cameraDirty = true;
+	FireRenderThread::Wake();
+}
+
+void FireRenderContext::ReadDeformationSamples(const std::deque<std::shared_ptr<FireRenderObject>>& meshes)
 {
-	HashValue hash(size_t(this));
+	MAIN_THREAD_ONLY;
+
+	std::vector<FireRenderObject*> deformingMeshes;
+	unsigned int sampleCount = 0;
+
+	for (const std::shared_ptr<FireRenderObject>& ptr : meshes)
+	{
+		unsigned int pendingCount = ptr ? ptr->GetPendingDeformationSampleCount() : 0;
+		if (pendingCount == 0)
+			continue;
+
+		deformingMeshes.push_back(ptr.get());
+		sampleCount = (pendingCount + 1 > sampleCount) ? pendingCount + 1 : sampleCount;
+	}
+
+	if (deformingMeshes.empty())
+		return;
+
+	RPR_TRACE_ZONE("FireRenderContext::ReadDeformationSamples");
+
+	// sub-frame evaluation shouldn't make meshes dirty
+	ContextSetDirtyObjectAutoLocker locker(*this);
+
+	MTime currentTime = FireMaya::MotionSampleCache::GetEvaluationTime();
+	std::vector<FireMaya::MeshTranslator::DeformationSample> samples;
+
+	// samples which can't be evaluated through DG context, by sample index
+	std::vector<std::pair<unsigned int, FireRenderObject*>> reloadSamples;
+
+	// Current time isn't changed (it would update whole scene and UI per sample), meshes are evaluated
+	// through DG context of the sample time one after another, then Maya owned points are copied on worker threads
+	for (unsigned int sampleIdx = 1; sampleIdx < sampleCount; ++sampleIdx)
+	{
+		MTime sampleTime = FireMaya::MotionSampleCache::GetSampleTime(currentTime, sampleIdx, sampleCount);
+
+		samples.assign(deformingMeshes.size(), FireMaya::MeshTranslator::DeformationSample());
+
+		for (size_t idx = 0; idx < deformingMeshes.size(); ++idx)
+		{
+			if (sampleIdx <= deformingMeshes[idx]->GetPendingDeformationSampleCount())
+			{
+				RPR_TRACE_ZONE("FireRenderMesh::ReadDeformationSample");
+				deformingMeshes[idx]->ReadDeformationSample(sampleIdx, sampleTime, samples[idx]);
+
+				if (!samples[idx].cached && (samples[idx].points == nullptr))
+				{
+					reloadSamples.emplace_back(sampleIdx, deformingMeshes[idx]);
+				}
+			}
+		}
+
+		FireMaya::WorkerPool::Instance().ParallelFor(deformingMeshes.size(), [&deformingMeshes, &samples, sampleIdx, &sampleTime](size_t idx)
+		{
+			if (sampleIdx <= deformingMeshes[idx]->GetPendingDeformationSampleCount())
+			{
+				deformingMeshes[idx]->StoreDeformationSample(sampleIdx, sampleTime, samples[idx]);
+			}
+		});
+
+		// Maya data is released on the main thread
+		samples.clear();
+	}
+
+	if (reloadSamples.empty())
+		return;
+
+	// The rest is read the way the first frame is, by moving current time to the sample time.
+	// Stored first frame is replaced, or it stays if the sample fails again
+	RPR_TRACE_ZONE("FireRenderMesh::ReloadDeformationSample");
+
+	MTime initialTime = MAnimControl::currentTime();
+	unsigned int viewSampleIdx = 0;
 
-	for (auto& it : m_sceneObjects)
+	for (const auto& reloadSample : reloadSamples)
 	{
-		if (it.second)
-			hash << it.second->GetStateHash();
+		MTime sampleTime = FireMaya::MotionSampleCache::GetSampleTime(currentTime, reloadSample.first, sampleCount);
+
+		if (reloadSample.first != viewSampleIdx)
+		{
+			viewSampleIdx = reloadSample.first;
+			MGlobal::viewFrame(sampleTime);
+		}
+
+		reloadSample.second->ReloadDeformationSample(reloadSample.first, sampleTime);
 	}
 
+	MGlobal::viewFrame(initialTime);
+}
+
+HashValue FireRenderContext::GetStateHash()
+{
+	// Sum of mixed object hashes doesn't depend on object order, so it is updated
+	// incrementally when dirty objects are refreshed instead of rehashing whole scene here.
+	// Object hashes (with material networks) and globals hash are built from node uuids and values only,
+	// so the result can be used as a persistent key
+	HashValue hash;
+	{
+		std::lock_guard<std::mutex> lock(m_stateHashMutex);
+		hash = HashValue(size_t(m_stateHashSum));
+		hash << m_globalsHash;
+	}
+
+	// render camera isn't a scene object, its hash is not part of the sum
 	hash << m_camera.GetStateHash();
 
 	return hash;
 }
 
+void FireRenderContext::UpdateStateHash(const FireRenderObject* object, HashValue hash)
+{
+	if (object == &m_camera)
+		return;
+
+	HashValue part;
+	part << size_t(hash);
+
+	std::lock_guard<std::mutex> lock(m_stateHashMutex);
+
+	StateHashPart& storedPart = m_stateHashParts[object];
+	if (storedPart.attached)
+		m_stateHashSum = m_stateHashSum - storedPart.value + size_t(part);
+	storedPart.value = size_t(part);
+}
+
+void FireRenderContext::RemoveFromStateHash(const FireRenderObject* object)
+{
+	std::lock_guard<std::mutex> lock(m_stateHashMutex);
+
+	auto it = m_stateHashParts.find(object);
+	if (it == m_stateHashParts.end())
+		return;
+
+	if (it->second.attached)
+		m_stateHashSum -= it->second.value;
+	m_stateHashParts.erase(it);
+}
+
+void FireRenderContext::SetStateHashAttached(const FireRenderObject* object, bool attached)
+{
+	if (object == &m_camera)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_stateHashMutex);
+
+	StateHashPart& storedPart = m_stateHashParts[object];
+	if (storedPart.attached == attached)
+		return;
+
+	if (attached)
+		m_stateHashSum += storedPart.value;
+	else
+		m_stateHashSum -= storedPart.value;
+
+	storedPart.attached = attached;
+}
+
 void FireRenderContext::UpdateTimeAndTriggerProgressCallback(ContextWorkProgressData& syncProgressData, ProgressType progressType)
 {
 	if (progressType != ContextWorkProgressData::ProgressType::Unknown)
@@ -2712,8 +3126,13 @@ bool FireRenderContext::Freshen(bool lock, std::function<bool()> cancelled)
 	if (!isDirty() || cancelled())
 		return false;
 
+	RPR_TRACE_ZONE("FireRenderContext::Freshen");
+
 	LOCKFORUPDATE((lock ? this : nullptr));
 
+	// sub-frame matrices and deformation samples are shared by all objects of this sync
+	FireMaya::MotionSampleCache::SyncScope motionSampleScope(FireMaya::MotionSampleCache::GetEvaluationTime());
+
 	m_inRefresh = true;
 
 	updateFromGlobals(false /*applyLock*/);
@@ -2811,7 +3230,10 @@ bool FireRenderContext::Freshen(bool lock, std::function<bool()> cancelled)
 			DebugPrint("Freshing object");
 
 			UpdateTimeAndTriggerProgressCallback(syncProgressData, ProgressType::ObjectPreSync);
-			ptr->Freshen(shouldCalculateHash);
+			{
+				RPR_TRACE_ZONE("FireRenderObject::Freshen");
+				ptr->Freshen(shouldCalculateHash);
+			}
 
 			syncProgressData.currentIndex++;
 			UpdateTimeAndTriggerProgressCallback(syncProgressData, ProgressType::ObjectSyncComplete);
@@ -2823,43 +3245,59 @@ bool FireRenderContext::Freshen(bool lock, std::function<bool()> cancelled)
 		}
 	}
 
-	const bool isDeformationMotionBlurEnabled = motionBlur() && IsDeformationMotionBlurEnabled() && !isInteractive();
-	const unsigned int motionSamplesCount = isDeformationMotionBlurEnabled ? motionSamples() : 1;
-
-	// read data from meshes
-	MTime initialTime = MAnimControl::currentTime();
-	MTime currentTime = initialTime;
-	unsigned int currentSampeIdx = 0;
-
-	do
+	// read data from meshes at the current time
+	for (auto it = meshesToReload.begin(); it != meshesToReload.end(); ++it)
 	{
-		// iterate through meshes
-		for (auto it = meshesToReload.begin(); it != meshesToReload.end(); ++it)
+		if (!it->get())
 		{
-			if (!it->get())
-			{
-				continue;
-			}
+			continue;
+		}
 
-			const bool success = it->get()->ReloadMesh(currentSampeIdx);
-			if (success && (currentSampeIdx == 0))
-			{
-				meshesToFreshen.emplace_back() = *it;
-			}
+		RPR_TRACE_ZONE("FireRenderMesh::ReloadMesh");
+		const bool success = it->get()->ReloadMesh(0);
+		if (success)
+		{
+			meshesToFreshen.emplace_back() = *it;
 		}
+	}
 
-		if (++currentSampeIdx >= motionSamplesCount)
-			break;
+	ReadDeformationSamples(meshesToReload);
 
-		// positioning on next point of time (starting from currentTime)
-		currentTime += (float)currentSampeIdx / (motionSamplesCount - 1);
-		MGlobal::viewFrame(currentTime);
-		
-	} while (currentTime != MAnimControl::maxTime());
+	TimePoint translateStartTime = GetCurrentChronoTime();
+	syncProgressData.elapsedSyncGather = TimeDiffChrono<std::chrono::milliseconds>(translateStartTime, syncStartTime);
 
-	MGlobal::viewFrame(initialTime);
+	// translate read data on worker threads (triangulation, indices, hashing); Maya API is not used here
+	std::vector<FireRenderObject*> meshesToTranslate;
+	meshesToTranslate.reserve(meshesToFreshen.size());
+
+	for (const std::shared_ptr<FireRenderObject>& ptr : meshesToFreshen)
+	{
+		if (!ptr)
+			continue;
+
+		// heavy meshes are translated one by one with polygon ranges split between workers,
+		// nested ParallelFor would run serially on a single worker
+		if (ptr->GetPendingPolygonCount() >= FireMaya::MeshTranslator::LargeMeshPolygonCount)
+		{
+			RPR_TRACE_ZONE("FireRenderMesh::PrepareMeshIndices");
+			ptr->PrepareMeshIndices(shouldCalculateHash);
+		}
+		else
+		{
+			meshesToTranslate.push_back(ptr.get());
+		}
+	}
 
-	// process read data (would be done in multiple threads in the future)
+	FireMaya::WorkerPool::Instance().ParallelFor(meshesToTranslate.size(), [&meshesToTranslate, shouldCalculateHash](size_t idx)
+	{
+		RPR_TRACE_ZONE("FireRenderMesh::PrepareMeshIndices");
+		meshesToTranslate[idx]->PrepareMeshIndices(shouldCalculateHash);
+	});
+
+	TimePoint commitStartTime = GetCurrentChronoTime();
+	syncProgressData.elapsedSyncTranslate = TimeDiffChrono<std::chrono::milliseconds>(commitStartTime, translateStartTime);
+
+	// commit translated data into rpr scene; order is the same as objects were read
 	for (auto it = meshesToFreshen.begin(); it != meshesToFreshen.end(); ++it)
 	{
 		FireRenderObject* pMesh = it->get();
@@ -2867,11 +3305,15 @@ bool FireRenderContext::Freshen(bool lock, std::function<bool()> cancelled)
 			continue;
 
 		UpdateTimeAndTriggerProgressCallback(syncProgressData, ProgressType::ObjectPreSync);
-		pMesh->Freshen(shouldCalculateHash);
+		{
+			RPR_TRACE_ZONE("FireRenderMesh::Freshen");
+			pMesh->Freshen(shouldCalculateHash);
+		}
 		syncProgressData.currentIndex++;
 		UpdateTimeAndTriggerProgressCallback(syncProgressData, ProgressType::ObjectSyncComplete);
 	}
 
+	syncProgressData.elapsedSyncCommit = TimeDiffChrono<std::chrono::milliseconds>(GetCurrentChronoTime(), commitStartTime);
 	syncProgressData.elapsedTotal = TimeDiffChrono<std::chrono::milliseconds>(GetCurrentChronoTime(), syncStartTime);
 	UpdateTimeAndTriggerProgressCallback(syncProgressData, ProgressType::SyncComplete);
 
@@ -2894,6 +3336,7 @@ bool FireRenderContext::Freshen(bool lock, std::function<bool()> cancelled)
 	m_inRefresh = false;
 
 	m_needRedraw = true;
+	FireRenderThread::Wake();
 
 	return true;
 }
@@ -2907,6 +3350,9 @@ void FireRenderContext::SetState(StateEnum newState)
 
 	m_state = newState;
 
+	// idle render loops wait for state change
+	FireRenderThread::Wake();
+
 	if (m_state == StateEnum::StateExiting)
 	{
 		ContextWorkProgressData data;
@@ -2978,12 +3424,18 @@ void FireRenderContext::setCameraAttributeChanged(bool value)
 {
 	m_cameraAttributeChanged = value;
 	if (value)
+	{
 		m_restartRender = true;
+		FireRenderThread::Wake();
+	}
 }
 
 void FireRenderContext::setCompletionCriteria(const CompletionCriteriaParams& completionCriteriaParams)
 {
 	m_completionCriteriaParams = completionCriteriaParams;
+
+	// render may have to continue if the limit was raised
+	FireRenderThread::Wake();
 }
 
 const CompletionCriteriaParams& FireRenderContext::getCompletionCriteria(void) const
@@ -3406,10 +3858,21 @@ void FireRenderContext::ForEachFramebuffer(
 	}
 }
 
-std::vector<float> FireRenderContext::DenoiseAndUpscaleForViewport()
+bool FireRenderContext::StartDenoiseJob(bool upscale)
 {
-	bool useRAMBuffer = true;
-	RenderRegion region = RenderRegion(m_width, m_height);
+	RPR_THREAD_ONLY;
+	RPR_TRACE_ZONE("FireRenderContext::StartDenoiseJob");
+
+	{
+		std::lock_guard<std::mutex> lock(m_denoiseMutex);
+		if (m_denoiseBusy)
+			return false;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	// viewport always denoises and upscales the whole frame
+	RenderRegion region = (useRegion() && !upscale) ? m_region : RenderRegion(m_width, m_height);
 
 	ReadFrameBufferRequestParams params(region);
 	params.width = m_width;
@@ -3420,50 +3883,278 @@ std::vector<float> FireRenderContext::DenoiseAndUpscaleForViewport()
 	params.shadowTransp = m_shadowTransparency;
 	params.shadowWeight = m_shadowWeight;
 
-	// read frame buffers
-	if (useRAMBuffer)
+	// filters always read RAM copies here because frame buffers are rendered into while the job runs
+	ReadDenoiserFrameBuffersIntoRAM(params);
+
+	std::shared_ptr<ImageFilter> denoiser;
 	{
-		ReadDenoiserFrameBuffersIntoRAM(params);
+		std::lock_guard<std::mutex> lock(m_rifLock);
+
+		bool isDenoiserInitialized = upscale ? setupDenoiserForViewport() : TryCreateDenoiserImageFilters(true);
+		if (!isDenoiserInitialized || !IsDenoiserCreated())
+			return false;
+
+		denoiser = m_denoiserFilter;
 	}
 
-	std::lock_guard<std::mutex> lock(m_rifLock);
-	bool isDenoiserInitialized = setupDenoiserForViewport(); // will read data from outBuffers if useRAMBuffer == true
-	assert(isDenoiserInitialized);
-	if (!isDenoiserInitialized || !IsDenoiserCreated())
-		return std::vector<float>();
+	// rif objects are created on RPR thread only, denoiser thread just runs them
+	std::shared_ptr<ImageFilter> upscaler;
+	if (upscale)
+	{
+		size_t upscalerInputSize = size_t(m_width) * m_height * 4;
 
-	std::vector<float> vecData;
-	bool denoiseResult = false;
-	vecData = GetDenoisedData(denoiseResult);
-	assert(denoiseResult);
+		if (!m_upscaler || (m_upscalerInput.size() != upscalerInputSize))
+		{
+			m_upscaler.reset();
+			m_upscalerInput.assign(upscalerInputSize, 0.0f);
 
-	// save denoiser result in RAM buffer
-	RV_PIXEL* data = (RV_PIXEL*)vecData.data();
+			try
+			{
+				m_upscaler = CreateViewportUpscaler(context(), (RV_PIXEL*) m_upscalerInput.data(), m_width, m_height, GetModelPath().asChar());
+			}
+			catch (std::exception& e)
+			{
+				ErrorPrint(e.what());
+				return false;
+			}
+		}
 
-#ifdef DUMP_DENOISE_VP_SOURCE
-	PixelBuffer tempPixelBuffer1;
-	tempPixelBuffer1.resize(m_width, m_height);
-	tempPixelBuffer1.overwrite(data, region, params.height, params.width);
-	const std::string pathToFile = "C://debug//fb//";
-	tempPixelBuffer1.debugDump(params.height, params.width, "just_denoised", pathToFile);
-#endif
+		upscaler = m_upscaler;
+	}
 
-	if (useRAMBuffer)
+	// opacity is merged into denoised color on the denoiser thread
+	m_denoiseOpacity.clear();
+	if (!upscale && camera().GetAlphaMask() && isAOVEnabled(RPR_AOV_OPACITY))
 	{
-		setupUpscalerForViewport(data);
+		params.aov = RPR_AOV_COLOR;
+		params.mergeOpacity = true;
+		ReadOpacityAOV(params);
 
-		m_upscalerFilter->Run();
-		vecData = m_upscalerFilter->GetData();
+		m_denoiseOpacity.assign(m_opacityData.get(), m_opacityData.get() + region.getArea());
 	}
 
-#ifdef DUMP_DENOISE_VP_SOURCE
-	PixelBuffer tempPixelBuffer;
-	tempPixelBuffer.resize(m_width, m_height);
-	tempPixelBuffer.overwrite((RV_PIXEL*)vecData.data(), region, params.height, params.width);
-	tempPixelBuffer.debugDump(params.height, params.width, "denoised_and_upscaled", pathToFile);
-#endif
+	// filter inputs stay with the job, next job will fill buffers of the previous one
+	std::swap(m_pixelBuffers, m_denoiseInputs);
 
-	return vecData;
+	unsigned int width = m_width;
+	unsigned int height = m_height;
+
+	s_denoiseSetupTotalUs += MicrosecondsSince(startTime);
+	s_denoiseSubmitted++;
+
+	std::lock_guard<std::mutex> lock(m_denoiseMutex);
+
+	if (!m_denoiseThread.joinable())
+	{
+		m_denoiseExit = false;
+		m_denoiseThread = std::thread(&FireRenderContext::DenoiseThreadProc, this);
+	}
+
+	unsigned int generation = m_denoiseGeneration;
+	m_denoiseBusy = true;
+	m_denoiseTask = [=]()
+	{
+		RunDenoiseJob(denoiser, upscaler, width, height, generation, startTime);
+	};
+
+	m_denoiseCondition.notify_all();
+
+	return true;
+}
+
+bool FireRenderContext::IsDenoiseJobRunning()
+{
+	std::lock_guard<std::mutex> lock(m_denoiseMutex);
+
+	return m_denoiseBusy;
+}
+
+bool FireRenderContext::TakeDenoisedFrame(std::vector<float>& frame)
+{
+	std::lock_guard<std::mutex> lock(m_denoiseMutex);
+
+	if (!m_denoisedFrameReady)
+		return false;
+
+	m_denoisedFrameReady = false;
+
+	// resolution could change while the job was running
+	if ((m_denoisedFrameWidth != m_width) || (m_denoisedFrameHeight != m_height))
+	{
+		s_denoiseDropped++;
+		return false;
+	}
+
+	frame.swap(m_denoisedFrame);
+	s_denoiseCompleted++;
+
+	return true;
+}
+
+void FireRenderContext::CancelDenoiseJob()
+{
+	std::lock_guard<std::mutex> lock(m_denoiseMutex);
+
+	// running filters can't be interrupted, their result is dropped when they finish
+	m_denoiseGeneration++;
+
+	if (m_denoiseTask)
+	{
+		m_denoiseTask = nullptr;
+		m_denoiseBusy = false;
+		s_denoiseDropped++;
+	}
+
+	if (m_denoisedFrameReady)
+	{
+		m_denoisedFrameReady = false;
+		s_denoiseDropped++;
+	}
+}
+
+void FireRenderContext::DenoiseThreadProc()
+{
+	FireMaya::Trace::SetThreadName("Denoiser");
+
+	std::unique_lock<std::mutex> lock(m_denoiseMutex);
+
+	while (true)
+	{
+		m_denoiseCondition.wait(lock, [this]() { return m_denoiseExit || m_denoiseTask; });
+
+		if (m_denoiseExit)
+			break;
+
+		std::function<void()> task = std::move(m_denoiseTask);
+		m_denoiseTask = nullptr;
+
+		lock.unlock();
+		task();
+		lock.lock();
+
+		m_denoiseBusy = false;
+		m_denoiseCondition.notify_all();
+
+		// render loop sleeps while the job is running
+		lock.unlock();
+		FireRenderThread::Wake();
+		lock.lock();
+	}
+}
+
+void FireRenderContext::RunDenoiseJob(std::shared_ptr<ImageFilter> denoiser, std::shared_ptr<ImageFilter> upscaler,
+	unsigned int width, unsigned int height, unsigned int generation, std::chrono::steady_clock::time_point startTime)
+{
+	RPR_TRACE_ZONE("FireRenderContext::RunDenoiseJob");
+
+	std::vector<float> result;
+
+	try
+	{
+		denoiser->Run();
+		result = denoiser->GetData();
+
+		// m_upscalerInput is not touched by render thread while the job is running
+		if (upscaler)
+		{
+			if (result.size() != m_upscalerInput.size())
+			{
+				s_denoiseDropped++;
+				return;
+			}
+
+			std::copy(result.begin(), result.end(), m_upscalerInput.begin());
+
+			upscaler->Run();
+			result = upscaler->GetData();
+		}
+	}
+	catch (std::exception& e)
+	{
+		ErrorPrint(e.what());
+		s_denoiseDropped++;
+		return;
+	}
+
+	// m_denoiseOpacity is not touched by render thread while the job is running
+	if (!m_denoiseOpacity.empty() && (result.size() == 4 * m_denoiseOpacity.size()))
+	{
+		FireMaya::PixelConversion::CopyRGBA(result.data(), reinterpret_cast<const float*>(m_denoiseOpacity.data()), result.data(), m_denoiseOpacity.size());
+	}
+
+	std::lock_guard<std::mutex> lock(m_denoiseMutex);
+
+	if (generation != m_denoiseGeneration)
+	{
+		s_denoiseDropped++;
+		return;
+	}
+
+	// previous result was never taken
+	if (m_denoisedFrameReady)
+		s_denoiseDropped++;
+
+	m_denoisedFrame.swap(result);
+	m_denoisedFrameReady = true;
+	m_denoisedFrameWidth = width;
+	m_denoisedFrameHeight = height;
+
+	unsigned long long latency = MicrosecondsSince(startTime);
+	s_denoiseLatencyTotalUs += latency;
+	s_denoiseLatencyCount++;
+
+	unsigned long long currentMax = s_denoiseLatencyMaxUs;
+	while (latency > currentMax && !s_denoiseLatencyMaxUs.compare_exchange_weak(currentMax, latency))
+	{
+	}
+}
+
+void FireRenderContext::StopDenoiseThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_denoiseMutex);
+
+		m_denoiseExit = true;
+		m_denoiseTask = nullptr;
+		m_denoiseGeneration++;
+		m_denoisedFrameReady = false;
+	}
+
+	m_denoiseCondition.notify_all();
+
+	if (m_denoiseThread.joinable())
+		m_denoiseThread.join();
+
+	m_denoiseBusy = false;
+	m_upscaler.reset();
+}
+
+FireRenderContext::DenoiseStatistics FireRenderContext::GetDenoiseStatistics()
+{
+	DenoiseStatistics stats;
+
+	stats.submitted = s_denoiseSubmitted;
+	stats.completed = s_denoiseCompleted;
+	stats.dropped = s_denoiseDropped;
+
+	stats.averageSetupMs = stats.submitted > 0 ? (s_denoiseSetupTotalUs / 1000.0) / stats.submitted : 0.0;
+
+	unsigned long long latencyCount = s_denoiseLatencyCount;
+	stats.averageLatencyMs = latencyCount > 0 ? (s_denoiseLatencyTotalUs / 1000.0) / latencyCount : 0.0;
+	stats.maxLatencyMs = s_denoiseLatencyMaxUs / 1000.0;
+
+	return stats;
+}
+
+void FireRenderContext::ResetDenoiseStatistics()
+{
+	s_denoiseSubmitted = 0;
+	s_denoiseCompleted = 0;
+	s_denoiseDropped = 0;
+	s_denoiseSetupTotalUs = 0;
+	s_denoiseLatencyTotalUs = 0;
+	s_denoiseLatencyMaxUs = 0;
+	s_denoiseLatencyCount = 0;
 }
 
 bool FireRenderContext::TonemapIntoRAM()
@@ -3520,6 +4211,8 @@ bool FireRenderContext::TonemapIntoRAM()
 
 std::vector<float> FireRenderContext::DenoiseIntoRAM()
 {
+	RPR_TRACE_ZONE("FireRenderContext::DenoiseIntoRAM");
+
 	bool shouldDenoise = IsDenoiserEnabled() &&
 		((m_RenderType == RenderType::ProductionRender) || (m_RenderType == RenderType::IPR));
 
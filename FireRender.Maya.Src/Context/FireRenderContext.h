@@ -22,18 +22,24 @@ limitations under the License.
 #include "FireRenderObjects.h"
 #include <string>
 #include <map>
+#include <set>
+#include <deque>
+#include <unordered_map>
 #include <time.h>
 
 #include "frWrap.h"
 #include "FireMaya.h"
 #include "RenderRegion.h"
 #include "FireRenderAOV.h"
+#include "ImageCache.h"
 
 #include <thread>
+#include <chrono>
 #include <functional>
 
 #include <future>
 #include <functional>
+#include <condition_variable>
 
 #include "FireRenderUtils.h"
 #include "FireRenderContextIFace.h"
@@ -114,6 +120,11 @@ struct ContextWorkProgressData
 	unsigned long long elapsedTotal = 0;
 	unsigned long long elapsedPostRenderTonemap = 0; // for extra data
 
+	// sync phases timings (filled for SyncComplete)
+	unsigned long long elapsedSyncGather = 0; // reading data from Maya (main thread)
+	unsigned long long elapsedSyncTranslate = 0; // building rpr data (worker threads)
+	unsigned long long elapsedSyncCommit = 0; // creating rpr objects (main thread)
+
 	unsigned int GetPercentProgress() const { return (unsigned int)(100 * currentIndex / totalCount); }
 };
 
@@ -311,6 +322,10 @@ public:
 	// reads aov directly into internal storage
 	RV_PIXEL* GetAOVData(const ReadFrameBufferRequestParams& params);
 
+	// reads whole opacity AOV if it should be merged into requested AOV, returns nullptr otherwise
+	const RV_PIXEL* ReadOpacityFrameBuffer(const ReadFrameBufferRequestParams& params);
+
+	// reads opacity AOV region into m_opacityData for CombineOpacity
 	void ReadOpacityAOV(const ReadFrameBufferRequestParams& params);
 
 	void CombineOpacity(int aov, RV_PIXEL* pixels, unsigned int area);
@@ -324,10 +339,11 @@ public:
 	// required, or directly into the supplied pixel buffer.
 	void doOutputFromComposites(const ReadFrameBufferRequestParams& params, size_t dataSize, const frw::FrameBuffer& frameBufferOut);
 
-	// Copy pixels from the source buffer to the destination buffer.
-	void copyPixels(RV_PIXEL* dest, RV_PIXEL* source,
+	// Copy region pixels from the source buffer to the destination buffer.
+	// If alphaSource (same layout as source) is set, its red channel is written to alpha in the same pass.
+	void copyPixels(RV_PIXEL* dest, const RV_PIXEL* source,
 		unsigned int sourceWidth, unsigned int sourceHeight,
-		const RenderRegion& region) const;
+		const RenderRegion& region, const RV_PIXEL* alphaSource = nullptr) const;
 
 	// Combine pixels (set alpha) with Opacity pixels
 	void combineWithOpacity(RV_PIXEL* pixels, unsigned int size, RV_PIXEL *opacityPixels = NULL) const;
@@ -335,7 +351,31 @@ public:
 	// do action for each framebuffer matching filter
 	void ForEachFramebuffer(std::function<void(int aovId)> actionFunc, std::function<bool(int aovId)> filter);
 
-	std::vector<float> DenoiseAndUpscaleForViewport();
+	/* Async denoiser counters, see GetDenoiseStatistics */
+	struct DenoiseStatistics
+	{
+		unsigned long long submitted = 0;
+		unsigned long long completed = 0;	// results taken by IPR or viewport
+		unsigned long long dropped = 0;		// scene changed before result was taken or filter failed
+		double averageSetupMs = 0.0;		// time render thread spent reading AOVs and creating filters
+		double averageLatencyMs = 0.0;		// time from job start till result is ready
+		double maxLatencyMs = 0.0;
+	};
+
+	// Reads denoiser AOVs into RAM and sets up filters on the calling (RPR) thread, filters are run by the context's denoiser thread
+	// so rendering can continue meanwhile. Viewport result is upscaled 2x. Returns false if denoiser is off or previous job is still running
+	bool StartDenoiseJob(bool upscale);
+
+	bool IsDenoiseJobRunning();
+
+	// Swaps finished frame into frame (its storage is reused for the next result); returns false if nothing new is ready
+	bool TakeDenoisedFrame(std::vector<float>& frame);
+
+	// Result of the running job (and not yet taken one) is dropped, should be called when a new render iteration starts
+	void CancelDenoiseJob();
+
+	static DenoiseStatistics GetDenoiseStatistics();
+	static void ResetDenoiseStatistics();
 
 	// try running denoiser; result is saved into RAM buffer in context
 	std::vector<float> DenoiseIntoRAM(void);
@@ -468,6 +508,10 @@ public:
 	void disableSetDirtyObjects(bool disable);
 	void setDirtyObject(FireRenderObject* obj);
 
+	// Marks all scene objects and the camera dirty, used when the scene is read at another time
+	// through DG context (Maya doesn't send dirty notifications then)
+	void setDirtyAllObjects();
+
 	// Check if the context is dirty
 	bool isDirty();
 
@@ -477,6 +521,12 @@ public:
 
 	HashValue GetStateHash();
 
+	// Updates object's part of the state hash, called when object hash is recalculated
+	void UpdateStateHash(const FireRenderObject* object, HashValue hash);
+	void RemoveFromStateHash(const FireRenderObject* object);
+	// Detached objects keep their hash but don't contribute to the state hash until attached again
+	void SetStateHashAttached(const FireRenderObject* object, bool attached);
+
 	// Add a node to the scene.
 	void addNode(const MObject& node);
 
@@ -503,6 +553,11 @@ public:
 	// Return the render region
 	RenderRegion renderRegion();
 
+	// Replaces the render call of every iteration step (e.g. to render regions of the frame with their own cameras),
+	// nullptr restores the default one
+	typedef std::function<void(frw::Context& context)> RenderPassFunc;
+	void setRenderPass(RenderPassFunc renderPass) { m_renderPass = renderPass; }
+
 	// Disable the *creation* of callbacks (recommend refactoring this when looking at callbacks)
 	void setCallbackCreationDisabled(bool value);
 
@@ -608,6 +663,53 @@ public:
 		}
 	}
 
+	// Shapes translated in this context by mesh geometry content key (MeshTranslator::CalculateContentKey).
+	// Meshes with the same geometry are created as instances of the registered shape
+	frw::Shape FindGeometryShape(uint64_t contentKey) const
+	{
+		auto found = m_geometryShapes.find(contentKey);
+
+		if (found != m_geometryShapes.end())
+		{
+			return found->second.shape;
+		}
+
+		return frw::Shape();
+	}
+
+	void AddGeometryShape(uint64_t contentKey, const frw::Shape& shape, const FireRenderMesh* owner)
+	{
+		m_geometryShapes[contentKey] = { shape, owner };
+	}
+
+	bool IsGeometryShapeOwner(const FireRenderMesh* owner) const
+	{
+		for (const auto& it : m_geometryShapes)
+		{
+			if (it.second.owner == owner)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void RemoveGeometryShapes(const FireRenderMesh* owner)
+	{
+		for (auto it = m_geometryShapes.begin(); it != m_geometryShapes.end();)
+		{
+			if (it->second.owner == owner)
+			{
+				it = m_geometryShapes.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
 	bool GetNodePath(MDagPath& outPath, const std::string& uuid) const
 	{
 		auto it = m_nodePathCache.find(uuid);
@@ -706,7 +808,6 @@ public:
   
 	const FireRenderGlobalsData& Globals(void) const { return m_globals; }
 
-	bool setupUpscalerForViewport(RV_PIXEL* data);
 	bool setupDenoiserForViewport();
 
 	// used for toon shader light linking
@@ -736,6 +837,9 @@ protected:
 
 	void ReadDenoiserFrameBuffersIntoRAM(ReadFrameBufferRequestParams& params);
 
+	// Waits for the running denoiser job, derived contexts call it from their destructors before their members are destroyed
+	void StopDenoiseThread();
+
 private:
 	struct CallbacksAttachmentHelper
 	{
@@ -763,17 +867,59 @@ private:
 
 	void setupDenoiserFB(void);
 	void setupDenoiserRAM(void);
+
+	// runs on denoiser thread
+	void DenoiseThreadProc();
+	void RunDenoiseJob(std::shared_ptr<ImageFilter> denoiser, std::shared_ptr<ImageFilter> upscaler,
+		unsigned int width, unsigned int height, unsigned int generation, std::chrono::steady_clock::time_point startTime);
 	void BuildLateinitObjects();
 
+	// Reads deformation motion blur samples of meshes reloaded by Freshen, all meshes per sample time through DG context
+	void ReadDeformationSamples(const std::deque<std::shared_ptr<FireRenderObject>>& meshes);
+
+	// Collects file textures used by the shading networks and starts decoding them on the worker pool
+	FireMaya::ImageCache::PrefetchTasks PrefetchTextures();
+
 private:
 	std::mutex m_rifLock;
 	std::shared_ptr<ImageFilter> m_denoiserFilter;
-	std::shared_ptr<ImageFilter> m_upscalerFilter;
+
+	// Async denoiser, only one job is in flight. Job inputs are swapped with m_pixelBuffers when it starts,
+	// so both sets of buffers are kept allocated. Result waits in m_denoisedFrame until taken
+	std::thread m_denoiseThread;
+	std::mutex m_denoiseMutex;
+	std::condition_variable m_denoiseCondition;
+	std::function<void()> m_denoiseTask;
+	bool m_denoiseBusy;
+	bool m_denoiseExit;
+	unsigned int m_denoiseGeneration;
+	AOVPixelBuffers m_denoiseInputs;
+	std::vector<RV_PIXEL> m_denoiseOpacity;
+	// viewport upscaler is created on RPR thread and recreated on resize, job copies denoised frame into its input
+	std::shared_ptr<ImageFilter> m_upscaler;
+	std::vector<float> m_upscalerInput;
+	std::vector<float> m_denoisedFrame;
+	bool m_denoisedFrameReady;
+	unsigned int m_denoisedFrameWidth;
+	unsigned int m_denoisedFrameHeight;
 
 	frw::DirectionalLight m_defaultLight;
 
 	std::atomic<StateEnum> m_state;
 
+	// Object hashes combined into GetStateHash. Declared before objects
+	// because they remove themselves from it on destruction
+	std::mutex m_stateHashMutex;
+	struct StateHashPart
+	{
+		uint64_t value = 0;
+		bool attached = true;
+	};
+	std::unordered_map<const FireRenderObject*, StateHashPart> m_stateHashParts;
+	uint64_t m_stateHashSum = 0;
+	// render globals are part of the state too, updated when globals are read
+	HashValue m_globalsHash;
+
 	// Render camera
 	FireRenderCamera m_camera;
 
@@ -846,6 +992,9 @@ private:
 	/** True if globals have changed since the last refresh. */
 	bool m_globalsChanged;
 
+	/** Globals attributes changed since the last refresh, only these are read and applied. Guarded by m_dirtyMutex. */
+	std::set<std::string> m_changedGlobals;
+
 	/** Signals if tone-mapping options have changed */
 	bool m_tonemappingChanged;
 
@@ -875,6 +1024,15 @@ private:
 	/** map corresponds shape in Maya with main FireRenderMesh (used for instancing) **/
 	std::map<std::string, FireRenderMeshCommon*> m_mainMeshesDictionary;
 
+	struct GeometryShape
+	{
+		frw::Shape shape;
+		const FireRenderMesh* owner; // mesh which has translated the shape
+	};
+
+	/** map corresponds geometry content key with shape translated for it (used for instancing of duplicated meshes) **/
+	std::unordered_map<uint64_t, GeometryShape> m_geometryShapes;
+
 	/** map corresponding dag path of the node with the mode **/
 	std::map<std::string, MDagPath> m_nodePathCache;
 
@@ -946,6 +1104,9 @@ public:
 	// Use region flag
 	bool m_useRegion;
 
+	// Custom render call of iteration step
+	RenderPassFunc m_renderPass;
+
 	// Callbacks disabled flag
 	bool m_callbackCreationDisabled = false;
 
@@ -27,6 +27,11 @@ HybridContext::HybridContext()
 
 }
 
+HybridContext::~HybridContext()
+{
+	StopDenoiseThread();
+}
+
 rpr_int HybridContext::GetPluginID()
 {
 	if (m_gHybridPluginID == INCORRECT_PLUGIN_ID)
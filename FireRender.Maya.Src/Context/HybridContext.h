@@ -18,6 +18,7 @@ class HybridContext : public FireRenderContext
 {
 public:
 	HybridContext();
+	~HybridContext() override;
 
 	static rpr_int GetPluginID();
 	void setupContextPostSceneCreation(const FireRenderGlobalsData& fireRenderGlobalsData, bool disableWhiteBalance = false) override;
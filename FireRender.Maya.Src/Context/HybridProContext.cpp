@@ -28,6 +28,11 @@ HybridProContext::HybridProContext()
 
 }
 
+HybridProContext::~HybridProContext()
+{
+	StopDenoiseThread();
+}
+
 rpr_int HybridProContext::GetPluginID()
 {
 	if (m_gHybridProPluginID == INCORRECT_PLUGIN_ID)
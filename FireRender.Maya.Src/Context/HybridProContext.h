@@ -18,6 +18,7 @@ class HybridProContext : public HybridContext
 {
 public:
     HybridProContext();
+    ~HybridProContext() override;
 
     static rpr_int GetPluginID();
 
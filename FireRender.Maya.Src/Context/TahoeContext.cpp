@@ -27,6 +27,11 @@ NorthStarContext::NorthStarContext() :
 
 }
 
+NorthStarContext::~NorthStarContext()
+{
+	StopDenoiseThread();
+}
+
 rpr_int NorthStarContext::GetPluginID()
 {
 	if (m_gTahoePluginID == INCORRECT_PLUGIN_ID)
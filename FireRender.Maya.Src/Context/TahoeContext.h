@@ -20,6 +20,7 @@ class NorthStarContext : public FireRenderContext
 {
 public:
 	NorthStarContext();
+	~NorthStarContext() override;
 
 	static rpr_int GetPluginID();
 	static bool IsGivenContextNorthStar(const FireRenderContext* pContext);
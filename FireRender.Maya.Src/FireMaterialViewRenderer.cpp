@@ -82,6 +82,7 @@ bool FireMaterialViewRenderer::RunOnFireRenderThread()
 		case ThreadCommand::BEGIN_UPDATE:
 
 		default:
+			FireRenderThread::ReportIdle();
 			return true;
 	}
 }
@@ -122,6 +123,7 @@ MStatus FireMaterialViewRenderer::startAsync(const JobParams& params)
 MStatus FireMaterialViewRenderer::stopAsync()
 {
 	m_threadCmd = ThreadCommand::STOP_THREAD;
+	FireRenderThread::Wake();
 
 	RPR::AutoMutexLock lock(m_renderDataPtr->m_mutex);
 
@@ -542,6 +544,8 @@ MStatus FireMaterialViewRenderer::endSceneUpdate()
 
 		m_renderDataPtr->m_mutex.unlock();
 
+		FireRenderThread::Wake();
+
 		return MS::kSuccess;
 	});
 }
@@ -13,6 +13,10 @@ limitations under the License.
 #include "FireMaya.h"
 #include "common.h"
 #include "FireRenderThread.h"
+#include "ImageCache.h"
+#include "ParallelUtils.h"
+#include "PixelConversion.h"
+#include "Tracing.h"
 #include "VRay.h"
 #include "Context/FireRenderContext.h"
 #include "MayaStandardNodesSupport/NodeConverterUtil.h"
@@ -28,6 +32,7 @@ limitations under the License.
 #include <maya/MImageFileInfo.h>
 #include <FireRenderLayeredTextureUtils.h>
 #include <exception>
+#include <chrono>
 
 #ifdef MAYA2017
 #include "maya/MColorManagementUtilities.h"
@@ -751,6 +756,11 @@ std::vector<unsigned char> calculateTileImage(
 	return dummy;
 }
 
+frw::Image FireMaya::Scope::CreateImageFromData(const ImageData& imageData) const
+{
+	return frw::Image(m->context, imageData.format, imageData.desc, imageData.pixels.data());
+}
+
 frw::Image FireMaya::Scope::GetTiledImage(MString texturePath,
 	int viewWidth, int viewHeight,
 	int maxTileWidth, int maxTileHeight,
@@ -782,11 +792,38 @@ frw::Image FireMaya::Scope::GetTiledImage(MString texturePath,
 		return it->second;
 	}
 
+	// tile could be already generated for another context
+	char tileParams[256] = {};
+	snprintf(tileParams, 256, "tile-%d-%d-%d-%d-%d-%d-%d-%d-%d-%d-%d",
+		viewWidth, viewHeight,
+		maxTileWidth, maxTileHeight,
+		currTileWidth, currTileHeight,
+		countXTiles, countYTiles,
+		xTileIdx, yTileIdx, int(imgFit));
+
+	std::string sharedKey = ImageCache::MakeKey(texturePath.asUTF8(), colorSpace.asUTF8(), tileParams);
+
+	if (ImageDataPtr imageData = ImageCache::Instance().Find(sharedKey))
+	{
+		frw::Image image = CreateImageFromData(*imageData);
+
+		if (image)
+		{
+			image.SetName(key);
+			rprImageSetWrap(image.Handle(), RPR_IMAGE_WRAP_TYPE_MIRRORED_REPEAT);
+			m->imageCache[key] = image;
+		}
+
+		return image;
+	}
+
 	// not cached => generate new
 	frw::Image retImage = FireRenderThread::RunOnMainThread<frw::Image>([&]()
 	{
 		MAIN_THREAD_ONLY; // MTextureManager will not work in other threads
 
+		auto loadStart = std::chrono::steady_clock::now();
+
 		frw::Image image;
 
 		// back-offs
@@ -867,6 +904,17 @@ frw::Image FireMaya::Scope::GetTiledImage(MString texturePath,
 
 		texture->freeRawData(rawData);
 
+		if (image)
+		{
+			auto imageData = std::make_shared<ImageData>();
+			imageData->format = format;
+			imageData->desc = img_desc;
+			imageData->pixels = std::move(buffer);
+
+			double loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+			ImageCache::Instance().Insert(sharedKey, imageData, loadTimeMs);
+		}
+
 		return image;
 	});
 
@@ -884,18 +932,37 @@ frw::Image FireMaya::Scope::GetImage(MString texturePath, MString colorSpace, co
 		return NULL;
 	}
 
+	RPR_TRACE_ZONE_DETAIL("Scope::GetImage", texturePath.asUTF8());
+
 	std::string key = (texturePath + ":" + colorSpace).asUTF8();
 
 	auto it = m->imageCache.find(key);
 	if (it != m->imageCache.end())
 		return it->second;
 
-	frw::Image retImage = FireRenderThread::RunOnMainThread<frw::Image>([this, texturePath, key, colorSpace, ownerNodeName]() -> frw::Image
+	// image could be already decoded for another context
+	std::string processedTexturePath = ProcessEnvVarsInFilePath<std::string, char>(texturePath.asChar());
+	std::string sharedKey = ImageCache::MakeKey(processedTexturePath, colorSpace.asUTF8());
+
+	if (ImageDataPtr imageData = ImageCache::Instance().Find(sharedKey))
+	{
+		frw::Image image = CreateImageFromData(*imageData);
+
+		if (image)
+		{
+			m->imageCache[key] = image;
+			image.SetName(texturePath.asUTF8());
+		}
+
+		return image;
+	}
+
+	frw::Image retImage = FireRenderThread::RunOnMainThread<frw::Image>([this, texturePath, key, sharedKey, processedTexturePath, colorSpace, ownerNodeName]() -> frw::Image
 	{
 		MAIN_THREAD_ONLY; // MTextureManager will not work in other threads
 		DebugPrint("Loading Image: %s in colorSpace: %s", texturePath.asUTF8(), colorSpace.asUTF8());
 
-		std::string processedTexturePath = ProcessEnvVarsInFilePath<std::string, char>(texturePath.asChar());
+		auto loadStart = std::chrono::steady_clock::now();
 
 		frw::Image image;
 
@@ -910,6 +977,15 @@ frw::Image FireMaya::Scope::GetImage(MString texturePath, MString colorSpace, co
 		{
 			m->imageCache[key] = image;
 
+			// share decoded pixels with other contexts, images the cache would reject are not read back
+			auto imageData = std::make_shared<ImageData>();
+			if (ImageCache::Instance().CanStore(image.GetDataSize()) &&
+				image.GetPixels(imageData->format, imageData->desc, imageData->pixels))
+			{
+				double loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+				ImageCache::Instance().Insert(sharedKey, imageData, loadTimeMs);
+			}
+
 			// recent RPR API is friendly with UTF-8.
 			// RPRS and GLTF lib use RPR Object Name (set with rprObjectSetName) to get image file path for quick export. They support this path as UTF-8.
 			image.SetName(texturePath.asUTF8());
@@ -924,6 +1000,8 @@ frw::Image FireMaya::Scope::GetImage(MString texturePath, MString colorSpace, co
 
 frw::Image FireMaya::Scope::LoadImageUsingMTexture(MString texturePath, MString colorSpace, const MString& ownerNodeName) const
 {
+	RPR_TRACE_ZONE("Scope::LoadImageUsingMTexture");
+
 	frw::Image img;
 
 	if (auto renderer = MHWRender::MRenderer::theRenderer())
@@ -1001,27 +1079,9 @@ frw::Image FireMaya::Scope::CreateImageInternal(MString colorSpace,
 												unsigned int rowPitch,
 												bool flipY) const
 {
-	int srcRowPitch = rowPitch;// desc.fBytesPerRow;
-
-	std::vector<float> tempBuffer;
-	if (componentSize == 2)	// we don't support half size floats at the moment!
-	{
-		tempBuffer.resize(width * height * channels);
-		for (auto y = 0u; y < height; y++)
-		{
-			auto src = static_cast<const unsigned short*>(srcData) + y * rowPitch / sizeof(unsigned short);
-			auto dst = tempBuffer.data() + y * (width * channels);
-			for (auto x = 0u; x < width * channels; x++)
-			{
-				dst[x] = src[x];
-			}
-		}
-
-		componentSize = 4;
-		srcData = tempBuffer.data();
-		srcRowPitch = width * channels * componentSize;
-	}
+	size_t srcRowPitch = rowPitch;// desc.fBytesPerRow;
 
+	// half float textures are kept as they are, rpr supports them natively
 	rpr_image_format format = {};
 	format.num_components = channels >= 3 ? 3 : 1;
 	format.type =
@@ -1029,35 +1089,41 @@ frw::Image FireMaya::Scope::CreateImageInternal(MString colorSpace,
 		(componentSize == 2) ? RPR_COMPONENT_TYPE_FLOAT16 :
 		RPR_COMPONENT_TYPE_UINT8;
 
-	int srcPixSize = componentSize * channels;
-	int dstPixSize = componentSize * format.num_components;
+	size_t srcPixSize = componentSize * channels;
+	size_t dstPixSize = componentSize * format.num_components;
 
 	rpr_image_desc img_desc = {};
 	img_desc.image_width = width;
 	img_desc.image_height = height;
-	img_desc.image_row_pitch = width * dstPixSize;
+	img_desc.image_row_pitch = rpr_uint(width * dstPixSize);
 
 	std::vector<unsigned char> buffer(height * img_desc.image_row_pitch);
 
-	for (unsigned int y = 0; y < height; y++)
+	// rows are repacked independently, flipping only changes destination row
+	WorkerPool::Instance().ParallelForRange(height, 64, [&](size_t begin, size_t end)
 	{
-		auto src = static_cast<const char*>(srcData) + y * srcRowPitch;
-		unsigned char* dst = nullptr;
-		
-		if (!flipY)
-		{
-			dst = buffer.data() + y * img_desc.image_row_pitch;
-		}
-		else
+		for (size_t y = begin; y < end; y++)
 		{
-			dst = buffer.data() + (height - y - 1) * img_desc.image_row_pitch;
-		}
+			auto src = static_cast<const unsigned char*>(srcData) + y * srcRowPitch;
+			unsigned char* dst = buffer.data() + (flipY ? height - y - 1 : y) * img_desc.image_row_pitch;
 
-		for (unsigned int x = 0; x < width; x++)
-		{
-			memcpy(dst + x * dstPixSize, src + x * srcPixSize, dstPixSize);
+			if (channels == 4 && format.num_components == 3)
+			{
+				PixelConversion::DropAlpha(src, dst, width, componentSize);
+			}
+			else if (srcPixSize == dstPixSize)
+			{
+				memcpy(dst, src, width * dstPixSize);
+			}
+			else
+			{
+				for (unsigned int x = 0; x < width; x++)
+				{
+					memcpy(dst + x * dstPixSize, src + x * srcPixSize, dstPixSize);
+				}
+			}
 		}
-	}
+	});
 
 	convertColorSpace(colorSpace, format, img_desc, buffer);
 	return frw::Image(m->context, format, img_desc, buffer.data());
@@ -1092,10 +1158,25 @@ frw::Image FireMaya::Scope::GetAdjustedImage(MString texturePath,
 		return it->second;
 	}
 
+	// adjusted image could be already generated for another context, the same parameters string is used as the key
+	std::string sharedKey = ImageCache::MakeKey(texturePath.asUTF8(), colorSpace.asUTF8(), key);
+
+	if (ImageDataPtr imageData = ImageCache::Instance().Find(sharedKey))
+	{
+		frw::Image image = CreateImageFromData(*imageData);
+
+		if (image)
+			m->imageCache[key] = image;
+
+		return image;
+	}
+
 	return FireRenderThread::RunOnMainThread<frw::Image>([&]()
 	{
 		MAIN_THREAD_ONLY; // MTextureManager will not work in other threads
 
+		auto loadStart = std::chrono::steady_clock::now();
+
 		frw::Image image;
 		if (auto renderer = MHWRender::MRenderer::theRenderer())
 		{
@@ -1284,6 +1365,17 @@ frw::Image FireMaya::Scope::GetAdjustedImage(MString texturePath,
 						convertColorSpace(colorSpace, format, img_desc, buffer);
 
 						image = frw::Image(m->context, format, img_desc, buffer.data());
+
+						if (image)
+						{
+							auto imageData = std::make_shared<ImageData>();
+							imageData->format = format;
+							imageData->desc = img_desc;
+							imageData->pixels = std::move(buffer);
+
+							double loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+							ImageCache::Instance().Insert(sharedKey, imageData, loadTimeMs);
+						}
 #ifndef MAYA2015
 						texture->freeRawData(rawData);
 #else
@@ -28,6 +28,7 @@ class FireRenderMeshCommon;
 namespace FireMaya
 {
 	class Scope;
+	struct ImageData;
 
 	typedef std::string NodeId;
 
@@ -280,6 +281,7 @@ namespace FireMaya
 			bool flipY = false) const;
 
 		frw::Image LoadImageUsingMTexture(MString texturePath, MString colorSpace, const MString& ownerNodeName) const;
+		frw::Image CreateImageFromData(const ImageData& imageData) const;
 
 	public:
 		Scope();
@@ -16,6 +16,7 @@ limitations under the License.
 #include "Context/FireRenderContext.h"
 #include "FireRenderImageUtil.h"
 #include "RenderStamp.h"
+#include "Tracing.h"
 
 #include "RenderViewUpdater.h"
 
@@ -238,6 +239,8 @@ void FireRenderAOV::readFrameBuffer(FireRenderContext& context)
 	if (!active || !pixels || m_region.isZeroArea() || !context.IsAOVSupported(id))
 		return;
 
+	RPR_TRACE_ZONE_DETAIL("FireRenderAOV::readFrameBuffer", name.asUTF8());
+
 	// It special aov, skip it here
 	if (id == RPR_AOV_DEEP_COLOR)
 	{
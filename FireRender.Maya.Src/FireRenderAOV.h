@@ -15,6 +15,7 @@ limitations under the License.
 #include "RenderRegion.h"
 #include "RenderStamp.h"
 #include <memory>
+#include <utility>
 
 // Maya 2015 has min/max defined, what prevents imageio.h from being compiled
 #undef min
@@ -90,6 +91,14 @@ public:
 
 	void resize(size_t newCount);
 
+	void swap(PixelBuffer& other)
+	{
+		std::swap(m_pBuffer, other.m_pBuffer);
+		std::swap(m_size, other.m_size);
+		std::swap(m_width, other.m_width);
+		std::swap(m_height, other.m_height);
+	}
+
 	void resize(size_t width, size_t height)
 	{
 		m_width = width;
@@ -19,13 +19,15 @@ limitations under the License.
 #include "FireMaya.h"
 
 #include <maya/MStatus.h>
+#include <maya/MGlobal.h>
 #include <maya/MFnEnumAttribute.h>
 #include <wchar.h>
 
 // Life Cycle
 // -----------------------------------------------------------------------------
 FireRenderAOVs::FireRenderAOVs() :
-	m_renderViewAOVId(RPR_AOV_COLOR)
+	m_renderViewAOVId(RPR_AOV_COLOR),
+	m_pendingWriteCallback(nullptr)
 {
 	// Initialize and add AOV types.
 	AddAOV(RPR_AOV_COLOR, "aovColor", "Color", "color", 
@@ -392,7 +394,8 @@ void FireRenderAOVs::readFrameBuffers(FireRenderContext& context)
 }
 
 // -----------------------------------------------------------------------------
-void FireRenderAOVs::writeToFile(FireRenderContext& context, const MString& filePath, unsigned int imageFormat, FireRenderAOV::FileWrittenCallback fileWrittenCallback)
+void FireRenderAOVs::writeToFile(FireRenderContext& context, const MString& filePath, unsigned int imageFormat,
+	FireRenderAOV::FileWrittenCallback fileWrittenCallback, bool asyncMultichannel)
 {
 	// Check if only the color AOV is active.
 	const bool colorOnly = getActiveAOVCount() == 1;
@@ -407,7 +410,20 @@ void FireRenderAOVs::writeToFile(FireRenderContext& context, const MString& file
 		deepEXRAov->SaveDeepExrFrameBuffer(context, path.asChar());
 	}
 
-	if ((extension == "exr") && (FireRenderGlobalsData::isExrMultichannelEnabled()) )
+	if ((extension == "exr") && (FireRenderGlobalsData::isExrMultichannelEnabled()) && asyncMultichannel)
+	{
+		// only one frame is written at a time, so there is at most one extra set of AOV buffers
+		waitForPendingWrite();
+
+		m_pendingWrite = FireRenderImageUtil::saveMultichannelAOVsAsync(filePath,
+			m_region.getWidth(), m_region.getHeight(), imageFormat, *this);
+		m_pendingWritePath = filePath;
+		m_pendingWriteCallback = fileWrittenCallback;
+
+		// buffers were moved to the writer
+		allocatePixels();
+	}
+	else if ((extension == "exr") && (FireRenderGlobalsData::isExrMultichannelEnabled()) )
 	{
 		if (FireRenderImageUtil::saveMultichannelAOVs(filePath,
 			m_region.getWidth(), m_region.getHeight(), imageFormat, *this))
@@ -429,6 +445,35 @@ void FireRenderAOVs::writeToFile(FireRenderContext& context, const MString& file
 	}
 }
 
+// -----------------------------------------------------------------------------
+void FireRenderAOVs::waitForPendingWrite()
+{
+	if (!m_pendingWrite.valid())
+		return;
+
+	// called from error handlers too, so the writer exception is reported here and not rethrown
+	bool written;
+	try
+	{
+		written = m_pendingWrite.get();
+	}
+	catch (...)
+	{
+		written = false;
+	}
+
+	if (!written)
+	{
+		MGlobal::displayError("Unable to save " + m_pendingWritePath);
+	}
+	else if (m_pendingWriteCallback != nullptr)
+	{
+		m_pendingWriteCallback(m_pendingWritePath);
+	}
+
+	m_pendingWriteCallback = nullptr;
+}
+
 int FireRenderAOVs::getNumberOfAOVs() 
 {
 	return (int)m_aovs.size();
@@ -16,6 +16,7 @@ limitations under the License.
 #include "FireRenderAOV.h"
 #include <maya/MFnDependencyNode.h>
 #include <functional>
+#include <future>
 
 using namespace OIIO;
 
@@ -78,8 +79,14 @@ public:
 	/** Read the frame buffer pixels for all active AOVs. */
 	void readFrameBuffers(FireRenderContext& context);
 
-	/** Write the active AOVs to file. */
-	void writeToFile(FireRenderContext& context, const MString& filePath, unsigned int imageFormat, FireRenderAOV::FileWrittenCallback fileWrittenCallback = nullptr);
+	/** Write the active AOVs to file.
+		With asyncMultichannel a multichannel EXR is written on a background thread while the next frame renders,
+		the previous pending write is finished first. */
+	void writeToFile(FireRenderContext& context, const MString& filePath, unsigned int imageFormat,
+		FireRenderAOV::FileWrittenCallback fileWrittenCallback = nullptr, bool asyncMultichannel = false);
+
+	/** Wait for the asynchronous multichannel write started by writeToFile. Doesn't throw, failed write is reported as an error. */
+	void waitForPendingWrite();
 
 	/** Setup render stamp */
 	void setRenderStamp(const MString& renderStamp);
@@ -122,4 +129,9 @@ private:
 	std::map<int, MString> m_exrCompressionTypesMap;
 	MString m_exrCompressionType;
 	TypeDesc::BASETYPE m_channelFormat;
+
+	/** Multichannel file being written in background. */
+	std::future<bool> m_pendingWrite;
+	MString m_pendingWritePath;
+	FireRenderAOV::FileWrittenCallback m_pendingWriteCallback;
 };
@@ -44,6 +44,10 @@ limitations under the License.
 #include "RenderProgressBars.h"
 #include "RenderRegion.h"
 #include "FireRenderThread.h"
+#include "ImageCache.h"
+#include "Translators/MeshCache.h"
+#include "Translators/MotionSampleCache.h"
+#include "Tracing.h"
 #include "RenderStampUtils.h"
 #include "FireRenderImageUtil.h"
 
@@ -96,6 +100,21 @@ MSyntax FireRenderCmd::newSyntax()
 	CHECK_MSTATUS(syntax.addFlag(kWaitForIt, kWaitForItLong, MSyntax::kNoArg));
 	CHECK_MSTATUS(syntax.addFlag(kWaitForItTwoStep, kWaitForItTwoStepLong, MSyntax::kNoArg));
 	CHECK_MSTATUS(syntax.addFlag(kExportsGLTF, kExportsGLTFLong, MSyntax::kBoolean));
+	CHECK_MSTATUS(syntax.addFlag(kThreadStatsFlag, kThreadStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kResetThreadStatsFlag, kResetThreadStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kImageCacheStatsFlag, kImageCacheStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kImageCacheBudgetFlag, kImageCacheBudgetFlagLong, MSyntax::kLong));
+	CHECK_MSTATUS(syntax.addFlag(kClearImageCacheFlag, kClearImageCacheFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kMeshCacheStatsFlag, kMeshCacheStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kClearMeshCacheFlag, kClearMeshCacheFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kProfileTraceFlag, kProfileTraceFlagLong, MSyntax::kBoolean));
+	CHECK_MSTATUS(syntax.addFlag(kSaveProfileTraceFlag, kSaveProfileTraceFlagLong, MSyntax::kString));
+	CHECK_MSTATUS(syntax.addFlag(kProfileTraceStatsFlag, kProfileTraceStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kDenoiseStatsFlag, kDenoiseStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kResetDenoiseStatsFlag, kResetDenoiseStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kRenderViewRefreshRateFlag, kRenderViewRefreshRateFlagLong, MSyntax::kDouble));
+	CHECK_MSTATUS(syntax.addFlag(kMotionSampleStatsFlag, kMotionSampleStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kClearMotionSampleCacheFlag, kClearMotionSampleCacheFlagLong, MSyntax::kNoArg));
 
 	return syntax;
 }
@@ -115,6 +134,42 @@ MStatus FireRenderCmd::doIt(const MArgList & args)
 	{
 		return exportsGLTF(argData);
 	}
+	else if (argData.isFlagSet(kThreadStatsFlag) || argData.isFlagSet(kResetThreadStatsFlag))
+	{
+		return queryThreadStatistics(argData);
+	}
+	else if (argData.isFlagSet(kImageCacheStatsFlag) || argData.isFlagSet(kImageCacheBudgetFlag) || argData.isFlagSet(kClearImageCacheFlag))
+	{
+		return imageCache(argData);
+	}
+	else if (argData.isFlagSet(kMeshCacheStatsFlag) || argData.isFlagSet(kClearMeshCacheFlag))
+	{
+		return meshCache(argData);
+	}
+	else if (argData.isFlagSet(kMotionSampleStatsFlag) || argData.isFlagSet(kClearMotionSampleCacheFlag))
+	{
+		return motionSampleCache(argData);
+	}
+	else if (argData.isFlagSet(kProfileTraceFlag) || argData.isFlagSet(kSaveProfileTraceFlag) || argData.isFlagSet(kProfileTraceStatsFlag))
+	{
+		return profileTrace(argData);
+	}
+	else if (argData.isFlagSet(kDenoiseStatsFlag) || argData.isFlagSet(kResetDenoiseStatsFlag))
+	{
+		return queryDenoiseStatistics(argData);
+	}
+	else if (argData.isFlagSet(kRenderViewRefreshRateFlag))
+	{
+		// maximum IPR render view updates per second, 0 - update on every timer tick
+		double updatesPerSecond = 0.0;
+		MStatus status = argData.getFlagArgument(kRenderViewRefreshRateFlag, 0, updatesPerSecond);
+		if (status == MS::kSuccess)
+		{
+			FireRenderIpr::setMaxRefreshRate(updatesPerSecond);
+		}
+
+		return status;
+	}
 	else if (argData.isFlagSet(kOpenFolder))
 	{
 		MString path;
@@ -564,14 +619,17 @@ MStatus FireRenderCmd::renderBatch(const MArgDatabase& args)
 					context.ProcessDenoise(aovs.getRenderViewAOV(), *pColorAOV, context.m_width, context.m_height, region, [this](RV_PIXEL* data) {});
 				}
 
-				// Save the frame to file.
-				aovs.writeToFile(context, filePath, settings.imageFormat);
+				// Save the frame to file. Multichannel EXR is compressed while the next frame renders,
+				// unless there is a post frame command which may expect the file to be written.
+				aovs.writeToFile(context, filePath, settings.imageFormat, nullptr, settings.postRenderMel.length() == 0);
 
 				// Execute the post frame command if there is one.
 				MGlobal::executeCommand(settings.postRenderMel);
 			}
 		}
 
+		aovs.waitForPendingWrite();
+
 		MGlobal::displayInfo(MString(devicesStr.c_str()));
 
 		// Perform clean up operations.
@@ -579,6 +637,8 @@ MStatus FireRenderCmd::renderBatch(const MArgDatabase& args)
 	}
 	catch (...)
 	{
+		aovs.waitForPendingWrite();
+
 		// Perform clean up operations.
 		context.cleanScene();
 
@@ -629,6 +689,213 @@ MStatus FireRenderCmd::exportsGLTF(const MArgDatabase& argData)
 	return status;
 }
 
+// -----------------------------------------------------------------------------
+MStatus FireRenderCmd::queryThreadStatistics(const MArgDatabase& argData)
+{
+	if (argData.isFlagSet(kResetThreadStatsFlag))
+	{
+		FireRenderThread::ResetStatistics();
+		return MS::kSuccess;
+	}
+
+	FireRenderThread::Statistics stats = FireRenderThread::GetStatistics();
+
+	clearResult();
+	appendToResult(MString(string_format("queueDepth=%zu", stats.queueDepth).c_str()));
+	appendToResult(MString(string_format("keepRunningCount=%zu", stats.keepRunningCount).c_str()));
+	appendToResult(MString(string_format("mainThreadQueueDepth=%zu", stats.mainThreadQueueDepth).c_str()));
+	appendToResult(MString(string_format("itemsExecuted=%llu", stats.itemsExecuted).c_str()));
+	appendToResult(MString(string_format("mainThreadItemsExecuted=%llu", stats.mainThreadItemsExecuted).c_str()));
+	appendToResult(MString(string_format("averageWaitLatencyMs=%.3f", stats.averageWaitLatencyMs).c_str()));
+	appendToResult(MString(string_format("maxWaitLatencyMs=%.3f", stats.maxWaitLatencyMs).c_str()));
+	appendToResult(MString(string_format("mainThreadWaitTimeMs=%.3f", stats.mainThreadWaitTimeMs).c_str()));
+
+	return MS::kSuccess;
+}
+
+// -----------------------------------------------------------------------------
+MStatus FireRenderCmd::imageCache(const MArgDatabase& argData)
+{
+	FireMaya::ImageCache& cache = FireMaya::ImageCache::Instance();
+
+	if (argData.isFlagSet(kClearImageCacheFlag))
+	{
+		cache.Clear();
+	}
+
+	if (argData.isFlagSet(kImageCacheBudgetFlag))
+	{
+		// budget is specified in megabytes
+		int budgetMB = 0;
+		argData.getFlagArgument(kImageCacheBudgetFlag, 0, budgetMB);
+
+		cache.SetByteBudget(size_t(budgetMB > 0 ? budgetMB : 0) * 1024 * 1024);
+	}
+
+	if (argData.isFlagSet(kImageCacheStatsFlag))
+	{
+		FireMaya::ImageCache::Statistics stats = cache.GetStatistics();
+
+		unsigned long long requests = stats.hits + stats.misses;
+		double hitRate = requests > 0 ? double(stats.hits) / double(requests) : 0.0;
+
+		clearResult();
+		appendToResult(MString(string_format("entries=%zu", stats.entryCount).c_str()));
+		appendToResult(MString(string_format("residentMB=%.1f", stats.byteSize / (1024.0 * 1024.0)).c_str()));
+		appendToResult(MString(string_format("budgetMB=%.1f", stats.byteBudget / (1024.0 * 1024.0)).c_str()));
+		appendToResult(MString(string_format("pinnedMB=%.1f", stats.pinnedByteSize / (1024.0 * 1024.0)).c_str()));
+		appendToResult(MString(string_format("hits=%llu", stats.hits).c_str()));
+		appendToResult(MString(string_format("misses=%llu", stats.misses).c_str()));
+		appendToResult(MString(string_format("hitRate=%.3f", hitRate).c_str()));
+		appendToResult(MString(string_format("evictions=%llu", stats.evictions).c_str()));
+		appendToResult(MString(string_format("loadTimeMs=%.1f", stats.loadTimeMs).c_str()));
+		appendToResult(MString(string_format("prefetched=%llu", stats.prefetched).c_str()));
+		appendToResult(MString(string_format("prefetchFailed=%llu", stats.prefetchFailed).c_str()));
+		appendToResult(MString(string_format("rejected=%llu", stats.rejected).c_str()));
+	}
+
+	return MS::kSuccess;
+}
+
+// -----------------------------------------------------------------------------
+MStatus FireRenderCmd::meshCache(const MArgDatabase& argData)
+{
+	FireMaya::MeshCache& cache = FireMaya::MeshCache::Instance();
+
+	if (argData.isFlagSet(kClearMeshCacheFlag))
+	{
+		cache.Clear();
+		cache.ResetStatistics();
+	}
+
+	if (argData.isFlagSet(kMeshCacheStatsFlag))
+	{
+		FireMaya::MeshCache::Statistics stats = cache.GetStatistics();
+
+		unsigned long long requests = stats.hits + stats.misses;
+		double hitRate = requests > 0 ? double(stats.hits) / double(requests) : 0.0;
+
+		clearResult();
+		appendToResult(MString(string_format("entries=%zu", stats.entryCount).c_str()));
+		appendToResult(MString(string_format("residentMB=%.1f", stats.byteSize / (1024.0 * 1024.0)).c_str()));
+		appendToResult(MString(string_format("budgetMB=%.1f", stats.byteBudget / (1024.0 * 1024.0)).c_str()));
+		appendToResult(MString(string_format("hits=%llu", stats.hits).c_str()));
+		appendToResult(MString(string_format("misses=%llu", stats.misses).c_str()));
+		appendToResult(MString(string_format("hitRate=%.3f", hitRate).c_str()));
+		appendToResult(MString(string_format("evictions=%llu", stats.evictions).c_str()));
+		appendToResult(MString(string_format("sharedMB=%.1f", stats.sharedBytes / (1024.0 * 1024.0)).c_str()));
+		appendToResult(MString(string_format("instancedShapes=%llu", stats.instancedShapes).c_str()));
+		appendToResult(MString(string_format("instancedMB=%.1f", stats.instancedBytes / (1024.0 * 1024.0)).c_str()));
+	}
+
+	return MS::kSuccess;
+}
+
+// -----------------------------------------------------------------------------
+MStatus FireRenderCmd::motionSampleCache(const MArgDatabase& argData)
+{
+	FireMaya::MotionSampleCache& cache = FireMaya::MotionSampleCache::Instance();
+
+	if (argData.isFlagSet(kClearMotionSampleCacheFlag))
+	{
+		cache.Clear();
+		cache.ResetStatistics();
+	}
+
+	if (argData.isFlagSet(kMotionSampleStatsFlag))
+	{
+		FireMaya::MotionSampleCache::Statistics stats = cache.GetStatistics();
+
+		unsigned long long requests = stats.hits + stats.misses;
+		double hitRate = requests > 0 ? double(stats.hits) / double(requests) : 0.0;
+
+		clearResult();
+		appendToResult(MString(string_format("entries=%zu", stats.entryCount).c_str()));
+		appendToResult(MString(string_format("residentMB=%.1f", stats.byteSize / (1024.0 * 1024.0)).c_str()));
+		appendToResult(MString(string_format("budgetMB=%.1f", stats.byteBudget / (1024.0 * 1024.0)).c_str()));
+		appendToResult(MString(string_format("hits=%llu", stats.hits).c_str()));
+		appendToResult(MString(string_format("misses=%llu", stats.misses).c_str()));
+		appendToResult(MString(string_format("hitRate=%.3f", hitRate).c_str()));
+		appendToResult(MString(string_format("evaluatedSamples=%llu", stats.evaluatedSamples).c_str()));
+		appendToResult(MString(string_format("invalidatedSamples=%llu", stats.invalidatedSamples).c_str()));
+		appendToResult(MString(string_format("matrixHits=%llu", stats.matrixHits).c_str()));
+		appendToResult(MString(string_format("matrixEvaluations=%llu", stats.matrixEvaluations).c_str()));
+	}
+
+	return MS::kSuccess;
+}
+
+// -----------------------------------------------------------------------------
+MStatus FireRenderCmd::profileTrace(const MArgDatabase& argData)
+{
+	bool enable = FireMaya::Trace::IsEnabled();
+
+	if (argData.isFlagSet(kProfileTraceFlag))
+	{
+		argData.getFlagArgument(kProfileTraceFlag, 0, enable);
+
+		if (!enable)
+			FireMaya::Trace::Stop();
+	}
+
+	// "fireRender -profileTrace false -saveProfileTrace path" stops recording and saves what was collected
+	if (argData.isFlagSet(kSaveProfileTraceFlag))
+	{
+		MString path;
+		argData.getFlagArgument(kSaveProfileTraceFlag, 0, path);
+		if (path.length() == 0)
+			path = getLogFolder() + "/rprProfileTrace.json";
+
+		if (!FireMaya::Trace::Save(path.asUTF8()))
+		{
+			MGlobal::displayError("Failed to save profile trace to " + path);
+			return MS::kFailure;
+		}
+
+		MGlobal::displayInfo("Profile trace saved to " + path);
+	}
+
+	if (argData.isFlagSet(kProfileTraceFlag) && enable)
+	{
+		FireMaya::Trace::Start();
+	}
+
+	if (argData.isFlagSet(kProfileTraceStatsFlag))
+	{
+		FireMaya::Trace::Statistics stats = FireMaya::Trace::GetStatistics();
+
+		clearResult();
+		appendToResult(MString(string_format("enabled=%d", stats.enabled ? 1 : 0).c_str()));
+		appendToResult(MString(string_format("events=%llu", stats.events).c_str()));
+		appendToResult(MString(string_format("dropped=%llu", stats.dropped).c_str()));
+		appendToResult(MString(string_format("threads=%zu", stats.threads).c_str()));
+	}
+
+	return MS::kSuccess;
+}
+
+// -----------------------------------------------------------------------------
+MStatus FireRenderCmd::queryDenoiseStatistics(const MArgDatabase& argData)
+{
+	if (argData.isFlagSet(kResetDenoiseStatsFlag))
+	{
+		FireRenderContext::ResetDenoiseStatistics();
+		return MS::kSuccess;
+	}
+
+	FireRenderContext::DenoiseStatistics stats = FireRenderContext::GetDenoiseStatistics();
+
+	clearResult();
+	appendToResult(MString(string_format("submitted=%llu", stats.submitted).c_str()));
+	appendToResult(MString(string_format("completed=%llu", stats.completed).c_str()));
+	appendToResult(MString(string_format("dropped=%llu", stats.dropped).c_str()));
+	appendToResult(MString(string_format("averageSetupMs=%.3f", stats.averageSetupMs).c_str()));
+	appendToResult(MString(string_format("averageLatencyMs=%.3f", stats.averageLatencyMs).c_str()));
+	appendToResult(MString(string_format("maxLatencyMs=%.3f", stats.maxLatencyMs).c_str()));
+
+	return MS::kSuccess;
+}
+
 // -----------------------------------------------------------------------------
 MString FireRenderCmd::getOutputFilePath(const MCommonRenderSettingsData& settings,
 	 int frame, const MString& camera, bool preview) const
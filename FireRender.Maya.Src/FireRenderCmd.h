@@ -106,6 +106,24 @@ private:
 	/** Enables or disables gltf export */
 	MStatus exportsGLTF(const MArgDatabase& argData);
 
+	/** Returns RPR and main thread dispatch counters as "name=value" strings */
+	MStatus queryThreadStatistics(const MArgDatabase& argData);
+
+	/** Queries statistics, sets budget or clears process wide cache of decoded textures */
+	MStatus imageCache(const MArgDatabase& argData);
+
+	/** Queries statistics or clears process wide cache of translated mesh indices */
+	MStatus meshCache(const MArgDatabase& argData);
+
+	/** Queries statistics or clears process wide cache of sub-frame motion blur samples */
+	MStatus motionSampleCache(const MArgDatabase& argData);
+
+	/** Starts or stops recording of profiling zones, saves them as Chrome trace JSON or queries statistics */
+	MStatus profileTrace(const MArgDatabase& argData);
+
+	/** Returns background denoiser job counters and latencies of IPR and viewport as "name=value" strings */
+	MStatus queryDenoiseStatistics(const MArgDatabase& argData);
+
 	/** Get the output file path, with an optional frame for multi-frame renders. */
 	MString getOutputFilePath(const MCommonRenderSettingsData& settings,
 		 int frame, const MString& camera, bool preview) const;
@@ -181,4 +199,34 @@ private:
 #define kWaitForItTwoStepLong "-waitForItTwo"
 #define kExportsGLTF "-eg"
 #define kExportsGLTFLong "-exportsGLTF"
+#define kThreadStatsFlag "-ts"
+#define kThreadStatsFlagLong "-threadStats"
+#define kResetThreadStatsFlag "-rts"
+#define kResetThreadStatsFlagLong "-resetThreadStats"
+#define kImageCacheStatsFlag "-ics"
+#define kImageCacheStatsFlagLong "-imageCacheStats"
+#define kImageCacheBudgetFlag "-icb"
+#define kImageCacheBudgetFlagLong "-imageCacheBudget"
+#define kClearImageCacheFlag "-cic"
+#define kClearImageCacheFlagLong "-clearImageCache"
+#define kMeshCacheStatsFlag "-mcs"
+#define kMeshCacheStatsFlagLong "-meshCacheStats"
+#define kClearMeshCacheFlag "-cmc"
+#define kClearMeshCacheFlagLong "-clearMeshCache"
+#define kProfileTraceFlag "-pt"
+#define kProfileTraceFlagLong "-profileTrace"
+#define kSaveProfileTraceFlag "-spt"
+#define kSaveProfileTraceFlagLong "-saveProfileTrace"
+#define kProfileTraceStatsFlag "-pts"
+#define kProfileTraceStatsFlagLong "-profileTraceStats"
+#define kDenoiseStatsFlag "-dns"
+#define kDenoiseStatsFlagLong "-denoiseStats"
+#define kResetDenoiseStatsFlag "-rdns"
+#define kResetDenoiseStatsFlagLong "-resetDenoiseStats"
+#define kRenderViewRefreshRateFlag "-rvr"
+#define kRenderViewRefreshRateFlagLong "-renderViewRefreshRate"
+#define kMotionSampleStatsFlag "-mss"
+#define kMotionSampleStatsFlagLong "-motionSampleStats"
+#define kClearMotionSampleCacheFlag "-cmsc"
+#define kClearMotionSampleCacheFlagLong "-clearMotionSampleCache"
 
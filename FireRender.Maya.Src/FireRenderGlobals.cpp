@@ -28,6 +28,7 @@ limitations under the License.
 #include <thread>
 #include <filesystem>
 #include "StartupContextChecker.h"
+#include "TileRenderer.h"
 
 #define DEFAULT_RENDER_STAMP "Radeon ProRender for Maya %b | %h | Time: %pt | Passes: %pp | Objects: %so | Lights: %sl"
 
@@ -192,6 +193,7 @@ namespace
         MObject tileRenderEnabled;
         MObject tileRenderX;
         MObject tileRenderY;
+        MObject tileRenderFillType;
 
 		// hybrid specific
 		MObject useGmon;
@@ -216,8 +218,11 @@ namespace
 
 		MObject enableSwatches;
 		MObject thumbnailIterCount;
+		MObject thumbnailBatchSize;
+		MObject thumbnailCache;
 		MObject renderMode;
 		MObject motionBlur;
+		MObject hairDensity;
 
 		// Other tabs
 		MObject completionCriteriaHours;
@@ -682,6 +687,16 @@ void FireRenderGlobals::createTileRenderAttributes()
 	nAttr.setSoftMax(tileDefaultSizeMax);
 
 	CHECK_MSTATUS(addAttribute(FinalRenderAttributes::tileRenderY));
+
+	MFnEnumAttribute eAttr;
+
+	FinalRenderAttributes::tileRenderFillType = eAttr.create("tileRenderFillType", "trft", (short) TileRenderFillType::Normal, &status);
+	eAttr.addField("Row by Row", (short) TileRenderFillType::Normal);
+	eAttr.addField("Snake", (short) TileRenderFillType::Snake);
+	eAttr.addField("Spiral", (short) TileRenderFillType::Spiral);
+	MAKE_INPUT_CONST(eAttr);
+
+	CHECK_MSTATUS(addAttribute(FinalRenderAttributes::tileRenderFillType));
 }
 
 void FireRenderGlobals::createCryptomatteAttributes()
@@ -1282,6 +1297,17 @@ void FireRenderGlobals::createViewportAttributes()
 	nAttr.setMax(INT_MAX);
 	addAsGlobalAttribute(nAttr);
 
+	ViewportRenderAttributes::thumbnailBatchSize = nAttr.create("thumbnailBatchSize", "tbs", MFnNumericData::kInt, 16, &status);
+	MAKE_INPUT(nAttr);
+	nAttr.setMin(1);
+	nAttr.setSoftMax(64);
+	nAttr.setMax(256);
+	addAsGlobalAttribute(nAttr);
+
+	ViewportRenderAttributes::thumbnailCache = nAttr.create("thumbnailCache", "tch", MFnNumericData::kBoolean, true, &status);
+	MAKE_INPUT(nAttr);
+	addAsGlobalAttribute(nAttr);
+
 	ViewportRenderAttributes::renderMode = createRenderModeAttr("renderModeViewport", "vrm", eAttr);
 	addAsGlobalAttribute(eAttr);
 
@@ -1313,6 +1339,12 @@ void FireRenderGlobals::createViewportAttributes()
 	MAKE_INPUT(nAttr);
 	CHECK_MSTATUS(addAttribute(ViewportRenderAttributes::motionBlur));
 
+	ViewportRenderAttributes::hairDensity = nAttr.create("hairDensityViewport", "hdv", MFnNumericData::kFloat, 1.0, &status);
+	MAKE_INPUT(nAttr);
+	nAttr.setMin(0.01);
+	nAttr.setMax(1.0);
+	CHECK_MSTATUS(addAttribute(ViewportRenderAttributes::hairDensity));
+
 	ViewportRenderAttributes::adaptiveThresholdViewport = nAttr.create("adaptiveThresholdViewport", "atv", MFnNumericData::kFloat, 0.05, &status);
 	MAKE_INPUT(nAttr);
 	nAttr.setMin(0.0);
@@ -13,10 +13,13 @@ limitations under the License.
 #include "FireRenderObjects.h"
 #include "Context/FireRenderContext.h"
 #include "FireRenderUtils.h"
+#include "ParallelUtils.h"
 
 #include <float.h>
 #include <array>
 #include <algorithm>
+#include <numeric>
+#include <set>
 #include <vector>
 #include <iterator>
 
@@ -62,6 +65,8 @@ FireRenderHair::FireRenderHair(FireRenderContext* context, const MDagPath& dagPa
 	: FireRenderNode(context, dagPath)
 	, m_matrix()
 	, m_Curves()
+	, m_groomKey()
+	, m_isGroomChanged(true)
 {}
 
 FireRenderHair::~FireRenderHair()
@@ -255,66 +260,38 @@ void FireRenderHair::ApplyTransform(void)
 */
 const unsigned int PointsPerSegment = 4;
 
-void ProcessHairPoints(
-	std::vector<rpr_uint>& outCurveIndicesData,
-	unsigned int offset,
-	unsigned int length
-)
-{
-	rpr_uint currIdx = offset;
-	for (unsigned int idx = 0; idx < length; idx++)
-	{
-		outCurveIndicesData.push_back(currIdx++);
+// strands are converted in parallel by chunks of this size
+const size_t StrandChunkSize = 1024;
 
-		// duplicate index of last point in segment if necessary
-		if (outCurveIndicesData.size() % PointsPerSegment != 0)
-			continue;
+// Last point of segment is duplicated as the first point of next segment,
+// last segment of strand is padded by the last point of strand
+unsigned int GetSegmentCount(unsigned int length)
+{
+	if (length == 0)
+		return 0;
 
-		if (idx < (length - 1))
-			outCurveIndicesData.push_back(outCurveIndicesData.back());
-	}
+	return (length < PointsPerSegment) ? 1 : (length + 1) / (PointsPerSegment - 1);
 }
 
-void ProcessHairTail(std::vector<rpr_uint>& outCurveIndicesData)
+// Indices of strands translated with given density, selected strands are spread evenly over the batch
+void SelectStrands(size_t strandCount, float density, std::vector<unsigned int>& outStrands)
 {
-	// Number of points that should be added 
-	unsigned int tail = outCurveIndicesData.size() % PointsPerSegment;
-	if (tail != 0)
-		tail = PointsPerSegment - tail;
-
-	// Extend data indices array if necessary 
-	// Segment of RPR curve should always be composed of 4 3D points
-	for (unsigned int idx = 0; idx < tail; idx++)
+	outStrands.clear();
+
+	if (density >= 1.0f)
 	{
-		outCurveIndicesData.push_back(outCurveIndicesData.back());
+		outStrands.resize(strandCount);
+		std::iota(outStrands.begin(), outStrands.end(), 0);
+		return;
 	}
-}
-
-template <typename T>
-void ProcessHairWidth(
-	std::vector<float>& outRadiuses,
-	const T* width,
-	const std::vector<rpr_uint>& curveIndicesData)
-{
-	// ensure correct inputs
-	assert(width != nullptr);
-	assert(curveIndicesData.size() % PointsPerSegment == 0);
 
-	const unsigned int segmentsInCurve = (unsigned int)(curveIndicesData.size()) / PointsPerSegment;
+	const double step = density;
+	outStrands.reserve((size_t)(strandCount * step) + 1);
 
-	// N = 2*(number of segments)
-	// In RPR we set 2 widths per segment (segment is 4 points)
-	for (unsigned int idx = 0; idx < segmentsInCurve; ++idx)
+	for (size_t strandIdx = 0; strandIdx < strandCount; ++strandIdx)
 	{
-		// bottom circle
-		rpr_uint controlPointIdx = curveIndicesData[idx * PointsPerSegment];
-		float radius = (float)width[controlPointIdx] * 0.5f;
-		outRadiuses.push_back(radius);
-
-		// top circle
-		controlPointIdx = curveIndicesData[idx * PointsPerSegment + (PointsPerSegment - 1)];
-		radius = (float)width[controlPointIdx] * 0.5f;
-		outRadiuses.push_back(radius);
+		if ((size_t)((strandIdx + 1) * step) != (size_t)(strandIdx * step))
+			outStrands.push_back((unsigned int)strandIdx);
 	}
 }
 
@@ -339,54 +316,97 @@ struct CurvesBatchData
 	unsigned int m_pointCount;
 	const float* m_points;
 
+	// first point and number of points of every translated strand
+	std::vector<unsigned int> m_strandOffsets;
+	std::vector<unsigned int> m_strandLengths;
+
 	CurvesBatchData(void)
 		: m_indicesData()
 		, m_numPointsPerSegment()
 		, m_radiuses() // In RPR we set 2 widths per segment (segment is 4 points)
 		, m_uvCoord() // RPR accepts only one UV pair per curve
-		, m_pointCount(0) // splineIt.vertexCount() returns wrong number - it returns number of vertexes used, not size of vertex array, which is different number when density mask is used
+		, m_pointCount(0)
 		, m_points(nullptr)
+		, m_strandOffsets()
+		, m_strandLengths()
 	{}
 
-	using IHair = Ephere::Plugins::Ornatrix::IHair;
-	void Init(const std::shared_ptr<IHair>& sourceHair)
+	void AddStrand(unsigned int offset, unsigned int length)
 	{
-		m_pointCount = sourceHair->GetVertexCount();
-		m_indicesData.reserve(m_pointCount * 2);
-
-		int curveCount = sourceHair->GetStrandCount();
-		m_uvCoord.reserve(curveCount * 2);
-		m_numPointsPerSegment.reserve(curveCount);
-		m_radiuses.reserve(m_pointCount);
+		m_strandOffsets.push_back(offset);
+		m_strandLengths.push_back(length);
 	}
 
-	void Init(const XGenSplineAPI::XgItSpline& splineIt)
+	// size of points array referenced by strands
+	unsigned int GetUsedPointCount(void) const
 	{
-		m_points = splineIt.positions(0)->getValue();
+		unsigned int pointCount = 0;
 
-		const unsigned int  curveCount = splineIt.primitiveCount();
+		for (size_t curveIdx = 0; curveIdx < m_strandLengths.size(); ++curveIdx)
+		{
+			unsigned int end = m_strandOffsets[curveIdx] + m_strandLengths[curveIdx];
+			if ((m_strandLengths[curveIdx] > 0) && (end > pointCount))
+				pointCount = end;
+		}
 
-		m_indicesData.reserve(splineIt.vertexCount() * 2);
-		m_numPointsPerSegment.reserve(curveCount);
-		m_radiuses.reserve(splineIt.vertexCount()); // array of N float. If curve is not tapered, N = curveCount. If curve is tapered, N = 2*(number of segments)
-		m_uvCoord.reserve(2 * curveCount);
+		return pointCount;
 	}
 
-	void Init(MRenderLineArray& mainLines)
+	// Writes indices and radiuses of all strands.
+	// Output arrays are sized by prefix sum of segment counts, so strands are written in parallel.
+	// Width is indexed by point index
+	template <typename T>
+	void BuildSegments(const T* width)
 	{
-		int curveCount = mainLines.length();
-		for (int idx = 0; idx < curveCount; ++idx)
+		assert(width != nullptr);
+
+		const size_t curveCount = m_strandLengths.size();
+
+		std::vector<size_t> firstSegments(curveCount + 1);
+		m_numPointsPerSegment.resize(curveCount);
+
+		firstSegments[0] = 0;
+		for (size_t curveIdx = 0; curveIdx < curveCount; ++curveIdx)
 		{
-			MStatus status;
-			MRenderLine renderLine = mainLines.renderLine(idx, &status);
-			MVectorArray lineVtxs = renderLine.getLine();
-			m_pointCount += lineVtxs.length();
+			unsigned int segmentsInCurve = GetSegmentCount(m_strandLengths[curveIdx]);
+
+			m_numPointsPerSegment[curveIdx] = (int)segmentsInCurve;
+			firstSegments[curveIdx + 1] = firstSegments[curveIdx] + segmentsInCurve;
 		}
 
-		m_indicesData.reserve(m_pointCount * 2);
-		m_numPointsPerSegment.reserve(curveCount);
-		m_radiuses.reserve(m_pointCount); // array of N float. If curve is not tapered, N = curveCount. If curve is tapered, N = 2*(number of segments)
-		m_uvCoord.reserve(2 * curveCount);
+		m_indicesData.resize(firstSegments[curveCount] * PointsPerSegment);
+		m_radiuses.resize(firstSegments[curveCount] * 2);
+
+		FireMaya::WorkerPool::Instance().ParallelForRange(curveCount, StrandChunkSize, [&](size_t begin, size_t end)
+		{
+			for (size_t curveIdx = begin; curveIdx < end; ++curveIdx)
+			{
+				const unsigned int offset = m_strandOffsets[curveIdx];
+				const unsigned int lastPoint = m_strandLengths[curveIdx] - 1;
+				const unsigned int segmentsInCurve = (unsigned int)m_numPointsPerSegment[curveIdx];
+
+				rpr_uint* indices = m_indicesData.data() + firstSegments[curveIdx] * PointsPerSegment;
+				float* radiuses = m_radiuses.data() + firstSegments[curveIdx] * 2;
+
+				for (unsigned int segmentIdx = 0; segmentIdx < segmentsInCurve; ++segmentIdx)
+				{
+					for (unsigned int pointIdx = 0; pointIdx < PointsPerSegment; ++pointIdx)
+					{
+						unsigned int point = segmentIdx * (PointsPerSegment - 1) + pointIdx;
+						indices[pointIdx] = offset + ((point < lastPoint) ? point : lastPoint);
+					}
+
+					// bottom circle
+					radiuses[0] = (float)width[indices[0]] * 0.5f;
+
+					// top circle
+					radiuses[1] = (float)width[indices[PointsPerSegment - 1]] * 0.5f;
+
+					indices += PointsPerSegment;
+					radiuses += 2;
+				}
+			}
+		});
 	}
 
 	frw::Curve CreateRPRCurve(frw::Context& currContext)
@@ -397,56 +417,49 @@ struct CurvesBatchData
 	}
 };
 
-frw::Curve ProcessCurvesBatch(const XGenSplineAPI::XgItSpline& splineIt, frw::Context currContext)
+frw::Curve ProcessCurvesBatch(const XGenSplineAPI::XgItSpline& splineIt, float density, frw::Context currContext)
 {
 	// create data buffers
 	CurvesBatchData batchData;
-	batchData.Init(splineIt);
+	batchData.m_points = splineIt.positions(0)->getValue();
+
+	std::vector<unsigned int> strands;
+	SelectStrands(splineIt.primitiveCount(), density, strands);
+
+	batchData.m_strandOffsets.reserve(strands.size());
+	batchData.m_strandLengths.reserve(strands.size());
+	batchData.m_uvCoord.reserve(2 * strands.size());
 
-	// for each primitive (for each hair in batch)
-	for (unsigned int currCurveIdx = 0; currCurveIdx < splineIt.primitiveCount(); ++currCurveIdx)
+	const SgVec2f* patchUVs = splineIt.patchUVs();
+
+	// for each translated primitive (for each hair in batch)
+	for (unsigned int currCurveIdx : strands)
 	{
 		unsigned int offset = 0;
 		unsigned int length = 0;
 		std::tie(length, offset) = GetHairLengthOffset(splineIt, currCurveIdx);
 
-		// Write indices and copy points
-		std::vector<rpr_uint> curveIndicesData;
-		ProcessHairPoints(curveIndicesData, offset, length);
-		ProcessHairTail(curveIndicesData);
-		assert(curveIndicesData.size() % PointsPerSegment == 0);
+		batchData.AddStrand(offset, length);
 
 		// Texcoord using the patch UV from the root point
-		const SgVec2f* patchUVs = splineIt.patchUVs();
 		batchData.m_uvCoord.push_back(patchUVs[offset][0]);
 		batchData.m_uvCoord.push_back(patchUVs[offset][1]);
-		// Number of points in the current curve
-		const unsigned int segmentsInCurve = (unsigned int)(curveIndicesData.size()) / PointsPerSegment;
-		batchData.m_numPointsPerSegment.push_back(segmentsInCurve);
-
-		// add tmp_indicesData to output
-		batchData.m_indicesData.insert(batchData.m_indicesData.end(), curveIndicesData.begin(), curveIndicesData.end());
-
-		// Hair segments radiuses
-		ProcessHairWidth(batchData.m_radiuses, splineIt.width(), curveIndicesData);
 	}
 
+	// Write indices and hair segments radiuses
+	batchData.BuildSegments(splineIt.width());
+
 	// find size of points array 
 	// splineIt.vertexCount() returns wrong number - it returns number of vertexes used, not size of vertex array, which is different number when density mask is used
-	if (!batchData.m_indicesData.empty())
-	{
-		auto maxIndexElement = std::max_element(batchData.m_indicesData.begin(), batchData.m_indicesData.end());
-		batchData.m_pointCount = *maxIndexElement + 1;
-	}
+	batchData.m_pointCount = batchData.GetUsedPointCount();
 
 	// create RPR curve (create batch of hairs)
 	return batchData.CreateRPRCurve(currContext);
 }
 
-bool GetCurvesData(XGenSplineAPI::XgFnSpline& out, MFnDagNode& curvesNode)
+bool GetCurvesData(std::string& out, MFnDagNode& curvesNode)
 {
 	// Stream out the spline data
-	std::string data;
 	MPlug       outPlug = curvesNode.findPlug("outRenderData");
 	MObject     outObj = outPlug.asMObject();
 	MPxData*    outData = MFnPluginData(outObj).data();
@@ -457,7 +470,14 @@ bool GetCurvesData(XGenSplineAPI::XgFnSpline& out, MFnDagNode& curvesNode)
 	// Data found => dump data to stream
 	std::stringstream opaqueStrm;
 	outData->writeBinary(opaqueStrm);
-	data = opaqueStrm.str();
+	out = opaqueStrm.str();
+
+	return true;
+}
+
+bool LoadCurvesData(XGenSplineAPI::XgFnSpline& out, const std::string& data)
+{
+	std::stringstream opaqueStrm(data);
 
 	// Compute the padding bytes and number of array elements
 	const unsigned int tail = data.size() % sizeof(unsigned int);
@@ -480,18 +500,44 @@ bool GetCurvesData(XGenSplineAPI::XgFnSpline& out, MFnDagNode& curvesNode)
 
 void FireRenderHair::Freshen(bool shouldCalculateHash)
 {
-	detachFromScene();
-	clear();
-
 	auto node = Object();
 	MFnDagNode fnDagNode(node);
 	MString name = fnDagNode.fullPathName();
+	MDagPath path = MDagPath::getAPathTo(node);
+
+	// only transform has changed => existing curves are moved
+	if (m_bIsTransformChanged && !m_isGroomChanged && !m_Curves.empty())
+	{
+		m_bIsTransformChanged = false;
+
+		ApplyTransform();
 
+		if (path.isVisible())
+			attachToScene();
+		else
+			detachFromScene();
+
+		FireRenderNode::Freshen(shouldCalculateHash);
+		return;
+	}
+
+	m_bIsTransformChanged = false;
+	m_isGroomChanged = false;
+
+	// callbacks are registered again for current hair shader
+	FireRenderObject::clear();
+
+	// existing curves are reused if groom data has not changed
 	bool haveCurves = CreateCurves();
 
 	if (haveCurves)
 	{
-		MDagPath path = MDagPath::getAPathTo(node);
+		// apply transform to curves
+		ApplyTransform();
+
+		// apply material to curves
+		ApplyMaterial();
+
 		if (path.isVisible())
 		{
 			for (int i = 0; i < m_Curves.size(); i++)
@@ -502,16 +548,48 @@ void FireRenderHair::Freshen(bool shouldCalculateHash)
 
 			attachToScene();
 		}
+		else
+		{
+			detachFromScene();
+		}
 
 		setRenderStats(path);
 	}
+	else
+	{
+		ReleaseCurves();
+	}
 
 	FireRenderNode::Freshen(shouldCalculateHash);
 }
 
+bool FireRenderHair::IsGroomUnchanged(const HashValue& groomKey) const
+{
+	return !m_Curves.empty() && (groomKey == m_groomKey);
+}
+
+void FireRenderHair::ReleaseCurves(void)
+{
+	detachFromScene();
+
+	m_Curves.clear();
+	m_groomKey = HashValue();
+}
+
+float FireRenderHair::GetStrandDensity(void) const
+{
+	if (context()->GetRenderType() != RenderType::ViewportRender)
+		return 1.0f;
+
+	float density = context()->Globals().viewportHairDensity;
+
+	return (density < 0.01f) ? 0.01f : ((density > 1.0f) ? 1.0f : density);
+}
+
 void FireRenderHair::clear()
 {
 	m_Curves.clear();
+	m_groomKey = HashValue();
 
 	FireRenderObject::clear();
 }
@@ -526,7 +604,7 @@ void FireRenderHair::attachToScene()
 		for (frw::Curve& curve : m_Curves)
 			scene.Attach(curve);
 
-		m_isVisible = true;
+		SetIsVisible(true);
 	}
 }
 
@@ -541,7 +619,7 @@ void FireRenderHair::detachFromScene()
 			scene.Detach(curve);
 	}
 
-	m_isVisible = false;
+	SetIsVisible(false);
 }
 
 void FireRenderHair::setPrimaryVisibility(bool primaryVisibility)
@@ -639,21 +717,32 @@ bool FireRenderHairXGenGrooming::CreateCurves()
 	MFnDagNode fnDagNode(node);
 
 	// get curves data
+	std::string data;
+	if (!GetCurvesData(data, fnDagNode))
+		return false;
+
+	float density = GetStrandDensity();
+
+	HashValue groomKey;
+	groomKey.Append(data.data(), (int)data.size());
+	groomKey << density;
+
+	if (IsGroomUnchanged(groomKey))
+		return true;
+
+	ReleaseCurves();
+
 	XGenSplineAPI::XgFnSpline splines;
-	if (!GetCurvesData(splines, fnDagNode))
+	if (!LoadCurvesData(splines, data))
 		return false;
 
 	// create rpr curves (hair batch) for each primitive batch
 	for (XGenSplineAPI::XgItSpline splineIt = splines.iterator(); !splineIt.isDone(); splineIt.next())
 	{
-		m_Curves.push_back(ProcessCurvesBatch(splineIt, Context()));
+		m_Curves.push_back(ProcessCurvesBatch(splineIt, density, Context()));
 	}
 
-	// apply transform to curves
-	ApplyTransform();
-
-	// apply material to curves
-	ApplyMaterial();
+	m_groomKey = groomKey;
 
 	return (m_Curves.size() > 0);
 }
@@ -684,108 +773,127 @@ bool EnsureValidOrnatrixHairBatch(const std::shared_ptr<Ephere::Plugins::Ornatri
 	return true;
 }
 
-void ProcessOrnatrixTextureCoordinates(
-	const std::shared_ptr<Ephere::Plugins::Ornatrix::IHair>& sourceHair, 
-	int currStrandVertexCount,
-	int currCurveIdx,
-	std::vector<int>& firstVertexIndices,
-	CurvesBatchData& batchData)
+// Overall batch data grabbed from ornatrix
+struct OrnatrixHairData
 {
-	// texture coords
-	int countTextureChannels = sourceHair->GetTextureCoordinateChannelCount();
-	if (countTextureChannels == 0)
-		return;
+	std::vector<int> pointCounts;
+	std::vector<int> firstVertexIndices;
+	std::vector<Ephere::Ornatrix::Vector3> vertices;
+	std::vector<float> widths;
+	std::vector<Ephere::Ornatrix::Xform3> strand2obj;
+	std::vector<Ephere::Ornatrix::TextureCoordinate> textureCoords; // per vertex, empty if hair has no texture coordinates
+
+	bool Read(const std::shared_ptr<Ephere::Plugins::Ornatrix::IHair>& sourceHair)
+	{
+		// ensure hair is described in supported way
+		assert(EnsureValidOrnatrixHairBatch(sourceHair));
 
-	// RPR supports only 1 channel!
-	/*if (countTextureChannels > 1)
-		display some warning; */
+		int strandCount = sourceHair->GetStrandCount();
+		if (strandCount == 0)
+			return false;
 
-	int channel = 0;
+		int pointCount = sourceHair->GetVertexCount();
 
-	Ephere::Ornatrix::IHair::StrandDataType strandDataType = sourceHair->GetTextureCoordinateDataType(channel);
+		pointCounts.resize(strandCount);
+		sourceHair->GetStrandPointCounts(0, strandCount, pointCounts.data());
 
-	std::vector<Ephere::Ornatrix::TextureCoordinate> coords(currStrandVertexCount);
-	sourceHair->GetTextureCoordinates(
-		channel,
-		firstVertexIndices[currCurveIdx],
-		currStrandVertexCount,
-		coords.data(),
-		Ephere::Ornatrix::IHair::PerVertex);
+		firstVertexIndices.resize(strandCount);
+		sourceHair->GetStrandFirstVertexIndices(0, strandCount, firstVertexIndices.data());
 
-	// RPR supports only one uv coordinate pair per hair strand! Thus we pass UV of the root point
-	batchData.m_uvCoord.push_back(coords[0].x());
-	batchData.m_uvCoord.push_back(coords[0].y());
-}
+		// - vertices
+		vertices = sourceHair->GetVerticesVector(0, pointCount, Ephere::Ornatrix::IHair::Strand);
 
-frw::Curve ProcessCurvesBatch(const std::shared_ptr<Ephere::Plugins::Ornatrix::IHair>& sourceHair, frw::Context currContext)
-{
-	// ensure hair is described in supported way
-	assert(EnsureValidOrnatrixHairBatch(sourceHair));
+		// - hairs widths
+		widths.resize(pointCount);
+		sourceHair->GetWidths(firstVertexIndices[0], pointCount, widths.data());
 
-	// create data buffers
-	CurvesBatchData batchData;
-	batchData.Init(sourceHair);
-
-	// get overall batch data
-	int strandCount = sourceHair->GetStrandCount();
+		// - vertex coords tranformations
+		strand2obj.resize(strandCount);
+		sourceHair->GetStrandToObjectTransforms(0, strandCount, strand2obj.data());
 
-	std::vector<int> pointCounts(strandCount);
-	sourceHair->GetStrandPointCounts(0, int(pointCounts.size()), pointCounts.data());
+		// - texture coords of all vertices in one call
+		// RPR supports only 1 channel!
+		textureCoords.clear();
+		if (sourceHair->GetTextureCoordinateChannelCount() > 0)
+		{
+			textureCoords.resize(pointCount);
+			sourceHair->GetTextureCoordinates(0, firstVertexIndices[0], pointCount, textureCoords.data(), Ephere::Ornatrix::IHair::PerVertex);
+		}
 
-	std::vector<int> firstVertexIndices(strandCount);
-	sourceHair->GetStrandFirstVertexIndices(0, int(firstVertexIndices.size()), firstVertexIndices.data());
+		return true;
+	}
 
-	// - vertices
-	std::vector<Ephere::Ornatrix::Vector3> vertices = sourceHair->GetVerticesVector(0, batchData.m_pointCount, Ephere::Ornatrix::IHair::Strand);
-	batchData.m_points = &vertices[0][0];
+	HashValue GetKey(void) const
+	{
+		HashValue key;
+		key.Append(pointCounts.data(), (int)pointCounts.size());
+		key.Append(firstVertexIndices.data(), (int)firstVertexIndices.size());
+		key.Append(vertices.data(), (int)vertices.size());
+		key.Append(widths.data(), (int)widths.size());
+		key.Append(strand2obj.data(), (int)strand2obj.size());
+		key.Append(textureCoords.data(), (int)textureCoords.size());
+
+		return key;
+	}
+};
 
-	// - hairs widths
-	std::vector<float> width(batchData.m_pointCount);
-	sourceHair->GetWidths(firstVertexIndices[0], batchData.m_pointCount, width.data());
+frw::Curve ProcessCurvesBatch(OrnatrixHairData& hairData, float density, frw::Context currContext)
+{
+	// create data buffers
+	CurvesBatchData batchData;
+	batchData.m_pointCount = (unsigned int)hairData.vertices.size();
+	batchData.m_points = &hairData.vertices[0][0];
 
-	// - vertex coords tranformations
-	std::vector <Ephere::Ornatrix::Xform3> strand2ojb (strandCount);
-	sourceHair->GetStrandToObjectTransforms(0, strandCount, strand2ojb.data());
+	std::vector<unsigned int> strands;
+	SelectStrands(hairData.pointCounts.size(), density, strands);
 
-	// for each primitive (for each hair in batch)
+	// offsets of strands in vertices array
+	std::vector<unsigned int> strandOffsets(hairData.pointCounts.size());
 	unsigned int offset = 0;
-	int currStrandVertexCount = 0;
-
-	for (int currCurveIdx = 0; currCurveIdx < strandCount; ++currCurveIdx, offset += currStrandVertexCount)
+	for (size_t strandIdx = 0; strandIdx < strandOffsets.size(); ++strandIdx)
 	{
-		// get current curve
-		currStrandVertexCount = sourceHair->GetStrandPointCount(currCurveIdx);
-		assert(currStrandVertexCount == pointCounts[currCurveIdx]);
-
-		// transform vertexes from local space
-		for (int currVtxIdx = 0; currVtxIdx < currStrandVertexCount; currVtxIdx++)
-		{
-			Ephere::Ornatrix::Vector3& tcoord = vertices[currVtxIdx + offset];
-			tcoord = strand2ojb[currCurveIdx] * tcoord;
-		}
+		strandOffsets[strandIdx] = offset;
+		offset += hairData.pointCounts[strandIdx];
+	}
 
-		// texture coords
-		ProcessOrnatrixTextureCoordinates(sourceHair, currStrandVertexCount, currCurveIdx, firstVertexIndices, batchData);
+	batchData.m_strandOffsets.reserve(strands.size());
+	batchData.m_strandLengths.reserve(strands.size());
+	for (unsigned int currCurveIdx : strands)
+	{
+		batchData.AddStrand(strandOffsets[currCurveIdx], hairData.pointCounts[currCurveIdx]);
+	}
 
-		// convert data grabbed from ornatrix to rpr
-		unsigned int length = pointCounts[currCurveIdx];
+	// RPR supports only one uv coordinate pair per hair strand! Thus we pass UV of the root point
+	if (!hairData.textureCoords.empty())
+	{
+		batchData.m_uvCoord.resize(2 * strands.size());
+	}
 
-		// Write indices and copy points
-		std::vector<rpr_uint> curveIndicesData;
-		ProcessHairPoints(curveIndicesData, offset, length);
-		ProcessHairTail(curveIndicesData);
-		assert(curveIndicesData.size() % PointsPerSegment == 0);
+	FireMaya::WorkerPool::Instance().ParallelForRange(strands.size(), StrandChunkSize, [&](size_t begin, size_t end)
+	{
+		for (size_t idx = begin; idx < end; ++idx)
+		{
+			unsigned int currCurveIdx = strands[idx];
 
-		// Number of points in the current curve
-		const unsigned int segmentsInCurve = (unsigned int)(curveIndicesData.size()) / PointsPerSegment;
-		batchData.m_numPointsPerSegment.push_back(segmentsInCurve);
+			// transform vertexes from local space
+			Ephere::Ornatrix::Vector3* strandVertices = &hairData.vertices[strandOffsets[currCurveIdx]];
+			for (int currVtxIdx = 0; currVtxIdx < hairData.pointCounts[currCurveIdx]; currVtxIdx++)
+			{
+				strandVertices[currVtxIdx] = hairData.strand2obj[currCurveIdx] * strandVertices[currVtxIdx];
+			}
 
-		// add tmp_indicesData to output
-		batchData.m_indicesData.insert(batchData.m_indicesData.end(), curveIndicesData.begin(), curveIndicesData.end());
+			// texture coords
+			if (!hairData.textureCoords.empty())
+			{
+				const Ephere::Ornatrix::TextureCoordinate& coord = hairData.textureCoords[hairData.firstVertexIndices[currCurveIdx] - hairData.firstVertexIndices[0]];
+				batchData.m_uvCoord[2 * idx] = coord.x();
+				batchData.m_uvCoord[2 * idx + 1] = coord.y();
+			}
+		}
+	});
 
-		// Hair segments radiuses
-		ProcessHairWidth(batchData.m_radiuses, width.data(), curveIndicesData);
-	}
+	// Write indices and hair segments radiuses
+	batchData.BuildSegments(hairData.widths.data());
 
 	// create RPR curve (create batch of hairs)
 	return batchData.CreateRPRCurve(currContext);
@@ -801,14 +909,24 @@ bool FireRenderHairOrnatrix::CreateCurves()
 	if (sourceHair == nullptr)
 		return false;
 
-	// create rpr curves
-	m_Curves.push_back(ProcessCurvesBatch(sourceHair, Context()));
+	OrnatrixHairData hairData;
+	if (!hairData.Read(sourceHair))
+		return false;
 
-	// apply transform to curves
-	ApplyTransform();
+	float density = GetStrandDensity();
+
+	HashValue groomKey = hairData.GetKey();
+	groomKey << density;
 
-	// apply material to curves
-	ApplyMaterial();
+	if (IsGroomUnchanged(groomKey))
+		return true;
+
+	ReleaseCurves();
+
+	// create rpr curves
+	m_Curves.push_back(ProcessCurvesBatch(hairData, density, Context()));
+
+	m_groomKey = groomKey;
 
 	return (m_Curves.size() > 0);
 }
@@ -820,69 +938,97 @@ FireRenderHairNHair::FireRenderHairNHair(FireRenderContext* context, const MDagP
 FireRenderHairNHair::~FireRenderHairNHair()
 {}
 
-frw::Curve ProcessCurvesBatch(MRenderLineArray& mainLines, frw::Context currContext)
-{	
-	MStatus status;
-
-	// create data buffers
-	CurvesBatchData batchData;
-	batchData.Init(mainLines);
-
+// Data of translated strands grabbed from nHair render lines
+struct NHairData
+{
 	std::vector<float> vertices;
-	vertices.reserve(batchData.m_pointCount * 3);
 	std::vector<double> widths;
-	widths.reserve(batchData.m_pointCount * 3);
+	std::vector<float> parameters;
+	std::vector<unsigned int> pointCounts;
 
-	// for each primitive (for each hair)
-	int currStrandVertexCount = 0;
-	unsigned int offset = 0;
-
-	int countMainLines = mainLines.length();
-	for (int idx = 0; idx < countMainLines; ++idx, offset += currStrandVertexCount)
+	// Maya API is not thread safe so render lines are read sequentially
+	void Read(MRenderLineArray& mainLines, const std::vector<unsigned int>& strands)
 	{
-		MRenderLine renderLine = mainLines.renderLine(idx, &status);
-		MVectorArray lineVtxs = renderLine.getLine();
-		currStrandVertexCount = lineVtxs.length();
+		MStatus status;
+
+		pointCounts.reserve(strands.size());
 
-		// Copy points
-		for (unsigned int vtxIdx = 0; vtxIdx < lineVtxs.length(); ++vtxIdx)
+		for (unsigned int strandIdx : strands)
 		{
-			MVector& tVect = lineVtxs[vtxIdx];
-			vertices.push_back((float)tVect.x);
-			vertices.push_back((float)tVect.y);
-			vertices.push_back((float)tVect.z);
+			MRenderLine renderLine = mainLines.renderLine(strandIdx, &status);
+			MVectorArray lineVtxs = renderLine.getLine();
+			unsigned int length = lineVtxs.length();
+
+			size_t offset = widths.size();
+			pointCounts.push_back(length);
+
+			// Copy points
+			vertices.resize(vertices.size() + 3 * length);
+			float* points = &vertices[3 * offset];
+			for (unsigned int vtxIdx = 0; vtxIdx < length; ++vtxIdx)
+			{
+				const MVector& tVect = lineVtxs[vtxIdx];
+				points[3 * vtxIdx] = (float)tVect.x;
+				points[3 * vtxIdx + 1] = (float)tVect.y;
+				points[3 * vtxIdx + 2] = (float)tVect.z;
+			}
+
+			// Widths
+			MDoubleArray width = renderLine.getWidth();
+			widths.resize(offset + length, 0.0);
+			for (unsigned int vtxIdx = 0; (vtxIdx < length) && (vtxIdx < width.length()); ++vtxIdx)
+			{
+				widths[offset + vtxIdx] = width[vtxIdx];
+			}
+
+			// Texcoord
+			MDoubleArray parameter = renderLine.getParameter();
+			for (unsigned int idx = 0; idx < parameter.length(); ++idx)
+			{
+				parameters.push_back((float)parameter[idx]);
+			}
 		}
+	}
 
-		// Write indices
-		std::vector<rpr_uint> curveIndicesData;
-		ProcessHairPoints(curveIndicesData, offset, currStrandVertexCount);
-		ProcessHairTail(curveIndicesData);
-		assert(curveIndicesData.size() % PointsPerSegment == 0);
+	HashValue GetKey(void) const
+	{
+		HashValue key;
+		key.Append(pointCounts.data(), (int)pointCounts.size());
+		key.Append(vertices.data(), (int)vertices.size());
+		key.Append(widths.data(), (int)widths.size());
+		key.Append(parameters.data(), (int)parameters.size());
 
-		// Number of segments in the current curve
-		const unsigned int segmentsInCurve = (unsigned int)(curveIndicesData.size()) / PointsPerSegment;
-		batchData.m_numPointsPerSegment.push_back(segmentsInCurve);
+		return key;
+	}
+};
 
-		// add tmp_indicesData to output
-		batchData.m_indicesData.insert(batchData.m_indicesData.end(), curveIndicesData.begin(), curveIndicesData.end());
+frw::Curve ProcessCurvesBatch(const NHairData& hairData, frw::Context currContext)
+{	
+	// create data buffers
+	CurvesBatchData batchData;
+	batchData.m_pointCount = (unsigned int)hairData.widths.size();
+	batchData.m_points = hairData.vertices.data();
 
-		// Hair segments radiuses
-		MDoubleArray width = renderLine.getWidth();
-		std::fill_n(std::back_inserter(widths), width.length(), 0.0);
-		width.get(&widths[offset]);
-		ProcessHairWidth(batchData.m_radiuses, widths.data(), curveIndicesData);
+	batchData.m_strandOffsets.reserve(hairData.pointCounts.size());
+	batchData.m_strandLengths.reserve(hairData.pointCounts.size());
 
-		// Texcoord
-		MDoubleArray parameter = renderLine.getParameter();
-		for (unsigned int idx = 0; idx < parameter.length(); ++idx)
-		{
-			float param = (float)parameter[idx];
-			batchData.m_uvCoord.push_back(param);
-			batchData.m_uvCoord.push_back(param);
-		}
+	unsigned int offset = 0;
+	for (unsigned int length : hairData.pointCounts)
+	{
+		batchData.AddStrand(offset, length);
+		offset += length;
+	}
+
+	// Texcoord
+	batchData.m_uvCoord.resize(2 * hairData.parameters.size());
+	for (size_t idx = 0; idx < hairData.parameters.size(); ++idx)
+	{
+		batchData.m_uvCoord[2 * idx] = hairData.parameters[idx];
+		batchData.m_uvCoord[2 * idx + 1] = hairData.parameters[idx];
 	}
 
-	batchData.m_points = vertices.data();
+	// Write indices and hair segments radiuses
+	batchData.BuildSegments(hairData.widths.data());
 
 	// create RPR curve (create batch of hairs)
 	return batchData.CreateRPRCurve(currContext);
@@ -917,23 +1063,32 @@ bool FireRenderHairNHair::CreateCurves()
 		false //worldSpace
 		);
 	assert(status == MStatus::kSuccess);
-	int countMainLines = mainLines.length();
-	int countLeafLines = leafLines.length();
-	int countFlowerLines = flowerLines.length();
 
-	// create rpr curves
-	m_Curves.push_back(ProcessCurvesBatch(mainLines, Context()));
+	float density = GetStrandDensity();
+
+	std::vector<unsigned int> strands;
+	SelectStrands(mainLines.length(), density, strands);
+
+	NHairData hairData;
+	hairData.Read(mainLines, strands);
 
 	// clean up
 	mainLines.deleteArray();
 	leafLines.deleteArray();
 	flowerLines.deleteArray();
 
-	// apply transform to curves
-	ApplyTransform();
+	HashValue groomKey = hairData.GetKey();
+	groomKey << density;
+
+	if (IsGroomUnchanged(groomKey))
+		return true;
 
-	// apply material to curves
-	ApplyMaterial();
+	ReleaseCurves();
+
+	// create rpr curves
+	m_Curves.push_back(ProcessCurvesBatch(hairData, Context()));
+
+	m_groomKey = groomKey;
 
 	return (m_Curves.size() > 0);
 }
@@ -950,9 +1105,23 @@ static void HairShaderDirtyCallback(MObject& node, void* clientData)
 
 void FireRenderHair::OnShaderDirty()
 {
+	m_isGroomChanged = true;
 	setDirty();
 }
 
+void FireRenderHair::OnPlugDirty(MObject& node, MPlug& plug)
+{
+	// world matrix plugs are dirtied by transform changes which don't require conversion of curves
+	static const std::set<std::string> transformPlugs = { "wm", "wim", "pm", "pim" };
+
+	if (transformPlugs.find(plug.partialName().asChar()) == transformPlugs.end())
+	{
+		m_isGroomChanged = true;
+	}
+
+	FireRenderNode::OnPlugDirty(node, plug);
+}
+
 void FireRenderHair::RegisterCallbacks()
 {
 	FireRenderNode::RegisterCallbacks();
@@ -13,6 +13,8 @@ limitations under the License.
 #include "common.h"
 #include "frWrap.h"
 #include "FireRenderImageUtil.h"
+#include "ParallelUtils.h"
+#include "Tracing.h"
 #include <maya/MGlobal.h>
 #include <maya/MImage.h>
 #include <string>
@@ -26,6 +28,8 @@ void FireRenderImageUtil::save(MString filePath, unsigned int width, unsigned in
 	// Get the UTF8 file name.
 	const char* fileName = filePath.asUTF8();
 
+	RPR_TRACE_ZONE_DETAIL("FireRenderImageUtil::save", fileName);
+
 	// Create and verify the image output.
 	std::unique_ptr<ImageOutput> output = std::unique_ptr<ImageOutput>(ImageOutput::create(fileName));
 
@@ -144,127 +148,236 @@ void FireRenderImageUtil::saveMayaImage(MString filePath, unsigned int width, un
 		MGlobal::displayError("Unable to save " + filePath);
 }
 
-// -----------------------------------------------------------------------------
-bool FireRenderImageUtil::saveMultichannelAOVs(MString filePath,
-	unsigned int width, unsigned int height, unsigned int imageFormat, FireRenderAOVs& aovs)
+namespace
 {
-	std::vector<int> aovs_component_count;
-	aovs_component_count.resize(RPR_AOV_MAX, 0);
+	// Rows interleaved and handed to OIIO at once. Multiple of the EXR compression block heights (16 or 32 lines)
+	const unsigned int MultichannelChunkRows = 32;
 
-	auto outImage = OIIO::ImageOutput::create(filePath.asUTF8());
-	if (!outImage)
+	struct MultichannelSource
 	{
-		auto nameWithExt = filePath + "." + getImageFormatExtension(imageFormat);
-		outImage = ImageOutput::create(nameWithExt.asUTF8());
-		if (!outImage)
-		{
-			return false;
-		}
-	}
+		const RV_PIXEL* pixels = nullptr;
+		unsigned int componentCount = 0;
+	};
 
-	// Not using more complex constructor as OIIO allocates data in a different heap
-	// and modifying std::vector in our heap crashes(seems line CRTs don't match for
-	// the plugin and OpenImageIO.dll that gets loaded).
-	OIIO::ImageSpec imgSpec;
-	imgSpec.width = width;
-	imgSpec.height = height;
+	// Channel layout of the multichannel file and the AOV buffers its channels are read from
+	struct MultichannelImage
+	{
+		std::string formatPath;	// selects OIIO writer, can differ from the file path when it has no extension
+		std::string filePath;
+		unsigned int width = 0;
+		unsigned int height = 0;
 
-	const char* comments = "Created with " FIRE_RENDER_NAME " " PLUGIN_VERSION;
-	imgSpec.attribute("ImageDescription", comments);
-	imgSpec.attribute("compression", aovs.GetEXRCompressionType().asChar());
+		OIIO::ImageSpec spec;
+		std::vector<MultichannelSource> sources;
 
-	if (aovs.IsCryptomatteMaterial())
-	{
-		imgSpec.attribute("cryptomatte/be93ba3/conversion", "uint32_to_float32");
-		imgSpec.attribute("cryptomatte/be93ba3/hash", "MurmurHash3_32");
-		imgSpec.attribute("cryptomatte/be93ba3/name", "CryptoMaterial");
-	}
+		// buffers moved out of the AOVs for the asynchronous write
+		std::vector<std::shared_ptr<PixelBuffer>> ownedBuffers;
 
-	if (aovs.IsCryptomatteObject())
-	{
-		imgSpec.attribute("cryptomatte/d593dd7/conversion", "uint32_to_float32");
-		imgSpec.attribute("cryptomatte/d593dd7/hash", "MurmurHash3_32");
-		imgSpec.attribute("cryptomatte/d593dd7/name", "CryptoObject");
-	}
+		~MultichannelImage()
+		{
+			// This is to deallocate from our module, else it will be released in the openimageio.dll
+			// (in obj destructor) and lead to crash. Because we have filled those arrays in our code,
+			// oiio has no api functions to fill those safely(so that vector operations are called from ooio code)
+			// unfortunately
+			std::vector<OIIO::TypeDesc> temp0 = std::vector<OIIO::TypeDesc>();
+			spec.channelformats.swap(temp0);
+			std::vector<std::string> temp1 = std::vector<std::string>();
+			spec.channelnames.swap(temp1);
+		}
+	};
 
-	//fill image spec setting up channels for each aov
-	aovs.ForEachActiveAOV([&](FireRenderAOV& aov)
+	void describeMultichannelImage(MultichannelImage& image, FireRenderAOVs& aovs, bool takeBuffers)
 	{
-		assert(aov.IsActive());
-
-		int aov_component_count = 0;
+		// Not using more complex constructor as OIIO allocates data in a different heap
+		// and modifying std::vector in our heap crashes(seems line CRTs don't match for
+		// the plugin and OpenImageIO.dll that gets loaded).
+		OIIO::ImageSpec& imgSpec = image.spec;
+		imgSpec.width = image.width;
+		imgSpec.height = image.height;
+		imgSpec.nchannels = 0;
+
+		const char* comments = "Created with " FIRE_RENDER_NAME " " PLUGIN_VERSION;
+		imgSpec.attribute("ImageDescription", comments);
+		imgSpec.attribute("compression", aovs.GetEXRCompressionType().asChar());
+
+		if (aovs.IsCryptomatteMaterial())
+		{
+			imgSpec.attribute("cryptomatte/be93ba3/conversion", "uint32_to_float32");
+			imgSpec.attribute("cryptomatte/be93ba3/hash", "MurmurHash3_32");
+			imgSpec.attribute("cryptomatte/be93ba3/name", "CryptoMaterial");
+		}
 
-		if (aov.id == RPR_AOV_DEEP_COLOR)
+		if (aovs.IsCryptomatteObject())
 		{
-			return;
+			imgSpec.attribute("cryptomatte/d593dd7/conversion", "uint32_to_float32");
+			imgSpec.attribute("cryptomatte/d593dd7/hash", "MurmurHash3_32");
+			imgSpec.attribute("cryptomatte/d593dd7/name", "CryptoObject");
 		}
 
-		for (const char* c : aov.description.components)
+		//fill image spec setting up channels for each aov
+		aovs.ForEachActiveAOV([&](FireRenderAOV& aov)
 		{
-			if (!c)
-				continue;
+			assert(aov.IsActive());
+
+			if (aov.id == RPR_AOV_DEEP_COLOR)
+			{
+				return;
+			}
 
-			++aov_component_count;
-			++imgSpec.nchannels;
+			MultichannelSource source;
 
-			std::string name = (0 == aov.id) ? c : (std::string(aov.folder.asChar()) + "." + c);
-			imgSpec.channelnames.push_back(name);
+			for (const char* c : aov.description.components)
+			{
+				if (!c)
+					continue;
 
-			TypeDesc::BASETYPE channelFormat = aov.IsCryptomateiralAOV() ? TypeDesc::FLOAT : aovs.GetChannelFormat();
-			imgSpec.channelformats.push_back(channelFormat);
-		}
+				++source.componentCount;
+				++imgSpec.nchannels;
 
-		aovs_component_count[aov.id] = aov_component_count;
-	});
+				std::string name = (0 == aov.id) ? c : (std::string(aov.folder.asChar()) + "." + c);
+				imgSpec.channelnames.push_back(name);
 
-	size_t pixel_size = imgSpec.nchannels;
-	std::vector<float> pixels_for_oiio;
-	pixels_for_oiio.resize(imgSpec.image_pixels() * pixel_size);
+				// half channels are converted by OIIO while the chunk is being written
+				TypeDesc::BASETYPE channelFormat = aov.IsCryptomateiralAOV() ? TypeDesc::FLOAT : aovs.GetChannelFormat();
+				imgSpec.channelformats.push_back(channelFormat);
+			}
 
-	//interleave aov components for OIIO(each pixel contains all channels data)
-	for (unsigned int y = 0; y < height; ++y)
+			if (source.componentCount == 0)
+				return;
+
+			if (takeBuffers)
+			{
+				auto buffer = std::make_shared<PixelBuffer>();
+				buffer->swap(aov.pixels);
+				image.ownedBuffers.push_back(buffer);
+				source.pixels = buffer->get();
+			}
+			else
+			{
+				source.pixels = aov.pixels.get();
+			}
+
+			image.sources.push_back(source);
+		});
+	}
+
+	bool writeMultichannelImage(const MultichannelImage& image)
 	{
-		for (unsigned int x = 0; x < width; ++x)
-		{
-			unsigned int pixel_index = x + y * width;
+		std::unique_ptr<OIIO::ImageOutput> outImage(OIIO::ImageOutput::create(image.formatPath));
+		if (!outImage || image.spec.nchannels == 0)
+			return false;
+
+		if (!outImage->open(image.filePath, image.spec))
+			return false;
+
+		const size_t pixelSize = image.spec.nchannels;
+		const size_t width = image.width;
+
+		std::vector<float> chunk(width * MultichannelChunkRows * pixelSize);
 
-			float* pixel = pixels_for_oiio.data() + pixel_size * pixel_index;
+		bool written = true;
 
-			aovs.ForEachActiveAOV([&](FireRenderAOV& aov)
+		for (unsigned int chunkBegin = 0; chunkBegin < image.height && written; chunkBegin += MultichannelChunkRows)
+		{
+			unsigned int chunkEnd = chunkBegin + MultichannelChunkRows;
+			if (chunkEnd > image.height)
+				chunkEnd = image.height;
+
+			// interleave aov components for OIIO(each pixel contains all channels data), rows are independent
+			FireMaya::WorkerPool::Instance().ParallelForRange(chunkEnd - chunkBegin, 1, [&](size_t rowBegin, size_t rowEnd)
 			{
-				if (aov.id == RPR_AOV_DEEP_COLOR)
+				for (size_t row = rowBegin; row < rowEnd; ++row)
 				{
-					return;
-				}
+					float* dstRow = chunk.data() + row * width * pixelSize;
+					size_t srcOffset = (chunkBegin + row) * width;
+					size_t channelOffset = 0;
 
-				int aov_component_count = aovs_component_count[aov.id];
-				if (aov_component_count)
-				{
-					auto aov_pixel = aov.pixels.get()[pixel_index];
-					pixel = std::copy(&aov_pixel.r, (&aov_pixel.r) + aov_component_count, pixel);
+					for (const MultichannelSource& source : image.sources)
+					{
+						const RV_PIXEL* src = source.pixels + srcOffset;
+						float* dst = dstRow + channelOffset;
+
+						for (size_t x = 0; x < width; ++x, dst += pixelSize)
+						{
+							const float* srcPixel = &src[x].r;
+
+							for (unsigned int c = 0; c < source.componentCount; ++c)
+								dst[c] = srcPixel[c];
+						}
+
+						channelOffset += source.componentCount;
+					}
 				}
 			});
+
+			written = outImage->write_scanlines(chunkBegin, chunkEnd, 0, OIIO::TypeDesc::FLOAT, chunk.data());
 		}
+
+		outImage->close();
+
+		return written;
 	}
 
-	if (outImage->open(filePath.asUTF8(), imgSpec))
+	// Returns path OIIO recognizes the output format from, empty if there is no writer for it
+	MString getMultichannelFormatPath(const MString& filePath, unsigned int imageFormat)
 	{
-		outImage->write_image(OIIO::TypeDesc::FLOAT, pixels_for_oiio.data());
-		outImage->close();
+		auto outImage = std::unique_ptr<OIIO::ImageOutput>(OIIO::ImageOutput::create(filePath.asUTF8()));
+		if (outImage)
+			return filePath;
+
+		auto nameWithExt = filePath + "." + FireRenderImageUtil::getImageFormatExtension(imageFormat);
+		outImage = std::unique_ptr<OIIO::ImageOutput>(OIIO::ImageOutput::create(nameWithExt.asUTF8()));
+
+		return outImage ? nameWithExt : MString();
 	}
+}
 
-	delete outImage;
+// -----------------------------------------------------------------------------
+bool FireRenderImageUtil::saveMultichannelAOVs(MString filePath,
+	unsigned int width, unsigned int height, unsigned int imageFormat, FireRenderAOVs& aovs)
+{
+	MString formatPath = getMultichannelFormatPath(filePath, imageFormat);
+	if (formatPath.length() == 0)
+	{
+		return false;
+	}
+
+	MultichannelImage image;
+	image.formatPath = formatPath.asUTF8();
+	image.filePath = filePath.asUTF8();
+	image.width = width;
+	image.height = height;
 
-	// This is to deallocate from our module, else it will be released in the openimageio.dll
-	// (in obj destructor) and lead to crash. Because we have filled those arrays in our code,
-	// oiio has no api functions to fill those safely(so that vector operations are called from ooio code)
-	// unfortunately
-	std::vector<OIIO::TypeDesc> temp0 = std::vector<OIIO::TypeDesc>();
-	imgSpec.channelformats.swap(temp0);
-	std::vector<std::string> temp1 = std::vector<std::string>();
-	imgSpec.channelnames.swap(temp1);
+	describeMultichannelImage(image, aovs, false);
 
-	return true;
+	return writeMultichannelImage(image);
+}
+
+// -----------------------------------------------------------------------------
+std::future<bool> FireRenderImageUtil::saveMultichannelAOVsAsync(MString filePath,
+	unsigned int width, unsigned int height, unsigned int imageFormat, FireRenderAOVs& aovs)
+{
+	MString formatPath = getMultichannelFormatPath(filePath, imageFormat);
+	if (formatPath.length() == 0)
+	{
+		std::promise<bool> failed;
+		failed.set_value(false);
+		return failed.get_future();
+	}
+
+	auto image = std::make_shared<MultichannelImage>();
+	image->formatPath = formatPath.asUTF8();
+	image->filePath = filePath.asUTF8();
+	image->width = width;
+	image->height = height;
+
+	describeMultichannelImage(*image, aovs, true);
+
+	// own thread, so interleaving still runs in parallel on the worker pool
+	return std::async(std::launch::async, [image]()
+	{
+		return writeMultichannelImage(*image);
+	});
 }
 
 static const std::map<unsigned int, std::string> imageFormats =
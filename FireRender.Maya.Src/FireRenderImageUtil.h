@@ -15,6 +15,7 @@ limitations under the License.
 #include "FireRenderAOVs.h"
 #include <maya/MRenderView.h>
 #include <maya/MString.h>
+#include <future>
 
 enum EXRCompressionMethod
 {
@@ -41,10 +42,15 @@ public:
 	static void saveMayaImage(MString filePath, unsigned int width, unsigned int height,
 		RV_PIXEL* pixels, unsigned int imageFormat);
 
-	/** Save AOVs to a multi-channel file. */
+	/** Save AOVs to a multi-channel file. Channels are interleaved and written in chunks of scanlines. */
 	static bool saveMultichannelAOVs(MString filePath,
 		unsigned int width, unsigned int height, unsigned int imageFormat, FireRenderAOVs& aovs);
 
+	/** Save AOVs to a multi-channel file on a background thread.
+		Pixel buffers of the active AOVs are moved to the writer, so they are empty when this returns. */
+	static std::future<bool> saveMultichannelAOVsAsync(MString filePath,
+		unsigned int width, unsigned int height, unsigned int imageFormat, FireRenderAOVs& aovs);
+
 	/** Get an image format string for the given format value. */
 	static MString getImageFormatExtension(unsigned int format);
 };
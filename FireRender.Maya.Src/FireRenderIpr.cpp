@@ -25,6 +25,7 @@ limitations under the License.
 #include <maya/MRenderView.h>
 #include <maya/MViewport2Renderer.h>
 #include <maya/MGlobal.h>
+#include <maya/MTimerMessage.h>
 #include "maya/MItSelectionList.h"
 
 #include <thread>
@@ -35,17 +36,27 @@ using namespace std::chrono;
 using namespace RPR;
 using namespace FireMaya;
 
+namespace
+{
+	// how often renderViewUpdateCallback checks for scheduled updates
+	const float RenderViewTimerPeriod = 0.01f;
+}
+
+std::atomic<double> FireRenderIpr::s_maxRefreshRate(30.0);
+
 // Life Cycle
 // -----------------------------------------------------------------------------
 FireRenderIpr::FireRenderIpr() :
 	m_width(0),
 	m_height(0),
 	m_isRunning(false),
+	m_stopRequested(false),
 	m_isPaused(false),
 	m_isRegion(false),
 	m_renderStarted(false),
 	m_needsContextRefresh(false),
 	m_finishedFrame(false),
+	m_denoisePending(false),
 	m_previousSelectionList(),
 	m_currentAOVToDisplay(RPR_AOV_COLOR)
 {
@@ -249,7 +260,14 @@ bool FireRenderIpr::start()
 		// Ensure the scheduled update flag is clear initially.
 		m_renderViewUpdateScheduled = false;
 
+		if (!m_renderViewUpdateCallback)
+		{
+			m_renderViewUpdateCallback = MTimerMessage::addTimerCallback(RenderViewTimerPeriod, FireRenderIpr::renderViewUpdateCallback, this, &status);
+			CHECK_MSTATUS(status);
+		}
+
 		m_isRunning = true;
+		m_stopRequested = false;
 
 		// Start the render
 		FireRenderThread::KeepRunning([this]()
@@ -317,16 +335,16 @@ bool FireRenderIpr::stop()
 
 	if (m_isRunning)
 	{
+		m_stopRequested = true;
 		m_contextPtr->SetState(FireRenderContext::StateExiting);
 
 		stopMayaRender();
 
-		while (m_isRunning)
+		// main thread is notified when the item returns false and is removed
+		FireRenderThread::WaitOnMainThreadUntil([this]()
 		{
-			//Run items queued for main thread
-			FireRenderThread::RunItemsQueuedForTheMainThread();
-			this_thread::sleep_for(1ms);
-		}
+			return !m_isRunning;
+		});
 	}
 
 	if (m_renderGlobalsCallback)
@@ -335,6 +353,12 @@ bool FireRenderIpr::stop()
 		m_renderGlobalsCallback = 0;
 	}
 
+	if (m_renderViewUpdateCallback)
+	{
+		MMessage::removeCallback(m_renderViewUpdateCallback);
+		m_renderViewUpdateCallback = 0;
+	}
+
 	m_NorthStarRenderingHelper.StopAndJoin();
 
 	return true;
@@ -356,6 +380,9 @@ bool FireRenderIpr::RunOnViewportThread()
 {
 	RPR_THREAD_ONLY;
 
+	if (m_stopRequested)
+		return false;
+
 	if (m_contextPtr && !m_contextPtr->DoesContextSupportCurrentSettings())
 	{
 		// Restart IPR
@@ -389,6 +416,10 @@ bool FireRenderIpr::RunOnViewportThread()
 			{
 				m_finishedFrame = false;
 
+				// Denoised result of the previous frame is stale now
+				m_denoisePending = false;
+				m_contextPtr->CancelDenoiseJob();
+
 				// Render.
 				AutoMutexLock contextLock(m_contextLock);
 				m_contextPtr->render(false);
@@ -432,22 +463,31 @@ bool FireRenderIpr::RunOnViewportThread()
 					}
 				}
 
-				// run denoiser
-				if (m_contextPtr->IsDenoiserEnabled() && isOutputAOVColor)
-				{
-					std::vector<float> vecData = m_contextPtr->DenoiseIntoRAM();
-					assert(vecData.size() != 0);
-					if (vecData.size() == 0)
-						return true;
+				// run denoiser in background, render view is updated when the result is ready
+				m_denoisePending = m_contextPtr->IsDenoiserEnabled() && isOutputAOVColor;
+			}
+
+			if (m_denoisePending && !m_contextPtr->IsDenoiseJobRunning())
+			{
+				m_denoisePending = false;
+				m_contextPtr->StartDenoiseJob(false);
+			}
 
-					RV_PIXEL* data = (RV_PIXEL*)vecData.data();
+			if (m_contextPtr->TakeDenoisedFrame(m_denoisedPixels) &&
+				(m_denoisedPixels.size() * sizeof(float) >= sizeof(RV_PIXEL) * m_pixels.size()))
+			{
+				{
+					AutoMutexLock pixelsLock(m_pixelsLock);
 
 					// put denoised image to ipr buffer
-					memcpy(m_pixels.data(), data, sizeof(RV_PIXEL) * m_pixels.size());
-
-					scheduleRenderViewUpdate();
+					memcpy(m_pixels.data(), m_denoisedPixels.data(), sizeof(RV_PIXEL) * m_pixels.size());
 				}
+
+				scheduleRenderViewUpdate();
 			}
+
+			// Frame is complete, the thread sleeps until scene, camera or state change or denoiser finishes
+			FireRenderThread::ReportIdle();
 		}
 
 		return true;
@@ -456,6 +496,7 @@ bool FireRenderIpr::RunOnViewportThread()
 	case FireRenderContext::StatePaused:
 	case FireRenderContext::StateUpdating:
 	default:
+		FireRenderThread::ReportIdle();
 		return true;
 	}
 }
@@ -550,6 +591,7 @@ void FireRenderIpr::updateRenderView()
 	AutoMutexLock refreshLock(m_refreshLock);
 	// Clear the scheduled flag.
 	m_renderViewUpdateScheduled = false;
+	m_lastRenderViewUpdate = steady_clock::now();
 
 	CheckSelection();
 
@@ -561,7 +603,7 @@ void FireRenderIpr::updateRenderView()
 		// Acquire the pixels lock.
 		AutoMutexLock pixelsLock(m_pixelsLock);
 
-		RenderViewUpdater::UpdateAndRefreshRegion(m_pixels.data(), m_region.getWidth(), m_region.getHeight(), m_region);
+		RenderViewUpdater::UpdateAndRefreshChangedTiles(m_pixels.data(), m_region.getWidth(), m_region.getHeight(), m_region);
 
 		updateMayaRenderInfo();
 
@@ -572,22 +614,50 @@ void FireRenderIpr::updateRenderView()
 
 	// Refresh the context if required.
 	m_needsContextRefresh = true;
+	FireRenderThread::Wake();
 }
 
 // -----------------------------------------------------------------------------
 void FireRenderIpr::scheduleRenderViewUpdate()
 {
-	AutoMutexLock refreshLock(m_refreshLock);
+	// Picked up by renderViewUpdateCallback, several iterations
+	// rendered between two timer ticks result in a single update.
+	m_renderViewUpdateScheduled = true;
+}
 
-	// Only schedule one update at a time.
-	if (m_renderViewUpdateScheduled)
+// -----------------------------------------------------------------------------
+void FireRenderIpr::renderViewUpdateCallback(float, float, void* clientData)
+{
+	FireRenderIpr* ipr = static_cast<FireRenderIpr*>(clientData);
+
+	if (!ipr->m_renderViewUpdateScheduled)
 		return;
 
-	// Schedule the update.
-	MGlobal::executeCommandOnIdle("fireRender -ipr -updateRenderView", false);
+	double maxRefreshRate = s_maxRefreshRate;
+	if ((maxRefreshRate > 0.0) && (steady_clock::now() - ipr->m_lastRenderViewUpdate < duration<double>(1.0 / maxRefreshRate)))
+		return;
 
-	// Flag as scheduled.
-	m_renderViewUpdateScheduled = true;
+	// Errors are handled by the command which stops the IPR
+	if (ipr->isError())
+	{
+		ipr->m_renderViewUpdateScheduled = false;
+		MGlobal::executeCommandOnIdle("fireRender -ipr -updateRenderView", false);
+		return;
+	}
+
+	ipr->updateRenderView();
+}
+
+// -----------------------------------------------------------------------------
+void FireRenderIpr::setMaxRefreshRate(double updatesPerSecond)
+{
+	s_maxRefreshRate = (updatesPerSecond > 0.0) ? updatesPerSecond : 0.0;
+}
+
+// -----------------------------------------------------------------------------
+double FireRenderIpr::getMaxRefreshRate()
+{
+	return s_maxRefreshRate;
 }
 
 
@@ -607,6 +677,9 @@ void FireRenderIpr::startMayaRender()
 	else
 		MRenderView::startRender(m_width, m_height, true, true);
 
+	// Render view may be cleared, next update uploads whole region
+	RenderViewUpdater::Invalidate();
+
 	// Flag as started.
 	m_renderStarted = true;
 	pause(false);
@@ -20,6 +20,8 @@ limitations under the License.
 #include "NorthStarRenderingHelper.h"
 
 #include <mutex>
+#include <chrono>
+#include <atomic>
 
 /**
  * Manages an interactive photo real (IPR)
@@ -69,6 +71,10 @@ public:
 	/** Update the Maya render view. */
 	void updateRenderView();
 
+	/** Limits how many times per second the render view is updated, 0 - on every timer tick. */
+	static void setMaxRefreshRate(double updatesPerSecond);
+	static double getMaxRefreshRate();
+
 private:
 
 	// Life Cycle
@@ -88,9 +94,12 @@ private:
 	// Private Methods
 	// -----------------------------------------------------------------------------
 
-	/** Schedule a render view update. */
+	/** Schedule a render view update, updates requested before it is shown are coalesced. */
 	void scheduleRenderViewUpdate();
 
+	/** Timer callback, updates the render view if it was scheduled and the refresh rate allows. */
+	static void renderViewUpdateCallback(float elapsedTime, float lastTime, void* clientData);
+
 	/** Start the Maya render view render. */
 	void startMayaRender();
 
@@ -152,6 +161,9 @@ private:
 	/** True if the IPR is running. */
 	bool m_isRunning;
 
+	/** Set by stop, context state can't be used for that because Lock restores the previous state. */
+	std::atomic<bool> m_stopRequested;
+
 	/** True if the IPR is paused. */
 	bool m_isPaused;
 
@@ -159,11 +171,25 @@ private:
 
 	bool m_finishedFrame;
 
+	/** True if denoiser should be started as soon as the previous (stale) job finishes. */
+	bool m_denoisePending;
+
+	/** Denoised frame taken from the context, kept to reuse its storage. */
+	std::vector<float> m_denoisedPixels;
+
 	unsigned int m_currentAOVToDisplay;
 
 	/** True if a render view update is scheduled. */
 	std::atomic<bool> m_renderViewUpdateScheduled;
 
+	/** Time of the last render view update, used to limit the refresh rate. */
+	std::chrono::steady_clock::time_point m_lastRenderViewUpdate;
+
+	MCallbackId m_renderViewUpdateCallback = 0;
+
+	/** Maximum render view updates per second. */
+	static std::atomic<double> s_maxRefreshRate;
+
 	/** A lock to control access to the system memory frame buffer pixels. */
 	std::mutex m_pixelsLock;
 
@@ -17,8 +17,18 @@ limitations under the License.
 #include <maya/MPlug.h>
 #include <maya/MGlobal.h>
 #include <maya/MFileObject.h>
+#include <maya/MFnAttribute.h>
+#include <maya/MItDependencyGraph.h>
+#include <maya/MObjectHandle.h>
+#include <maya/MPlugArray.h>
+#include <maya/MStringArray.h>
 
 #include <thread>
+#include <filesystem>
+#include <unordered_map>
+#include <cstring>
+
+#include "common.h"
 
 #include "SkyBuilder.h"
 #include "FireRenderSkyLocator.h"
@@ -28,11 +38,108 @@ limitations under the License.
 using namespace FireMaya;
 using namespace std::chrono;
 
+namespace
+{
+	void AppendString(HashValue& hash, const MString& str)
+	{
+		const char* chars = str.asChar();
+		hash.Append(chars, int(strlen(chars)));
+	}
+
+	// Hash of the shader network: types, non default attribute values and connections of all upstream nodes.
+	// Modification time of files used by the network is included, so edited textures are rendered again
+	HashValue GetShaderNetworkHash(const MObject& shaderNode)
+	{
+		HashValue hash;
+
+		MStatus status;
+		MObject root = shaderNode;
+		MItDependencyGraph it(root, MFn::kInvalid, MItDependencyGraph::kUpstream, MItDependencyGraph::kDepthFirst, MItDependencyGraph::kNodeLevel, &status);
+		if (status != MStatus::kSuccess)
+			return hash;
+
+		// connections refer to nodes by traversal order, so the key does not depend on node names
+		std::vector<MObject> nodes;
+		std::unordered_map<unsigned int, size_t> nodeIndices;
+
+		for (; !it.isDone(); it.next())
+		{
+			MObject node = it.currentItem();
+			nodeIndices[MObjectHandle(node).hashCode()] = nodes.size();
+			nodes.push_back(node);
+		}
+
+		MStringArray commands;
+		MPlugArray connections;
+		MPlugArray sources;
+
+		for (const MObject& node : nodes)
+		{
+			MFnDependencyNode nodeFn(node);
+			AppendString(hash, nodeFn.typeName());
+
+			for (unsigned int attrIdx = 0; attrIdx < nodeFn.attributeCount(); ++attrIdx)
+			{
+				MObject attr = nodeFn.attribute(attrIdx);
+				MFnAttribute attrFn(attr);
+
+				// values of children are written by the parent
+				if (!attrFn.parent().isNull() || !attrFn.isWritable())
+					continue;
+
+				MPlug plug(node, attr);
+
+				commands.clear();
+				plug.getSetAttrCmds(commands, MPlug::kNonDefault);
+
+				for (unsigned int cmdIdx = 0; cmdIdx < commands.length(); ++cmdIdx)
+				{
+					AppendString(hash, commands[cmdIdx]);
+				}
+
+				if (attrFn.isUsedAsFilename())
+				{
+					MString path = plug.asString();
+
+					std::error_code error;
+					auto time = std::filesystem::last_write_time(std::filesystem::u8path(path.asUTF8()), error);
+					if (!error)
+					{
+						hash << time.time_since_epoch().count();
+					}
+				}
+			}
+
+			connections.clear();
+			nodeFn.getConnections(connections);
+
+			for (unsigned int plugIdx = 0; plugIdx < connections.length(); ++plugIdx)
+			{
+				connections[plugIdx].connectedTo(sources, true, false);
+
+				for (unsigned int srcIdx = 0; srcIdx < sources.length(); ++srcIdx)
+				{
+					AppendString(hash, connections[plugIdx].partialName());
+					AppendString(hash, sources[srcIdx].partialName());
+
+					auto found = nodeIndices.find(MObjectHandle(sources[srcIdx].node()).hashCode());
+					hash << (found != nodeIndices.end() ? found->second : nodes.size());
+				}
+			}
+		}
+
+		return hash;
+	}
+}
+
 FireRenderMaterialSwatchRender::FireRenderMaterialSwatchRender(MObject obj, MObject renderObj, int res) :
 	MSwatchRenderBase(obj, renderObj, res),
 	m_runningAsyncRender(false),
 	m_finishedAsyncRender(false),
-	m_cancelAsyncRender(false)
+	m_cancelAsyncRender(false),
+	m_resolution(res),
+	m_batched(false),
+	m_cacheKey(0)
 {
 
 }
@@ -102,17 +209,42 @@ bool FireRenderMaterialSwatchRender::setupFRNode()
 	auto disableSwatchPlug = nodeFn.findPlug("disableSwatch");
 
 	bool enableSwatches = false;
-	FireRenderGlobalsData::getThumbnailIterCount(&enableSwatches);
+	int iterations = FireRenderGlobalsData::getThumbnailIterCount(&enableSwatches);
 	 
 	if (enableSwatches && (disableSwatchPlug.isNull() || !disableSwatchPlug.asBool()))
 	{
 		FireRenderSwatchInstance& swatchInstance = getSwatchInstance();
 
+		m_resolution = resolution();
+		m_batched = FireRenderGlobalsData::getThumbnailBatchSize() > 1;
+		m_cacheKey = 0;
+
+		if (FireRenderGlobalsData::isThumbnailCacheEnabled() && swatchInstance.getSwatchCache().IsEnabled())
+		{
+			HashValue key = GetShaderNetworkHash(mnode);
+			// batched and single renders differ in noise, so their images are cached under different keys
+			key << m_resolution << iterations << (m_batched ? 1 : 0);
+			key.Append(PLUGIN_VERSION, int(sizeof(PLUGIN_VERSION)));
+
+			m_cacheKey = size_t(key) != 0 ? uint64_t(size_t(key)) : 1;
+
+			StoredFrame frame;
+			if (swatchInstance.getSwatchCache().Load(m_cacheKey, m_resolution, m_resolution, frame))
+			{
+				std::vector<float> scratch;
+				const float* pixels = frame.Pixels(scratch);
+
+				std::vector<float> data(pixels, pixels + size_t(m_resolution) * m_resolution * 4);
+				setImagePixels(data, m_resolution, m_resolution);
+
+				// nothing to render, image is taken from the cache
+				return false;
+			}
+		}
+
 		m_shader = swatchInstance.getContext().GetShader(mnode);
 		m_volumeShader = swatchInstance.getContext().GetVolumeShader(mnode);
 
-		m_resolution = resolution();
-
 		return true;
 	}
 
@@ -122,7 +254,10 @@ bool FireRenderMaterialSwatchRender::setupFRNode()
 void FireRenderMaterialSwatchRender::processFromBackgroundThread()
 {
 	if (m_cancelAsyncRender)
+	{
+		releaseAsyncRender();
 		return;
+	}
 
 	try
 	{
@@ -172,6 +307,31 @@ void FireRenderMaterialSwatchRender::processFromBackgroundThread()
 		finalizeRendering();
 	}
 
+	releaseAsyncRender();
+}
+
+void FireRenderMaterialSwatchRender::finishBatchedRender(std::vector<float>& pixels)
+{
+	m_finishedAsyncRender = !m_cancelAsyncRender;
+
+	if (m_finishedAsyncRender)
+	{
+		storeInCache(pixels);
+		setImagePixels(pixels, m_resolution, m_resolution);
+
+		finishParallelRender();
+	}
+
+	releaseAsyncRender();
+}
+
+void FireRenderMaterialSwatchRender::cancelBatchedRender()
+{
+	releaseAsyncRender();
+}
+
+void FireRenderMaterialSwatchRender::releaseAsyncRender()
+{
 	std::unique_lock<std::mutex> lck(m_cancellationMutex);
 	m_runningAsyncRender = false;
 	m_cancellationCondVar.notify_one();
@@ -185,16 +345,38 @@ bool FireRenderMaterialSwatchRender::finalizeRendering()
 	unsigned int height = context.m_height;
 	std::vector<float> data = context.getRenderImageData();
 
-	MImage& img = image();
+	if ((width == (unsigned int) m_resolution) && (height == (unsigned int) m_resolution))
+	{
+		storeInCache(data);
+	}
 
-	img.setFloatPixels(data.data(), width, height);
-	img.convertPixelFormat(MImage::kByte);
+	setImagePixels(data, width, height);
 
 	finishParallelRender();
 
 	return true;
 }
 
+void FireRenderMaterialSwatchRender::setImagePixels(std::vector<float>& pixels, unsigned int width, unsigned int height)
+{
+	MImage& img = image();
+
+	img.setFloatPixels(pixels.data(), width, height);
+	img.convertPixelFormat(MImage::kByte);
+}
+
+void FireRenderMaterialSwatchRender::storeInCache(const std::vector<float>& pixels)
+{
+	if (m_cacheKey == 0)
+		return;
+
+	StoredFrame frame(m_resolution, m_resolution);
+	memcpy(frame.data(), pixels.data(), size_t(m_resolution) * m_resolution * 4 * sizeof(float));
+	frame.Compact();
+
+	getSwatchInstance().getSwatchCache().Save(m_cacheKey, m_resolution, m_resolution, frame);
+}
+
 bool FireRenderMaterialSwatchRender::doIterationForNonFRNode()
 {
 	MImage& img = image();
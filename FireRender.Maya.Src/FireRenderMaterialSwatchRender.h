@@ -21,6 +21,8 @@ limitations under the License.
 
 #include <mutex>              // std::mutex, std::unique_lock
 #include <condition_variable> // std::condition_variable
+#include <vector>
+#include <cstdint>
 
 
 class FireRenderSwatchInstance;
@@ -47,7 +49,17 @@ public:
 
 	void processFromBackgroundThread();
 
+	// Swatch is rendered as a tile of the batch frame, pixels are the tile cut from the frame
+	void finishBatchedRender(std::vector<float>& pixels);
+	void cancelBatchedRender();
+
 	void setAsyncRunning(bool val) { m_runningAsyncRender = val; }
+	bool isCancelled() const { return m_cancelAsyncRender; }
+
+	const frw::Shader& getShader() const { return m_shader; }
+	const frw::Shader& getVolumeShader() const { return m_volumeShader; }
+	int getResolution() const { return m_resolution; }
+	bool isBatched() const { return m_batched; }
 
 	// Creator function
 	static MSwatchRenderBase* creator(MObject dependNode, MObject renderNode, int imageResolution);
@@ -55,6 +67,9 @@ public:
 private:
 	bool doIterationForNonFRNode();
 	bool finalizeRendering();
+	void setImagePixels(std::vector<float>& pixels, unsigned int width, unsigned int height);
+	void storeInCache(const std::vector<float>& pixels);
+	void releaseAsyncRender();
 
 	bool IsFRNode() const;
 	bool setupFRNode();
@@ -69,6 +84,12 @@ private:
 
 	int m_resolution;
 
+	// swatch is rendered as a tile of the batch frame (FireRenderSwatchInstance::ProcessBatch)
+	bool m_batched;
+
+	// key of the rendered image in the swatch disk cache, 0 if the cache is not used
+	uint64_t m_cacheKey;
+
 	// for cancelation synchronization
 	std::mutex m_cancellationMutex;
 	std::condition_variable m_cancellationCondVar;
@@ -15,14 +15,14 @@ limitations under the License.
 FireRenderMeshMASH::FireRenderMeshMASH(const FireRenderMesh& rhs, const std::string& uuid, const MObject instancer)
 	: FireRenderMesh(rhs, uuid),
 	m_Instancer(instancer),
-	m_originalFRMesh(rhs)
-{ 
-	m_SelfTransform.setToIdentity();
+	m_originalFRMesh(rhs),
+	m_allInstancesChanged(true)
+{
 }
 
-void FireRenderMeshMASH::SetSelfTransform(const MMatrix& matrix)
+FireRenderMeshMASH::~FireRenderMeshMASH()
 {
-	m_SelfTransform = matrix;
+	detachFromScene();
 }
 
 bool FireRenderMeshMASH::IsMeshVisible(const MDagPath& meshPath, const FireRenderContext* context) const
@@ -34,11 +34,6 @@ bool FireRenderMeshMASH::IsMeshVisible(const MDagPath& meshPath, const FireRende
 	return instancerPath.isVisible();
 }
 
-MMatrix FireRenderMeshMASH::GetSelfTransform()
-{
-	return m_SelfTransform;
-}
-
 bool FireRenderMeshMASH::ReloadMesh(unsigned int sampleIdx /*= 0*/)
 {
 	return (FireRenderMesh::ReloadMesh(sampleIdx));
@@ -47,5 +42,324 @@ bool FireRenderMeshMASH::ReloadMesh(unsigned int sampleIdx /*= 0*/)
 void FireRenderMeshMASH::Rebuild(void)
 {
 	FireRenderMesh::Rebuild();
+
+	// rebuild can come from mesh own dirty callbacks as well, without the instancer being freshened,
+	// so instances of recreated shape (or with new shaders) are synced here
+	SyncInstances();
+}
+
+void FireRenderMeshMASH::SetInstanceCount(size_t count)
+{
+	m_instanceMatrices.resize(count * 16);
+	m_changedInstances.clear();
+	m_allInstancesChanged = true;
+}
+
+void FireRenderMeshMASH::MarkInstancesChanged(const std::vector<uint32_t>& instanceIndices)
+{
+	if (m_allInstancesChanged)
+		return;
+
+	m_changedInstances.insert(m_changedInstances.end(), instanceIndices.begin(), instanceIndices.end());
 }
 
+void FireRenderMeshMASH::detachFromScene()
+{
+	if (!m_isVisible)
+		return;
+
+	if (auto scene = context()->GetScene())
+	{
+		for (frw::Shape& shape : m_instanceShapes)
+		{
+			if (shape)
+				scene.Detach(shape);
+		}
+
+		SetIsVisible(false);
+	}
+}
+
+void FireRenderMeshMASH::attachToScene()
+{
+	if (m_isVisible)
+		return;
+
+	if (auto scene = context()->GetScene())
+	{
+		for (frw::Shape& shape : m_instanceShapes)
+		{
+			if (shape)
+				scene.Attach(shape);
+		}
+
+		SetIsVisible(true);
+	}
+}
+
+bool FireRenderMeshMASH::HasCatcherShader(void) const
+{
+	for (const FrElement& element : m.elements)
+	{
+		for (const frw::Shader& shader : element.shaders)
+		{
+			if (shader.IsShadowCatcher() || shader.IsReflectionCatcher())
+				return true;
+		}
+	}
+
+	return false;
+}
+
+void FireRenderMeshMASH::ApplyShaders(frw::Shape& instance, std::vector<std::vector<int>>& shaderFaceIds) const
+{
+	const FrElement& element = m.elements.back();
+
+	instance.SetShader(nullptr);
+
+	if (!shaderFaceIds.empty())
+	{
+		for (size_t shaderIdx = 0; shaderIdx < element.shaders.size(); ++shaderIdx)
+		{
+			if (!shaderFaceIds[shaderIdx].empty())
+			{
+				instance.SetPerFaceShader(element.shaders[shaderIdx], shaderFaceIds[shaderIdx]);
+			}
+		}
+	}
+	else if (!element.shaders.empty())
+	{
+		instance.SetShader(element.shaders.back());
+	}
+
+	if (element.volumeShader)
+	{
+		instance.SetVolumeShader(element.volumeShader);
+	}
+}
+
+void FireRenderMeshMASH::ApplyRenderFlags(frw::Shape& instance) const
+{
+	bool hasCatcher = HasCatcherShader();
+
+	instance.SetPrimaryVisibility(m_renderFlags.primaryVisibility);
+	instance.SetReflectionVisibility(m_renderFlags.reflectionVisibility && !hasCatcher);
+	instance.setRefractionVisibility(m_renderFlags.refractionVisibility && !hasCatcher);
+	instance.SetShadowFlag(m_renderFlags.castShadows);
+	instance.SetReceiveShadowFlag(m_renderFlags.receiveShadows);
+
+	if (m_renderFlags.hasContourVisibility)
+	{
+		instance.SetContourVisibilityFlag(m_renderFlags.contourVisibility);
+	}
+}
+
+void FireRenderMeshMASH::SyncInstances(void)
+{
+	frw::Shape baseShape;
+	if (!m.elements.empty())
+	{
+		baseShape = m.elements.back().shape;
+	}
+
+	frw::Scene scene = context()->GetScene();
+
+	// prototype shape has been recreated (or removed) => instances of previous shape are not valid anymore
+	if (!(baseShape == m_instancedShape))
+	{
+		if (m_isVisible && scene)
+		{
+			for (frw::Shape& shape : m_instanceShapes)
+			{
+				if (shape)
+					scene.Detach(shape);
+			}
+		}
+
+		m_instanceShapes.clear();
+		m_instancedShaders.clear();
+		m_instancedVolumeShader = frw::Shader();
+		m_instancedShape = baseShape;
+		m_allInstancesChanged = true;
+	}
+
+	if (!baseShape)
+	{
+		return;
+	}
+
+	size_t count = GetInstanceCount();
+
+	if (m_instanceShapes.size() > count)
+	{
+		if (m_isVisible && scene)
+		{
+			for (size_t idx = count; idx < m_instanceShapes.size(); ++idx)
+			{
+				scene.Detach(m_instanceShapes[idx]);
+			}
+		}
+
+		m_instanceShapes.resize(count);
+	}
+
+	// create missing instances in one go
+	size_t firstNewInstance = m_instanceShapes.size();
+	m_instanceShapes.resize(count);
+
+	frw::Context context = Context();
+	frw::Shape prototypeShape = GetPrototypeShape();
+	for (size_t idx = firstNewInstance; idx < count; ++idx)
+	{
+		m_instanceShapes[idx] = prototypeShape.CreateInstance(context);
+	}
+
+	// shaders of prototype are applied to every instance only if they have changed
+	const FrElement& element = m.elements.back();
+	bool shadersChanged = (element.shaders.size() != m_instancedShaders.size()) || !(element.volumeShader == m_instancedVolumeShader);
+	for (size_t shaderIdx = 0; !shadersChanged && (shaderIdx < element.shaders.size()); ++shaderIdx)
+	{
+		shadersChanged = !(element.shaders[shaderIdx] == m_instancedShaders[shaderIdx]);
+	}
+
+	size_t firstShaderInstance = shadersChanged ? 0 : firstNewInstance;
+
+	if (firstShaderInstance < count)
+	{
+		// faces of shaders are the same for every instance
+		std::vector<std::vector<int>> shaderFaceIds;
+		if ((element.shadingEngines.size() > 1) && (element.shaders.size() == element.shadingEngines.size()))
+		{
+			std::vector<int> sortedFaceIds;
+			std::vector<size_t> shaderFaceOffsets;
+			FireMaya::MeshTranslator::SortFacesByMaterial(GetFaceMaterialIndices(), element.shadingEngines.size(), sortedFaceIds, shaderFaceOffsets);
+
+			shaderFaceIds.resize(element.shaders.size());
+			for (size_t shaderIdx = 0; shaderIdx < shaderFaceIds.size(); ++shaderIdx)
+			{
+				shaderFaceIds[shaderIdx].assign(sortedFaceIds.begin() + shaderFaceOffsets[shaderIdx], sortedFaceIds.begin() + shaderFaceOffsets[shaderIdx + 1]);
+			}
+		}
+
+		for (size_t idx = firstShaderInstance; idx < count; ++idx)
+		{
+			ApplyShaders(m_instanceShapes[idx], shaderFaceIds);
+		}
+
+		m_instancedShaders = element.shaders;
+		m_instancedVolumeShader = element.volumeShader;
+	}
+
+	// flags of existing instances are updated by setters
+	for (size_t idx = firstNewInstance; idx < count; ++idx)
+	{
+		ApplyRenderFlags(m_instanceShapes[idx]);
+	}
+
+	// transforms
+	if (m_allInstancesChanged)
+	{
+		for (size_t idx = 0; idx < count; ++idx)
+		{
+			m_instanceShapes[idx].SetTransform(GetInstanceMatrix(idx));
+		}
+	}
+	else
+	{
+		for (uint32_t idx : m_changedInstances)
+		{
+			m_instanceShapes[idx].SetTransform(GetInstanceMatrix(idx));
+		}
+
+		for (size_t idx = firstNewInstance; idx < count; ++idx)
+		{
+			m_instanceShapes[idx].SetTransform(GetInstanceMatrix(idx));
+		}
+	}
+
+	m_changedInstances.clear();
+	m_allInstancesChanged = false;
+
+	if (m_isVisible && scene)
+	{
+		for (size_t idx = firstNewInstance; idx < count; ++idx)
+		{
+			scene.Attach(m_instanceShapes[idx]);
+		}
+	}
+}
+
+void FireRenderMeshMASH::setReflectionVisibility(bool reflectionVisibility)
+{
+	FireRenderMesh::setReflectionVisibility(reflectionVisibility);
+
+	m_renderFlags.reflectionVisibility = reflectionVisibility;
+	bool value = reflectionVisibility && !HasCatcherShader();
+
+	for (frw::Shape& shape : m_instanceShapes)
+	{
+		shape.SetReflectionVisibility(value);
+	}
+}
+
+void FireRenderMeshMASH::setRefractionVisibility(bool refractionVisibility)
+{
+	FireRenderMesh::setRefractionVisibility(refractionVisibility);
+
+	m_renderFlags.refractionVisibility = refractionVisibility;
+	bool value = refractionVisibility && !HasCatcherShader();
+
+	for (frw::Shape& shape : m_instanceShapes)
+	{
+		shape.setRefractionVisibility(value);
+	}
+}
+
+void FireRenderMeshMASH::setCastShadows(bool castShadow)
+{
+	FireRenderMesh::setCastShadows(castShadow);
+
+	m_renderFlags.castShadows = castShadow;
+
+	for (frw::Shape& shape : m_instanceShapes)
+	{
+		shape.SetShadowFlag(castShadow);
+	}
+}
+
+void FireRenderMeshMASH::setReceiveShadows(bool receiveShadow)
+{
+	FireRenderMesh::setReceiveShadows(receiveShadow);
+
+	m_renderFlags.receiveShadows = receiveShadow;
+
+	for (frw::Shape& shape : m_instanceShapes)
+	{
+		shape.SetReceiveShadowFlag(receiveShadow);
+	}
+}
+
+void FireRenderMeshMASH::setPrimaryVisibility(bool primaryVisibility)
+{
+	FireRenderMesh::setPrimaryVisibility(primaryVisibility);
+
+	m_renderFlags.primaryVisibility = primaryVisibility;
+
+	for (frw::Shape& shape : m_instanceShapes)
+	{
+		shape.SetPrimaryVisibility(primaryVisibility);
+	}
+}
+
+void FireRenderMeshMASH::setContourVisibility(bool contourVisibility)
+{
+	FireRenderMesh::setContourVisibility(contourVisibility);
+
+	m_renderFlags.contourVisibility = contourVisibility;
+	m_renderFlags.hasContourVisibility = true;
+
+	for (frw::Shape& shape : m_instanceShapes)
+	{
+		shape.SetContourVisibilityFlag(contourVisibility);
+	}
+}
@@ -14,27 +14,82 @@ limitations under the License.
 #include "FireRenderObjects.h"
 #include "Context/FireRenderContext.h"
 
+#include <cstdint>
+
+/**
+	Prototype of MASH instances: one object per shape instanced by MASH.
+	Mesh is translated once, its shape is not attached to scene and is used as the base
+	of rpr instances created in bulk for every MASH point which uses the shape.
+*/
 class FireRenderMeshMASH : public FireRenderMesh
 {
-	/** Contain generated matrix from MASH */
-	MMatrix m_SelfTransform;
 	MObject m_Instancer;
 
 public:
 	FireRenderMeshMASH(const FireRenderMesh& rhs, const std::string& uuid, const MObject instancer);
-	void SetSelfTransform(const MMatrix& matrix);
+	virtual ~FireRenderMeshMASH();
 
 	const FireRenderMesh& GetOriginalFRMeshinstancedObject() const { return m_originalFRMesh; }
 
 	virtual void Rebuild(void) override;
 	virtual bool ReloadMesh(unsigned int sampleIdx = 0) override;
 
+	/** Resizes instance arrays, all instances are marked as changed */
+	void SetInstanceCount(size_t count);
+	size_t GetInstanceCount(void) const { return m_instanceMatrices.size() / 16; }
+
+	/** Row major matrix of instance (in meters), is applied to rpr instance on next SyncInstances */
+	float* GetInstanceMatrix(size_t instanceIdx) { return &m_instanceMatrices[instanceIdx * 16]; }
+	void MarkInstancesChanged(const std::vector<uint32_t>& instanceIndices);
+	void MarkAllInstancesChanged(void) { m_changedInstances.clear(); m_allInstancesChanged = true; }
+
+	/** Creates missing rpr instances of prototype shape and applies materials, render flags and changed transforms.
+		Is called by Rebuild */
+	void SyncInstances(void);
+
+	virtual void setReflectionVisibility(bool reflectionVisibility) override;
+	virtual void setRefractionVisibility(bool refractionVisibility) override;
+	virtual void setCastShadows(bool castShadow) override;
+	virtual void setReceiveShadows(bool receiveShadow) override;
+	virtual void setPrimaryVisibility(bool primaryVisibility) override;
+	virtual void setContourVisibility(bool contourVisibility) override;
+
 protected:
 	/** Logic should be changed to not pass DagPath into the function, because it's not used in MASH visibility check */
 	virtual bool IsMeshVisible(const MDagPath& meshPath, const FireRenderContext* context) const final override;
-	virtual MMatrix GetSelfTransform() final override;
+	virtual bool IsGeometryShareable(void) const final override { return false; } // instances can't be created from rpr instance
+
+	// only instances are attached to scene
+	virtual void detachFromScene() override;
+	virtual void attachToScene() override;
+
+private:
+	bool HasCatcherShader(void) const;
+	void ApplyShaders(frw::Shape& instance, std::vector<std::vector<int>>& shaderFaceIds) const;
+	void ApplyRenderFlags(frw::Shape& instance) const;
 
 private:
 	const FireRenderMesh& m_originalFRMesh;
-};
 
+	std::vector<frw::Shape> m_instanceShapes;
+	std::vector<float> m_instanceMatrices; // 16 floats per instance
+
+	std::vector<uint32_t> m_changedInstances;
+	bool m_allInstancesChanged;
+
+	// prototype shape and shaders applied to instances
+	frw::Shape m_instancedShape;
+	std::vector<frw::Shader> m_instancedShaders;
+	frw::Shader m_instancedVolumeShader;
+
+	struct
+	{
+		bool primaryVisibility = true;
+		bool reflectionVisibility = true;
+		bool refractionVisibility = true;
+		bool castShadows = true;
+		bool receiveShadows = true;
+		bool contourVisibility = false;
+		bool hasContourVisibility = false;
+	} m_renderFlags;
+};
@@ -16,6 +16,7 @@ limitations under the License.
 #include "base_mesh.h"
 #include "FireRenderDisplacement.h"
 #include "SkyBuilder.h"
+#include "Translators/MeshCache.h"
 
 #include <float.h>
 #include <array>
@@ -52,6 +53,9 @@ limitations under the License.
 #include <ostream>
 #include <sstream>
 #include <fstream>
+#include <filesystem>
+#include <functional>
+#include <set>
 
 #include <Xgen/src/xgsculptcore/api/XgSplineAPI.h>
 
@@ -84,6 +88,9 @@ FireRenderObject::FireRenderObject(const FireRenderObject& rhs, const std::strin
 FireRenderObject::~FireRenderObject()
 {
 	FireRenderObject::clear();
+
+	if (m.context)
+		m.context->RemoveFromStateHash(this);
 }
 
 std::string FireRenderObject::uuid() const
@@ -153,14 +160,24 @@ void FireRenderObject::Dump(const MObject& ob, int depth, int maxDepth)
 
 HashValue FireRenderObject::GetHash(const MObject& ob)
 {
+	// hash node uuid rather than MObject contents so the value is stable across sessions
 	HashValue hash;
-	hash << ob;
+
+	if (!ob.isNull())
+	{
+		std::string nodeId = getNodeUUid(ob);
+		hash.Append(nodeId.c_str(), int(nodeId.size()));
+	}
+
 	return hash;
 }
 
 HashValue FireRenderObject::CalculateHash()
 {
-	return GetHash(Object());
+	// m.uuid also contains instance number for instanced dag nodes
+	HashValue hash;
+	hash.Append(m.uuid.c_str(), int(m.uuid.size()));
+	return hash;
 }
 
 HashValue FireRenderNode::CalculateHash()
@@ -259,6 +276,14 @@ void FireRenderNode::OnPlugDirty(MObject& node, MPlug &plug)
 	setDirty();
 }
 
+void FireRenderNode::SetIsVisible(bool isVisible)
+{
+	m_isVisible = isVisible;
+
+	if (context())
+		context()->SetStateHashAttached(this, isVisible);
+}
+
 void FireRenderNode::OnWorldMatrixChanged()
 {
 	m_bIsTransformChanged = true;
@@ -278,15 +303,13 @@ HashValue GetHashValue(const MPlug& plug)
 	if (!attr.isWritable() || attr.isDynamic())
 		return hash;
 
-	if (plug.isArray())
+	// compound children are attributes of the node too, so they are hashed separately
+	if (plug.isArray() || plug.isCompound())
 		return hash;
 
 	if (plug.isIgnoredWhenRendering())
 		return hash;
 
-	if (!plug.isKeyable())
-		return hash;
-
 	auto data = plug.asMDataHandle();
 
 	auto type = data.type();
@@ -356,6 +379,11 @@ HashValue GetHashValue(const MPlug& plug)
 	{
 		hash << data.asMatrix();
 	}	break;
+	case MFnData::kString:
+	{
+		MString value = data.asString();
+		hash.Append(value.asUTF8(), int(value.length()));
+	}	break;
 	case MFnData::kDoubleArray:
 	case MFnData::kFloatArray:
 	case MFnData::kIntArray:
@@ -366,6 +394,55 @@ HashValue GetHashValue(const MPlug& plug)
 		break;
 	}
 
+	plug.destructHandle(data);
+
+	return hash;
+}
+
+HashValue FireRenderObject::GetNetworkHash(const MObject& ob, int maxDepth)
+{
+	HashValue hash;
+	std::set<std::string> visited;
+
+	std::function<void(const MObject&, int)> appendNode = [&](const MObject& node, int depth)
+	{
+		if (node.isNull() || !node.hasFn(MFn::kDependencyNode))
+			return;
+
+		std::string nodeId = getNodeUUid(node);
+		if (!visited.insert(nodeId).second)
+			return;
+
+		hash.Append(nodeId.c_str(), int(nodeId.size()));
+
+		MFnDependencyNode depNode(node);
+
+		for (unsigned int i = 0; i < depNode.attributeCount(); i++)
+		{
+			MPlug plug = depNode.findPlug(depNode.attribute(i), false);
+			hash << GetHashValue(plug);
+
+			if (depth < maxDepth)
+			{
+				MObject connectedNode = FireMaya::GetConnectedNode(plug);
+				if (!connectedNode.isNull())
+					appendNode(connectedNode, depth + 1);
+			}
+		}
+
+		// texture file could be replaced on disk while its name stays the same
+		if (node.hasFn(MFn::kFileTexture))
+		{
+			MString path = depNode.findPlug("fileTextureName", false).asString();
+
+			std::error_code error;
+			auto writeTime = std::filesystem::last_write_time(std::filesystem::u8path(path.asUTF8()), error);
+			if (!error)
+				hash << writeTime.time_since_epoch().count();
+		}
+	};
+
+	appendNode(ob, 0);
 
 	return hash;
 }
@@ -378,6 +455,9 @@ void FireRenderObject::Freshen(bool shouldCalculateHash)
 	if (shouldCalculateHash)
 	{
 		m.hash = CalculateHash();
+
+		if (m.context)
+			m.context->UpdateStateHash(this, m.hash);
 	}
 }
 
@@ -683,6 +763,16 @@ FireRenderMeshCommon::~FireRenderMeshCommon()
 	FireRenderObject::clear();
 }
 
+frw::Shape FireRenderMeshCommon::GetPrototypeShape() const
+{
+	if (m.sharedGeometryShape)
+	{
+		return m.sharedGeometryShape;
+	}
+
+	return m.elements.empty() ? frw::Shape() : m.elements.back().shape;
+}
+
 FireRenderMesh::FireRenderMesh(FireRenderContext* context, const MDagPath& dagPath) :
 	FireRenderMeshCommon(context, dagPath), m_SkipCallbackCounter(0)
 {
@@ -717,7 +807,7 @@ void FireRenderMeshCommon::detachFromScene()
 				scene.Detach(shape);
 		}
 
-		m_isVisible = false;
+		SetIsVisible(false);
 	}
 }
 
@@ -734,7 +824,7 @@ void FireRenderMeshCommon::attachToScene()
 				scene.Attach(shape);
 		}
 
-		m_isVisible = true;
+		SetIsVisible(true);
 	}
 }
 
@@ -1035,6 +1125,34 @@ void FireRenderNode::RegisterCallbacks()
 	AddCallback(MDagMessage::addWorldMatrixModifiedCallback(dagPath, WorldMatrixChangedCallback, this));
 }
 
+// Checks the same shader connections as FireRenderMesh::setupDisplacement without applying displacement
+static bool HasDisplacement(MObjectArray& shadingEngines)
+{
+	for (unsigned int idx = 0; idx < shadingEngines.length(); ++idx)
+	{
+		MObject shadingEngine = shadingEngines[idx];
+
+		if (!getDisplacementShader(shadingEngine).isNull())
+			return true;
+
+		MObject surfaceShader = getSurfaceShader(shadingEngine);
+		if (surfaceShader.isNull())
+			continue;
+
+		MFnDependencyNode shaderNode(surfaceShader);
+		FireMaya::ShaderNode* shader = dynamic_cast<FireMaya::ShaderNode*>(shaderNode.userNode());
+		if (shader && !shader->GetDisplacementNode().isNull())
+			return true;
+
+		bool isDisplacementEnabled = false;
+		MPlug plug = shaderNode.findPlug("displacementEnable");
+		if (!plug.isNull() && (plug.getValue(isDisplacementEnabled) == MStatus::kSuccess) && isDisplacementEnabled)
+			return true;
+	}
+
+	return false;
+}
+
 bool FireRenderMesh::setupDisplacement(std::vector<MObject>& shadingEngines, frw::Shape shape)
 {
 	if (!shape)
@@ -1220,7 +1338,9 @@ void FireRenderMesh::ReinitializeMesh(const MDagPath& meshPath)
 
 	setVisibility(false);
 
+	context()->RemoveGeometryShapes(this);
 	m.elements.clear();
+	m.sharedGeometryShape = frw::Shape();
 
 	// node is not visible => skip
 	if (IsMeshVisible(meshPath, this->context()))
@@ -1388,6 +1508,15 @@ void FireRenderMesh::ProcessMesh(const MDagPath& meshPath)
 
 		element.shape.SetShader(nullptr);
 
+		// faces of all shading engines sorted by shader index in a single pass
+		std::vector<int> sortedFaceIds;
+		std::vector<size_t> shaderFaceOffsets;
+
+		if (element.shadingEngines.size() > 1)
+		{
+			FireMaya::MeshTranslator::SortFacesByMaterial(GetFaceMaterialIndices(), element.shadingEngines.size(), sortedFaceIds, shaderFaceOffsets);
+		}
+
 		unsigned int shaderIdx = 0;
 		for (; shaderIdx < element.shadingEngines.size(); ++shaderIdx)
 		{
@@ -1399,13 +1528,10 @@ void FireRenderMesh::ProcessMesh(const MDagPath& meshPath)
 
 			element.shaders.push_back(context->GetShader(surfaceShader, shadingEngine, this, m.changed.shader));
 
-			const std::vector<int>& faceMaterialIndices = GetFaceMaterialIndices();
 			std::vector<int> face_ids;
-			face_ids.reserve(faceMaterialIndices.size());
-			for (int faceIdx = 0; faceIdx < faceMaterialIndices.size(); ++faceIdx)
+			if (!shaderFaceOffsets.empty())
 			{
-				if (faceMaterialIndices[faceIdx] == shaderIdx)
-					face_ids.push_back(faceIdx);
+				face_ids.assign(sortedFaceIds.begin() + shaderFaceOffsets[shaderIdx], sortedFaceIds.begin() + shaderFaceOffsets[shaderIdx + 1]);
 			}
 
 			if (!face_ids.empty() && (element.shadingEngines.size() != 1))
@@ -1432,7 +1558,11 @@ void FireRenderMesh::ProcessMesh(const MDagPath& meshPath)
 
 		if (context->IsDisplacementSupported())
 		{
-			bool haveDispl = setupDisplacement(element.shadingEngines, element.shape);
+			if (setupDisplacement(element.shadingEngines, element.shape))
+			{
+				// IsRebuildNeeded has given the mesh own shape, displaced shape must not be a base of other meshes
+				assert(!IsGeometryShared());
+			}
 		}
 
 		MObject volumeShader = MObject::kNullObj;
@@ -1711,7 +1841,7 @@ void FireRenderMesh::GetShapes(frw::Shape& outShape)
 	{
 		assert(!m.elements.empty());
 
-		outShape = mainMesh->Elements().back().shape.CreateInstance(Context());
+		outShape = mainMesh->GetPrototypeShape().CreateInstance(Context());
 
 		m.isMainInstance = false;
 	}
@@ -1798,7 +1928,43 @@ bool FireRenderMesh::TranslateMeshWrapped(const MDagPath& dagPath, frw::Shape& o
 		MString name = dagNode.fullPathName();
 		assert(m_meshData.IsInitialized());
 
-		outShape = FireMaya::MeshTranslator::TranslateMesh(m_meshData, context->GetContext(), Object(), m.faceMaterialIndices, motionSamplesCount, dagPath.fullPathName());
+		// meshes with the same geometry (duplicated, referenced or imported several times) share one shape in the context
+		bool canShareGeometry = (motionSamplesCount == 0) && IsGeometryShareable();
+		if (canShareGeometry && context->IsDisplacementSupported())
+		{
+			MObjectArray shadingEngines = GetShadingEngines(dagNode, Instance());
+			canShareGeometry = !HasDisplacement(shadingEngines);
+		}
+
+		frw::Shape geometryShape;
+		if (canShareGeometry && FireMaya::MeshTranslator::BuildIndices(m_meshData))
+		{
+			geometryShape = context->FindGeometryShape(m_meshData.contentKey);
+		}
+
+		if (geometryShape)
+		{
+			outShape = geometryShape.CreateInstance(context->GetContext());
+			m.sharedGeometryShape = geometryShape;
+			m.faceMaterialIndices = m_meshData.indices->faceMaterialIndices;
+
+			FireMaya::MeshCache::Instance().RecordInstancedShape(m_meshData.indices->byteSize());
+
+			FireMaya::MeshTranslator::RemoveTemporaryMeshes(m_meshData, Object());
+			m_meshData.clear();
+		}
+		else
+		{
+			uint64_t contentKey = m_meshData.contentKey;
+			m.sharedGeometryShape = frw::Shape();
+
+			outShape = FireMaya::MeshTranslator::TranslateMesh(m_meshData, context->GetContext(), Object(), m.faceMaterialIndices, motionSamplesCount, dagPath.fullPathName());
+
+			if (canShareGeometry && outShape && (contentKey != 0))
+			{
+				context->AddGeometryShape(contentKey, outShape, this);
+			}
+		}
 	}
 
 	m.isPreProcessed = false;
@@ -1928,6 +2094,9 @@ const std::vector<int>& FireRenderMeshCommon::GetFaceMaterialIndices(void) const
 
 void FireRenderMesh::OnNodeDirty()
 {
+	// sub-frame samples could change even if the current frame is the same
+	FireMaya::MotionSampleCache::Instance().InvalidateNode(uuid());
+
 	setDirty();
 }
 
@@ -1997,9 +2166,12 @@ HashValue FireRenderMesh::CalculateHash()
 	if (!m.elements.empty())
 	{
 		auto& e = m.elements.back();
-		hash << e.shadingEngines;
+		for (const MObject& shadingEngine : e.shadingEngines)
+			hash << GetNetworkHash(shadingEngine);
 	}
 
+	hash << m_geometryHash;
+
 	return hash;
 }
 
@@ -2032,9 +2204,21 @@ bool FireRenderMesh::IsRebuildNeeded()
 		return true;
 	}
 
+	// displacement is applied to the base shape, so a shared shape would displace all meshes using it;
+	// translated again the mesh gets own shape (TranslateMeshWrapped doesn't share displaced geometry)
+	if (context()->IsDisplacementSupported() && IsGeometryShared() && HasDisplacement(shadingEngines))
+	{
+		return true;
+	}
+
 	return false;
 }
 
+bool FireRenderMesh::IsGeometryShared() const
+{
+	return m.sharedGeometryShape || context()->IsGeometryShapeOwner(this);
+}
+
 bool FireRenderMesh::ReloadMesh(unsigned int sampleIdx /*= 0*/)
 {
 	if (!IsRebuildNeeded())
@@ -2077,8 +2261,9 @@ bool FireRenderMesh::ReloadMesh(unsigned int sampleIdx /*= 0*/)
 		context->AddMainMesh(this);
 	}
 
-	bool finishedPreProcessing = deformationMotionBlurEnabled ? (motionSamplesCount == sampleIdx + 1) : true;
-	if (!finishedPreProcessing)
+	// deformation samples after the first one are read by FireRenderContext::Freshen, see StoreDeformationSample
+	m_deformationSamplesPending = m_meshData.haveDeformation && (m_meshData.motionSamplesCount > 1);
+	if (m_deformationSamplesPending)
 		return success;
 
 	m.isPreProcessed = true;
@@ -2086,6 +2271,118 @@ bool FireRenderMesh::ReloadMesh(unsigned int sampleIdx /*= 0*/)
 	return success;
 }
 
+unsigned int FireRenderMesh::GetPendingDeformationSampleCount() const
+{
+	return m_deformationSamplesPending ? m_meshData.motionSamplesCount - 1 : 0;
+}
+
+void FireRenderMesh::ReadDeformationSample(unsigned int sampleIdx, const MTime& time, FireMaya::MeshTranslator::DeformationSample& outSample)
+{
+	MAIN_THREAD_ONLY;
+
+	if (sampleIdx == 1)
+	{
+		m_deformationKey = m_meshData.CalculateDeformationKey(uuid());
+	}
+
+	outSample.cached = FireMaya::MotionSampleCache::Instance().FindMeshSample(m_deformationKey, time);
+	if (outSample.cached)
+		return;
+
+	if (!FireMaya::MeshTranslator::EvaluateDeformationSample(Object(), time, m_meshData, outSample))
+	{
+		outSample.points = nullptr;
+		outSample.normals = nullptr;
+	}
+}
+
+void FireRenderMesh::StoreDeformationSample(unsigned int sampleIdx, const MTime& time, const FireMaya::MeshTranslator::DeformationSample& sample)
+{
+	if (sample.cached)
+	{
+		m_meshData.StoreDeformationFrame(sampleIdx, sample.cached->points.data(), sample.cached->normals.data());
+	}
+	else if (sample.points != nullptr)
+	{
+		auto cached = std::make_shared<FireMaya::MotionSampleCache::MeshSample>();
+		cached->points.assign(sample.points, sample.points + 3 * m_meshData.countVertices);
+		cached->normals.assign(sample.normals, sample.normals + 3 * m_meshData.countNormals);
+
+		m_meshData.StoreDeformationFrame(sampleIdx, cached->points.data(), cached->normals.data());
+
+		FireMaya::MotionSampleCache::Instance().InsertMeshSample(uuid(), m_deformationKey, time, cached);
+	}
+	else
+	{
+		// sample couldn't be evaluated through DG context, the first frame is kept unless ReloadDeformationSample reads it
+		m_meshData.StoreDeformationFrame(sampleIdx, m_meshData.arrVertices.data(), m_meshData.arrNormals.data());
+	}
+
+	if (sampleIdx + 1 >= m_meshData.motionSamplesCount)
+	{
+		m_deformationSamplesPending = false;
+		m.isPreProcessed = true;
+	}
+}
+
+bool FireRenderMesh::ReloadDeformationSample(unsigned int sampleIdx, const MTime& time)
+{
+	MAIN_THREAD_ONLY;
+
+	MDagPath dagPath = DagPath();
+
+	if (!FireMaya::MeshTranslator::PreProcessMesh(m_meshData, context()->GetContext(), Object(), m_meshData.motionSamplesCount, sampleIdx, dagPath.fullPathName()))
+	{
+		std::string message = std::string(dagPath.fullPathName().asChar()) + ": deformation motion blur sample at frame " +
+			std::to_string(time.as(MTime::uiUnit())) + " can't be evaluated, mesh stays still at this time";
+		MGlobal::displayWarning(message.c_str());
+
+		return false;
+	}
+
+	size_t floatsVertexOneFrame = 3 * m_meshData.countVertices;
+	size_t floatsNormalOneFrame = 3 * m_meshData.countNormals;
+
+	auto cached = std::make_shared<FireMaya::MotionSampleCache::MeshSample>();
+	cached->points.assign(m_meshData.arrVertices.begin() + floatsVertexOneFrame * sampleIdx, m_meshData.arrVertices.begin() + floatsVertexOneFrame * (sampleIdx + 1));
+	cached->normals.assign(m_meshData.arrNormals.begin() + floatsNormalOneFrame * sampleIdx, m_meshData.arrNormals.begin() + floatsNormalOneFrame * (sampleIdx + 1));
+
+	FireMaya::MotionSampleCache::Instance().InsertMeshSample(uuid(), m_deformationKey, time, cached);
+
+	return true;
+}
+
+size_t FireRenderMesh::GetPendingPolygonCount() const
+{
+	if (!IsMainInstance() || !m.isPreProcessed || m_meshData.HasIndices())
+	{
+		return 0;
+	}
+
+	return m_meshData.GetPolygonCount();
+}
+
+bool FireRenderMesh::PrepareMeshIndices(bool shouldCalculateHash)
+{
+	if (!IsMainInstance() || !m.isPreProcessed || !m_meshData.IsInitialized())
+	{
+		return false;
+	}
+
+	if (!FireMaya::MeshTranslator::BuildIndices(m_meshData))
+	{
+		return false;
+	}
+
+	if (shouldCalculateHash)
+	{
+		// content key covers points, normals, topology and uvs
+		m_geometryHash = HashValue(size_t(m_meshData.contentKey));
+	}
+
+	return true;
+}
+
 //===================
 // Light
 //===================
@@ -2136,7 +2433,7 @@ void FireRenderLight::detachFromScene()
 		if ((!m_light.isAreaLight) && m_light.light)
 			scene.Detach(m_light.light);
 	}
-	m_isVisible = false;
+	SetIsVisible(false);
 }
 
 void FireRenderLight::attachToScene()
@@ -2149,7 +2446,7 @@ void FireRenderLight::attachToScene()
 			scene.Attach(m_light.areaLight);
 		if ((!m_light.isAreaLight) && m_light.light)
 			scene.Attach(m_light.light);
-		m_isVisible = true;
+		SetIsVisible(true);
 	}
 }
 
@@ -2359,7 +2656,7 @@ void FireRenderEnvLight::detachFromScene()
 		detachFromSceneInternal();
 	}
 
-	m_isVisible = false;
+	SetIsVisible(false);
 }
 
 void FireRenderEnvLight::attachToScene()
@@ -2370,7 +2667,7 @@ void FireRenderEnvLight::attachToScene()
 	if (auto scene = Scene())
 	{
 		attachToSceneInternal();
-		m_isVisible = true;
+		SetIsVisible(true);
 	}
 }
 
@@ -3068,7 +3365,7 @@ void FireRenderSky::detachFromScene()
 		scene.Detach(m_sunLight);
 	}
 
-	m_isVisible = false;
+	SetIsVisible(false);
 }
 
 void FireRenderSky::attachToScene()
@@ -3083,7 +3380,7 @@ void FireRenderSky::attachToScene()
 		if (m_sunLight.Handle()) // m_sunLight could be empty if IBL is used for lighting
 			scene.Attach(m_sunLight);
 
-		m_isVisible = true;
+		SetIsVisible(true);
 	}
 }
 
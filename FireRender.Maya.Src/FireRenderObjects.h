@@ -14,13 +14,18 @@ limitations under the License.
 
 #include "frWrap.h"
 #include "Translators/Translators.h"
+#include "Translators/MotionSampleCache.h"
 #include <maya/MNodeMessage.h>
+#include <maya/MTime.h>
 #include <maya/MDagMessage.h>
 #include <maya/MPlug.h>
 #include <maya/MFnFluid.h>
 #include <string>
 #include <atomic>
+#include <cstdint>
+#include <cstring>
 #include "FireMaya.h"
+#include "HashValue.h"
 
 #include "PhysicalLightData.h"
 
@@ -28,52 +33,6 @@ limitations under the License.
 class FireRenderContext;
 class SkyBuilder;
 
-class HashValue
-{
-	const static size_t BigDumbPrime = 0x1fffffffffffffff;
-	size_t value = 0;
-
-	template<class T>
-	size_t HashItems(const T* v, int count, size_t ret)
-	{
-		auto n = sizeof(T) * count;
-		auto p = reinterpret_cast<const unsigned char*>(v);
-
-		if (!p)
-			return (ret >> 17 | ret << 47) ^ ((n + ret) * BigDumbPrime);
-
-		for (int i = 0; i < n; i++)
-			ret = (ret >> 17 | ret << 47) ^ ((p[i] + i + 1 + ret) * BigDumbPrime);
-
-		return ret;
-	}
-
-public:
-	HashValue(size_t v = 0) : value(v) {}
-
-	bool operator==(const HashValue& h) const { return value == h.value; }
-	bool operator!=(const HashValue& h) const { return value != h.value; }
-
-	template <class T>
-	HashValue& operator<<(const T& v)
-	{
-		value = HashItems(&v, 1, value);
-		return *this;
-	}
-
-	template <class T>
-	void Append(const T* v, int count)
-	{
-		value = HashItems(v, count, value);
-	}
-
-	operator size_t() const { return value; }
-	operator int() const
-	{
-		return  int((value >> 32) ^ value);
-	}
-};
-
 // FireRenderObject
 // Base class for each translated object
 class FireRenderObject
@@ -116,6 +75,9 @@ public:
 
 	static void Dump(const MObject& ob, int depth = 0, int maxDepth = 4);
 	static HashValue GetHash(const MObject& ob);
+	// Hash of node uuids and attribute values of the node and the nodes connected to it (shading network),
+	// stable across sessions. Main thread only
+	static HashValue GetNetworkHash(const MObject& ob, int maxDepth = 16);
 
 	static std::string uuidWithoutInstanceNumberForString(const std::string& uuid);
 
@@ -124,8 +86,23 @@ public:
 
 	virtual bool IsMesh(void) const { return false; }
 	virtual bool ReloadMesh(unsigned int sampleIdx = 0) { return false; }
+	// translates data read by ReloadMesh; must not use Maya API since it is called from worker threads
+	virtual bool PrepareMeshIndices(bool shouldCalculateHash) { return false; }
+	// number of polygons read by ReloadMesh and not translated yet
+	virtual size_t GetPendingPolygonCount(void) const { return 0; }
 	virtual bool ShouldForceReload(void) const { return false; }
 
+	// Deformation motion blur: ReloadMesh reads the first frame, other samples are read by FireRenderContext::Freshen
+	// for all meshes at once per sample time, through DG context. Returns number of sub-frame samples to read
+	virtual unsigned int GetPendingDeformationSampleCount(void) const { return 0; }
+	// reads deformation sample at given time from Maya or MotionSampleCache, main thread only
+	virtual void ReadDeformationSample(unsigned int sampleIdx, const MTime& time, FireMaya::MeshTranslator::DeformationSample& outSample) {}
+	// copies sample read by ReadDeformationSample; must not use Maya API since it is called from worker threads
+	virtual void StoreDeformationSample(unsigned int sampleIdx, const MTime& time, const FireMaya::MeshTranslator::DeformationSample& sample) {}
+	// reads sample which couldn't be evaluated through DG context at the current time (which is set to the sample time
+	// by the caller), like the first frame is read. Returns false if the mesh stays still at this time
+	virtual bool ReloadDeformationSample(unsigned int sampleIdx, const MTime& time) { return false; }
+
 	// hash is generated during Freshen call
 	HashValue GetStateHash() { return m.hash; }
 
@@ -250,6 +227,9 @@ public:
 	std::vector<std::pair<MObject, bool>> m_visiblePortals_SKY;
 
 protected:
+	// sets m_isVisible; detached nodes don't contribute to the context state hash
+	void SetIsVisible(bool isVisible);
+
 	bool m_isVisible = false;
 	bool m_bIsTransformChanged = false;
 
@@ -286,6 +266,10 @@ public:
 
 	bool IsMainInstance() const { return m.isMainInstance; }
 
+	// Shape to create rpr instances of this mesh from. Mesh sharing geometry holds an instance itself,
+	// so the shared shape is returned for it (rpr instances can't be created from instances)
+	frw::Shape GetPrototypeShape() const;
+
 	bool IsNotInitialized() const { return m.isPreProcessed; }
 
 	// utility functions
@@ -294,7 +278,7 @@ public:
 	virtual void setReflectionVisibility(bool reflectionVisibility);
 	virtual void setRefractionVisibility(bool refractionVisibility);
 	virtual void setCastShadows(bool castShadow);
-	void setReceiveShadows(bool recieveShadow);
+	virtual void setReceiveShadows(bool recieveShadow);
 	virtual void setPrimaryVisibility(bool primaryVisibility);
 	virtual void setContourVisibility(bool contourVisibility);
 
@@ -332,6 +316,7 @@ protected:
 	{
 		std::vector<FrElement> elements;
 		std::vector<int> faceMaterialIndices;
+		frw::Shape sharedGeometryShape;
 		bool isEmissive = false;
 		bool isMainInstance = false;
 
@@ -394,6 +379,12 @@ public:
 
 	virtual bool InitializeMaterials() override;
 	virtual bool ReloadMesh(unsigned int sampleIdx = 0) override;
+	virtual bool PrepareMeshIndices(bool shouldCalculateHash) override;
+	virtual size_t GetPendingPolygonCount(void) const override;
+	virtual unsigned int GetPendingDeformationSampleCount(void) const override;
+	virtual void ReadDeformationSample(unsigned int sampleIdx, const MTime& time, FireMaya::MeshTranslator::DeformationSample& outSample) override;
+	virtual void StoreDeformationSample(unsigned int sampleIdx, const MTime& time, const FireMaya::MeshTranslator::DeformationSample& sample) override;
+	virtual bool ReloadDeformationSample(unsigned int sampleIdx, const MTime& time) override;
 	virtual bool TranslateMeshWrapped(const MDagPath& dagPath, frw::Shape& outShape) override;
 
 	// build a sphere
@@ -417,6 +408,9 @@ public:
 	virtual bool IsMeshVisible(const MDagPath& meshPath, const FireRenderContext* context) const;
 
 protected:
+	// false if the shape should not be an instance of other mesh with the same geometry
+	virtual bool IsGeometryShareable(void) const { return true; }
+
 	void SaveUsedUV(const MObject& meshNode);
 
 	void SetupObjectId(MObject parentTransform);
@@ -425,9 +419,18 @@ protected:
 
 	bool IsRebuildNeeded();
 
+	// true if the shape is an instance of other mesh geometry or other meshes are instances of it
+	bool IsGeometryShared() const;
+
 protected:
 	FireMaya::MeshTranslator::MeshPolygonData m_meshData;
 
+	// set by ReloadMesh when the first frame of deforming mesh is read, cleared when all samples are stored
+	bool m_deformationSamplesPending = false;
+
+	// key of deformation samples in MotionSampleCache, calculated when the first sub-frame sample is read
+	uint64_t m_deformationKey = 0;
+
 private:
 	void GetShapes(frw::Shape& outShape);
 	
@@ -442,6 +445,9 @@ private:
 
 private:
 	unsigned int m_SkipCallbackCounter;
+
+	// hash of translated geometry, calculated by PrepareMeshIndices
+	HashValue m_geometryHash;
 };
 
 // Fire render light
@@ -888,6 +894,9 @@ public:
 	// node dirty
 	virtual void OnShaderDirty(void);
 
+	// plug dirty
+	virtual void OnPlugDirty(MObject& node, MPlug& plug) override;
+
 	// visibility flags
 	virtual void setRenderStats(MDagPath dagPath);
 	void setPrimaryVisibility(bool primaryVisibility);
@@ -915,14 +924,30 @@ protected:
 	// set filter
 	// NIY
 	// tries to load curves data and creates rpr curve (batch) if succesfull
+	// existing curves are kept if groom data has not changed since they were created
 	// returns false if failed to create curves
 	virtual bool CreateCurves(void) = 0;
 
+	// returns true if existing curves were created from groom data with given key
+	bool IsGroomUnchanged(const HashValue& groomKey) const;
+
+	// detaches and releases existing curves
+	void ReleaseCurves(void);
+
+	// fraction of strands which should be translated (reduced in viewport only)
+	float GetStrandDensity(void) const;
+
 	// transform matrix
 	MMatrix m_matrix;
 
 	// curves
 	std::vector<frw::Curve> m_Curves;
+
+	// key of groom data (and strand density) used for existing curves
+	HashValue m_groomKey;
+
+	// true if anything but transform has changed since last Freshen
+	bool m_isGroomChanged;
 };
 
 class FireRenderHairXGenGrooming : public FireRenderHair
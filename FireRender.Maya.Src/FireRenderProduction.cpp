@@ -27,6 +27,7 @@ limitations under the License.
 #include "RenderViewUpdater.h"
 
 #include "TileRenderer.h"
+#include "ParallelUtils.h"
 #include "Athena/athenaWrap.h"
 
 #include "RenderStampUtils.h"
@@ -185,6 +186,14 @@ void FireRenderProduction::SetupWorkProgressCallback()
 				break;
 			case ProgressType::SyncComplete:
 				strOutput = string_format("RPR scene synchronization time: %s", getTimeSpentString(progressData.elapsedTotal).c_str());
+
+				if (m_globals.useDetailedContextWorkLog)
+				{
+					strOutput += string_format(" (read: %s, translate: %s, commit: %s)",
+						getTimeSpentString(progressData.elapsedSyncGather).c_str(),
+						getTimeSpentString(progressData.elapsedSyncTranslate).c_str(),
+						getTimeSpentString(progressData.elapsedSyncCommit).c_str());
+				}
 				break;
 			case ProgressType::RenderPassStarted:
 				strOutput = string_format("Render Pass: %d/%d", progressData.currentIndex, progressData.totalCount);
@@ -992,7 +1001,7 @@ void FireRenderProduction::RenderTiles()
 
 	TileRenderInfo info;
 
-	info.tilesFillType = TileRenderFillType::Normal;
+	info.tilesFillType = (TileRenderFillType) m_globals.tileFillType;
 	info.tileSizeX = m_globals.tileSizeX;
 	info.tileSizeY = m_globals.tileSizeY;
 
@@ -1012,55 +1021,134 @@ void FireRenderProduction::RenderTiles()
 	// we need to resetup camera because total width and height differs with tileSizeX and tileSizeY
 	m_contextPtr->camera().TranslateCameraExplicit(info.totalWidth, info.totalHeight);
 
-	tileRenderer.Render(*m_contextPtr, info, outBuffers, [&](RenderRegion& region, int progress, AOVPixelBuffers& out)
+	TileQueue tileQueue(info);
+
+	// Tile pixels are read into the AOV buffers and swapped into the staging buffers right after the readback.
+	// Staging buffers are copied to the output on the worker pool while the next tile renders,
+	// the two sets of buffers are reused for all tiles.
+	AOVPixelBuffers stagingBuffers;
+	std::future<void> pendingCopy;
+
+	unsigned int contextWidth = 0;
+	unsigned int contextHeight = 0;
+	int tilesDone = 0;
+
+	auto waitForCopy = [&pendingCopy]()
 	{
-		// make proper size
-		unsigned int width = region.getWidth();
-		unsigned int height = region.getHeight();
+		if (pendingCopy.valid())
+			pendingCopy.wait();
+	};
 
-		m_contextPtr->resize(width, height, true);
+	try
+	{
+		tileRenderer.Render(*m_contextPtr, info, tileQueue, outBuffers, [&](RenderRegion& region, int progress, AOVPixelBuffers& out)
+		{
+			TimePoint tileStart = GetCurrentChronoTime();
 
-		m_aovs->setRegion(RenderRegion(width, height), region.getWidth(), region.getHeight());
-		m_aovs->allocatePixels();
+			// make proper size, only border tiles differ
+			unsigned int width = region.getWidth();
+			unsigned int height = region.getHeight();
 
-		m_contextPtr->render(false);
+			if ((width != contextWidth) || (height != contextHeight))
+			{
+				m_contextPtr->resize(width, height, true);
+				m_aovs->setRegion(RenderRegion(width, height), region.getWidth(), region.getHeight());
 
+				contextWidth = width;
+				contextHeight = height;
+			}
 
-		// copy data to buffer
-		m_aovs->ForEachActiveAOV([&](FireRenderAOV& aov)
-		{
-			aov.readFrameBuffer(*m_contextPtr);
+			// doesn't reallocate buffers which already have the tile size
+			m_aovs->allocatePixels();
 
-			auto it = out.find(aov.id);
+			m_contextPtr->render(false);
 
-			if (it == out.end())
-				return;
+			TimePoint renderEnd = GetCurrentChronoTime();
 
-			it->second.overwrite(aov.pixels.get(), region, info.totalHeight, info.totalWidth, aov.id);
-		});
+			m_aovs->ForEachActiveAOV([&](FireRenderAOV& aov)
+			{
+				aov.readFrameBuffer(*m_contextPtr);
+			});
 
-		// send data to Maya render view
-		FireRenderThread::RunProcOnMainThread([this, region]()
-		{
-			// Update the Maya render view.
-			RenderViewUpdater::UpdateAndRefreshRegion(m_renderViewAOV->pixels.get(), region.getWidth(), region.getHeight(), region);
+			// previous tile is copied from the staging buffers
+			waitForCopy();
 
-			if (rcWarningDialog.shown)
-				rcWarningDialog.close();
-		});
+			m_aovs->ForEachActiveAOV([&](FireRenderAOV& aov)
+			{
+				stagingBuffers[aov.id].swap(aov.pixels);
+			});
 
-		m_contextPtr->setProgress(progress);
+			// copy data to buffer
+			pendingCopy = FireMaya::WorkerPool::Instance().Submit([&stagingBuffers, &out, region, &info]()
+			{
+				for (auto& staged : stagingBuffers)
+				{
+					auto it = out.find(staged.first);
 
-		bool isContinue = !m_cancelled;
+					if (it == out.end() || !staged.second)
+						continue;
 
-		if (isContinue)
-		{
-			m_contextPtr->setStartedRendering();
-		}
+					it->second.overwrite(staged.second.get(), region, info.totalHeight, info.totalWidth, staged.first);
+				}
+			});
+
+			long renderTime = TimeDiffChrono<std::chrono::milliseconds>(renderEnd, tileStart);
+			long readTime = TimeDiffChrono<std::chrono::milliseconds>(GetCurrentChronoTime(), renderEnd);
+			++tilesDone;
+
+			DebugPrint("Tile %d of %zu rendered in %ld ms, read in %ld ms", tilesDone, tileQueue.Count(), renderTime, readTime);
+
+			// send data to Maya render view, staging buffers are only read while they are being copied
+			const RV_PIXEL* renderViewPixels = stagingBuffers[m_renderViewAOV->id].get();
+			size_t tileCount = tileQueue.Count();
+
+			FireRenderThread::RunProcOnMainThread([this, region, renderViewPixels, tilesDone, tileCount, renderTime]()
+			{
+				// Update the Maya render view.
+				RenderViewUpdater::UpdateAndRefreshRegion(const_cast<RV_PIXEL*>(renderViewPixels), region.getWidth(), region.getHeight(), region);
+
+				if (m_progressBars)
+				{
+					std::string text = string_format("Rendering tile %d of %zu, last tile %.2f s...[Press ESC to Cancel]",
+						tilesDone, tileCount, renderTime / 1000.0);
+
+					m_progressBars->SetTextAboveProgress(text);
+				}
+
+				if (rcWarningDialog.shown)
+					rcWarningDialog.close();
+			});
+
+			m_contextPtr->setProgress(progress);
+
+			bool isContinue = !m_cancelled;
 
-		return isContinue;
+			if (isContinue)
+			{
+				m_contextPtr->setStartedRendering();
+			}
+
+			return isContinue;
+		}
+		);
+	}
+	catch (...)
+	{
+		// copy task references the staging buffers
+		waitForCopy();
+		throw;
 	}
-	);
+
+	waitForCopy();
+
+	// AOV buffers stay valid after the tile render, last tile is in the staging buffers
+	m_aovs->ForEachActiveAOV([&](FireRenderAOV& aov)
+	{
+		auto it = stagingBuffers.find(aov.id);
+
+		if (it != stagingBuffers.end() && it->second)
+			aov.pixels.swap(it->second);
+	});
 
 #ifdef _DEBUG
 #ifdef DUMP_TILES_AOVS_ALL
@@ -16,14 +16,46 @@ limitations under the License.
 #include "AutoLock.h"
 #include "FireRenderThread.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
 FireRenderSwatchInstance FireRenderSwatchInstance::m_instance;
 
 using namespace FireMaya;
 
+namespace
+{
+	// Camera of single swatch (FireRenderCamera::buildSwatchCamera). Every tile of the batch frame
+	// is rendered by the same camera placed in front of the sphere of the tile
+	const float SwatchCameraDistance = 7.5f;
+	const float SwatchFocalLength = 100.0f;
+	const float SwatchFocusDistance = 10.0f;
+	const float SwatchSensorSize = 35.0f;
+
+	// Spheres of the batch are so far from each other that a neighbour doesn't show up in reflections,
+	// refractions and shadows of the sphere (swatch light is directional), so visibility flags are kept as is
+	const float SwatchSpacing = 100.0f;
+
+	// Batch frame is limited to MaxBatchFrameSize x MaxBatchFrameSize pixels
+	const int MaxBatchFrameSize = 4096;
+
+	const size_t SwatchCacheByteBudget = size_t(512) * 1024 * 1024;
+
+	// Offset of the tile center from the frame center, in tiles
+	float TileOffset(int index, int count)
+	{
+		return index - 0.5f * (count - 1);
+	}
+}
+
 FireRenderSwatchInstance::FireRenderSwatchInstance()
 {
 	sceneIsCleaned = true;
 	m_shouldClearContext = false;
+	m_batchSize = 1;
+	m_swatchCacheInitialized = false;
 	pContext = std::make_unique<NorthStarContext>(); 
 
 	MStatus status;
@@ -88,11 +120,24 @@ void FireRenderSwatchInstance::cleanScene()
 {
 	if (!sceneIsCleaned)
 	{
+		ReleaseBatchGrid();
 		pContext->cleanScene();
 		sceneIsCleaned = true;
 	}
 }
 
+FireMaya::FrameDiskCache& FireRenderSwatchInstance::getSwatchCache()
+{
+	if (!m_swatchCacheInitialized)
+	{
+		m_swatchCache.SetByteBudget(SwatchCacheByteBudget);
+		m_swatchCache.SetDirectory(getSwatchCachePath().asUTF8());
+		m_swatchCacheInitialized = true;
+	}
+
+	return m_swatchCache;
+}
+
 void FireRenderSwatchInstance::ProcessInRenderThread()
 {
 	backgroundRendererBusy = true;
@@ -101,11 +146,21 @@ void FireRenderSwatchInstance::ProcessInRenderThread()
 	{
 		try
 		{
-			FireRenderMaterialSwatchRender* item = nullptr;
+			std::vector<FireRenderMaterialSwatchRender*> items;
 
-			while ((item = dequeSwatch()) != nullptr)
+			for (dequeSwatches(items, size_t(m_batchSize)); !items.empty(); dequeSwatches(items, size_t(m_batchSize)))
 			{
-				item->processFromBackgroundThread();
+				if (items.front()->isBatched())
+				{
+					ProcessBatch(items);
+				}
+				else
+				{
+					for (FireRenderMaterialSwatchRender* item : items)
+					{
+						item->processFromBackgroundThread();
+					}
+				}
 			}
 		}
 		catch (...)
@@ -132,6 +187,9 @@ void FireRenderSwatchInstance::enqueSwatch(FireRenderMaterialSwatchRender* swatc
 {
 	m_shouldClearContext = false; // should not clear context if renderer is running
 
+	int batchSize = FireRenderGlobalsData::getThumbnailBatchSize();
+	m_batchSize = batchSize > 1 ? batchSize : 1;
+
 	{
 		RPR::AutoLock<MSpinLock> lock(mutex);
 		queueToProcess.push_back(swatch);
@@ -143,20 +201,230 @@ void FireRenderSwatchInstance::enqueSwatch(FireRenderMaterialSwatchRender* swatc
 	}
 }
 
-FireRenderMaterialSwatchRender* FireRenderSwatchInstance::dequeSwatch()
+void FireRenderSwatchInstance::dequeSwatches(std::vector<FireRenderMaterialSwatchRender*>& outSwatches, size_t maxCount)
 {
+	outSwatches.clear();
+
 	RPR::AutoLock<MSpinLock> lock(mutex);
 
 	if (queueToProcess.size() == 0)
 	{
-		return nullptr;
+		return;
+	}
+
+	// swatches of one batch are tiles of the same frame
+	int resolution = queueToProcess.front()->getResolution();
+	bool batched = queueToProcess.front()->isBatched();
+
+	size_t tilesPerSide = size_t(resolution < MaxBatchFrameSize ? MaxBatchFrameSize / resolution : 1);
+	if (maxCount > tilesPerSide * tilesPerSide)
+	{
+		maxCount = tilesPerSide * tilesPerSide;
+	}
+
+	for (auto it = queueToProcess.begin(); (it != queueToProcess.end()) && (outSwatches.size() < maxCount);)
+	{
+		if (((*it)->getResolution() != resolution) || ((*it)->isBatched() != batched))
+		{
+			++it;
+			continue;
+		}
+
+		(*it)->setAsyncRunning(true);
+		outSwatches.push_back(*it);
+
+		it = queueToProcess.erase(it);
+	}
+}
+
+void FireRenderSwatchInstance::ProcessBatch(std::vector<FireRenderMaterialSwatchRender*>& swatches)
+{
+	FireRenderContext& context = getContext();
+
+	auto mesh = context.getRenderObject<FireRenderMesh>("mesh");
+
+	frw::Shape sphere;
+	if (mesh && !mesh->Elements().empty())
+	{
+		sphere = mesh->Elements().front().shape;
+	}
+
+	if (!sphere)
+	{
+		for (FireRenderMaterialSwatchRender* swatch : swatches)
+		{
+			swatch->processFromBackgroundThread();
+		}
+
+		return;
+	}
+
+	size_t count = swatches.size();
+	int resolution = swatches.front()->getResolution();
+	int columns = int(std::ceil(std::sqrt(double(count))));
+	int rows = int((count + columns - 1) / columns);
+
+	auto isCancelled = [](FireRenderMaterialSwatchRender* swatch) { return swatch->isCancelled(); };
+
+	frw::Scene scene = context.GetScene();
+	size_t attachedCount = 0;
+	size_t finishedCount = 0;
+
+	try
+	{
+		frw::Context frContext = context.GetContext();
+
+		while (m_gridShapes.size() < count)
+		{
+			m_gridShapes.push_back(sphere.CreateInstance(frContext));
+		}
+
+		if (!m_gridCamera)
+		{
+			m_gridCamera = frContext.CreateCamera();
+
+			rpr_int frstatus = rprCameraSetMode(m_gridCamera.Handle(), RPR_CAMERA_MODE_PERSPECTIVE);
+			checkStatus(frstatus);
+
+			frstatus = rprCameraSetFocalLength(m_gridCamera.Handle(), SwatchFocalLength);
+			checkStatus(frstatus);
+
+			frstatus = rprCameraSetFocusDistance(m_gridCamera.Handle(), SwatchFocusDistance);
+			checkStatus(frstatus);
+
+			frstatus = rprCameraSetFStop(m_gridCamera.Handle(), FLT_MAX);
+			checkStatus(frstatus);
+		}
+
+		// sensor covers the whole frame, every tile gets the sensor size of single swatch
+		rpr_int frstatus = rprCameraSetSensorSize(m_gridCamera.Handle(), columns * SwatchSensorSize, rows * SwatchSensorSize);
+		checkStatus(frstatus);
+
+		context.setStartedRendering();
+		mesh->setVisibility(false);
+
+		for (size_t idx = 0; idx < count; ++idx)
+		{
+			frw::Shape& shape = m_gridShapes[idx];
+
+			shape.SetShader(swatches[idx]->getShader());
+			shape.SetVolumeShader(swatches[idx]->getVolumeShader());
+
+			// framebuffer rows go from the bottom (as MImage rows do), so the first tile row is the lowest one
+			int column = int(idx) % columns;
+			int row = int(idx) / columns;
+
+			float tm[16] = {
+				1.0f, 0.0f, 0.0f, 0.0f,
+				0.0f, 1.0f, 0.0f, 0.0f,
+				0.0f, 0.0f, 1.0f, 0.0f,
+				TileOffset(column, columns) * SwatchSpacing, TileOffset(row, rows) * SwatchSpacing, 0.0f, 1.0f
+			};
+			shape.SetTransform(tm);
+
+			scene.Attach(shape);
+			attachedCount = idx + 1;
+		}
+
+		scene.SetCamera(m_gridCamera);
+
+		unsigned int frameWidth = (unsigned int) (columns * resolution);
+		unsigned int frameHeight = (unsigned int) (rows * resolution);
+
+		if ((context.width() != frameWidth) || (context.height() != frameHeight))
+		{
+			context.setResolution(frameWidth, frameHeight, false);
+		}
+
+		// every iteration step renders the tiles one by one, camera is moved in front of the tile sphere
+		// and its lens is shifted to put the tile on the optical axis (lens shift is in sensor sizes)
+		rpr_camera camera = m_gridCamera.Handle();
+		context.setRenderPass([camera, count, columns, rows, resolution, frameHeight](frw::Context& frContext)
+		{
+			for (size_t idx = 0; idx < count; ++idx)
+			{
+				int column = int(idx) % columns;
+				int row = int(idx) / columns;
+
+				float x = TileOffset(column, columns) * SwatchSpacing;
+				float y = TileOffset(row, rows) * SwatchSpacing;
+
+				rpr_int frstatus = rprCameraLookAt(camera, x, y, SwatchCameraDistance, x, y, 0.0f, 0.0f, 1.0f, 0.0f);
+				checkStatus(frstatus);
+
+				frstatus = rprCameraSetLensShift(camera, -TileOffset(column, columns) / columns, -TileOffset(row, rows) / rows);
+				checkStatus(frstatus);
+
+				// rpr tile rows go from the top
+				frContext.RenderTile(column * resolution, (column + 1) * resolution, frameHeight - (row + 1) * resolution, frameHeight - row * resolution);
+			}
+		});
+
+		context.setDirty();
+		context.m_restartRender = true;
+		context.UpdateCompletionCriteriaForSwatch();
+
+		while (context.keepRenderRunning())
+		{
+			if (std::all_of(swatches.begin(), swatches.end(), isCancelled))
+				break;
+
+			context.render();
+		}
+
+		if (!std::all_of(swatches.begin(), swatches.end(), isCancelled))
+		{
+			std::vector<float> frame = context.getRenderImageData();
+			std::vector<float> tile(size_t(resolution) * resolution * 4);
+
+			size_t tileRowSize = size_t(resolution) * 4;
+
+			for (; finishedCount < count; ++finishedCount)
+			{
+				size_t column = finishedCount % columns;
+				size_t row = finishedCount / columns;
+
+				for (size_t y = 0; y < size_t(resolution); ++y)
+				{
+					const float* src = frame.data() + ((row * resolution + y) * frameWidth + column * resolution) * 4;
+					memcpy(tile.data() + y * tileRowSize, src, tileRowSize * sizeof(float));
+				}
+
+				swatches[finishedCount]->finishBatchedRender(tile);
+			}
+		}
+	}
+	catch (...)
+	{
+		DebugPrint("Unknown error running batched material swatch render");
 	}
 
-	FireRenderMaterialSwatchRender* item = queueToProcess.front();
-	queueToProcess.pop_front();
+	try
+	{
+		for (size_t idx = 0; idx < attachedCount; ++idx)
+		{
+			scene.Detach(m_gridShapes[idx]);
+		}
 
-	item->setAsyncRunning(true);
-	return item;
+		context.setRenderPass(nullptr);
+		scene.SetCamera(context.GetCamera().data());
+		mesh->setVisibility(true);
+	}
+	catch (...)
+	{
+		DebugPrint("Unknown error restoring material swatch scene");
+	}
+
+	for (; finishedCount < count; ++finishedCount)
+	{
+		swatches[finishedCount]->cancelBatchedRender();
+	}
+}
+
+void FireRenderSwatchInstance::ReleaseBatchGrid()
+{
+	m_gridShapes.clear();
+	m_gridCamera = frw::Camera();
 }
 
 void FireRenderSwatchInstance::removeFromQueue(FireRenderMaterialSwatchRender* swatch)
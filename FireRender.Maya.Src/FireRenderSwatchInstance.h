@@ -16,8 +16,11 @@ limitations under the License.
 
 #include "RenderCacheWarningDialog.h"
 #include "Context/TahoeContext.h"
+#include "FrameDiskCache.h"
 #include <maya/MTimerMessage.h>
 
+#include <vector>
+
 class FireRenderMaterialSwatchRender;
 
 class FireRenderSwatchInstance
@@ -28,9 +31,13 @@ public:
 	void cleanScene();
 
 	void enqueSwatch(FireRenderMaterialSwatchRender* swatch);
-	FireRenderMaterialSwatchRender* dequeSwatch();
+	// Takes up to maxCount queued swatches of the same resolution and render path (batched or not) as the first one
+	void dequeSwatches(std::vector<FireRenderMaterialSwatchRender*>& outSwatches, size_t maxCount);
 	void removeFromQueue(FireRenderMaterialSwatchRender* swatch);
 
+	// Rendered swatches kept between sessions; should be first accessed from the main thread
+	FireMaya::FrameDiskCache& getSwatchCache();
+
 	static void resetInstance();
 
 	FireRenderContext& getContext() { return *pContext.get(); }
@@ -44,6 +51,10 @@ private:
 
 	void ProcessInRenderThread();
 
+	// Renders swatches in one frame: every swatch is an instance of the preview sphere placed in its own tile
+	void ProcessBatch(std::vector<FireRenderMaterialSwatchRender*>& swatches);
+	void ReleaseBatchGrid();
+
 	FireRenderSwatchInstance(const FireRenderSwatchInstance&);
 
 	FireRenderSwatchInstance& operator=(const FireRenderSwatchInstance&);
@@ -59,6 +70,14 @@ private:
 	std::atomic<bool> m_shouldClearContext;
 
 	std::list<FireRenderMaterialSwatchRender*> queueToProcess;
+	std::atomic<int> m_batchSize;
+
+	// instances of the preview sphere and camera of the batch frame
+	std::vector<frw::Shape> m_gridShapes;
+	frw::Camera m_gridCamera;
+
+	FireMaya::FrameDiskCache m_swatchCache;
+	bool m_swatchCacheInitialized;
 
 	RenderCacheWarningDialog rcWarningDialog;
 	bool m_warningDialogOpen;
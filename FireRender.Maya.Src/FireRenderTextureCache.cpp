@@ -11,49 +11,199 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ********************************************************************/
 #include "FireRenderTextureCache.h"
+#include "PixelConversion.h"
 
 using namespace FireMaya;
 
+TextureCache::TextureCache() :
+	m_byteSize(0),
+	m_byteBudget(DefaultByteBudget),
+	m_storageMode(StorageFloat),
+	m_hits(0),
+	m_misses(0),
+	m_evictions(0)
+{
+}
+
 bool TextureCache::Contains(const char *sz) const
 {
-	return m_map.find(sz) != m_map.end();
+	return m_index.find(sz) != m_index.end();
 }
 
 StoredFrame& TextureCache::operator[](const char* sz)
 {
-	auto& e = m_map[sz];
-	e.age = m_age++;
+	// Frame returned by previous call could be resized by the caller, take it into account
+	if (!m_entries.empty())
+		UpdateSize(m_entries.front());
+
+	auto found = m_index.find(sz);
+
+	if (found != m_index.end())
+	{
+		++m_hits;
+
+		// move to the front of the list, iterators stay valid
+		m_entries.splice(m_entries.begin(), m_entries, found->second);
+	}
+	else
+	{
+		++m_misses;
+
+		m_entries.emplace_front();
+		m_entries.front().key = sz;
+		m_index.emplace(m_entries.front().key, m_entries.begin());
+	}
+
+	EvictToBudget();
+
+	return m_entries.front().frame;
+}
+
+void TextureCache::Store(const char* sz)
+{
+	auto found = m_index.find(sz);
+	if (found == m_index.end())
+		return;
+
+	Entry& entry = *found->second;
+
+	if (m_storageMode == StorageHalf)
+		entry.frame.Compact();
+
+	UpdateSize(entry);
+	EvictToBudget();
+}
+
+void TextureCache::UpdateSize(Entry& entry)
+{
+	size_t byteSize = entry.frame.byteSize();
 
-	if (m_map.size() > MaxSize)
+	m_byteSize = m_byteSize - entry.byteSize + byteSize;
+	entry.byteSize = byteSize;
+}
+
+void TextureCache::EvictToBudget()
+{
+	// keep at least the most recently used entry
+	while (m_byteSize > m_byteBudget && m_entries.size() > 1)
 	{
-		auto oldest = m_map.begin();
-		for (auto it = m_map.begin(); it != m_map.end(); ++it)
-		{
-			if (it->second.age < oldest->second.age)
-				oldest = it;
-		}
-		m_map.erase(oldest);
+		Entry& oldest = m_entries.back();
+
+		m_byteSize -= oldest.byteSize;
+		m_index.erase(oldest.key);
+		m_entries.pop_back();
+
+		++m_evictions;
 	}
+}
+
+void TextureCache::SetByteBudget(size_t bytes)
+{
+	m_byteBudget = bytes;
+
+	if (!m_entries.empty())
+		UpdateSize(m_entries.front());
+
+	EvictToBudget();
+}
+
+TextureCache::Statistics TextureCache::GetStatistics() const
+{
+	Statistics stats;
+
+	stats.entryCount = m_entries.size();
+	stats.byteSize = m_byteSize;
+	stats.byteBudget = m_byteBudget;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.evictions = m_evictions;
 
-	return e.frame;
+	return stats;
+}
+
+void TextureCache::ResetStatistics()
+{
+	m_hits = 0;
+	m_misses = 0;
+	m_evictions = 0;
+}
+
+void TextureCache::Clear()
+{
+	m_index.clear();
+	m_entries.clear();
+	m_byteSize = 0;
+}
+
+StoredFrame::StoredFrame(int width, int height)
+	: m_data(width * height * 4, 0)
+{
 }
 
 bool StoredFrame::Resize(int width, int height)
 {
-	if (m_data.size() == width * height * 4)
+	if (ComponentCount() == width * height * 4)
 		return false;
 
+	m_halfData.clear();
+	m_halfData.shrink_to_fit();
 	m_data.resize(width * height * 4, 0);
 	return true;
 }
 
-void TextureCache::Clear()
+float* StoredFrame::data()
 {
-	m_map.clear();
-	m_age = 0;
+	if (IsCompact())
+	{
+		m_data.resize(m_halfData.size());
+		PixelConversion::HalfToFloat(m_halfData.data(), m_data.data(), m_halfData.size());
+
+		m_halfData.clear();
+		m_halfData.shrink_to_fit();
+	}
+
+	return m_data.data();
 }
 
-StoredFrame::StoredFrame(int width, int height)
-	: m_data(width * height * 4, 0)
+void StoredFrame::Compact()
+{
+	if (m_data.empty())
+		return;
+
+	m_halfData.resize(m_data.size());
+	PixelConversion::FloatToHalf(m_data.data(), m_halfData.data(), m_data.size());
+
+	m_data.clear();
+	m_data.shrink_to_fit();
+}
+
+const float* StoredFrame::Pixels(std::vector<float>& scratch) const
+{
+	if (!IsCompact())
+		return m_data.data();
+
+	scratch.resize(m_halfData.size());
+	PixelConversion::HalfToFloat(m_halfData.data(), scratch.data(), m_halfData.size());
+
+	return scratch.data();
+}
+
+void StoredFrame::Assign(const void* data, size_t componentCount, bool compact)
 {
-}
\ No newline at end of file
+	if (compact)
+	{
+		const uint16_t* src = static_cast<const uint16_t*>(data);
+
+		m_data.clear();
+		m_data.shrink_to_fit();
+		m_halfData.assign(src, src + componentCount);
+	}
+	else
+	{
+		const float* src = static_cast<const float*>(data);
+
+		m_halfData.clear();
+		m_halfData.shrink_to_fit();
+		m_data.assign(src, src + componentCount);
+	}
+}
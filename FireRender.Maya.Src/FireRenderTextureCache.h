@@ -14,7 +14,10 @@ limitations under the License.
 
 #include <maya/MTextureManager.h>
 #include <maya/MShaderManager.h>
-#include <map>
+#include <list>
+#include <unordered_map>
+#include <string>
+#include <cstdint>
 #ifndef MAYA2015
 #include <maya/MGL.h>
 #else
@@ -80,40 +83,104 @@ namespace FireMaya
 	class StoredFrame
 	{
 		std::vector<float> m_data;
+		std::vector<uint16_t> m_halfData;	// used instead of m_data when frame is compacted
+
 	public:
 		StoredFrame() {}
 		StoredFrame(int width, int height);
 
-		float* data() { return m_data.data(); }
-		operator bool() const { return !m_data.empty(); }
+		// returns writable float pixels (expands compacted frame back to float storage)
+		float* data();
+		operator bool() const { return !m_data.empty() || !m_halfData.empty(); }
 		bool Resize(int width, int height);	// returns true if reallocated
 
-		size_t byteSize() const { return m_data.size() * sizeof(float); }
+		// converts pixels to half floats and releases float storage
+		void Compact();
+		bool IsCompact() const { return !m_halfData.empty(); }
+
+		// returns float pixels for reading, compacted frame is expanded into scratch buffer
+		const float* Pixels(std::vector<float>& scratch) const;
+
+		size_t byteSize() const { return m_data.size() * sizeof(float) + m_halfData.size() * sizeof(uint16_t); }
+
+		// raw storage access, used to store frames on disk
+		size_t ComponentCount() const { return m_data.empty() ? m_halfData.size() : m_data.size(); }
+		const void* RawData() const { return IsCompact() ? (const void*) m_halfData.data() : (const void*) m_data.data(); }
+		void Assign(const void* data, size_t componentCount, bool compact);
 	};
 
+	// LRU cache of rendered frames bounded by total byte size of stored frames.
+	// Reference returned by operator[] stays valid until the entry is evicted or cache is cleared;
+	// the most recently accessed entry is never evicted.
 	class TextureCache
 	{
 	public:
 		enum
 		{
 			InvalidTexture = 0,
-			MaxSize = 1000,
 		};
 
+		enum StorageMode
+		{
+			StorageFloat,
+			StorageHalf,
+		};
+
+		struct Statistics
+		{
+			size_t entryCount = 0;
+			size_t byteSize = 0;
+			size_t byteBudget = 0;
+			unsigned long long hits = 0;
+			unsigned long long misses = 0;
+			unsigned long long evictions = 0;
+		};
+
+		static const size_t DefaultByteBudget = size_t(2048) * 1024 * 1024;
+
+		TextureCache();
+
 		// clear
 		void Clear();
 
 		bool Contains(const char *sz) const;
 		StoredFrame& operator[](const char * sz);
 
+		// Should be called after frame returned by operator[] for the same key was filled with pixels.
+		// Compacts frame according to storage mode and evicts old entries if the budget is exceeded
+		void Store(const char* sz);
+
+		void SetByteBudget(size_t bytes);
+		size_t GetByteBudget() const { return m_byteBudget; }
+
+		void SetStorageMode(StorageMode mode) { m_storageMode = mode; }
+		StorageMode GetStorageMode() const { return m_storageMode; }
+
+		Statistics GetStatistics() const;
+		void ResetStatistics();
+
 	private:
 		struct Entry
 		{
+			std::string key;
 			StoredFrame frame;
-			int age = 0;
+			size_t byteSize = 0;	// size accounted in m_byteSize
 		};
 
-		int m_age = 0;
-		std::map<std::string, Entry> m_map;
+		typedef std::list<Entry> EntryList;
+
+		void UpdateSize(Entry& entry);
+		void EvictToBudget();
+
+		EntryList m_entries;	// most recently used first
+		std::unordered_map<std::string, EntryList::iterator> m_index;
+
+		size_t m_byteSize;
+		size_t m_byteBudget;
+		StorageMode m_storageMode;
+
+		unsigned long long m_hits;
+		unsigned long long m_misses;
+		unsigned long long m_evictions;
 	};
 }
@@ -11,11 +11,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ********************************************************************/
 #include "FireRenderThread.h"
+#include "Tracing.h"
 
 #if _WIN32
 #include <windows.h>
 #endif
 #include <cassert>
+#include <algorithm>
 
 #include <maya/MTimerMessage.h>
 
@@ -23,24 +25,47 @@ using namespace std;
 
 namespace FireMaya
 {
-vector<shared_ptr<FireRenderThread::QueueItemBase>> FireRenderThread::itemQueue;
-vector<shared_ptr<FireRenderThread::QueueItemBase>> FireRenderThread::itemQueueForMainThread;
+deque<shared_ptr<FireRenderThread::QueueItemBase>> FireRenderThread::onceQueue;
+vector<shared_ptr<FireRenderThread::QueueItemBase>> FireRenderThread::keepRunningItems;
+deque<shared_ptr<FireRenderThread::QueueItemBase>> FireRenderThread::itemQueueForMainThread;
 mutex FireRenderThread::itemQueueMutex;
+condition_variable FireRenderThread::itemQueueCondition;
+condition_variable FireRenderThread::mainThreadCondition;
 unique_ptr<thread> FireRenderThread::ptrWorkerThread;
 atomic_bool FireRenderThread::shouldUseThread { false };
 atomic_bool FireRenderThread::runTheThread { true };
+bool FireRenderThread::keepRunningIdle = false;
+bool FireRenderThread::wakeRequested = false;
+unsigned long long FireRenderThread::mainThreadPostCount = 0;
+atomic_bool FireRenderThread::itemReportedIdle { false };
 set<thread::id> FireRenderThread::executingThreadIds;
 
+atomic<unsigned long long> FireRenderThread::statItemsExecuted { 0 };
+atomic<unsigned long long> FireRenderThread::statMainThreadItemsExecuted { 0 };
+atomic<unsigned long long> FireRenderThread::statWaitLatencyTotalUs { 0 };
+atomic<unsigned long long> FireRenderThread::statWaitLatencyMaxUs { 0 };
+atomic<unsigned long long> FireRenderThread::statWaitLatencyCount { 0 };
+atomic<unsigned long long> FireRenderThread::statMainThreadWaitUs { 0 };
+
 MCallbackId FireRenderThread::callbackId_RPRMainThreadEvent = 0;
 
 std::thread::id gMainThreadId;
 
+// Idle "keep running" items are still polled this often in case something changed without Wake
+static const chrono::milliseconds KeepRunningIdleTimeout(100);
+
+// Pause between passes over busy "keep running" items so the thread doesn't spin, posted items end it earlier
+static const chrono::milliseconds KeepRunningBusyTimeout(1);
+
+// Upper bound for main thread waits, main thread items posted meanwhile wake it earlier
+static const chrono::milliseconds MainThreadWaitTimeout(100);
+
 class QueueItem : public FireRenderThread::QueueItemBase
 {
 	std::future<void> _result;
 	std::promise<void> _promise;
 	std::function<bool()> _function;
-	bool _isFinished;
+	std::atomic_bool _isFinished;
 public:
 	QueueItem(std::function<bool()> function) :
 		_promise(),
@@ -54,10 +79,12 @@ public:
 	{
 		try
 		{
-			_isFinished = !_function();
+			bool isFinished = !_function();
 
-			if (_isFinished)
+			if (isFinished)
 				_promise.set_value();
+
+			_isFinished = isFinished;
 		}
 		catch (...)
 		{
@@ -75,11 +102,158 @@ public:
 
 void FireRenderThread::KeepRunning(std::function<bool()> function)
 {
-	unique_lock<mutex> lock(itemQueueMutex);
+	{
+		unique_lock<mutex> lock(itemQueueMutex);
+
+		CheckThreadIsRunning();
+
+		keepRunningItems.push_back(make_shared<QueueItem>(function));
+
+		// new item has to run at least once even if others are idle
+		wakeRequested = true;
+	}
+
+	itemQueueCondition.notify_one();
+}
+
+void FireRenderThread::PostOnceItem(std::shared_ptr<QueueItemBase> item)
+{
+	item->enqueueTime = chrono::steady_clock::now();
+
+	{
+		unique_lock<mutex> lock(itemQueueMutex);
 
-	CheckThreadIsRunning();
+		// caller is blocked until the item is done, so it goes ahead of already queued ones
+		onceQueue.push_front(item);
+	}
 
-	itemQueue.push_back(make_shared<QueueItem>(function));
+	itemQueueCondition.notify_one();
+}
+
+size_t FireRenderThread::RunOnceItems()
+{
+	decltype(onceQueue) queue;
+
+	{
+		unique_lock<mutex> lock(itemQueueMutex);
+		queue.swap(onceQueue);
+	}
+
+	for (auto& item : queue)
+	{
+		RecordWaitLatency(*item);
+		item->Run();
+	}
+
+	statItemsExecuted += queue.size();
+
+	return queue.size();
+}
+
+void FireRenderThread::PostMainThreadItem(std::shared_ptr<QueueItemBase> item)
+{
+	item->enqueueTime = chrono::steady_clock::now();
+
+	{
+		unique_lock<mutex> lock(itemQueueMutex);
+		itemQueueForMainThread.push_back(item);
+		mainThreadPostCount++;
+	}
+
+	mainThreadCondition.notify_all();
+}
+
+void FireRenderThread::NotifyItemFinished()
+{
+	// lock is needed so that notification can't be lost between predicate check and wait in WaitOnMainThread
+	{
+		unique_lock<mutex> lock(itemQueueMutex);
+	}
+
+	mainThreadCondition.notify_all();
+}
+
+void FireRenderThread::RecordWaitLatency(const QueueItemBase& item)
+{
+	if (item.enqueueTime == chrono::steady_clock::time_point())
+		return;
+
+	unsigned long long latency = (unsigned long long)
+		chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - item.enqueueTime).count();
+
+	statWaitLatencyTotalUs += latency;
+	statWaitLatencyCount++;
+
+	unsigned long long currentMax = statWaitLatencyMaxUs;
+	while (latency > currentMax && !statWaitLatencyMaxUs.compare_exchange_weak(currentMax, latency))
+	{
+	}
+}
+
+void FireRenderThread::ReportIdle()
+{
+	itemReportedIdle = true;
+}
+
+void FireRenderThread::Wake()
+{
+	{
+		unique_lock<mutex> lock(itemQueueMutex);
+		wakeRequested = true;
+		keepRunningIdle = false;
+	}
+
+	itemQueueCondition.notify_one();
+}
+
+void FireRenderThread::WaitOnMainThread(QueueItemBase& item)
+{
+	auto waitStart = chrono::steady_clock::now();
+
+	while (!item.IsFinished())
+	{
+		unsigned long long postCount = GetMainThreadPostCount();
+
+		RunItemsQueuedForTheMainThread();
+
+		// unfinished "keep running" items stay in the queue, so only newly posted items end the wait,
+		// the timeout lets those items run again while the wait is long
+		unique_lock<mutex> lock(itemQueueMutex);
+		auto isSignaled = [&item, postCount]()
+		{
+			return item.IsFinished() || (mainThreadPostCount != postCount);
+		};
+
+		if (itemQueueForMainThread.empty())
+		{
+			mainThreadCondition.wait(lock, isSignaled);
+		}
+		else
+		{
+			mainThreadCondition.wait_for(lock, MainThreadWaitTimeout, isSignaled);
+		}
+	}
+
+	statMainThreadWaitUs += (unsigned long long)
+		chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - waitStart).count();
+}
+
+void FireRenderThread::WaitOnMainThreadUntil(const std::function<bool()>& predicate)
+{
+	while (!predicate())
+	{
+		unsigned long long postCount = GetMainThreadPostCount();
+
+		RunItemsQueuedForTheMainThread();
+
+		// predicate is checked again under the lock so NotifyItemFinished can't be missed,
+		// wait is still bounded because predicate may depend on state changed without notification
+		unique_lock<mutex> lock(itemQueueMutex);
+		if ((mainThreadPostCount == postCount) && !predicate())
+		{
+			mainThreadCondition.wait_for(lock, MainThreadWaitTimeout);
+		}
+	}
 }
 
 /* Should return true if thread is running, if we are on that thread or we should not use the thread */
@@ -100,6 +274,12 @@ bool FireRenderThread::CheckThreadIsRunning()
 	}
 }
 
+unsigned long long FireRenderThread::GetMainThreadPostCount()
+{
+	unique_lock<mutex> lock(itemQueueMutex);
+	return mainThreadPostCount;
+}
+
 bool FireRenderThread::AreWeOnMainThread()
 {
 	assert(gMainThreadId != thread::id());	// Must be initialized!
@@ -113,32 +293,68 @@ size_t FireRenderThread::RunItemsQueuedForTheMainThread()
 
 	{
 		unique_lock<mutex> lock(itemQueueMutex);
-		queue = itemQueueForMainThread;
+		queue.swap(itemQueueForMainThread);
 	}
 
 	auto count = queue.size();
 
 	if (count)
 	{
-		for (auto item : queue)
-			item->Run();
+		decltype(itemQueueForMainThread) unfinished;
 
-		// Now remove complete items:
+		for (auto& item : queue)
 		{
-			unique_lock<mutex> lock(itemQueueMutex);
-			decltype(itemQueueForMainThread) newQueue;
+			RecordWaitLatency(*item);
+			item->Run();
+
+			if (item->IsFinished() == false)
+				unfinished.push_back(item);
+		}
 
-			for (auto item : itemQueueForMainThread)
-				if (item->IsFinished() == false)
-					newQueue.push_back(item);
+		statMainThreadItemsExecuted += count;
 
-			itemQueueForMainThread = newQueue;
+		// "keep running" items stay in the queue ahead of newly posted ones
+		if (!unfinished.empty())
+		{
+			unique_lock<mutex> lock(itemQueueMutex);
+			itemQueueForMainThread.insert(itemQueueForMainThread.begin(), unfinished.begin(), unfinished.end());
 		}
 	}
 
 	return count;
 }
 
+FireRenderThread::Statistics FireRenderThread::GetStatistics()
+{
+	Statistics stats;
+
+	{
+		unique_lock<mutex> lock(itemQueueMutex);
+		stats.queueDepth = onceQueue.size();
+		stats.keepRunningCount = keepRunningItems.size();
+		stats.mainThreadQueueDepth = itemQueueForMainThread.size();
+	}
+
+	stats.itemsExecuted = statItemsExecuted;
+	stats.mainThreadItemsExecuted = statMainThreadItemsExecuted;
+
+	unsigned long long latencyCount = statWaitLatencyCount;
+	stats.averageWaitLatencyMs = latencyCount > 0 ? (statWaitLatencyTotalUs / 1000.0) / latencyCount : 0.0;
+	stats.maxWaitLatencyMs = statWaitLatencyMaxUs / 1000.0;
+	stats.mainThreadWaitTimeMs = statMainThreadWaitUs / 1000.0;
+
+	return stats;
+}
+
+void FireRenderThread::ResetStatistics()
+{
+	statItemsExecuted = 0;
+	statMainThreadItemsExecuted = 0;
+	statWaitLatencyTotalUs = 0;
+	statWaitLatencyMaxUs = 0;
+	statWaitLatencyCount = 0;
+	statMainThreadWaitUs = 0;
+}
 
 #if _WIN32
 
@@ -178,56 +394,95 @@ void FireRenderThread::ThreadProc(void *)
 #if _WIN32
 	SetThreadName(GetCurrentThreadId(), "* FireRenderThread *");
 #endif
+	FireMaya::Trace::SetThreadName("FireRenderThread");
 	executingThreadIds.emplace(this_thread::get_id());
 
 	while (runTheThread)
 	{
-		decltype(itemQueue) queue;
+		decltype(keepRunningItems) keepRunning;
 
 		{
 			unique_lock<mutex> lock(itemQueueMutex);
-			queue = itemQueue;
+
+			auto hasWork = []()
+			{
+				return !runTheThread || !onceQueue.empty() || wakeRequested;
+			};
+
+			// sleep until something is posted, woken or thread is asked to quit;
+			// "keep running" items are polled again after a timeout, a long one when all of them are idle
+			if (keepRunningItems.empty())
+			{
+				itemQueueCondition.wait(lock, hasWork);
+			}
+			else
+			{
+				itemQueueCondition.wait_for(lock, keepRunningIdle ? KeepRunningIdleTimeout : KeepRunningBusyTimeout, hasWork);
+			}
+
+			wakeRequested = false;
+			keepRunningIdle = false;
+
+			keepRunning = keepRunningItems;
 		}
 
-		if (queue.empty())
+		RunOnceItems();
+
+		size_t idleCount = 0;
+		for (auto& item : keepRunning)
 		{
-			this_thread::sleep_for(10ms);
+			itemReportedIdle = false;
+			item->Run();
+
+			if (itemReportedIdle || item->IsFinished())
+				idleCount++;
+
+			// callers waiting for "once" items shouldn't wait for the whole pass
+			RunOnceItems();
 		}
-		else
-		{
-			for (auto item : queue)
-			{
-				item->Run();
-				this_thread::yield();
-			}
 
+		statItemsExecuted += keepRunning.size();
+
+		// Now remove complete items:
+		if (!keepRunning.empty())
+		{
+			size_t removed = 0;
 			{
 				unique_lock<mutex> lock(itemQueueMutex);
-				decltype(itemQueue) newQueue;
 
-				for (auto item : itemQueue)
-					if (item->IsFinished() == false)
-						newQueue.push_back(item);
+				size_t count = keepRunningItems.size();
+				keepRunningItems.erase(
+					std::remove_if(keepRunningItems.begin(), keepRunningItems.end(), [](const shared_ptr<QueueItemBase>& item) { return item->IsFinished(); }),
+					keepRunningItems.end());
+				removed = count - keepRunningItems.size();
 
-				itemQueue = newQueue;
+				// Wake called during this pass keeps wakeRequested set so the items run again immediately
+				keepRunningIdle = (idleCount == keepRunning.size());
 			}
 
-			this_thread::yield();
+			// main thread may be waiting for the item to finish (WaitOnMainThreadUntil)
+			if (removed > 0)
+				NotifyItemFinished();
 		}
+
+		this_thread::yield();
 	}
 
 	executingThreadIds.erase(this_thread::get_id());
-
-	ptrWorkerThread.release();
 }
 
 void FireRenderThread::KeepRunningOnMainThread(std::function<bool()> function)
 {
-	unique_lock<mutex> lock(itemQueueMutex);
+	{
+		unique_lock<mutex> lock(itemQueueMutex);
 
-	CheckThreadIsRunning();
+		CheckThreadIsRunning();
+
+		itemQueueForMainThread.push_back(make_shared<QueueItem>(function));
+		mainThreadPostCount++;
+	}
 
-	itemQueueForMainThread.push_back(make_shared<QueueItem>(function));
+	mainThreadCondition.notify_all();
 }
 
 void FireRenderThread::CheckIsOnRPRThread()
@@ -254,6 +509,11 @@ void FireRenderThread::RunTheThread(bool value)
 	{
 		UnregisterRPREventCallback();
 
+		{
+			unique_lock<mutex> lock(itemQueueMutex);
+		}
+		itemQueueCondition.notify_all();
+
 		auto ptr = std::move(FireRenderThread::ptrWorkerThread);
 		if (ptr)
 		ptr->join();
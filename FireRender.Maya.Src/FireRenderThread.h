@@ -15,8 +15,12 @@ limitations under the License.
 #include <functional>
 #include <memory>
 #include <vector>
+#include <deque>
 #include <set>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <thread>
 #include <exception>
@@ -46,9 +50,27 @@ class FireRenderThread
 public:
 	struct QueueItemBase
 	{
+		virtual ~QueueItemBase() = default;
 		virtual void Run() = 0;
 		virtual bool IsFinished() = 0;
+
+		// set when item is posted to the queue, used for latency statistics
+		std::chrono::steady_clock::time_point enqueueTime;
+	};
+
+	/* Dispatch counters, see GetStatistics */
+	struct Statistics
+	{
+		size_t queueDepth = 0;				// "once" items waiting for the RPR thread
+		size_t keepRunningCount = 0;		// "keep running" items on the RPR thread
+		size_t mainThreadQueueDepth = 0;	// items waiting for the main thread
+		unsigned long long itemsExecuted = 0;
+		unsigned long long mainThreadItemsExecuted = 0;
+		double averageWaitLatencyMs = 0.0;	// time from posting "once" item till it starts
+		double maxWaitLatencyMs = 0.0;
+		double mainThreadWaitTimeMs = 0.0;	// total time main thread was blocked waiting for items
 	};
+
 private:
 	template<typename T>
 	class RunOnceQueueItem : public QueueItemBase
@@ -56,7 +78,7 @@ private:
 		std::future<T> _result;
 		std::promise<T> _promise;
 		std::function<T()> _function;
-		bool _finished;
+		std::atomic_bool _finished;
 	public:
 		RunOnceQueueItem(std::function<T()> function) :
 			_promise(),
@@ -72,14 +94,15 @@ private:
 			{
 				T result = _function();
 
-				_finished = true;
 				_promise.set_value(result);
 			}
 			catch (...)
 			{
 				_promise.set_exception(std::current_exception());
-				_finished = true;
 			}
+
+			_finished = true;
+			NotifyItemFinished();
 		};
 
 		virtual bool IsFinished()
@@ -98,7 +121,7 @@ private:
 		std::future<void> _result;
 		std::promise<void> _promise;
 		std::function<void()> _function;
-		bool _finished;
+		std::atomic_bool _finished;
 	public:
 		RunOnceProcQueueItem(std::function<void()> function) :
 			_promise(),
@@ -114,14 +137,15 @@ private:
 			{
 				_function();
 
-				_finished = true;
 				_promise.set_value();
 			}
 			catch (...)
 			{
 				_promise.set_exception(std::current_exception());
-				_finished = true;
 			}
+
+			_finished = true;
+			NotifyItemFinished();
 		};
 
 		virtual bool IsFinished()
@@ -136,15 +160,35 @@ private:
 	};
 
 private:
-	static std::vector<std::shared_ptr<QueueItemBase>> itemQueue;
-	static std::vector<std::shared_ptr<QueueItemBase>> itemQueueForMainThread;
+	// "once" items are executed before "keep running" items and between them, the most recently posted one first
+	// since its caller is blocked waiting for it
+	static std::deque<std::shared_ptr<QueueItemBase>> onceQueue;
+	static std::vector<std::shared_ptr<QueueItemBase>> keepRunningItems;
+	static std::deque<std::shared_ptr<QueueItemBase>> itemQueueForMainThread;
 	static std::set<std::thread::id> executingThreadIds;
 	static std::mutex itemQueueMutex;
+	// wakes RPR thread when items are posted
+	static std::condition_variable itemQueueCondition;
+	// wakes main thread waiting in AlertWait when items are posted for it or any item is finished
+	static std::condition_variable mainThreadCondition;
 	static std::unique_ptr<std::thread> ptrWorkerThread;
 	static std::atomic_bool shouldUseThread;
 	static std::atomic_bool runTheThread;
+	// set when every "keep running" item reported idle on the last pass, cleared by Wake
+	static bool keepRunningIdle;
+	static bool wakeRequested;
+	// number of items ever posted for the main thread, "keep running" items put back in the queue aren't counted
+	static unsigned long long mainThreadPostCount;
+	static std::atomic_bool itemReportedIdle;
 	static MCallbackId callbackId_RPRMainThreadEvent;
 
+	static std::atomic<unsigned long long> statItemsExecuted;
+	static std::atomic<unsigned long long> statMainThreadItemsExecuted;
+	static std::atomic<unsigned long long> statWaitLatencyTotalUs;
+	static std::atomic<unsigned long long> statWaitLatencyMaxUs;
+	static std::atomic<unsigned long long> statWaitLatencyCount;
+	static std::atomic<unsigned long long> statMainThreadWaitUs;
+
 public:
 	/**
 	This method will execute specified function on that one thread and pause main/calling function until block is complete
@@ -162,9 +206,7 @@ public:
 
 			if (shouldPostToQueue)
 			{
-				std::unique_lock<std::mutex> lock(itemQueueMutex);
-
-				itemQueue.emplace(itemQueue.begin(), ptr);
+				PostOnceItem(ptr);
 			}
 			else
 			{
@@ -183,9 +225,7 @@ public:
 		{
 			if (CheckThreadIsRunning())
 			{
-				std::unique_lock<std::mutex> lock(itemQueueMutex);
-
-				itemQueue.emplace(itemQueue.begin(), ptr);
+				PostOnceItem(ptr);
 			}
 			else
 			{
@@ -209,9 +249,7 @@ public:
 			}
 			else
 			{
-				std::unique_lock<std::mutex> lock(itemQueueMutex);
-
-				itemQueueForMainThread.push_back(ptr);
+				PostMainThreadItem(ptr);
 			}
 		}
 
@@ -228,9 +266,7 @@ public:
 			}
 			else
 			{
-				std::unique_lock<std::mutex> lock(itemQueueMutex);
-
-				itemQueueForMainThread.push_back(ptr);
+				PostMainThreadItem(ptr);
 			}
 		}
 
@@ -247,6 +283,17 @@ public:
 	Block of code should avoid waiting and sleeping as it shares the main thread.
 	*/
 	static void KeepRunningOnMainThread(std::function<bool()> function);
+	/**
+	Called by a "keep running" item which has nothing to do on this pass. When all of them are idle the RPR thread
+	sleeps until an item is posted, Wake is called or KeepRunningIdleTimeout passes. Busy items are run again
+	after a short KeepRunningBusyTimeout wait, which is also cut short by posted items.
+	*/
+	static void ReportIdle();
+	/* Wakes idle "keep running" items, should be called when something they wait for changes (scene, camera, state) */
+	static void Wake();
+	/* Blocks main thread until predicate returns true, executing items posted for the main thread meanwhile.
+	Predicate is also called under the queue lock, so it must not post items. */
+	static void WaitOnMainThreadUntil(const std::function<bool()>& predicate);
 	/* Checks if caller is running on RPR Thread */
 	static void CheckIsOnRPRThread();
 	/* If set to false to just directly run all run and wait calls, returns previous value */
@@ -259,6 +306,9 @@ public:
 	static size_t RunItemsQueuedForTheMainThread();
 	static bool AreWeOnMainThread();
 
+	/* Returns queue depths and dispatch latency counters */
+	static Statistics GetStatistics();
+	static void ResetStatistics();
 
 private:
 	struct AutoAddThisExectingThread
@@ -276,14 +326,22 @@ private:
 	static void RegisterRPREventCallback();
 	static void UnregisterRPREventCallback();
 
+	static void PostOnceItem(std::shared_ptr<QueueItemBase> item);
+	static size_t RunOnceItems();
+	static void PostMainThreadItem(std::shared_ptr<QueueItemBase> item);
+	static void NotifyItemFinished();
+	static void RecordWaitLatency(const QueueItemBase& item);
+	static unsigned long long GetMainThreadPostCount();
+
+	/* Blocks main thread until item is finished, executing items posted for the main thread meanwhile */
+	static void WaitOnMainThread(QueueItemBase& item);
+
 	template<typename T>
 	static T AlertWait(std::shared_ptr<RunOnceQueueItem<T>> item)
 	{
 		if (AreWeOnMainThread())
 		{
-			do
-				RunItemsQueuedForTheMainThread();
-			while (!item->IsFinished());
+			WaitOnMainThread(*item);
 		}
 
 		return item->GetResult();
@@ -293,9 +351,7 @@ private:
 	{
 		if (AreWeOnMainThread())
 		{
-			do
-				RunItemsQueuedForTheMainThread();
-			while (!item->IsFinished());
+			WaitOnMainThread(*item);
 		}
 
 		item->GetResult();
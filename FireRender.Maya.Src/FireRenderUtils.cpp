@@ -14,6 +14,7 @@ limitations under the License.
 #include "RprTools.h"
 
 #include "FireRenderUtils.h"
+#include "Tracing.h"
 #include <maya/MPlug.h>
 #include <maya/MPlugArray.h>
 #include <maya/MItDag.h>
@@ -29,9 +30,11 @@ limitations under the License.
 #include <maya/MFnDependencyNode.h>
 #include <maya/MFileObject.h>
 #include <maya/MCommonSystemUtils.h>
+#include <maya/MObjectHandle.h>
 
 #include <cassert>
 #include <vector>
+#include <unordered_map>
 #include <time.h>
 #include <iostream>
 
@@ -87,6 +90,7 @@ FireRenderGlobalsData::FireRenderGlobalsData() :
 	viewportMaxRayDepth(2),
 	viewportMaxDiffuseRayDepth(2),
 	viewportMaxReflectionRayDepth(2),
+	viewportHairDensity(1.0f),
 	viewportRenderMode(FireRenderGlobals::kGlobalIllumination),
 	renderMode(FireRenderGlobals::kGlobalIllumination),
 	commandPort(0),
@@ -110,6 +114,7 @@ FireRenderGlobalsData::FireRenderGlobalsData() :
 	tileRenderingEnabled(false),
 	tileSizeX(0),
 	tileSizeY(0),
+	tileFillType(0),
 	cameraType(0),
 	useMPS(false),
 	useDetailedContextWorkLog(false),
@@ -139,9 +144,86 @@ FireRenderGlobalsData::~FireRenderGlobalsData()
 
 }
 
+namespace
+{
+	// Attribute objects of the current globals node, accessed on main thread only (GlobalsAttributeReader asserts it)
+	struct GlobalsAttributeCache
+	{
+		MObjectHandle node;
+		std::unordered_map<std::string, MObject> attributes;
+	};
+
+	GlobalsAttributeCache& GetGlobalsAttributeCache()
+	{
+		static GlobalsAttributeCache cache;
+		return cache;
+	}
+}
+
+GlobalsAttributeReader::GlobalsAttributeReader(const MObject& globalsNode, const std::set<std::string>* filter) :
+	m_globalsNode(globalsNode),
+	m_node(globalsNode),
+	m_filter(filter),
+	m_readCount(0)
+{
+	MAIN_THREAD_ONLY;
+
+	GlobalsAttributeCache& cache = GetGlobalsAttributeCache();
+
+	// globals node is recreated with new scene
+	if (!cache.node.isValid() || (cache.node.object() != globalsNode))
+	{
+		cache.node = MObjectHandle(globalsNode);
+		cache.attributes.clear();
+	}
+}
+
+MPlug GlobalsAttributeReader::findPlug(const char* name)
+{
+	if (m_filter != nullptr)
+	{
+		if (m_filter->find(name) == m_filter->end())
+			return MPlug();
+
+		++m_readCount;
+	}
+
+	MAIN_THREAD_ONLY;
+
+	GlobalsAttributeCache& cache = GetGlobalsAttributeCache();
+
+	auto it = cache.attributes.find(name);
+	if (it == cache.attributes.end())
+	{
+		MStatus status;
+		MObject attribute = m_node.attribute(name, &status);
+		if ((status != MStatus::kSuccess) || attribute.isNull())
+			return MPlug();
+
+		it = cache.attributes.emplace(name, attribute).first;
+	}
+
+	return MPlug(m_globalsNode, it->second);
+}
+
+bool GlobalsAttributeReader::HasUnreadAttributes(void) const
+{
+	return (m_filter != nullptr) && (m_readCount < m_filter->size());
+}
+
 void FireRenderGlobalsData::readFromCurrentScene()
 {
-	FireMaya::FireRenderThread::RunProcOnMainThread([this]
+	readAttributes(nullptr);
+}
+
+void FireRenderGlobalsData::readFromCurrentScene(const std::set<std::string>& changedAttributes)
+{
+	readAttributes(&changedAttributes);
+}
+
+void FireRenderGlobalsData::readAttributes(const std::set<std::string>* filter)
+{
+	FireMaya::FireRenderThread::RunProcOnMainThread([this, filter]
 	{
 		MStatus status;
 
@@ -162,160 +244,168 @@ void FireRenderGlobalsData::readFromCurrentScene()
 		}
 
 		// Get Fire render globals attributes
-		MFnDependencyNode frGlobalsNode(fireRenderGlobals);
+		GlobalsAttributeReader globals(fireRenderGlobals, filter);
 
-/*		MPlug plug = frGlobalsNode.findPlug("completionCriteriaType");
+/*		MPlug plug = globals.findPlug("completionCriteriaType");
 		if (!plug.isNull())
 			completionCriteriaFinalRender.completionCriteriaType = plug.asShort();*/
 
-		MPlug plug = frGlobalsNode.findPlug("completionCriteriaHours");
+		MPlug plug = globals.findPlug("completionCriteriaHours");
 		if (!plug.isNull())
 			completionCriteriaFinalRender.completionCriteriaHours = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("completionCriteriaMinutes");
+		plug = globals.findPlug("completionCriteriaMinutes");
 		if (!plug.isNull())
 			completionCriteriaFinalRender.completionCriteriaMinutes = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("completionCriteriaSeconds");
+		plug = globals.findPlug("completionCriteriaSeconds");
 		if (!plug.isNull())
 			completionCriteriaFinalRender.completionCriteriaSeconds = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("completionCriteriaIterations");
+		plug = globals.findPlug("completionCriteriaIterations");
 		if (!plug.isNull())
 			completionCriteriaFinalRender.completionCriteriaMaxIterations = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("completionCriteriaMinIterations");
+		plug = globals.findPlug("completionCriteriaMinIterations");
 		if (!plug.isNull())
 			completionCriteriaFinalRender.completionCriteriaMinIterations = plug.asInt();
 
 
-		/*plug = frGlobalsNode.findPlug("completionCriteriaTypeViewport");
+		/*plug = globals.findPlug("completionCriteriaTypeViewport");
 		if (!plug.isNull())
 			completionCriteriaViewport.completionCriteriaType = plug.asShort();*/
 
-		plug = frGlobalsNode.findPlug("completionCriteriaHoursViewport");
+		plug = globals.findPlug("completionCriteriaHoursViewport");
 		if (!plug.isNull())
 			completionCriteriaViewport.completionCriteriaHours = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("completionCriteriaMinutesViewport");
+		plug = globals.findPlug("completionCriteriaMinutesViewport");
 		if (!plug.isNull())
 			completionCriteriaViewport.completionCriteriaMinutes = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("completionCriteriaSecondsViewport");
+		plug = globals.findPlug("completionCriteriaSecondsViewport");
 		if (!plug.isNull())
 			completionCriteriaViewport.completionCriteriaSeconds = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("completionCriteriaIterationsViewport");
+		plug = globals.findPlug("completionCriteriaIterationsViewport");
 		if (!plug.isNull())
 			completionCriteriaViewport.completionCriteriaMaxIterations = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("completionCriteriaMinIterationsViewport");
+		plug = globals.findPlug("completionCriteriaMinIterationsViewport");
 		if (!plug.isNull())
 			completionCriteriaViewport.completionCriteriaMinIterations = plug.asInt();
 
 
-		plug = frGlobalsNode.findPlug("adaptiveTileSize");
+		plug = globals.findPlug("adaptiveTileSize");
 		if (!plug.isNull())
 			adaptiveTileSize = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("adaptiveThreshold");
+		plug = globals.findPlug("adaptiveThreshold");
 		if (!plug.isNull())
 			adaptiveThreshold = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("adaptiveThresholdViewport");
+		plug = globals.findPlug("adaptiveThresholdViewport");
 		if (!plug.isNull())
 			adaptiveThresholdViewport = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("textureCompression");
+		plug = globals.findPlug("textureCompression");
 		if (!plug.isNull())
 			textureCompression = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("useLegacyRPRToon");
+		plug = globals.findPlug("useLegacyRPRToon");
 		if (!plug.isNull())
 			useLegacyRPRToon = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("renderModeViewport");
+		plug = globals.findPlug("renderModeViewport");
 		if (!plug.isNull())
 			viewportRenderMode = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("renderMode");
+		plug = globals.findPlug("renderMode");
 		if (!plug.isNull())
 			renderMode = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("textureCachePath");
+		plug = globals.findPlug("textureCachePath");
 		if (!plug.isNull())
 			textureCachePath = plug.asString();
 
-		plug = frGlobalsNode.findPlug("giClampIrradiance");
+		plug = globals.findPlug("giClampIrradiance");
 		if (!plug.isNull())
 			giClampIrradiance = plug.asBool();
-		plug = frGlobalsNode.findPlug("giClampIrradianceValue");
+		plug = globals.findPlug("giClampIrradianceValue");
 		if (!plug.isNull())
 			giClampIrradianceValue = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("samplesPerUpdate");
+		plug = globals.findPlug("samplesPerUpdate");
 		if (!plug.isNull())
 			samplesPerUpdate = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("filter");
+		plug = globals.findPlug("filter");
 		if (!plug.isNull())
 			filterType = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("filterSize");
+		plug = globals.findPlug("filterSize");
 		if (!plug.isNull())
 			filterSize = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxRayDepth");
+		plug = globals.findPlug("maxRayDepth");
 		if (!plug.isNull())
 			maxRayDepth = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxDepthDiffuse");
+		plug = globals.findPlug("maxDepthDiffuse");
 		if (!plug.isNull())
 			maxRayDepthDiffuse = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxDepthGlossy");
+		plug = globals.findPlug("maxDepthGlossy");
 		if (!plug.isNull())
 			maxRayDepthGlossy = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxDepthRefraction");
+		plug = globals.findPlug("maxDepthRefraction");
 		if (!plug.isNull())
 			maxRayDepthRefraction = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxDepthRefractionGlossy");
+		plug = globals.findPlug("maxDepthRefractionGlossy");
 		if (!plug.isNull())
 			maxRayDepthGlossyRefraction = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxDepthShadow");
+		plug = globals.findPlug("maxDepthShadow");
 		if (!plug.isNull())
 			maxRayDepthShadow = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxRayDepthViewport");
+		plug = globals.findPlug("maxRayDepthViewport");
 		if (!plug.isNull())
 			viewportMaxRayDepth = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxDepthDiffuseViewport");
+		plug = globals.findPlug("maxDepthDiffuseViewport");
 		if (!plug.isNull())
 			viewportMaxDiffuseRayDepth = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("maxDepthGlossyViewport");
+		plug = globals.findPlug("maxDepthGlossyViewport");
 		if (!plug.isNull())
 			viewportMaxReflectionRayDepth = plug.asShort();
 
+		plug = globals.findPlug("hairDensityViewport");
+		if (!plug.isNull())
+			viewportHairDensity = plug.asFloat();
+
 		// 3 Tile Rendering related parameters
-		plug = frGlobalsNode.findPlug("tileRenderEnabled");
+		plug = globals.findPlug("tileRenderEnabled");
 		if (!plug.isNull())
 			tileRenderingEnabled = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("tileRenderX");
+		plug = globals.findPlug("tileRenderX");
 		if (!plug.isNull())
 			tileSizeX = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("tileRenderY");
+		plug = globals.findPlug("tileRenderY");
 		if (!plug.isNull())
 			tileSizeY = plug.asInt();
 
+		plug = globals.findPlug("tileRenderFillType");
+		if (!plug.isNull())
+			tileFillType = plug.asShort();
+
 		// In UI raycast epsilon defined in 1/10 of scene units, convert it to meters
-		plug = frGlobalsNode.findPlug("raycastEpsilon");
+		plug = globals.findPlug("raycastEpsilon");
 		if (!plug.isNull())
 		{
 			const MDistance::Unit sceneUnits = MDistance::uiUnit();
@@ -323,346 +413,393 @@ void FireRenderGlobalsData::readFromCurrentScene()
 			raycastEpsilon = (float)( MDistance((epsilonUIValue * 0.1f), sceneUnits).asMeters());
 		}
 
-		plug = frGlobalsNode.findPlug("enableOOC");
+		plug = globals.findPlug("enableOOC");
 		if (!plug.isNull())
 			enableOOC = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("textureCacheSize");
+		plug = globals.findPlug("textureCacheSize");
 		if (!plug.isNull())
 			oocTexCache = plug.asInt();
 
-/*		plug = frGlobalsNode.findPlug("maxRayDepthViewport");
+/*		plug = globals.findPlug("maxRayDepthViewport");
 		if (!plug.isNull())
 			maxRayDepthViewport = plug.asShort();*/
 
-		plug = frGlobalsNode.findPlug("commandPort");
+		plug = globals.findPlug("commandPort");
 		if (!plug.isNull())
 			commandPort = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("applyGammaToMayaViews");
+		plug = globals.findPlug("applyGammaToMayaViews");
 		if (!plug.isNull())
 			applyGammaToMayaViews = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("displayGamma");
+		plug = globals.findPlug("displayGamma");
 		if (!plug.isNull())
 			displayGamma = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("useRenderStamp");
+		plug = globals.findPlug("useRenderStamp");
 		if (!plug.isNull())
 			useRenderStamp = plug.asBool();
-		plug = frGlobalsNode.findPlug("renderStampText");
+		plug = globals.findPlug("renderStampText");
 		if (!plug.isNull())
 			renderStampText = plug.asString();
 
-		plug = frGlobalsNode.findPlug("textureGamma");
+		plug = globals.findPlug("textureGamma");
 		if (!plug.isNull())
 			textureGamma = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingType");
+		plug = globals.findPlug("toneMappingType");
 		if (!plug.isNull())
 			toneMappingType = plug.asShort();
 
-		plug = frGlobalsNode.findPlug("toneMappingWhiteBalanceEnabled");
+		plug = globals.findPlug("toneMappingWhiteBalanceEnabled");
 		if (!plug.isNull()) {
 			toneMappingWhiteBalanceEnabled = plug.asBool();
 		}
 
-		plug = frGlobalsNode.findPlug("toneMappingWhiteBalanceValue");
+		plug = globals.findPlug("toneMappingWhiteBalanceValue");
 		if (!plug.isNull()) {
 			toneMappingWhiteBalanceValue = plug.asFloat();
 		}
 
-		plug = frGlobalsNode.findPlug("toneMappingLinearScale");
+		plug = globals.findPlug("toneMappingLinearScale");
 		if (!plug.isNull())
 			toneMappingLinearScale = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingPhotolinearSensitivity");
+		plug = globals.findPlug("toneMappingPhotolinearSensitivity");
 		if (!plug.isNull())
 			toneMappingPhotolinearSensitivity = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingPhotolinearExposure");
+		plug = globals.findPlug("toneMappingPhotolinearExposure");
 		if (!plug.isNull())
 			toneMappingPhotolinearExposure = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingPhotolinearFstop");
+		plug = globals.findPlug("toneMappingPhotolinearFstop");
 		if (!plug.isNull())
 			toneMappingPhotolinearFstop = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingReinhard02Prescale");
+		plug = globals.findPlug("toneMappingReinhard02Prescale");
 		if (!plug.isNull())
 			toneMappingReinhard02Prescale = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingReinhard02Postscale");
+		plug = globals.findPlug("toneMappingReinhard02Postscale");
 		if (!plug.isNull())
 			toneMappingReinhard02Postscale = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingReinhard02Burn");
+		plug = globals.findPlug("toneMappingReinhard02Burn");
 		if (!plug.isNull())
 			toneMappingReinhard02Burn = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingSimpleTonemap");
+		plug = globals.findPlug("toneMappingSimpleTonemap");
 		if (!plug.isNull())
 			toneMappingSimpleTonemap = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("toneMappingSimpleExposure");
+		plug = globals.findPlug("toneMappingSimpleExposure");
 		if (!plug.isNull())
 			toneMappingSimpleExposure = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("toneMappingSimpleContrast");
+		plug = globals.findPlug("toneMappingSimpleContrast");
 		if (!plug.isNull())
 			toneMappingSimpleContrast = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("motionBlur");
+		plug = globals.findPlug("motionBlur");
 		if (!plug.isNull())
 			motionBlur = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("cameraMotionBlur");
+		plug = globals.findPlug("cameraMotionBlur");
 		if (!plug.isNull())
 			cameraMotionBlur = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("motionBlurViewport");
+		plug = globals.findPlug("motionBlurViewport");
 		if (!plug.isNull())
 			viewportMotionBlur = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("velocityAOVMotionBlur");
+		plug = globals.findPlug("velocityAOVMotionBlur");
 		if (!plug.isNull())
 			velocityAOVMotionBlur = plug.asBool();
 		
-		plug = frGlobalsNode.findPlug("motionBlurCameraExposure");
+		plug = globals.findPlug("motionBlurCameraExposure");
 		if (!plug.isNull())
 			motionBlurCameraExposure = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("motionSamples");
+		plug = globals.findPlug("motionSamples");
 		if (!plug.isNull())
 			motionSamples = plug.asInt();	
 
-		plug = frGlobalsNode.findPlug("cameraType");
+		plug = globals.findPlug("cameraType");
 		if (!plug.isNull())
 			cameraType = plug.asShort();
 
 		// Use Metal Performance Shaders for MacOS
-		plug = frGlobalsNode.findPlug("useMPS");
+		plug = globals.findPlug("useMPS");
 		if (!plug.isNull())
 			useMPS = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("detailedLog");
+		plug = globals.findPlug("detailedLog");
 		if (!plug.isNull())
 			useDetailedContextWorkLog = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("contourIsEnabled");
+		plug = globals.findPlug("contourIsEnabled");
 		if (!plug.isNull())
 			contourIsEnabled = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("contourUseObjectID");
+		plug = globals.findPlug("contourUseObjectID");
 		if (!plug.isNull())
 			contourUseObjectID = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("contourUseMaterialID");
+		plug = globals.findPlug("contourUseMaterialID");
 		if (!plug.isNull())
 			contourUseMaterialID = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("contourUseShadingNormal");
+		plug = globals.findPlug("contourUseShadingNormal");
 		if (!plug.isNull())
 			contourUseShadingNormal = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("contourUseUV");
+		plug = globals.findPlug("contourUseUV");
 		if (!plug.isNull())
 			contourUseUV = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("contourLineWidthObjectID");
+		plug = globals.findPlug("contourLineWidthObjectID");
 		if (!plug.isNull())
 			contourLineWidthObjectID = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("contourLineWidthMaterialID");
+		plug = globals.findPlug("contourLineWidthMaterialID");
 		if (!plug.isNull())
 			contourLineWidthMaterialID = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("contourLineWidthShadingNormal");
+		plug = globals.findPlug("contourLineWidthShadingNormal");
 		if (!plug.isNull())
 			contourLineWidthShadingNormal = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("contourLineWidthUV");
+		plug = globals.findPlug("contourLineWidthUV");
 		if (!plug.isNull())
 			contourLineWidthUV = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("contourNormalThreshold");
+		plug = globals.findPlug("contourNormalThreshold");
 		if (!plug.isNull())
 			contourNormalThreshold = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("contourUVThreshold");
+		plug = globals.findPlug("contourUVThreshold");
 		if (!plug.isNull())
 			contourUVThreshold = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("contourAntialiasing");
+		plug = globals.findPlug("contourAntialiasing");
 		if (!plug.isNull())
 			contourAntialiasing = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("contourIsDebugEnabled");
+		plug = globals.findPlug("contourIsDebugEnabled");
 		if (!plug.isNull())
 			contourIsDebugEnabled = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("deepEXRMergeZThreshold");
+		plug = globals.findPlug("deepEXRMergeZThreshold");
 		if (!plug.isNull())
 			deepEXRMergeZThreshold = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("cryptomatteExtendedMode");
+		plug = globals.findPlug("cryptomatteExtendedMode");
 		if (!plug.isNull())
 			cryptomatteExtendedMode = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("cryptomatteSplitIndirect");
+		plug = globals.findPlug("cryptomatteSplitIndirect");
 		if (!plug.isNull())
 			cryptomatteSplitIndirect = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("aovShadowCatcher");
+		plug = globals.findPlug("aovShadowCatcher");
 		if (!plug.isNull())
 			shadowCatcherEnabled = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("aovReflectionCatcher");
+		plug = globals.findPlug("aovReflectionCatcher");
 		if (!plug.isNull())
 			reflectionCatcherEnabled = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("useGmon");
+		plug = globals.findPlug("useGmon");
 		if (!plug.isNull())
 			viewportUseGmon = plug.asBool();
 		
-		plug = frGlobalsNode.findPlug("useOpenCLContext");
+		plug = globals.findPlug("useOpenCLContext");
 		if (!plug.isNull())
 			useOpenCLContext = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("giniCoeffGmon");
+		plug = globals.findPlug("giniCoeffGmon");
 		if (!plug.isNull())  
 			viewportGiniCoeffGmon = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("ptDenoiser");
+		plug = globals.findPlug("ptDenoiser");
 		if (!plug.isNull())
 			viewportPtDenoiser = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("FSR");
+		plug = globals.findPlug("FSR");
 		if (!plug.isNull())
 			viewportFSR = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("materialCache");
+		plug = globals.findPlug("materialCache");
 		if (!plug.isNull())
 			viewportMaterialCache = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("restirGI");
+		plug = globals.findPlug("restirGI");
 		if (!plug.isNull())
 			viewportRestirGI = plug.asBool();
 		
-		plug = frGlobalsNode.findPlug("restirGIBiasCorrection");
+		plug = globals.findPlug("restirGIBiasCorrection");
 		if (!plug.isNull())
 			viewportRestirGIBiasCorrection = plug.asInt();
 		
-		plug = frGlobalsNode.findPlug("reservoirSampling");
+		plug = globals.findPlug("reservoirSampling");
 		if (!plug.isNull())
 			viewportReservoirSampling = plug.asInt();
 		
-		plug = frGlobalsNode.findPlug("restirSpatialResampleIterations");
+		plug = globals.findPlug("restirSpatialResampleIterations");
 		if (!plug.isNull())
 			viewportRestirSpatialResampleIterations = plug.asInt();
 		
-		plug = frGlobalsNode.findPlug("restirMaxReservoirsPerCell");
+		plug = globals.findPlug("restirMaxReservoirsPerCell");
 		if (!plug.isNull())
 			viewportRestirMaxReservoirsPerCell = plug.asInt(); 
 		
-		plug = frGlobalsNode.findPlug("finalRender_useGmon");
+		plug = globals.findPlug("finalRender_useGmon");
 		if (!plug.isNull())
 			productionUseGmon = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("finalRender_giniCoeffGmon");
+		plug = globals.findPlug("finalRender_giniCoeffGmon");
 		if (!plug.isNull())
 			productionGiniCoeffGmon = plug.asFloat();
 
-		plug = frGlobalsNode.findPlug("finalRender_ptDenoiser");
+		plug = globals.findPlug("finalRender_ptDenoiser");
 		if (!plug.isNull())
 			productionPtDenoiser = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("finalRender_FSR");
+		plug = globals.findPlug("finalRender_FSR");
 		if (!plug.isNull())
 			productionFSR = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("finalRender_materialCache");
+		plug = globals.findPlug("finalRender_materialCache");
 		if (!plug.isNull())
 			productionMaterialCache = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("finalRender_restirGI");
+		plug = globals.findPlug("finalRender_restirGI");
 		if (!plug.isNull())
 			productionRestirGI = plug.asBool();
 
-		plug = frGlobalsNode.findPlug("finalRender_reservoirSampling");
+		plug = globals.findPlug("finalRender_reservoirSampling");
 		if (!plug.isNull())
 			productionReservoirSampling = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("finalRender_restirSpatialResampleIterations");
+		plug = globals.findPlug("finalRender_restirSpatialResampleIterations");
 		if (!plug.isNull())
 			productionRestirSpatialResampleIterations = plug.asInt();
 
-		plug = frGlobalsNode.findPlug("finalRender_restirMaxReservoirsPerCell");
+		plug = globals.findPlug("finalRender_restirMaxReservoirsPerCell");
 		if (!plug.isNull())
 			productionRestirMaxReservoirsPerCell = plug.asInt();
 
-		aovs.readFromGlobals(frGlobalsNode);
+		readDenoiserParameters(globals);
 
-		readDenoiserParameters(frGlobalsNode);
+		readAirVolumeParameters(globals);
 
-		readAirVolumeParameters(frGlobalsNode);
+		// AOV attributes are read by AOVs, changed attributes which are not read above may be AOV attributes
+		if ((filter == nullptr) || globals.HasUnreadAttributes())
+			aovs.readFromGlobals(globals.node());
 	});
 }
 
+// Getters below are also called from swatch, material viewer and render threads, globals are read on main thread
 int FireRenderGlobalsData::getThumbnailIterCount(bool* pSwatchesEnabled)
 {
-	MObject fireRenderGlobals;
-	GetRadeonProRenderGlobals(fireRenderGlobals);
+	return FireMaya::FireRenderThread::RunOnMainThread<int>([pSwatchesEnabled]()
+	{
+		MObject fireRenderGlobals;
+		GetRadeonProRenderGlobals(fireRenderGlobals);
 
-	// Get Fire render globals attributes
-	MFnDependencyNode frGlobalsNode(fireRenderGlobals);
+		// Get Fire render globals attributes
+		GlobalsAttributeReader globals(fireRenderGlobals);
+
+		if (pSwatchesEnabled != nullptr)
+		{
+			MPlug plug = globals.findPlug("enableSwatches");
+			if (!plug.isNull())
+			{
+				*pSwatchesEnabled = plug.asBool();
+			}
+		}
 
-	if (pSwatchesEnabled != nullptr)
+		MPlug plug = globals.findPlug("thumbnailIterationCount");
+		if (!plug.isNull())
+		{
+			return plug.asInt();
+		}
+
+		return 0;
+	});
+}
+
+int FireRenderGlobalsData::getThumbnailBatchSize()
+{
+	return FireMaya::FireRenderThread::RunOnMainThread<int>([]()
 	{
-		MPlug plug = frGlobalsNode.findPlug("enableSwatches");
+		MObject fireRenderGlobals;
+		GetRadeonProRenderGlobals(fireRenderGlobals);
+
+		GlobalsAttributeReader globals(fireRenderGlobals);
+
+		MPlug plug = globals.findPlug("thumbnailBatchSize");
 		if (!plug.isNull())
 		{
-			*pSwatchesEnabled = plug.asBool();
+			return plug.asInt();
 		}
-	}
 
-	MPlug plug = frGlobalsNode.findPlug("thumbnailIterationCount");
-	if (!plug.isNull())
+		return 16;
+	});
+}
+
+bool FireRenderGlobalsData::isThumbnailCacheEnabled()
+{
+	return FireMaya::FireRenderThread::RunOnMainThread<bool>([]()
 	{
-		return plug.asInt();
-	}
-	
-	return 0;
+		MObject fireRenderGlobals;
+		GetRadeonProRenderGlobals(fireRenderGlobals);
+
+		GlobalsAttributeReader globals(fireRenderGlobals);
+
+		MPlug plug = globals.findPlug("thumbnailCache");
+		if (!plug.isNull())
+		{
+			return plug.asBool();
+		}
+
+		return true;
+	});
 }
 
 bool FireRenderGlobalsData::isExrMultichannelEnabled()
 {
-	MObject fireRenderGlobals;
-	GetRadeonProRenderGlobals(fireRenderGlobals);
+	return FireMaya::FireRenderThread::RunOnMainThread<bool>([]()
+	{
+		MObject fireRenderGlobals;
+		GetRadeonProRenderGlobals(fireRenderGlobals);
 
-	// Get Fire render globals attributes
-	MFnDependencyNode frGlobalsNode(fireRenderGlobals);
+		// Get Fire render globals attributes
+		GlobalsAttributeReader globals(fireRenderGlobals);
 
-	MPlug plug = frGlobalsNode.findPlug("enableExrMultilayer");
-	if (!plug.isNull())
-	{
-		return plug.asBool();
-	}
+		MPlug plug = globals.findPlug("enableExrMultilayer");
+		if (!plug.isNull())
+		{
+			return plug.asBool();
+		}
 
-	return false;
+		return false;
+	});
 }
 
-void FireRenderGlobalsData::readAirVolumeParameters(const MFnDependencyNode& frGlobalsNode)
+void FireRenderGlobalsData::readAirVolumeParameters(GlobalsAttributeReader& globals)
 {
-	MPlug plug = frGlobalsNode.findPlug("airVolumeEnabled");
+	MPlug plug = globals.findPlug("airVolumeEnabled");
 	if (!plug.isNull())
 		airVolumeSettings.airVolumeEnabled = plug.asBool();
 
-	plug = frGlobalsNode.findPlug("fogEnabled");
+	plug = globals.findPlug("fogEnabled");
 	if (!plug.isNull())
 		airVolumeSettings.fogEnabled = plug.asBool();
 
-	plug = frGlobalsNode.findPlug("fogColor", false);
+	plug = globals.findPlug("fogColor");
 	if (!plug.isNull())
 	{
 		MDataHandle colorDataHandle;
@@ -676,19 +813,19 @@ void FireRenderGlobalsData::readAirVolumeParameters(const MFnDependencyNode& frG
 	const MDistance::Unit sceneUnits = MDistance::uiUnit();
 	double coeff = (MDistance(1.0, sceneUnits)).asMeters();
 
-	plug = frGlobalsNode.findPlug("fogDistance");
+	plug = globals.findPlug("fogDistance");
 	if (!plug.isNull())
 		airVolumeSettings.fogDistance = (float) (plug.asFloat() * coeff);
 
-	plug = frGlobalsNode.findPlug("fogHeight");
+	plug = globals.findPlug("fogHeight");
 	if (!plug.isNull())
 		airVolumeSettings.fogHeight = (float) (plug.asFloat() * coeff);
 
-	plug = frGlobalsNode.findPlug("airVolumeDensity");
+	plug = globals.findPlug("airVolumeDensity");
 	if (!plug.isNull())
 		airVolumeSettings.airVolumeDensity = plug.asFloat();
 
-	plug = frGlobalsNode.findPlug("airVolumeColor", false);
+	plug = globals.findPlug("airVolumeColor");
 	if (!plug.isNull())
 	{
 		MDataHandle colorDataHandle;
@@ -698,62 +835,62 @@ void FireRenderGlobalsData::readAirVolumeParameters(const MFnDependencyNode& frG
 		airVolumeSettings.airVolumeColor = MColor(color0);
 	}
 
-	plug = frGlobalsNode.findPlug("airVolumeClamp");
+	plug = globals.findPlug("airVolumeClamp");
 	if (!plug.isNull())
 		airVolumeSettings.airVolumeClamp = plug.asFloat();
 }
 
-void FireRenderGlobalsData::readDenoiserParameters(const MFnDependencyNode& frGlobalsNode)
+void FireRenderGlobalsData::readDenoiserParameters(GlobalsAttributeReader& globals)
 {
-	MPlug plug = frGlobalsNode.findPlug("denoiserEnabled");
+	MPlug plug = globals.findPlug("denoiserEnabled");
 	if (!plug.isNull())
 		denoiserSettings.enabled = plug.asBool();
 
-	plug = frGlobalsNode.findPlug("denoiserType");
+	plug = globals.findPlug("denoiserType");
 	if (!plug.isNull())
 		denoiserSettings.type = (FireRenderGlobals::DenoiserType) plug.asInt();
 
-	plug = frGlobalsNode.findPlug("denoiserRadius");
+	plug = globals.findPlug("denoiserRadius");
 	if (!plug.isNull())
 		denoiserSettings.radius = plug.asInt();
 
-	plug = frGlobalsNode.findPlug("denoiserSamples");
+	plug = globals.findPlug("denoiserSamples");
 	if (!plug.isNull())
 		denoiserSettings.samples = plug.asInt();
 
-	plug = frGlobalsNode.findPlug("denoiserFilterRadius");
+	plug = globals.findPlug("denoiserFilterRadius");
 	if (!plug.isNull())
 		denoiserSettings.filterRadius = plug.asInt();
 
-	plug = frGlobalsNode.findPlug("denoiserBandwidth");
+	plug = globals.findPlug("denoiserBandwidth");
 	if (!plug.isNull())
 		denoiserSettings.bandwidth = plug.asFloat();
 
-	plug = frGlobalsNode.findPlug("denoiserColor");
+	plug = globals.findPlug("denoiserColor");
 	if (!plug.isNull())
 		denoiserSettings.color = plug.asFloat();
 
-	plug = frGlobalsNode.findPlug("denoiserDepth");
+	plug = globals.findPlug("denoiserDepth");
 	if (!plug.isNull())
 		denoiserSettings.depth = plug.asFloat();
 
-	plug = frGlobalsNode.findPlug("denoiserNormal");
+	plug = globals.findPlug("denoiserNormal");
 	if (!plug.isNull())
 		denoiserSettings.normal = plug.asFloat();
 
-	plug = frGlobalsNode.findPlug("denoiserTrans");
+	plug = globals.findPlug("denoiserTrans");
 	if (!plug.isNull())
 		denoiserSettings.trans = plug.asFloat();
 
-	plug = frGlobalsNode.findPlug("denoiserColorOnly");
+	plug = globals.findPlug("denoiserColorOnly");
 	if (!plug.isNull())
 		denoiserSettings.colorOnly = plug.asInt() == 0;
 
-	plug = frGlobalsNode.findPlug("enable16bitCompute");
+	plug = globals.findPlug("enable16bitCompute");
 	if (!plug.isNull())
 		denoiserSettings.enable16bitCompute = plug.asInt() == 1;
 
-	plug = frGlobalsNode.findPlug("viewportDenoiseUpscaleEnabled");
+	plug = globals.findPlug("viewportDenoiseUpscaleEnabled");
 	if (!plug.isNull())
 		denoiserSettings.viewportDenoiseUpscaleEnabled = plug.asInt() == 1;	
 }
@@ -834,6 +971,55 @@ bool FireRenderGlobalsData::IsAirVolume(MString name)
 	return propNames.find(name.asChar()) != propNames.end();
 }
 
+bool FireRenderGlobalsData::IsContour(MString name)
+{
+	name = GetPropertyNameFromPlugName(name);
+
+	return name.indexW("contour") == 0;
+}
+
+bool FireRenderGlobalsData::IsCryptomatte(MString name)
+{
+	name = GetPropertyNameFromPlugName(name);
+
+	return name.indexW("cryptomatte") == 0;
+}
+
+bool FireRenderGlobalsData::IsCompletionCriteria(MString name)
+{
+	name = GetPropertyNameFromPlugName(name);
+
+	return name.indexW("completionCriteria") == 0;
+}
+
+bool FireRenderGlobalsData::IsHybridParam(MString name)
+{
+	name = GetPropertyNameFromPlugName(name);
+
+	static const std::set<std::string> propNames{
+		"useGmon", "giniCoeffGmon", "ptDenoiser", "FSR", "materialCache", "restirGI", "restirGIBiasCorrection",
+		"reservoirSampling", "restirSpatialResampleIterations", "restirMaxReservoirsPerCell",
+		"finalRender_useGmon", "finalRender_giniCoeffGmon", "finalRender_ptDenoiser", "finalRender_FSR", "finalRender_materialCache",
+		"finalRender_restirGI", "finalRender_reservoirSampling", "finalRender_restirSpatialResampleIterations", "finalRender_restirMaxReservoirsPerCell"
+	};
+
+	return propNames.find(name.asChar()) != propNames.end();
+}
+
+std::string FireRenderGlobalsData::GetAttributeName(const MPlug& plug)
+{
+	MPlug attributePlug = plug;
+
+	while (attributePlug.isChild())
+		attributePlug = attributePlug.parent();
+
+	if (attributePlug.isElement())
+		attributePlug = attributePlug.array();
+
+	// long attribute name without node name and indices
+	return attributePlug.partialName(false, false, false, false, false, true).asChar();
+}
+
 void FireRenderGlobalsData::getCPUThreadSetup(bool& overriden, int& cpuThreadCount, RenderType renderType)
 {
 	// Apply defaults in case if global node isn't created yet
@@ -1348,6 +1534,17 @@ MString getShaderCachePath()
 #endif
 }
 
+MString getSwatchCachePath()
+{
+	MString path = MGlobal::executeCommandStringResult("getenv RPR_MAYA_SWATCH_CACHE_PATH");
+	if (path.length() == 0)
+	{
+		path = MGlobal::executeCommandStringResult("internalVar -userAppDir") + "RadeonProRender/SwatchCache";
+	}
+
+	return path;
+}
+
 std::string replaceStrChar(std::string str, const std::string& replace, char ch) {
 
 	// set our locator equal to the first appearance of any character in replace
@@ -1536,9 +1733,7 @@ MObjectArray GetShadingEngines(MFnDagNode& mesh, uint instanceNum)
 
 int GetFaceMaterials(MFnMesh& mesh, MIntArray& faceList)
 {
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-#endif
+	RPR_TRACE_ZONE("GetFaceMaterials");
 
 	MPlug iog = mesh.findPlug("instObjGroups");
 	MPlug ogrp = iog.elementByPhysicalIndex(0);
@@ -1589,12 +1784,6 @@ int GetFaceMaterials(MFnMesh& mesh, MIntArray& faceList)
 		}
 	}
 
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point fin = std::chrono::steady_clock::now();
-	std::chrono::microseconds elapsed = std::chrono::duration_cast<std::chrono::microseconds>(fin - start);
-	FireRenderContext::inGetFaceMaterials += elapsed.count();
-#endif
-
 	//if no shaders encountered then consider it 1
 	return shadingEngines ? shadingEngines : 1;
 }
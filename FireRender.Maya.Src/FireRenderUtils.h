@@ -36,6 +36,8 @@ limitations under the License.
 #include <iterator>
 #include <array>
 #include <functional>
+#include <set>
+#include <string>
 #include <float.h>
 
 #ifndef PI
@@ -44,6 +46,29 @@ limitations under the License.
 
 typedef std::chrono::time_point<std::chrono::steady_clock> TimePoint;
 
+// Reads plugs of RadeonProRenderGlobals node.
+// Attribute objects are looked up by name once per globals node and cached, plugs are created from them.
+// If filter is given, only plugs of attributes in the filter are returned, others are null.
+// The cache is not synchronized, so the reader is used on main thread only
+class GlobalsAttributeReader
+{
+public:
+	GlobalsAttributeReader(const MObject& globalsNode, const std::set<std::string>* filter = nullptr);
+
+	MPlug findPlug(const char* name);
+
+	const MFnDependencyNode& node(void) const { return m_node; }
+
+	// true if some attributes of the filter have not been requested yet
+	bool HasUnreadAttributes(void) const;
+
+private:
+	MObject m_globalsNode;
+	MFnDependencyNode m_node;
+	const std::set<std::string>* m_filter;
+	size_t m_readCount;
+};
+
 // FireRenderGlobals
 // Utility class used to read attributes form the render global node
 // and configure the rpr_context
@@ -186,6 +211,9 @@ public:
 	//Read data from the FireRenderGLobals/FireRenderViewportGlobals node in the scene
 	void readFromCurrentScene();
 
+	// Read only given attributes (long names) of the FireRenderGLobals node
+	void readFromCurrentScene(const std::set<std::string>& changedAttributes);
+
 	// Update the tonemapping in rpr_context
 	//void updateTonemapping(class FireRenderContext& frcontext, bool disableWhiteBalance = false);
 
@@ -202,8 +230,21 @@ public:
 
 	static bool IsAirVolume(MString name);
 
+	static bool IsContour(MString name);
+
+	static bool IsCryptomatte(MString name);
+
+	static bool IsCompletionCriteria(MString name);
+
+	static bool IsHybridParam(MString name);
+
+	// Long name of globals attribute which plug belongs to (parent attribute for compound children and array elements)
+	static std::string GetAttributeName(const MPlug& plug);
+
 	static void getCPUThreadSetup(bool& overriden, int& cpuThreadCount, RenderType renderType);
 	static int getThumbnailIterCount(bool* pSwatchesEnabled = nullptr);
+	static int getThumbnailBatchSize(void);
+	static bool isThumbnailCacheEnabled(void);
 	static bool isExrMultichannelEnabled(void);
 
 public:
@@ -251,6 +292,9 @@ public:
 	int viewportMaxDiffuseRayDepth;
 	int viewportMaxReflectionRayDepth;
 
+	// fraction of hair strands translated for viewport render
+	float viewportHairDensity;
+
 	// hybrid viewport settings
 	bool viewportUseGmon;
 	float viewportGiniCoeffGmon;
@@ -361,6 +405,7 @@ public:
 	bool tileRenderingEnabled;
 	int tileSizeX;
 	int tileSizeY;
+	short tileFillType;
 
 	// AOVs.
 	FireRenderAOVs aovs;
@@ -398,8 +443,9 @@ private:
 	short getMaxRayDepth(const FireRenderContext& context) const;
 	short getSamples(const FireRenderContext& context) const;
 
-	void readDenoiserParameters(const MFnDependencyNode& frGlobalsNode);
-	void readAirVolumeParameters(const MFnDependencyNode& frGlobalsNode);
+	void readAttributes(const std::set<std::string>* filter);
+	void readDenoiserParameters(GlobalsAttributeReader& globals);
+	void readAirVolumeParameters(GlobalsAttributeReader& globals);
 };
 
 namespace FireMaya
@@ -449,6 +495,9 @@ MDagPath getSkyObject(MStatus& status);
 // Get shader cache path
 MString getShaderCachePath();
 
+// Get folder of rendered material swatches kept between sessions
+MString getSwatchCachePath();
+
 //Get if shaders have been cached (Shader System)
 int areShadersCached();
 
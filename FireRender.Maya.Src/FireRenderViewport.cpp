@@ -27,12 +27,19 @@ limitations under the License.
 #include <maya/MRenderView.h>
 #include <maya/MAnimControl.h>
 #include <maya/MTextureManager.h>
+#include <maya/MDGContext.h>
+
+#if MAYA_API_VERSION >= 20180000
+#include <maya/MDGContextGuard.h>
+#endif
 #include "AutoLock.h"
 
 #include "Context/ContextCreator.h"
 #include "Context/FireRenderContext.h"
 #include "FireRenderViewport.h"
 #include "FireRenderThread.h"
+#include "ParallelUtils.h"
+#include "Tracing.h"
 
 using namespace std;
 using namespace std::chrono_literals;
@@ -57,6 +64,7 @@ MStatus FireRenderViewport::FindMayaView(const MString& panelName, M3dView *view
 // -----------------------------------------------------------------------------
 FireRenderViewport::FireRenderViewport(const MString& panelName) :
 	m_isRunning(false),
+	m_stopRequested(false),
 	m_useAnimationCache(true),
 	m_pixelsUpdated(false),
 	m_panelName(panelName),
@@ -66,7 +74,10 @@ FireRenderViewport::FireRenderViewport(const MString& panelName) :
 	m_showUpscaledFrame(false),
 	m_createFailed(false),
 	m_currentAOV(RPR_AOV_COLOR),
-	m_pCurrentTexture(nullptr)
+	m_pCurrentTexture(nullptr),
+	m_diskFramesCache(std::make_shared<FireMaya::FrameDiskCache>()),
+	m_lifetimeToken(std::make_shared<int>(0)),
+	m_renderMode(FireRenderContext::kGlobalIllumination)
 {
 	m_alwaysEnabledAOVs.push_back(RPR_AOV_COLOR);
 	m_alwaysEnabledAOVs.push_back(RPR_AOV_VARIANCE);
@@ -259,15 +270,18 @@ void FireRenderViewport::ScheduleViewportUpdate()
 void FireRenderViewport::OnBufferAvailableCallback(float progress)
 {
 	// Get the frame hash.
-	auto hash = m_contextPtr->GetStateHash();
+	auto hash = getFrameCacheKey(m_contextPtr->width(), m_contextPtr->height());
 	stringstream ss;
-	ss << m_panelName.asChar() << ";" << size_t(hash);
+	ss << m_panelName.asChar() << ";" << hash;
+	std::string cacheKey = ss.str();
 
 	// Try find the frame for the hash.
 	// if not found => creates new frame in cache
-	auto& frame = m_renderedFramesCache[ss.str().c_str()];
+	auto& frame = m_renderedFramesCache[cacheKey.c_str()];
+	frame.Resize(m_contextPtr->width(), m_contextPtr->height());
 
 	readFrameBuffer(&frame);
+	m_renderedFramesCache.Store(cacheKey.c_str());
 
 	ScheduleViewportUpdate();
 }
@@ -277,6 +291,9 @@ bool FireRenderViewport::RunOnViewportThread()
 {
 	RPR_THREAD_ONLY;
 
+	if (m_stopRequested)
+		return false;
+
 	switch (m_contextPtr->GetState())
 	{
 		// The context is exiting.
@@ -293,8 +310,10 @@ bool FireRenderViewport::RunOnViewportThread()
 		{
 			try
 			{
+				// Upscaled result of the previous frame is stale now
 				m_showUpscaledFrame = false;
 				m_pCurrentTexture = &m_texture;
+				m_contextPtr->CancelDenoiseJob();
 
 				FireRenderContext::Lock lock(m_contextPtr.get(), "FireRenderContext::StateRendering"); // lock with constructor which will not change state
 
@@ -336,26 +355,34 @@ bool FireRenderViewport::RunOnViewportThread()
 		}
 		else
 		{
-			if (IsDenoiserUpscalerEnabled() && !m_showUpscaledFrame)
+			if (IsDenoiserUpscalerEnabled())
 			{
+				// Denoiser runs in background, a stale job has to finish before the next one is started
+				if (!m_showUpscaledFrame && !m_contextPtr->IsDenoiseJobRunning())
 				{
 					AutoMutexLock contextLock(m_contextLock);
-					AutoMutexLock pixelsLock(m_pixelsLock);
 
 					m_showUpscaledFrame = true;
+					m_contextPtr->StartDenoiseJob(true);
+				}
 
-					readFrameBuffer(nullptr, true);
+				if (m_showUpscaledFrame && m_contextPtr->TakeDenoisedFrame(m_upscaledPixels))
+				{
+					{
+						AutoMutexLock pixelsLock(m_pixelsLock);
 
-					m_pCurrentTexture = &m_textureUpscaled;
-				}
+						m_textureUpscaled.SwapPixelData(m_upscaledPixels);
+						m_textureChanged = true;
+						m_pixelsUpdated = true;
+						m_pCurrentTexture = &m_textureUpscaled;
+					}
 
-				ScheduleViewportUpdate();
-			}
-			else
-			{
-				// Don't waste CPU time too much when not rendering
-				this_thread::sleep_for(2ms);
+					ScheduleViewportUpdate();
+				}
 			}
+
+			// Nothing to render, the thread sleeps until scene, camera or state change or denoiser finishes
+			FireRenderThread::ReportIdle();
 		}
 
 		return true;
@@ -364,7 +391,7 @@ bool FireRenderViewport::RunOnViewportThread()
 	case FireRenderContext::StatePaused:	// The context is paused.
 	case FireRenderContext::StateUpdating:	// The context is updating.
 	default:								// Handle all other cases.
-		this_thread::sleep_for(5ms);
+		FireRenderThread::ReportIdle();
 		return true;
 	}
 }
@@ -389,6 +416,7 @@ bool FireRenderViewport::start()
 	}
 
 	m_isRunning = true;
+	m_stopRequested = false;
 	m_renderingErrors = 0;
 
 	FireRenderThread::KeepRunning([this]()
@@ -418,17 +446,15 @@ bool FireRenderViewport::stop()
 	
 	m_NorthStarRenderingHelper.SetStopFlag();
 
-	// should wait for thread
+	// terminate the thread, the item returns false on its next pass and main thread is notified when it's removed
+	m_stopRequested = true;
+	m_contextPtr->SetState(FireRenderContext::StateExiting);
+
 	// m_isRunning could be not updated when exiting Maya during rendering, so check for two conditions
-	while (m_isRunning && FireRenderThread::IsThreadRunning())
+	FireRenderThread::WaitOnMainThreadUntil([this]()
 	{
-		//Run items queued for main thread
-		FireRenderThread::RunItemsQueuedForTheMainThread();
-
-		// terminate the thread
-		m_contextPtr->SetState(FireRenderContext::StateExiting);
-		this_thread::sleep_for(10ms); // 10.03.2017 - perhaps this is better than yield()
-	}
+		return !m_isRunning || !FireRenderThread::IsThreadRunning();
+	});
 
 	m_NorthStarRenderingHelper.StopAndJoin();
 
@@ -451,6 +477,7 @@ void FireRenderViewport::setViewportRenderMode(int renderMode)
 	FireRenderThread::RunOnceProcAndWait([this, renderMode]()
 	{
 		AutoMutexLock contextLock(m_contextLock);
+		m_renderMode = renderMode;
 		m_contextPtr->setRenderMode(static_cast<FireRenderContext::RenderMode>(renderMode));
 		m_contextPtr->setDirty();
 		m_view.scheduleRefresh();
@@ -470,6 +497,140 @@ void FireRenderViewport::clearTextureCache()
 	m_view.scheduleRefresh();
 }
 
+// -----------------------------------------------------------------------------
+void FireRenderViewport::setAnimationCacheBudget(size_t bytes)
+{
+	m_renderedFramesCache.SetByteBudget(bytes);
+}
+
+// -----------------------------------------------------------------------------
+void FireRenderViewport::setAnimationCacheHalfFloat(bool value)
+{
+	m_renderedFramesCache.SetStorageMode(value ? FireMaya::TextureCache::StorageHalf : FireMaya::TextureCache::StorageFloat);
+}
+
+// -----------------------------------------------------------------------------
+FireMaya::TextureCache::Statistics FireRenderViewport::getAnimationCacheStatistics() const
+{
+	return m_renderedFramesCache.GetStatistics();
+}
+
+// -----------------------------------------------------------------------------
+void FireRenderViewport::setAnimationDiskCache(const MString& path)
+{
+	// every viewport has its own folder, so viewports (and Maya sessions) don't evict each other's frames
+	std::string directory = path.asUTF8();
+	if (!directory.empty())
+		directory += std::string("/") + m_panelName.asUTF8();
+
+	m_diskFramesCache->SetDirectory(directory);
+}
+
+// -----------------------------------------------------------------------------
+void FireRenderViewport::setAnimationDiskCacheBudget(size_t bytes)
+{
+	m_diskFramesCache->SetByteBudget(bytes);
+}
+
+// -----------------------------------------------------------------------------
+void FireRenderViewport::clearAnimationDiskCache()
+{
+	m_diskFramesCache->Clear();
+}
+
+// -----------------------------------------------------------------------------
+FireMaya::FrameDiskCache::Statistics FireRenderViewport::getAnimationDiskCacheStatistics() const
+{
+	return m_diskFramesCache->GetStatistics();
+}
+
+// -----------------------------------------------------------------------------
+void FireRenderViewport::prewarmAnimationCache(double startFrame, double endFrame, double step)
+{
+	MAIN_THREAD_ONLY;
+
+	if (step <= 0.0 || endFrame < startFrame)
+		return;
+
+	bool alreadyRunning = !m_prewarmFrames.empty();
+
+	if (!alreadyRunning)
+		m_prewarmRestoreTime = MAnimControl::currentTime();
+
+	for (double frame = startFrame; frame <= endFrame; frame += step)
+		m_prewarmFrames.push_back(MTime(frame, MTime::uiUnit()));
+
+	if (alreadyRunning)
+		return;
+
+	// Render frames from the main thread queue so Maya stays responsive between frames
+	std::weak_ptr<int> lifetime = m_lifetimeToken;
+
+	FireRenderThread::KeepRunningOnMainThread([this, lifetime]() -> bool
+	{
+		if (lifetime.expired())
+			return false;
+
+		return prewarmNextFrame();
+	});
+}
+
+// -----------------------------------------------------------------------------
+bool FireRenderViewport::prewarmNextFrame()
+{
+	MAIN_THREAD_ONLY;
+
+	if (m_prewarmFrames.empty())
+	{
+#if MAYA_API_VERSION >= 20180000
+		// objects were read at prewarmed times, read them again at the current time
+		m_contextPtr->setDirtyAllObjects();
+#else
+		MAnimControl::setCurrentTime(m_prewarmRestoreTime);
+#endif
+		m_view.scheduleRefresh();
+		return false;
+	}
+
+	MTime time = m_prewarmFrames.front();
+	m_prewarmFrames.pop_front();
+
+	try
+	{
+		// Cached frames are rendered with animation limits, same as during playback.
+		if (m_isRunning)
+			stop();
+
+		m_contextPtr->updateLimits(true);
+
+#if MAYA_API_VERSION >= 20180000
+		// Scene is evaluated at the frame time through DG context, so the time slider doesn't move.
+		// Maya doesn't dirty nodes for other contexts, objects are read again explicitly
+		MDGContext dgContext(time);
+		MDGContextGuard contextGuard(dgContext);
+
+		m_contextPtr->setDirtyAllObjects();
+#else
+		MAnimControl::setCurrentTime(time);
+#endif
+
+		if (refreshContext() != MStatus::kSuccess)
+		{
+			m_prewarmFrames.clear();
+			return true; // restore time on the next call
+		}
+
+		getCachedFrame(m_contextPtr->width(), m_contextPtr->height());
+	}
+	catch (...)
+	{
+		m_error.set(current_exception());
+		m_prewarmFrames.clear();
+	}
+
+	return true;
+}
+
 // -----------------------------------------------------------------------------
 MStatus FireRenderViewport::cameraChanged(MDagPath& cameraPath)
 {
@@ -702,30 +863,10 @@ MStatus FireRenderViewport::renderCached(unsigned int width, unsigned int height
 
 	try
 	{
-		// Get the frame hash.
-		auto hash = m_contextPtr->GetStateHash();
-		stringstream ss;
-		ss << m_panelName.asChar() << ";" << size_t(hash);
-
-		// Try find the frame for the hash.
-		// if not found => creates new frame in cache
-		auto& frame = m_renderedFramesCache[ss.str().c_str()];
-
-		// Render the frame if required.
-		bool shouldRender = frame.Resize(width, height); // returns false if frame is not empty
-		if (shouldRender)
-		{
-			AutoMutexLock contextLock(m_contextLock);
+		auto& frame = getCachedFrame(width, height);
 
-			m_contextPtr->render();
-			readFrameBuffer(&frame);
-
-			return m_texture.UpdateTexture(frame.data());
-		}
-		else // Otherwise, update the texture from the frame data.
-		{
-			return m_texture.UpdateTexture(frame.data());
-		}
+		// Update the texture from the frame data.
+		return m_texture.UpdateTexture(frame.Pixels(m_cachedFramePixels));
 	}
 	catch (...)
 	{
@@ -734,6 +875,69 @@ MStatus FireRenderViewport::renderCached(unsigned int width, unsigned int height
 	}
 }
 
+// -----------------------------------------------------------------------------
+uint64_t FireRenderViewport::getFrameCacheKey(unsigned int width, unsigned int height)
+{
+	// key is also used for frames stored on disk by previous sessions, which could be rendered by another plugin version
+	HashValue hash = m_contextPtr->GetStateHash();
+	hash.Append(PLUGIN_VERSION, int(sizeof(PLUGIN_VERSION) - 1));
+	hash << width;
+	hash << height;
+	hash << m_currentAOV;
+	hash << m_renderMode;
+
+	return size_t(hash);
+}
+
+// -----------------------------------------------------------------------------
+FireMaya::StoredFrame& FireRenderViewport::getCachedFrame(unsigned int width, unsigned int height)
+{
+	// Get the frame hash.
+	uint64_t key = getFrameCacheKey(width, height);
+	stringstream ss;
+	ss << m_panelName.asChar() << ";" << key;
+	std::string cacheKey = ss.str();
+
+	// Try find the frame for the hash.
+	// if not found => creates new frame in cache
+	auto& frame = m_renderedFramesCache[cacheKey.c_str()];
+
+	// Render the frame if required.
+	bool shouldRender = frame.Resize(width, height); // returns false if frame is not empty
+	if (!shouldRender)
+		return frame;
+
+	// Frame could be rendered in one of the previous sessions
+	if (m_diskFramesCache->Load(key, width, height, frame))
+	{
+		m_renderedFramesCache.Store(cacheKey.c_str());
+		return frame;
+	}
+
+	{
+		AutoMutexLock contextLock(m_contextLock);
+
+		m_contextPtr->render();
+		readFrameBuffer(&frame);
+	}
+
+	m_renderedFramesCache.Store(cacheKey.c_str());
+
+	if (m_diskFramesCache->IsEnabled())
+	{
+		// write file in background, frame copy is owned by the task
+		auto diskCache = m_diskFramesCache;
+		auto frameCopy = std::make_shared<FireMaya::StoredFrame>(frame);
+
+		FireMaya::WorkerPool::Instance().Submit([diskCache, frameCopy, key, width, height]()
+		{
+			diskCache->Save(key, int(width), int(height), *frameCopy);
+		});
+	}
+
+	return frame;
+}
+
 // -----------------------------------------------------------------------------
 MStatus FireRenderViewport::refreshContext()
 {
@@ -756,8 +960,10 @@ MStatus FireRenderViewport::refreshContext()
 }
 
 // -----------------------------------------------------------------------------
-void FireRenderViewport::readFrameBuffer(FireMaya::StoredFrame* storedFrame, bool runDenoiserAndUpscaler/* = false*/)
+void FireRenderViewport::readFrameBuffer(FireMaya::StoredFrame* storedFrame)
 {
+	RPR_TRACE_ZONE("FireRenderViewport::readFrameBuffer");
+
 	// Read the frame buffer.
 	RenderRegion region(0, m_contextPtr->width() - 1, m_contextPtr->height() - 1, 0);
 
@@ -790,12 +996,6 @@ void FireRenderViewport::readFrameBuffer(FireMaya::StoredFrame* storedFrame, boo
 		// process frame buffer
 		m_contextPtr->readFrameBufferSimple(params);
 
-		if (runDenoiserAndUpscaler)
-		{
-			m_textureUpscaled.SetPixelData(m_contextPtr->DenoiseAndUpscaleForViewport());
-			m_textureChanged = true;
-		}
-
 		// Flag as updated so the pixels will
 		// be copied to the viewport texture.
 		m_pixelsUpdated = true;
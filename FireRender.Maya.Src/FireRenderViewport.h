@@ -13,6 +13,9 @@ limitations under the License.
 #pragma once
 
 #include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
 #include "frWrap.h"
 
 #include <maya/MCallbackIdArray.h>
@@ -22,9 +25,11 @@ limitations under the License.
 #include <maya/MFrameContext.h>
 #include <maya/M3dView.h>
 #include <maya/MUiMessage.h>
+#include <maya/MTime.h>
 #include <maya/MShaderManager.h>
 #include "Context/FireRenderContext.h"
 #include "FireRenderTextureCache.h"
+#include "FrameDiskCache.h"
 #include <maya/MThreadAsync.h>
 #include <maya/MTextureManager.h>
 
@@ -79,6 +84,30 @@ public:
 	/** Clear the animation frame texture cache. */
 	void clearTextureCache();
 
+	/** Set the memory budget of the animation frame cache in bytes. */
+	void setAnimationCacheBudget(size_t bytes);
+
+	/** Set to true to store cached animation frames as half floats. */
+	void setAnimationCacheHalfFloat(bool value);
+
+	/** Return animation frame cache usage and hit / miss counters. */
+	FireMaya::TextureCache::Statistics getAnimationCacheStatistics() const;
+
+	/** Set the folder of the persistent animation frame cache. Empty path disables it. */
+	void setAnimationDiskCache(const MString& path);
+
+	/** Set the size limit of the persistent animation frame cache in bytes. */
+	void setAnimationDiskCacheBudget(size_t bytes);
+
+	/** Remove all frames from the persistent animation frame cache. */
+	void clearAnimationDiskCache();
+
+	/** Return persistent animation frame cache usage and hit / miss counters. */
+	FireMaya::FrameDiskCache::Statistics getAnimationDiskCacheStatistics() const;
+
+	/** Render frames of the given range into the animation cache, one frame per main thread tick. */
+	void prewarmAnimationCache(double startFrame, double endFrame, double step);
+
 	/** Return the hardware texture. */
 	ViewportTexture* getTexture() const;
 
@@ -125,6 +154,9 @@ private:
 	//
 	ViewportTexture m_textureUpscaled;
 
+	/** Upscaled frame taken from the context, swapped into m_textureUpscaled. */
+	std::vector<float> m_upscaledPixels;
+
 	/** True if the texture has changed since the last call to getTexture. */
 	bool m_textureChanged;
 
@@ -134,12 +166,33 @@ private:
 	/** True if the render thread is running. */
 	volatile bool m_isRunning;
 
+	/** Set by stop, context state can't be used for that because Lock restores the previous state. */
+	std::atomic<bool> m_stopRequested;
+
 	/** True if rendered animation frames should be cached. */
 	bool m_useAnimationCache;
 
 	/** Cached frame buffer textures to use for animation playback. */
 	FireMaya::TextureCache m_renderedFramesCache;
 
+	/** Expanded pixels of a half float cached frame. */
+	std::vector<float> m_cachedFramePixels;
+
+	/** Persistent tier of the animation frame cache, shared with pending disk writes. */
+	std::shared_ptr<FireMaya::FrameDiskCache> m_diskFramesCache;
+
+	/** Frames remaining to be rendered by prewarmAnimationCache. */
+	std::deque<MTime> m_prewarmFrames;
+
+	/** Current time before prewarming started, restored after prewarming when the time had to be changed. */
+	MTime m_prewarmRestoreTime;
+
+	/** Expires when the viewport is destroyed, checked by queued main thread callbacks. */
+	std::shared_ptr<int> m_lifetimeToken;
+
+	/** Current viewport render mode. */
+	int m_renderMode;
+
 	/** True if pixels have been updated. */
 	bool m_pixelsUpdated;
 
@@ -198,11 +251,20 @@ private:
 	/** Render a cached frame. */
 	MStatus renderCached(unsigned int width, unsigned int height);
 
+	/** Key of the current scene state in the animation frame caches. */
+	uint64_t getFrameCacheKey(unsigned int width, unsigned int height);
+
+	/** Find the frame for the current scene state in the caches, renders it if not found. */
+	FireMaya::StoredFrame& getCachedFrame(unsigned int width, unsigned int height);
+
+	/** Render the next frame queued by prewarmAnimationCache. Returns false when done. */
+	bool prewarmNextFrame();
+
 	/** Refresh the RPR context. */
 	MStatus refreshContext();
 
 	/** Read data from the RPR frame buffer into the texture. */
-	void readFrameBuffer(FireMaya::StoredFrame* storedFrame = nullptr, bool runUpscaler = false);
+	void readFrameBuffer(FireMaya::StoredFrame* storedFrame = nullptr);
 
 	/** Start the render thread. */
 	bool start();
@@ -13,6 +13,7 @@ limitations under the License.
 #include "FireRenderViewportCmd.h"
 #include "FireRenderViewport.h"
 #include "FireRenderViewportManager.h"
+#include "FireRenderUtils.h"
 
 #include <vector>
 #include <functional>
@@ -43,6 +44,14 @@ MSyntax FireRenderViewportCmd::newSyntax()
 	CHECK_MSTATUS(syntax.addFlag(kViewportModeFlag, kViewportModeFlagLong, MSyntax::kString));
 	CHECK_MSTATUS(syntax.addFlag(kRefreshFlag, kRefreshFlagLong, MSyntax::kNoArg));
 	CHECK_MSTATUS(syntax.addFlag(kViewportAOVFlag, kViewportAOVFlagLong, MSyntax::kLong));
+	CHECK_MSTATUS(syntax.addFlag(kCacheBudgetFlag, kCacheBudgetFlagLong, MSyntax::kLong));
+	CHECK_MSTATUS(syntax.addFlag(kCacheHalfFloatFlag, kCacheHalfFloatFlagLong, MSyntax::kBoolean));
+	CHECK_MSTATUS(syntax.addFlag(kCacheStatsFlag, kCacheStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kDiskCacheFlag, kDiskCacheFlagLong, MSyntax::kString));
+	CHECK_MSTATUS(syntax.addFlag(kDiskCacheBudgetFlag, kDiskCacheBudgetFlagLong, MSyntax::kLong));
+	CHECK_MSTATUS(syntax.addFlag(kDiskCacheStatsFlag, kDiskCacheStatsFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kClearDiskCacheFlag, kClearDiskCacheFlagLong, MSyntax::kNoArg));
+	CHECK_MSTATUS(syntax.addFlag(kPrewarmFlag, kPrewarmFlagLong, MSyntax::kDouble, MSyntax::kDouble, MSyntax::kDouble));
 
 	return syntax;
 }
@@ -133,6 +142,113 @@ MStatus FireRenderViewportCmd::doIt(const MArgList & args)
 			});
 		}
 
+		if (argData.isFlagSet(kCacheBudgetFlag))
+		{
+			// budget is specified in megabytes
+			int budgetMB = 0;
+			argData.getFlagArgument(kCacheBudgetFlag, 0, budgetMB);
+
+			size_t budget = size_t(budgetMB > 0 ? budgetMB : 0) * 1024 * 1024;
+
+			viewportActions.push_back([=](FireRenderViewport* viewport)
+			{
+				viewport->setAnimationCacheBudget(budget);
+			});
+		}
+
+		if (argData.isFlagSet(kCacheHalfFloatFlag))
+		{
+			bool halfFloat = false;
+			argData.getFlagArgument(kCacheHalfFloatFlag, 0, halfFloat);
+
+			viewportActions.push_back([=](FireRenderViewport* viewport)
+			{
+				viewport->setAnimationCacheHalfFloat(halfFloat);
+			});
+		}
+
+		if (argData.isFlagSet(kCacheStatsFlag))
+		{
+			viewportActions.push_back([this](FireRenderViewport* viewport)
+			{
+				FireMaya::TextureCache::Statistics stats = viewport->getAnimationCacheStatistics();
+
+				clearResult();
+				appendToResult(MString(string_format("entries=%zu", stats.entryCount).c_str()));
+				appendToResult(MString(string_format("sizeMB=%.1f", stats.byteSize / (1024.0 * 1024.0)).c_str()));
+				appendToResult(MString(string_format("budgetMB=%.1f", stats.byteBudget / (1024.0 * 1024.0)).c_str()));
+				appendToResult(MString(string_format("hits=%llu", stats.hits).c_str()));
+				appendToResult(MString(string_format("misses=%llu", stats.misses).c_str()));
+				appendToResult(MString(string_format("evictions=%llu", stats.evictions).c_str()));
+			});
+		}
+
+		if (argData.isFlagSet(kDiskCacheFlag))
+		{
+			MString diskCachePath;
+			argData.getFlagArgument(kDiskCacheFlag, 0, diskCachePath);
+
+			viewportActions.push_back([=](FireRenderViewport* viewport)
+			{
+				viewport->setAnimationDiskCache(diskCachePath);
+			});
+		}
+
+		if (argData.isFlagSet(kDiskCacheBudgetFlag))
+		{
+			// budget is specified in megabytes
+			int budgetMB = 0;
+			argData.getFlagArgument(kDiskCacheBudgetFlag, 0, budgetMB);
+
+			size_t budget = size_t(budgetMB > 0 ? budgetMB : 0) * 1024 * 1024;
+
+			viewportActions.push_back([=](FireRenderViewport* viewport)
+			{
+				viewport->setAnimationDiskCacheBudget(budget);
+			});
+		}
+
+		if (argData.isFlagSet(kClearDiskCacheFlag))
+		{
+			viewportActions.push_back([](FireRenderViewport* viewport)
+			{
+				viewport->clearAnimationDiskCache();
+			});
+		}
+
+		if (argData.isFlagSet(kDiskCacheStatsFlag))
+		{
+			viewportActions.push_back([this](FireRenderViewport* viewport)
+			{
+				FireMaya::FrameDiskCache::Statistics stats = viewport->getAnimationDiskCacheStatistics();
+
+				clearResult();
+				appendToResult(MString(string_format("files=%zu", stats.fileCount).c_str()));
+				appendToResult(MString(string_format("sizeMB=%.1f", stats.byteSize / (1024.0 * 1024.0)).c_str()));
+				appendToResult(MString(string_format("budgetMB=%.1f", stats.byteBudget / (1024.0 * 1024.0)).c_str()));
+				appendToResult(MString(string_format("hits=%llu", stats.hits).c_str()));
+				appendToResult(MString(string_format("misses=%llu", stats.misses).c_str()));
+				appendToResult(MString(string_format("writes=%llu", stats.writes).c_str()));
+				appendToResult(MString(string_format("evictions=%llu", stats.evictions).c_str()));
+			});
+		}
+
+		if (argData.isFlagSet(kPrewarmFlag))
+		{
+			// start frame, end frame, step
+			double startFrame = 0.0;
+			double endFrame = 0.0;
+			double step = 1.0;
+			argData.getFlagArgument(kPrewarmFlag, 0, startFrame);
+			argData.getFlagArgument(kPrewarmFlag, 1, endFrame);
+			argData.getFlagArgument(kPrewarmFlag, 2, step);
+
+			viewportActions.push_back([=](FireRenderViewport* viewport)
+			{
+				viewport->prewarmAnimationCache(startFrame, endFrame, step);
+			});
+		}
+
 		if (argData.isFlagSet(kRefreshFlag) && panelName != "")
 		{
 			viewportActions.push_back([=](FireRenderViewport* viewport)
@@ -34,6 +34,30 @@ limitations under the License.
 #define kRefreshFlag "-rf"
 #define kRefreshFlagLong "-refresh"
 
+#define kCacheBudgetFlag "-cb"
+#define kCacheBudgetFlagLong "-cacheBudget"
+
+#define kCacheHalfFloatFlag "-chf"
+#define kCacheHalfFloatFlagLong "-cacheHalfFloat"
+
+#define kCacheStatsFlag "-cs"
+#define kCacheStatsFlagLong "-cacheStats"
+
+#define kDiskCacheFlag "-dc"
+#define kDiskCacheFlagLong "-diskCache"
+
+#define kDiskCacheBudgetFlag "-dcb"
+#define kDiskCacheBudgetFlagLong "-diskCacheBudget"
+
+#define kDiskCacheStatsFlag "-dcs"
+#define kDiskCacheStatsFlagLong "-diskCacheStats"
+
+#define kClearDiskCacheFlag "-cdc"
+#define kClearDiskCacheFlagLong "-clearDiskCache"
+
+#define kPrewarmFlag "-pw"
+#define kPrewarmFlagLong "-prewarm"
+
 class FireRenderViewportCmd : public MPxCommand
 {
 public:
@@ -155,7 +155,7 @@ void FireRenderCommonVolume::attachToScene()
 	// attach material to shape
 	m_boundingBoxMesh.SetShader(fakeShader);
 
-	m_isVisible = true;
+	SetIsVisible(true);
 }
 
 void FireRenderCommonVolume::detachFromScene()
@@ -167,7 +167,7 @@ void FireRenderCommonVolume::detachFromScene()
 	{
 		scene.Detach(m_volume);
 
-		m_isVisible = false;
+		SetIsVisible(false);
 	}
 }
 
@@ -344,7 +344,7 @@ void NorthstarRPRVolume::attachToScene()
 
 	scene.Attach(m_boundingBoxMesh);
 
-	m_isVisible = true;
+	SetIsVisible(true);
 }
 
 void NorthstarRPRVolume::detachFromScene()
@@ -356,7 +356,7 @@ void NorthstarRPRVolume::detachFromScene()
 	{
 		scene.Detach(m_boundingBoxMesh);
 
-		m_isVisible = false;
+		SetIsVisible(false);
 	}
 }
 
@@ -1798,7 +1798,7 @@ void NorthstarFluidVolume::attachToScene()
 
 	scene.Attach(m_boundingBoxMesh);
 
-	m_isVisible = true;
+	SetIsVisible(true);
 }
 
 void NorthstarFluidVolume::detachFromScene()
@@ -1810,7 +1810,7 @@ void NorthstarFluidVolume::detachFromScene()
 	{
 		scene.Detach(m_boundingBoxMesh);
 
-		m_isVisible = false;
+		SetIsVisible(false);
 	}
 }
 
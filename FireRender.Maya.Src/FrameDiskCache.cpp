@@ -0,0 +1,501 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "FrameDiskCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace FireMaya;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const char* FrameFileExtension = ".rprframe";
+	const uint32_t FrameFileMagic = 0x46525052; // "RPRF"
+	const uint32_t FrameFileVersion = 1;
+
+	struct FrameFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t width;
+		uint32_t height;
+		uint32_t compact;
+		uint32_t componentCount;
+		uint64_t key;
+	};
+
+	unsigned long CurrentProcessId()
+	{
+#ifdef _WIN32
+		return (unsigned long) GetCurrentProcessId();
+#else
+		return (unsigned long) getpid();
+#endif
+	}
+
+	// Read only memory mapping of the whole file
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& path)
+		{
+#ifdef _WIN32
+			// file can be removed (evicted or cleared by another viewport) or replaced while it's mapped
+			m_file = CreateFileW(fs::u8path(path).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+				return;
+
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+				return;
+
+			m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!m_mapping)
+				return;
+
+			m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+			m_size = m_data ? size_t(fileSize.QuadPart) : 0;
+#else
+			m_file = open(path.c_str(), O_RDONLY);
+			if (m_file < 0)
+				return;
+
+			struct stat fileStat;
+			if (fstat(m_file, &fileStat) != 0 || fileStat.st_size == 0)
+				return;
+
+			void* data = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+			if (data == MAP_FAILED)
+				return;
+
+			m_data = data;
+			m_size = size_t(fileStat.st_size);
+#endif
+		}
+
+		~MappedFile()
+		{
+#ifdef _WIN32
+			if (m_data)
+				UnmapViewOfFile(m_data);
+			if (m_mapping)
+				CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE)
+				CloseHandle(m_file);
+#else
+			if (m_data)
+				munmap(m_data, m_size);
+			if (m_file >= 0)
+				close(m_file);
+#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const unsigned char* Data() const { return static_cast<const unsigned char*>(m_data); }
+		size_t Size() const { return m_size; }
+
+	private:
+#ifdef _WIN32
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+		void* m_data = nullptr;
+		size_t m_size = 0;
+	};
+}
+
+FrameDiskCache::FrameDiskCache() :
+	m_byteSize(0),
+	m_byteBudget(DefaultByteBudget),
+	m_hits(0),
+	m_misses(0),
+	m_writes(0),
+	m_evictions(0)
+{
+}
+
+std::string FrameDiskCache::FileName(uint64_t key, int width, int height)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "%016llx_%dx%d", (unsigned long long) key, width, height);
+
+	return std::string(name) + FrameFileExtension;
+}
+
+std::string FrameDiskCache::FilePath(const std::string& fileName) const
+{
+	return (fs::u8path(m_directory) / fileName).u8string();
+}
+
+void FrameDiskCache::SetDirectory(const std::string& path)
+{
+	std::vector<std::string> evicted;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_directory = path;
+		m_files.clear();
+		m_index.clear();
+		m_byteSize = 0;
+
+		if (m_directory.empty())
+			return;
+
+		std::error_code error;
+		fs::create_directories(fs::u8path(m_directory), error);
+
+		if (error)
+		{
+			m_directory.clear();
+			return;
+		}
+
+		// Index existing frames, last written (or last used) first
+		struct FoundFile
+		{
+			FileEntry entry;
+			fs::file_time_type time;
+		};
+
+		std::vector<FoundFile> found;
+
+		for (const fs::directory_entry& dirEntry : fs::directory_iterator(fs::u8path(m_directory), error))
+		{
+			if (!dirEntry.is_regular_file(error) || dirEntry.path().extension() != FrameFileExtension)
+				continue;
+
+			FoundFile file;
+			file.entry.name = dirEntry.path().filename().u8string();
+			file.entry.byteSize = size_t(dirEntry.file_size(error));
+			file.time = dirEntry.last_write_time(error);
+
+			found.push_back(file);
+		}
+
+		std::sort(found.begin(), found.end(), [](const FoundFile& a, const FoundFile& b) { return a.time > b.time; });
+
+		for (const FoundFile& file : found)
+		{
+			m_files.push_back(file.entry);
+			m_index[file.entry.name] = std::prev(m_files.end());
+			m_byteSize += file.entry.byteSize;
+		}
+
+		evicted = EvictToBudget();
+	}
+
+	RemoveFiles(evicted);
+}
+
+void FrameDiskCache::SetByteBudget(size_t bytes)
+{
+	std::vector<std::string> evicted;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_byteBudget = bytes;
+		evicted = EvictToBudget();
+	}
+
+	RemoveFiles(evicted);
+}
+
+bool FrameDiskCache::Contains(uint64_t key, int width, int height) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_index.find(FileName(key, width, height)) != m_index.end();
+}
+
+bool FrameDiskCache::Load(uint64_t key, int width, int height, StoredFrame& frame)
+{
+	std::string fileName = FileName(key, width, height);
+	std::string path;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!IsEnabled())
+			return false;
+
+		if (m_index.find(fileName) == m_index.end())
+		{
+			++m_misses;
+			return false;
+		}
+
+		path = FilePath(fileName);
+	}
+
+	bool loaded = false;
+
+	{
+		MappedFile file(path);
+
+		if (file.Size() >= sizeof(FrameFileHeader))
+		{
+			FrameFileHeader header;
+			memcpy(&header, file.Data(), sizeof(header));
+
+			size_t componentSize = header.compact ? sizeof(uint16_t) : sizeof(float);
+			size_t expectedComponents = size_t(width) * size_t(height) * 4;
+
+			if (header.magic == FrameFileMagic &&
+				header.version == FrameFileVersion &&
+				header.key == key &&
+				header.width == uint32_t(width) &&
+				header.height == uint32_t(height) &&
+				header.componentCount == expectedComponents &&
+				file.Size() == sizeof(FrameFileHeader) + expectedComponents * componentSize)
+			{
+				frame.Assign(file.Data() + sizeof(FrameFileHeader), expectedComponents, header.compact != 0);
+				loaded = true;
+			}
+		}
+	}
+
+	std::string touchedPath;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!loaded)
+		{
+			++m_misses;
+
+			// file is damaged or was removed outside of the plugin; the entry could be evicted meanwhile
+			auto it = m_index.find(fileName);
+			if (it == m_index.end())
+				return false;
+
+			m_byteSize -= it->second->byteSize;
+			m_files.erase(it->second);
+			m_index.erase(it);
+		}
+		else
+		{
+			++m_hits;
+			touchedPath = Touch(fileName);
+		}
+	}
+
+	if (!loaded)
+	{
+		RemoveFiles({ path });
+		return false;
+	}
+
+	if (!touchedPath.empty())
+	{
+		// modification time keeps LRU order between sessions
+		std::error_code error;
+		fs::last_write_time(fs::u8path(touchedPath), fs::file_time_type::clock::now(), error);
+	}
+
+	return true;
+}
+
+void FrameDiskCache::Save(uint64_t key, int width, int height, const StoredFrame& frame)
+{
+	if (!frame)
+		return;
+
+	FrameFileHeader header;
+	header.magic = FrameFileMagic;
+	header.version = FrameFileVersion;
+	header.width = uint32_t(width);
+	header.height = uint32_t(height);
+	header.compact = frame.IsCompact() ? 1 : 0;
+	header.componentCount = uint32_t(frame.ComponentCount());
+	header.key = key;
+
+	if (header.componentCount != size_t(width) * size_t(height) * 4)
+		return;
+
+	std::string fileName = FileName(key, width, height);
+	std::string path;
+	std::string touchedPath;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (!IsEnabled())
+			return;
+
+		path = FilePath(fileName);
+
+		if (m_index.find(fileName) != m_index.end())
+			touchedPath = Touch(fileName);
+	}
+
+	if (!touchedPath.empty())
+	{
+		std::error_code error;
+		fs::last_write_time(fs::u8path(touchedPath), fs::file_time_type::clock::now(), error);
+		return;
+	}
+
+	// write to the temporary file first so a partially written frame is never picked up,
+	// temporary name is unique so concurrent writers (other threads or Maya sessions) don't mix their data
+	static std::atomic<unsigned long long> tempCounter(0);
+	std::string tempPath = path + "." + std::to_string(CurrentProcessId()) + "_" + std::to_string(++tempCounter) + ".tmp";
+
+	{
+		std::ofstream stream(fs::u8path(tempPath), std::ios::binary | std::ios::trunc);
+		if (!stream)
+			return;
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(static_cast<const char*>(frame.RawData()), frame.byteSize());
+
+		if (!stream)
+		{
+			stream.close();
+
+			RemoveFiles({ tempPath });
+			return;
+		}
+	}
+
+	std::error_code error;
+	fs::rename(fs::u8path(tempPath), fs::u8path(path), error);
+
+	if (error)
+	{
+		RemoveFiles({ tempPath });
+		return;
+	}
+
+	std::vector<std::string> evicted;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// directory could be changed or the same frame saved by another thread while the file was written
+		if (path != FilePath(fileName) || m_index.find(fileName) != m_index.end())
+			return;
+
+		FileEntry entry;
+		entry.name = fileName;
+		entry.byteSize = sizeof(header) + frame.byteSize();
+
+		m_files.push_front(entry);
+		m_index[fileName] = m_files.begin();
+		m_byteSize += entry.byteSize;
+		++m_writes;
+
+		evicted = EvictToBudget();
+	}
+
+	RemoveFiles(evicted);
+}
+
+std::string FrameDiskCache::Touch(const std::string& fileName)
+{
+	// m_mutex should be locked by caller
+	auto it = m_index.find(fileName);
+	if (it == m_index.end())
+		return std::string();
+
+	m_files.splice(m_files.begin(), m_files, it->second);
+
+	return FilePath(fileName);
+}
+
+std::vector<std::string> FrameDiskCache::EvictToBudget()
+{
+	// m_mutex should be locked by caller
+	std::vector<std::string> evicted;
+
+	while (m_byteSize > m_byteBudget && !m_files.empty())
+	{
+		const FileEntry& oldest = m_files.back();
+
+		evicted.push_back(FilePath(oldest.name));
+
+		m_byteSize -= oldest.byteSize;
+		m_index.erase(oldest.name);
+		m_files.pop_back();
+
+		++m_evictions;
+	}
+
+	return evicted;
+}
+
+void FrameDiskCache::RemoveFiles(const std::vector<std::string>& paths)
+{
+	for (const std::string& path : paths)
+	{
+		std::error_code error;
+		fs::remove(fs::u8path(path), error);
+	}
+}
+
+void FrameDiskCache::Clear()
+{
+	std::vector<std::string> removed;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (const FileEntry& entry : m_files)
+		{
+			removed.push_back(FilePath(entry.name));
+		}
+
+		m_files.clear();
+		m_index.clear();
+		m_byteSize = 0;
+	}
+
+	RemoveFiles(removed);
+}
+
+FrameDiskCache::Statistics FrameDiskCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Statistics stats;
+	stats.fileCount = m_files.size();
+	stats.byteSize = m_byteSize;
+	stats.byteBudget = m_byteBudget;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.writes = m_writes;
+	stats.evictions = m_evictions;
+
+	return stats;
+}
@@ -0,0 +1,100 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#pragma once
+
+#include "FireRenderTextureCache.h"
+
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <string>
+#include <mutex>
+#include <cstdint>
+
+namespace FireMaya
+{
+	// Disk tier for the viewport animation frame cache.
+	// Frames are content addressed: file name is built from the frame key (scene state hash) and resolution,
+	// so frames rendered in previous sessions are reused as long as the scene state is the same.
+	// Files are memory mapped when loaded. Total size of the folder is bounded by the byte budget,
+	// least recently used files are removed first. File IO is done without holding the cache lock,
+	// only the index is updated under it.
+	class FrameDiskCache
+	{
+	public:
+		struct Statistics
+		{
+			size_t fileCount = 0;
+			size_t byteSize = 0;
+			size_t byteBudget = 0;
+			unsigned long long hits = 0;
+			unsigned long long misses = 0;
+			unsigned long long writes = 0;
+			unsigned long long evictions = 0;
+		};
+
+		static const size_t DefaultByteBudget = size_t(8192) * 1024 * 1024;
+
+		FrameDiskCache();
+
+		// Sets cache folder and indexes frames stored there. Empty path disables the cache
+		void SetDirectory(const std::string& path);
+		const std::string& GetDirectory() const { return m_directory; }
+		bool IsEnabled() const { return !m_directory.empty(); }
+
+		void SetByteBudget(size_t bytes);
+
+		bool Contains(uint64_t key, int width, int height) const;
+
+		// Returns false if frame is not stored
+		bool Load(uint64_t key, int width, int height, StoredFrame& frame);
+		void Save(uint64_t key, int width, int height, const StoredFrame& frame);
+
+		// Removes all frame files from the cache folder
+		void Clear();
+
+		Statistics GetStatistics() const;
+
+	private:
+		struct FileEntry
+		{
+			std::string name;
+			size_t byteSize = 0;
+		};
+
+		typedef std::list<FileEntry> FileList;
+
+		static std::string FileName(uint64_t key, int width, int height);
+		std::string FilePath(const std::string& fileName) const;
+
+		// Both return paths of files which should be updated or removed by the caller after unlocking
+		std::string Touch(const std::string& fileName);
+		std::vector<std::string> EvictToBudget();
+
+		static void RemoveFiles(const std::vector<std::string>& paths);
+
+		std::string m_directory;
+		size_t m_byteSize;
+		size_t m_byteBudget;
+
+		FileList m_files;	// most recently used first
+		std::unordered_map<std::string, FileList::iterator> m_index;
+
+		unsigned long long m_hits;
+		unsigned long long m_misses;
+		unsigned long long m_writes;
+		unsigned long long m_evictions;
+
+		mutable std::mutex m_mutex;
+	};
+}
@@ -0,0 +1,148 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+class HashValue
+{
+	// 64 bit word-at-a-time hash (XXH64 algorithm), each appended item is hashed with the current value as seed
+	static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+	static constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+	uint64_t value = 0;
+
+	static uint64_t Rotl(uint64_t v, int r) { return (v << r) | (v >> (64 - r)); }
+
+	static uint64_t Read64(const unsigned char* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+	static uint32_t Read32(const unsigned char* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+	static uint64_t Round(uint64_t acc, uint64_t input)
+	{
+		acc += input * Prime2;
+		return Rotl(acc, 31) * Prime1;
+	}
+
+	static uint64_t MergeRound(uint64_t acc, uint64_t v)
+	{
+		acc ^= Round(0, v);
+		return acc * Prime1 + Prime4;
+	}
+
+	static uint64_t HashBytes(const void* data, size_t length, uint64_t seed)
+	{
+		auto p = static_cast<const unsigned char*>(data);
+		auto end = p + length;
+		uint64_t ret;
+
+		if (length >= 32)
+		{
+			// 4 independent lanes
+			uint64_t v1 = seed + Prime1 + Prime2;
+			uint64_t v2 = seed + Prime2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - Prime1;
+
+			auto limit = end - 32;
+			do
+			{
+				v1 = Round(v1, Read64(p));
+				v2 = Round(v2, Read64(p + 8));
+				v3 = Round(v3, Read64(p + 16));
+				v4 = Round(v4, Read64(p + 24));
+				p += 32;
+			} while (p <= limit);
+
+			ret = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+			ret = MergeRound(ret, v1);
+			ret = MergeRound(ret, v2);
+			ret = MergeRound(ret, v3);
+			ret = MergeRound(ret, v4);
+		}
+		else
+		{
+			ret = seed + Prime5;
+		}
+
+		ret += uint64_t(length);
+
+		for (; p + 8 <= end; p += 8)
+		{
+			ret ^= Round(0, Read64(p));
+			ret = Rotl(ret, 27) * Prime1 + Prime4;
+		}
+
+		if (p + 4 <= end)
+		{
+			ret ^= uint64_t(Read32(p)) * Prime1;
+			ret = Rotl(ret, 23) * Prime2 + Prime3;
+			p += 4;
+		}
+
+		for (; p < end; ++p)
+		{
+			ret ^= (*p) * Prime5;
+			ret = Rotl(ret, 11) * Prime1;
+		}
+
+		// avalanche
+		ret ^= ret >> 33;
+		ret *= Prime2;
+		ret ^= ret >> 29;
+		ret *= Prime3;
+		ret ^= ret >> 32;
+
+		return ret;
+	}
+
+	template<class T>
+	static uint64_t HashItems(const T* v, int count, uint64_t ret)
+	{
+		size_t n = sizeof(T) * count;
+
+		if (!v)
+			return HashBytes(&n, sizeof(n), ret);
+
+		return HashBytes(v, n, ret);
+	}
+
+public:
+	HashValue(size_t v = 0) : value(v) {}
+
+	bool operator==(const HashValue& h) const { return value == h.value; }
+	bool operator!=(const HashValue& h) const { return value != h.value; }
+
+	template <class T>
+	HashValue& operator<<(const T& v)
+	{
+		value = HashItems(&v, 1, value);
+		return *this;
+	}
+
+	template <class T>
+	void Append(const T* v, int count)
+	{
+		value = HashItems(v, count, value);
+	}
+
+	operator size_t() const { return size_t(value); }
+	operator int() const
+	{
+		return  int((value >> 32) ^ value);
+	}
+};
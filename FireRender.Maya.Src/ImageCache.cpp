@@ -0,0 +1,378 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "ImageCache.h"
+#include "ParallelUtils.h"
+#include "Tracing.h"
+
+#include <filesystem>
+#include <chrono>
+
+// Maya 2015 has min/max defined, what prevents imageio.h from being compiled
+#undef min
+#undef max
+
+#include <imageio.h>
+
+using namespace FireMaya;
+
+namespace fs = std::filesystem;
+
+ImageCache::ImageCache() :
+	m_byteSize(0),
+	m_byteBudget(DefaultByteBudget),
+	m_pinnedByteSize(0),
+	m_hits(0),
+	m_misses(0),
+	m_evictions(0),
+	m_loadTimeMs(0.0),
+	m_prefetched(0),
+	m_prefetchFailed(0),
+	m_rejected(0)
+{
+}
+
+ImageCache& ImageCache::Instance()
+{
+	static ImageCache instance;
+	return instance;
+}
+
+std::string ImageCache::MakeKey(const std::string& resolvedPath, const std::string& colorSpace, const std::string& params)
+{
+	// modification time makes sure edited texture is reloaded; path which is not a plain file (udim, sequence) gets 0
+	long long modificationTime = 0;
+
+	std::error_code error;
+	fs::path path = fs::u8path(resolvedPath);
+
+	if (fs::is_regular_file(path, error))
+	{
+		auto time = fs::last_write_time(path, error);
+		if (!error)
+			modificationTime = (long long) time.time_since_epoch().count();
+	}
+
+	return resolvedPath + "|" + std::to_string(modificationTime) + "|" + colorSpace + "|" + params;
+}
+
+ImageDataPtr ImageCache::Find(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_index.find(key);
+	if (found == m_index.end())
+	{
+		++m_misses;
+		return nullptr;
+	}
+
+	++m_hits;
+	m_entries.splice(m_entries.begin(), m_entries, found->second);
+	Unpin(*found->second);
+
+	return found->second->data;
+}
+
+void ImageCache::Insert(const std::string& key, ImageDataPtr data, double loadTimeMs, bool pinned)
+{
+	if (!data)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (data->byteSize() > m_byteBudget / MaxEntryBudgetShare)
+	{
+		++m_rejected;
+		return;
+	}
+
+	m_loadTimeMs += loadTimeMs;
+
+	auto found = m_index.find(key);
+	if (found != m_index.end())
+	{
+		// image was loaded by another context meanwhile, replace with the latest data
+		Entry& entry = *found->second;
+		bool wasPinned = entry.pinned;
+
+		Unpin(entry);
+		m_byteSize -= entry.data->byteSize();
+		entry.data = data;
+		m_byteSize += data->byteSize();
+		m_entries.splice(m_entries.begin(), m_entries, found->second);
+
+		if (wasPinned || pinned)
+			Pin(entry);
+	}
+	else
+	{
+		m_entries.push_front(Entry { key, data });
+		m_index[key] = m_entries.begin();
+		m_byteSize += data->byteSize();
+
+		if (pinned)
+			Pin(m_entries.front());
+	}
+
+	EvictToBudget();
+}
+
+bool ImageCache::CanStore(size_t byteSize) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return byteSize <= m_byteBudget / MaxEntryBudgetShare;
+}
+
+bool ImageCache::DecodeFile(const std::string& path, ImageData& imageData)
+{
+	RPR_TRACE_ZONE_DETAIL("ImageCache::DecodeFile", path.c_str());
+
+	OIIO::ImageInput* input = OIIO::ImageInput::create(path);
+	if (!input)
+		return false;
+
+	bool decoded = false;
+
+	try
+	{
+		OIIO::ImageSpec spec;
+
+		// volume textures and images with extra channels are left to the core loader
+		if (input->open(path, spec) &&
+			spec.width > 0 && spec.height > 0 && spec.depth <= 1 &&
+			spec.nchannels > 0 && spec.nchannels <= 4)
+		{
+			OIIO::TypeDesc readType = OIIO::TypeDesc::FLOAT;
+			size_t componentSize = sizeof(float);
+
+			imageData.format.num_components = spec.nchannels;
+			imageData.format.type = RPR_COMPONENT_TYPE_FLOAT32;
+
+			if (spec.format == OIIO::TypeDesc::UINT8)
+			{
+				readType = OIIO::TypeDesc::UINT8;
+				componentSize = 1;
+				imageData.format.type = RPR_COMPONENT_TYPE_UINT8;
+			}
+			else if (spec.format == OIIO::TypeDesc::HALF)
+			{
+				readType = OIIO::TypeDesc::HALF;
+				componentSize = 2;
+				imageData.format.type = RPR_COMPONENT_TYPE_FLOAT16;
+			}
+
+			size_t rowPitch = size_t(spec.width) * spec.nchannels * componentSize;
+
+			imageData.desc = {};
+			imageData.desc.image_width = spec.width;
+			imageData.desc.image_height = spec.height;
+			imageData.desc.image_row_pitch = rpr_uint(rowPitch);
+
+			imageData.pixels.resize(rowPitch * spec.height);
+
+			// rpr images start with the bottom row (as the core file loader stores them), files start with the top one
+			unsigned char* topRow = imageData.pixels.data() + imageData.RowOffset(0);
+			decoded = input->read_image(readType, topRow, OIIO::AutoStride, -OIIO::stride_t(rowPitch));
+
+			input->close();
+		}
+	}
+	catch (...)
+	{
+		decoded = false;
+	}
+
+	delete input;
+
+	if (!decoded)
+		imageData.pixels.clear();
+
+	return decoded;
+}
+
+ImageCache::PrefetchTasks ImageCache::Prefetch(const std::vector<ImagePrefetchRequest>& requests)
+{
+	PrefetchTasks tasks;
+
+	// keys are made before locking, MakeKey reads file modification time
+	std::vector<std::string> keys;
+	keys.reserve(requests.size());
+
+	for (const ImagePrefetchRequest& request : requests)
+		keys.push_back(MakeKey(request.path, request.colorSpace));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// images prefetched for the previous scene which were never used
+	for (Entry& entry : m_entries)
+		Unpin(entry);
+
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		const std::string& key = keys[i];
+
+		// already decoded, keep it until the scene is translated
+		auto found = m_index.find(key);
+		if (found != m_index.end())
+		{
+			Pin(*found->second);
+			continue;
+		}
+
+		// requested by another context
+		auto pending = m_pendingTasks.find(key);
+		if (pending != m_pendingTasks.end())
+		{
+			tasks.push_back(pending->second);
+			continue;
+		}
+
+		std::string path = requests[i].path;
+
+		// task can't remove itself from m_pendingTasks before it is added there, m_mutex is locked
+		std::shared_future<void> task = WorkerPool::Instance().Submit([this, key, path]()
+		{
+			auto loadStart = std::chrono::steady_clock::now();
+
+			auto imageData = std::make_shared<ImageData>();
+			bool decoded = DecodeFile(path, *imageData);
+
+			if (decoded)
+			{
+				double loadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+				Insert(key, imageData, loadTimeMs, true);
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			m_pendingTasks.erase(key);
+
+			if (decoded)
+				++m_prefetched;
+			else
+				++m_prefetchFailed;
+		}).share();
+
+		m_pendingTasks.emplace(key, task);
+		tasks.push_back(task);
+	}
+
+	return tasks;
+}
+
+void ImageCache::WaitForPrefetch(const PrefetchTasks& tasks)
+{
+	for (const std::shared_future<void>& task : tasks)
+		task.wait();
+}
+
+bool ImageCache::Pin(Entry& entry)
+{
+	if (entry.pinned)
+		return true;
+
+	// prefetch bigger than the budget would keep the cache over it, the rest is evictable
+	if (m_pinnedByteSize + entry.data->byteSize() > m_byteBudget)
+		return false;
+
+	entry.pinned = true;
+	m_pinnedByteSize += entry.data->byteSize();
+
+	return true;
+}
+
+void ImageCache::Unpin(Entry& entry)
+{
+	if (!entry.pinned)
+		return;
+
+	entry.pinned = false;
+	m_pinnedByteSize -= entry.data->byteSize();
+}
+
+void ImageCache::EvictToBudget()
+{
+	// m_mutex should be locked by caller, pinned entries are skipped
+	auto it = m_entries.end();
+
+	while (m_byteSize > m_byteBudget && it != m_entries.begin())
+	{
+		--it;
+
+		if (it->pinned)
+			continue;
+
+		m_byteSize -= it->data->byteSize();
+		m_index.erase(it->key);
+		it = m_entries.erase(it);
+
+		++m_evictions;
+	}
+}
+
+void ImageCache::SetByteBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_byteBudget = bytes;
+
+	// the least recently used pins are released when the budget gets lower
+	for (auto it = m_entries.rbegin(); (it != m_entries.rend()) && (m_pinnedByteSize > m_byteBudget); ++it)
+		Unpin(*it);
+
+	EvictToBudget();
+}
+
+void ImageCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_index.clear();
+	m_entries.clear();
+	m_byteSize = 0;
+	m_pinnedByteSize = 0;
+}
+
+ImageCache::Statistics ImageCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Statistics stats;
+	stats.entryCount = m_entries.size();
+	stats.byteSize = m_byteSize;
+	stats.byteBudget = m_byteBudget;
+	stats.pinnedByteSize = m_pinnedByteSize;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.evictions = m_evictions;
+	stats.loadTimeMs = m_loadTimeMs;
+	stats.prefetched = m_prefetched;
+	stats.prefetchFailed = m_prefetchFailed;
+	stats.rejected = m_rejected;
+
+	return stats;
+}
+
+void ImageCache::ResetStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_hits = 0;
+	m_misses = 0;
+	m_evictions = 0;
+	m_loadTimeMs = 0.0;
+	m_prefetched = 0;
+	m_prefetchFailed = 0;
+	m_rejected = 0;
+}
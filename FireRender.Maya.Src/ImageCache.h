@@ -0,0 +1,156 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#pragma once
+
+#include <RadeonProRender.h>
+
+#include <list>
+#include <unordered_map>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace FireMaya
+{
+	// Decoded texture pixels in the form accepted by rprContextCreateImage.
+	// Rows are stored bottom first (the layout of images loaded by the core from file),
+	// so the top row of the file is the last one in pixels
+	struct ImageData
+	{
+		rpr_image_format format = {};
+		rpr_image_desc desc = {};
+		std::vector<unsigned char> pixels;
+
+		size_t byteSize() const { return pixels.size(); }
+
+		// offset of the row y counted from the top of the image
+		size_t RowOffset(unsigned int y) const
+		{
+			return size_t(desc.image_row_pitch) * (desc.image_height - 1 - y);
+		}
+	};
+
+	typedef std::shared_ptr<const ImageData> ImageDataPtr;
+
+	// File texture found in the shading networks before the scene is translated
+	struct ImagePrefetchRequest
+	{
+		std::string path;	// resolved path (env vars expanded), the same one Scope::GetImage uses
+		std::string colorSpace;
+	};
+
+	// Process wide cache of decoded textures.
+	// rpr images belong to a single rpr context, so every Scope keeps its own frw::Image map.
+	// This cache holds the decoded pixels so the IPR, viewport and production contexts
+	// decode the same file once and only create (upload) the image from memory.
+	// Entries are reference counted: evicted data stays alive until the last user releases it.
+	class ImageCache
+	{
+		ImageCache();
+
+	public:
+		struct Statistics
+		{
+			size_t entryCount = 0;
+			size_t byteSize = 0;
+			size_t byteBudget = 0;
+			size_t pinnedByteSize = 0;	// prefetched images which can't be evicted, at most byteBudget
+			unsigned long long hits = 0;
+			unsigned long long misses = 0;
+			unsigned long long evictions = 0;
+			double loadTimeMs = 0.0;	// total time spent decoding images which were put into cache
+			unsigned long long prefetched = 0;
+			unsigned long long prefetchFailed = 0;	// files left to the main thread loaders (MTextureManager)
+			unsigned long long rejected = 0;	// images too big to be kept in the cache
+		};
+
+		static const size_t DefaultByteBudget = size_t(4096) * 1024 * 1024;
+		static const size_t MaxEntryBudgetShare = 4;	// single entry can take at most 1/4 of the budget
+
+		static ImageCache& Instance();
+
+		// Builds key from the resolved file path (including its modification time),
+		// color space and optional parameters of the image adjustment (tiling, fit etc.)
+		static std::string MakeKey(const std::string& resolvedPath, const std::string& colorSpace, const std::string& params = std::string());
+
+		typedef std::vector<std::shared_future<void>> PrefetchTasks;
+
+		// Returned entry is consumed: it is unpinned if it was prefetched
+		ImageDataPtr Find(const std::string& key);
+
+		// Data bigger than MaxEntryBudgetShare of the budget is not kept, it would flush the rest of the cache.
+		// Pinned entries are not evicted until they are found or the next prefetch starts. Pinned data is bounded
+		// by the budget, entries above it are inserted unpinned
+		void Insert(const std::string& key, ImageDataPtr data, double loadTimeMs, bool pinned = false);
+
+		// False if data of this size would be rejected by Insert, lets callers skip reading pixels back
+		bool CanStore(size_t byteSize) const;
+
+		// Decodes files which are not cached yet on the worker pool, doesn't block.
+		// Files which can't be decoded here are skipped and later loaded by Scope::GetImage on the main thread.
+		// Requested images are pinned while they fit in the budget; pins left by the previous prefetch are released.
+		// Returns tasks decoding the requested files, including ones queued by other contexts
+		PrefetchTasks Prefetch(const std::vector<ImagePrefetchRequest>& requests);
+
+		// Blocks until the given prefetch tasks are finished
+		static void WaitForPrefetch(const PrefetchTasks& tasks);
+
+		// Decodes image file with OpenImageIO into the layout created by rprContextCreateImageFromFile.
+		// Safe to call from any thread
+		static bool DecodeFile(const std::string& path, ImageData& imageData);
+
+		void SetByteBudget(size_t bytes);
+
+		void Clear();
+
+		Statistics GetStatistics() const;
+		void ResetStatistics();
+
+	private:
+		struct Entry
+		{
+			std::string key;
+			ImageDataPtr data;
+			bool pinned = false;	// prefetched and not consumed yet
+		};
+
+		typedef std::list<Entry> EntryList;
+
+		// Pin returns false if pinned data would exceed the budget, m_mutex should be locked by caller
+		bool Pin(Entry& entry);
+		void Unpin(Entry& entry);
+
+		void EvictToBudget();
+
+		EntryList m_entries;	// most recently used first
+		std::unordered_map<std::string, EntryList::iterator> m_index;
+
+		size_t m_byteSize;
+		size_t m_byteBudget;
+		size_t m_pinnedByteSize;
+
+		unsigned long long m_hits;
+		unsigned long long m_misses;
+		unsigned long long m_evictions;
+		double m_loadTimeMs;
+		unsigned long long m_prefetched;
+		unsigned long long m_prefetchFailed;
+		unsigned long long m_rejected;
+
+		std::unordered_map<std::string, std::shared_future<void>> m_pendingTasks;	// keys being decoded by prefetch tasks
+
+		mutable std::mutex m_mutex;
+	};
+}
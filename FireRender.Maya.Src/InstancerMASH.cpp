@@ -12,8 +12,196 @@ limitations under the License.
 ********************************************************************/
 #include <InstancerMASH.h>
 #include <FireRenderMeshMASH.h>
+#include "ParallelUtils.h"
 #include <maya/MItDag.h>
-#include <maya/MEulerRotation.h>
+
+#include <cmath>
+
+namespace
+{
+	// points are processed by workers in chunks of this size
+	const size_t PointChunkSize = 4096;
+
+	// out = prefix * point * suffix; point is affine matrix stored as 4 rows of 3 floats
+	inline void ComposeInstanceMatrix(const float prefix[4][4], const float* point, const float suffix[4][4], float* out)
+	{
+		float tmp[4][4];
+
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int col = 0; col < 3; ++col)
+			{
+				tmp[row][col] =
+					prefix[row][0] * point[col] +
+					prefix[row][1] * point[3 + col] +
+					prefix[row][2] * point[6 + col] +
+					prefix[row][3] * point[9 + col];
+			}
+
+			tmp[row][3] = prefix[row][3];
+		}
+
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int col = 0; col < 4; ++col)
+			{
+				out[row * 4 + col] =
+					tmp[row][0] * suffix[0][col] +
+					tmp[row][1] * suffix[1][col] +
+					tmp[row][2] * suffix[2][col] +
+					tmp[row][3] * suffix[3][col];
+			}
+		}
+	}
+
+	void ReadVectorArray(MFnArrayAttrsData& arrayAttrsData, const char* name, std::vector<float>& x, std::vector<float>& y, std::vector<float>& z)
+	{
+		MStatus res;
+		MFnArrayAttrsData::Type arrType;
+
+		if (!arrayAttrsData.checkArrayExist(name, arrType, &res))
+			return;
+
+		MVectorArray data = arrayAttrsData.vectorArray(name, &res);
+		assert(res == MStatus::kSuccess);
+
+		unsigned int count = data.length();
+		if (count > x.size())
+		{
+			count = (unsigned int) x.size();
+		}
+
+		for (unsigned int idx = 0; idx < count; ++idx)
+		{
+			const MVector& value = data[idx];
+
+			x[idx] = (float) value.x;
+			y[idx] = (float) value.y;
+			z[idx] = (float) value.z;
+		}
+	}
+}
+
+void MASHInstanceData::Resize(size_t count)
+{
+	objectIndex.assign(count, 0);
+
+	positionX.assign(count, 0.0f);
+	positionY.assign(count, 0.0f);
+	positionZ.assign(count, 0.0f);
+
+	rotationX.assign(count, 0.0f);
+	rotationY.assign(count, 0.0f);
+	rotationZ.assign(count, 0.0f);
+
+	scaleX.assign(count, 1.0f);
+	scaleY.assign(count, 1.0f);
+	scaleZ.assign(count, 1.0f);
+}
+
+bool MASHInstanceData::Read(MFnArrayAttrsData& arrayAttrsData, size_t targetObjectCount)
+{
+	MStatus res;
+	MFnArrayAttrsData::Type arrType;
+
+	// this data is essential!
+	bool ojectIndexArrayExists = arrayAttrsData.checkArrayExist("objectIndex", arrType, &res);
+	assert(res == MStatus::kSuccess);
+	if (!ojectIndexArrayExists || (targetObjectCount == 0))
+		return false;
+
+	// objectIndex and id arrays are filled with doubles instead of ints in maya for some reason.
+	MDoubleArray objectIndexArray = arrayAttrsData.getDoubleData("objectIndex", &res);
+	assert(res == MStatus::kSuccess);
+
+	Resize(objectIndexArray.length());
+
+	for (unsigned int idx = 0; idx < objectIndexArray.length(); ++idx)
+	{
+		// MASH "Id Count" property might be bigger then real count of objects. We need to fix indices accordingly
+		double index = objectIndexArray[idx];
+		if (index >= targetObjectCount)
+		{
+			index = (double) (targetObjectCount - 1);
+		}
+
+		objectIndex[idx] = (index > 0.0) ? (uint32_t) index : 0;
+	}
+
+	ReadVectorArray(arrayAttrsData, "position", positionX, positionY, positionZ);
+	ReadVectorArray(arrayAttrsData, "rotation", rotationX, rotationY, rotationZ);
+	ReadVectorArray(arrayAttrsData, "scale", scaleX, scaleY, scaleZ);
+
+	return true;
+}
+
+size_t MASHInstanceData::FindChangedTransforms(const MASHInstanceData& other, std::vector<uint8_t>& outChanged) const
+{
+	const size_t count = Size();
+
+	if (other.Size() != count)
+	{
+		outChanged.assign(count, 1);
+		return count;
+	}
+
+	outChanged.resize(count);
+
+	size_t changedCount = 0;
+	for (size_t idx = 0; idx < count; ++idx)
+	{
+		bool changed =
+			(positionX[idx] != other.positionX[idx]) || (positionY[idx] != other.positionY[idx]) || (positionZ[idx] != other.positionZ[idx]) ||
+			(rotationX[idx] != other.rotationX[idx]) || (rotationY[idx] != other.rotationY[idx]) || (rotationZ[idx] != other.rotationZ[idx]) ||
+			(scaleX[idx] != other.scaleX[idx]) || (scaleY[idx] != other.scaleY[idx]) || (scaleZ[idx] != other.scaleZ[idx]);
+
+		outChanged[idx] = changed ? 1 : 0;
+		changedCount += changed ? 1 : 0;
+	}
+
+	return changedCount;
+}
+
+void MASHInstanceData::BuildMatrices(std::vector<float>& outMatrices) const
+{
+	const size_t count = Size();
+	outMatrices.resize(count * 12);
+
+	FireMaya::WorkerPool::Instance().ParallelForRange(count, PointChunkSize, [this, &outMatrices](size_t begin, size_t end)
+	{
+		const float degToRad = 3.14159265358979323846f / 180.0f;
+		float* out = outMatrices.data();
+
+		// same as MTransformationMatrix with scale, XYZ rotation and translation (row vectors)
+		for (size_t idx = begin; idx < end; ++idx)
+		{
+			float sx = std::sin(rotationX[idx] * degToRad);
+			float cx = std::cos(rotationX[idx] * degToRad);
+			float sy = std::sin(rotationY[idx] * degToRad);
+			float cy = std::cos(rotationY[idx] * degToRad);
+			float sz = std::sin(rotationZ[idx] * degToRad);
+			float cz = std::cos(rotationZ[idx] * degToRad);
+
+			float* m = out + idx * 12;
+
+			m[0] = scaleX[idx] * (cy * cz);
+			m[1] = scaleX[idx] * (cy * sz);
+			m[2] = scaleX[idx] * (-sy);
+
+			m[3] = scaleY[idx] * (sx * sy * cz - cx * sz);
+			m[4] = scaleY[idx] * (sx * sy * sz + cx * cz);
+			m[5] = scaleY[idx] * (sx * cy);
+
+			m[6] = scaleZ[idx] * (cx * sy * cz + sx * sz);
+			m[7] = scaleZ[idx] * (cx * sy * sz - sx * cz);
+			m[8] = scaleZ[idx] * (cx * cy);
+
+			m[9] = positionX[idx];
+			m[10] = positionY[idx];
+			m[11] = positionZ[idx];
+		}
+	});
+}
 
 InstancerMASH::InstancerMASH(FireRenderContext* context, const MDagPath& dagPath) :
 	FireRenderNode(context, dagPath),
@@ -39,12 +227,7 @@ void InstancerMASH::OnPlugDirty(MObject& node, MPlug& plug)
 
 	if (ShouldBeRecreated())
 	{
-		for (auto o : m_instancedObjects)
-		{
-			for (auto it = o.second.begin(); it != o.second.end(); ++it)
-				(*it)->setVisibility(false);
-		}
-		m_instancedObjects.clear();
+		ClearInstances();
 	}
 	setDirty();
 }
@@ -66,7 +249,7 @@ std::vector<MObject> InstancerMASH::GetTargetObjects() const
 	std::vector<MObject> targetObjects;
 	targetObjects.reserve(GetInstanceCount());
 
-	// Sometimes here appear empty input hierarchy nodes. 
+	// Sometimes here appear empty input hierarchy nodes.
 	for (const MPlug connection : dagConnections)
 	{
 		const std::string name(connection.partialName().asChar());
@@ -115,307 +298,193 @@ std::vector<MObject> GetShapesFromNode(MObject node)
 	return out;
 }
 
-std::vector<MMatrix> InstancerMASH::GetTransformMatrices() const
+MMatrix InstancerMASH::GetTargetMatrix(const FireRenderMesh& renderMesh) const
 {
-	std::vector<MMatrix> result;
-	result.reserve(GetInstanceCount());
+	//Target node translation shouldn't affect the result
+	// translation of shape in group however should
+	MFnDagNode meshTransformNode(MFnDagNode(renderMesh.Object()).parent(0));
+	MTransformationMatrix targetNodeMatrix = MFnTransform(meshTransformNode.object()).transformation();
+	MFnDagNode groupTransformNode(meshTransformNode.parent(0));
+	if (groupTransformNode.name() != "world")
+	{
+		MTransformationMatrix groupNodeMatrix = MFnTransform(groupTransformNode.object()).transformation();
+		groupNodeMatrix.setTranslation({ 0., 0., 0. }, MSpace::kObject);
+		MMatrix groupTransform = groupNodeMatrix.asMatrix();
+		MMatrix meshTransform = targetNodeMatrix.asMatrix();
 
+		return meshTransform * groupTransform;
+	}
+
+	targetNodeMatrix.setTranslation({ 0., 0., 0. }, MSpace::kObject);
+
+	return targetNodeMatrix.asMatrix();
+}
+
+bool InstancerMASH::ReadInstanceData(MASHInstanceData& outData) const
+{
 	MFnDependencyNode instancerDagNode(m.object);
 	MPlug plug(m.object, instancerDagNode.attribute("inp"));
 	MObject data = plug.asMDataHandle().data();
 	MFnArrayAttrsData arrayAttrsData(data);
 
-	MVectorArray positionData = arrayAttrsData.getVectorData("position");
-	MVectorArray rotationData = arrayAttrsData.getVectorData("rotation");
-	MVectorArray scaleData = arrayAttrsData.getVectorData("scale");
+	return outData.Read(arrayAttrsData, GetTargetObjects().size());
+}
 
-	for (unsigned int i = 0; i < static_cast<unsigned int>(GetInstanceCount()); i++)
+void InstancerMASH::ClearInstances()
+{
+	for (Prototype& prototype : m_prototypes)
 	{
-		MVector position = positionData[i];
-		MVector rotation = rotationData[i];
-		MVector scale = scaleData[i];
-
-		double rotationRadiansArray[] = { deg2rad(rotation.x), deg2rad(rotation.y), deg2rad(rotation.z) };
-		double scaleArray[] = { scale.x, scale.y, scale.z };
-
-		MTransformationMatrix transformFromMASH;
-		transformFromMASH.setScale(scaleArray, MSpace::Space::kWorld);
-		transformFromMASH.setRotation(rotationRadiansArray, MTransformationMatrix::RotationOrder::kXYZ);
-		transformFromMASH.setTranslation(position, MSpace::Space::kWorld);
-
-		result.push_back(transformFromMASH.asMatrix());
+		prototype.mesh->setVisibility(false);
 	}
 
-	return result;
+	m_prototypes.clear();
+	m_instanceData = MASHInstanceData();
+	m_pointMatrices.clear();
 }
 
-InstancerMASH::MASHContext::MASHContext()
-	: m_isValid(false)
-	, m_objectIndexArray()
-	, m_idArray()
-	, m_positionArray()
-	, m_rotationArray()
-	, m_scaleArray()
-	, m_shapesCache()
-	, m_uuidVectors()
-{}
-
-bool InstancerMASH::MASHContext::Init(MFnArrayAttrsData& arrayAttrsData, const InstancerMASH* pInstancer)
+void InstancerMASH::GenerateInstances()
 {
-	assert(pInstancer);
-	if (!pInstancer)
-		return false;
+	ClearInstances();
 
-	MStatus res;
-	MFnArrayAttrsData::Type arrType;
-
-	// this data is essential!
-	bool ojectIndexArrayExists = arrayAttrsData.checkArrayExist("objectIndex", arrType, &res);
-	assert(res == MStatus::kSuccess);
-	assert(ojectIndexArrayExists); 
-	if (!ojectIndexArrayExists)
-		return false;
+	MASHInstanceData instanceData;
+	bool IsDataReadSuccessfully = ReadInstanceData(instanceData);
+	if (!IsDataReadSuccessfully)
+		return;
 
 	// Get list of objects that are instanced by mash
-	std::vector<MObject> targetObjects = pInstancer->GetTargetObjects();
-
-	MDoubleArray dblArray = arrayAttrsData.getDoubleData("objectIndex", &res);
-	assert(res == MStatus::kSuccess);
+	std::vector<MObject> targetObjects = GetTargetObjects();
 
-	for (unsigned int idx = 0; idx < dblArray.length(); ++idx)
+	std::vector<uint8_t> isObjectUsed(targetObjects.size(), 0);
+	for (uint32_t objectIndex : instanceData.objectIndex)
 	{
-		// MASH "Id Count" property might be bigger then real count of objects. We need to fix indices accordingly
-		if (dblArray[idx] >= targetObjects.size())
-		{
-			dblArray[idx] = (double) (targetObjects.size() - 1);
-		}
+		isObjectUsed[objectIndex] = 1;
 	}
 
-	m_objectIndexArray = dblArray;
-
-	// Generate unique uuid, because we can't use instancer uuid - it initiates infinite Freshen() on whole hierarchy
-	m_uuidVectors.resize(m_objectIndexArray.length());
+	// one prototype per instanced shape
+	std::vector<std::vector<size_t>> objectPrototypes(targetObjects.size());
 
-	for (unsigned int idx = 0; idx < m_objectIndexArray.length(); ++idx)
+	for (size_t objectIndex = 0; objectIndex < targetObjects.size(); ++objectIndex)
 	{
-		size_t objectIndex = (size_t)m_objectIndexArray[idx];
-
-		if (m_shapesCache.count(objectIndex) != 0)
+		if (!isObjectUsed[objectIndex])
 			continue;
 
-		m_shapesCache[(size_t)objectIndex] = GetShapesFromNode(targetObjects.at((size_t)objectIndex));
-	}
+		for (MObject& shape : GetShapesFromNode(targetObjects[objectIndex]))
+		{
+			FireRenderObject* pFoundObj = context()->getRenderObject(shape);
+			if (!pFoundObj)
+				continue;
 
-	// try get id array
-	bool idArrayExists = arrayAttrsData.checkArrayExist("id", arrType, &res);
-	assert(res == MStatus::kSuccess);
-	if (idArrayExists)
-	{
-		m_idArray = arrayAttrsData.getDoubleData("id", &res);
-		assert(res == MStatus::kSuccess);
-	}
+			FireRenderMesh* renderMesh = static_cast<FireRenderMesh*>(pFoundObj);
+			assert(renderMesh);
 
-	// try get position array
-	bool positionArrayExists = arrayAttrsData.checkArrayExist("position", arrType, &res);
-	assert(res == MStatus::kSuccess);
-	if (positionArrayExists)
-	{
-		m_positionArray = arrayAttrsData.vectorArray("position", &res);
-		assert(res == MStatus::kSuccess);
+			// Generate unique uuid, because we can't use instancer uuid - it initiates infinite Freshen() on whole hierarchy
+			MUuid uuid;
+			uuid.generate();
+
+			Prototype prototype;
+			prototype.mesh = std::make_shared<FireRenderMeshMASH>(*renderMesh, uuid.asString().asChar(), m.object);
+
+			objectPrototypes[objectIndex].push_back(m_prototypes.size());
+			m_prototypes.push_back(std::move(prototype));
+		}
 	}
 
-	// try get rotation array
-	bool rotationArrayExists = arrayAttrsData.checkArrayExist("rotation", arrType, &res);
-	assert(res == MStatus::kSuccess);
-	if (rotationArrayExists)
+	for (size_t idx = 0; idx < instanceData.Size(); ++idx)
 	{
-		m_rotationArray = arrayAttrsData.vectorArray("rotation", &res);
-		assert(res == MStatus::kSuccess);
+		for (size_t prototypeIdx : objectPrototypes[instanceData.objectIndex[idx]])
+		{
+			m_prototypes[prototypeIdx].instanceIds.push_back((uint32_t) idx);
+		}
 	}
 
-	// try get scale array
-	bool scaleArrayExists = arrayAttrsData.checkArrayExist("scale", arrType, &res);
-	assert(res == MStatus::kSuccess);
-	if (scaleArrayExists)
+	for (Prototype& prototype : m_prototypes)
 	{
-		m_scaleArray = arrayAttrsData.vectorArray("scale", &res);
-		assert(res == MStatus::kSuccess);
+		prototype.mesh->SetInstanceCount(prototype.instanceIds.size());
 	}
 
-	m_isValid = true;
-
-	return true;
-}
-
-bool InstancerMASH::MASHContext::IsValid(void) const
-{
-	if (!m_isValid)
-		return false;
-
-	if (IsByID())
-		return true;
-
-	unsigned int objLen = m_objectIndexArray.length();
-	unsigned int posLen = m_positionArray.length();
-	unsigned int rotLen = m_rotationArray.length();
-	unsigned int scaleLen = m_scaleArray.length();
-	bool sizeMatch = (objLen == posLen) && (objLen == rotLen) && (objLen == scaleLen);
-	if (IsByParams() && sizeMatch)
-		return true;
-
-	return false;
+	UpdateInstanceTransforms(instanceData, true);
 }
 
-bool InstancerMASH::MASHContext::IsByParams(void) const
-{ 
-	unsigned int posLen = m_positionArray.length();
-	unsigned int rotLen = m_rotationArray.length();
-	unsigned int scaleLen = m_scaleArray.length();
-
-	return ((posLen != 0) && (rotLen != 0) && (scaleLen != 0));
-}
-
-void InstancerMASH::GenerateInstances()
+void InstancerMASH::UpdateInstanceTransforms(const MASHInstanceData& instanceData, bool forceAll)
 {
-	MFnDependencyNode instancerDagNode(m.object);
-	MPlug plug(m.object, instancerDagNode.attribute("inp"));
-	MObject data = plug.asMDataHandle().data();
-	MFnArrayAttrsData arrayAttrsData(data);
-
-	// objectIndex and id arrays are filled with doubles instead of ints in maya for some reason.
-	MASHContext mashContext;
-	bool IsDataReadSuccessfully = mashContext.Init(arrayAttrsData, this);
-	assert(IsDataReadSuccessfully);
-	if (!IsDataReadSuccessfully)
-		return;
+	std::vector<uint8_t> isPointChanged;
+	size_t changedPointCount = instanceData.Size();
 
-	if (mashContext.IsByID())
+	if (!forceAll)
 	{
-		GenerateInstancesById(mashContext);
+		changedPointCount = instanceData.FindChangedTransforms(m_instanceData, isPointChanged);
 	}
 
-	if (mashContext.IsByParams())
+	if (forceAll || (changedPointCount > 0))
 	{
-		GenerateInstancesByParams(mashContext);
+		m_instanceData = instanceData;
+		m_instanceData.BuildMatrices(m_pointMatrices);
 	}
-}
 
-void InstancerMASH::GenerateInstancesById(
-	MASHContext& mashContext
-	)
-{
-	assert(mashContext.IsValid());
-	assert(mashContext.IsByID());
+	MMatrix instancerMatrix = MFnTransform(m.object).transformation().asMatrix();
+	bool instancerChanged = forceAll || !(instancerMatrix == m_instancerMatrix);
+	m_instancerMatrix = instancerMatrix;
+
+	// convert Maya mesh in cm to m
+	MMatrix suffixMatrix = instancerMatrix;
+	FireMaya::ScaleMatrixFromCmToM(suffixMatrix);
 
-	// generate objects
-	for (unsigned int idArrayIndex = 0; idArrayIndex < mashContext.m_idArray.length(); ++idArrayIndex)
+	float suffix[4][4];
+	suffixMatrix.get(suffix);
+
+	for (Prototype& prototype : m_prototypes)
 	{
-		// get object(s) to be instanced
-		size_t objectIndex = (size_t)mashContext.m_objectIndexArray[idArrayIndex];
-		auto it = mashContext.m_shapesCache.find(objectIndex);
-		assert(it != mashContext.m_shapesCache.end());
-		if (it == mashContext.m_shapesCache.end())
-			continue;
+		MMatrix targetMatrix = GetTargetMatrix(prototype.mesh->GetOriginalFRMeshinstancedObject());
+		bool updateAll = instancerChanged || !(targetMatrix == prototype.targetMatrix);
+		prototype.targetMatrix = targetMatrix;
 
-		std::vector<MObject>& shapesToBeCreated = it->second;
+		if (!updateAll && (changedPointCount == 0))
+			continue;
 
-		// generate objectId(s) for new objects if neceessary
-		std::vector<MUuid>& uuidVector = mashContext.m_uuidVectors[objectIndex];
-		while (shapesToBeCreated.size() != uuidVector.size())
+		// instances of the prototype to be updated
+		std::vector<uint32_t> changedInstances;
+		if (updateAll)
 		{
-			MUuid uuid;
-			uuid.generate();
-			uuidVector.push_back(uuid);
+			changedInstances.resize(prototype.instanceIds.size());
+			for (size_t idx = 0; idx < changedInstances.size(); ++idx)
+			{
+				changedInstances[idx] = (uint32_t) idx;
+			}
 		}
-
-		// proceeed with generating objects
-		size_t id = (size_t)mashContext.m_idArray[idArrayIndex];
-		size_t currObjIdx = 0;
-		for (MObject& tmpObj : shapesToBeCreated)
+		else
 		{
-			FireRenderObject* pFoundObj = context()->getRenderObject(tmpObj);
-			if (!pFoundObj)
-				continue;
-
-			FireRenderMesh* renderMesh = static_cast<FireRenderMesh*>(pFoundObj);
-			assert(renderMesh);
-
-			auto instance = std::make_shared<FireRenderMeshMASH>(
-				*renderMesh,
-				uuidVector[currObjIdx].asString().asChar(),
-				m.object);
-			m_instancedObjects[id].push_back(instance);
-
-			currObjIdx++;
+			for (size_t idx = 0; idx < prototype.instanceIds.size(); ++idx)
+			{
+				if (isPointChanged[prototype.instanceIds[idx]])
+				{
+					changedInstances.push_back((uint32_t) idx);
+				}
+			}
 		}
-	}
-}
-
-void InstancerMASH::GenerateInstancesByParams(
-	MASHContext& mashContext
-)
-{
-	assert(mashContext.IsValid());
-	assert(mashContext.IsByParams());
-
-	MStatus res;
-
-	unsigned int countObjects = mashContext.m_objectIndexArray.length();
-	for (unsigned int idx = 0; idx < countObjects; ++idx)
-	{
-		// make transformation matrix for object to be instanced
-		MTransformationMatrix matr;
-		double vec_scale[3];
-		res = mashContext.m_scaleArray[idx].get(vec_scale);
-		assert(res == MStatus::kSuccess);
-		matr.setScale(vec_scale, MSpace::kTransform);
 
-		MEulerRotation rot(mashContext.m_rotationArray[idx]);
-		matr.rotateTo(rot);
+		float prefix[4][4];
+		targetMatrix.get(prefix);
 
-		double vec_transform[3];
-		res = mashContext.m_positionArray[idx].get(vec_transform);
-		assert(res == MStatus::kSuccess);
-		matr.setTranslation(vec_transform, MSpace::kTransform);
+		FireRenderMeshMASH* mesh = prototype.mesh.get();
+		const std::vector<uint32_t>& instanceIds = prototype.instanceIds;
+		const float* pointMatrices = m_pointMatrices.data();
 
-		// get object(s) to be instanced
-		size_t objectIndex = (size_t)mashContext.m_objectIndexArray[idx];
-		auto it = mashContext.m_shapesCache.find(objectIndex);
-		assert(it != mashContext.m_shapesCache.end());
-		if (it == mashContext.m_shapesCache.end())
-			continue;
-
-		std::vector<MObject>& shapesToBeCreated = it->second;
+		FireMaya::WorkerPool::Instance().ParallelForRange(changedInstances.size(), PointChunkSize, [&](size_t begin, size_t end)
+		{
+			for (size_t idx = begin; idx < end; ++idx)
+			{
+				uint32_t instanceIdx = changedInstances[idx];
+				ComposeInstanceMatrix(prefix, pointMatrices + size_t(instanceIds[instanceIdx]) * 12, suffix, mesh->GetInstanceMatrix(instanceIdx));
+			}
+		});
 
-		// generate objectId(s) for new objects if neceessary
-		std::vector<MUuid>& uuidVector = mashContext.m_uuidVectors[objectIndex];
-		while (shapesToBeCreated.size() != uuidVector.size())
+		if (updateAll)
 		{
-			MUuid uuid;
-			uuid.generate();
-			uuidVector.push_back(uuid);
+			mesh->MarkAllInstancesChanged();
 		}
-
-		// proceeed with generating objects
-		size_t currObjIdx = 0;
-		for (MObject& tmpObj : shapesToBeCreated)
+		else
 		{
-			FireRenderObject* pFoundObj = context()->getRenderObject(tmpObj);
-			if (!pFoundObj)
-				continue;
-
-			FireRenderMesh* renderMesh = static_cast<FireRenderMesh*>(pFoundObj);
-			assert(renderMesh);
-
-			auto instance = std::make_shared<FireRenderMeshMASH>(
-				*renderMesh,
-				uuidVector[currObjIdx].asString().asChar(),
-				m.object);
-			m_instancedObjects[idx].push_back(instance);
-
-			instance->SetSelfTransform(matr.asMatrix());
-
-			currObjIdx++;
+			mesh->MarkInstancesChanged(changedInstances);
 		}
 	}
 }
@@ -432,12 +501,9 @@ bool InstancerMASH::ReloadMesh(unsigned int sampleIdx /*= 0*/)
 {
 	if (sampleIdx != 0)
 	{
-		for (auto it = m_instancedObjects.begin(); it != m_instancedObjects.end(); ++it)
+		for (Prototype& prototype : m_prototypes)
 		{
-			for (auto& instancedFRObject : it->second)
-			{
-				instancedFRObject->ReloadMesh(sampleIdx);
-			}
+			prototype.mesh->ReloadMesh(sampleIdx);
 		}
 
 		return true;
@@ -448,51 +514,32 @@ bool InstancerMASH::ReloadMesh(unsigned int sampleIdx /*= 0*/)
 		return false;
 	}
 
-	if (m_instancedObjects.empty())
+	if (m_prototypes.empty())
 	{
 		GenerateInstances();
 	}
-
-	MTransformationMatrix instancerMatrix = MFnTransform(m.object).transformation();
-	std::vector<MMatrix> matricesFromMASH = GetTransformMatrices();
-
-	std::vector<MObject> targetObjects = GetTargetObjects();
-
-	for (size_t i = 0; i < GetInstanceCount(); i++)
+	else
 	{
-		std::vector<std::shared_ptr<FireRenderMeshMASH>>& instancedObjects = m_instancedObjects.at(i);
-		for (auto& instancedFRObject : instancedObjects)
+		MASHInstanceData instanceData;
+		if (ReadInstanceData(instanceData))
 		{
-			const FireRenderMesh& renderMesh = instancedFRObject->GetOriginalFRMeshinstancedObject();
-
-			//Target node translation shouldn't affect the result 
-			// translation of shape in group however should
-			MFnDagNode meshTransformNode(MFnDagNode(renderMesh.Object()).parent(0));
-			MTransformationMatrix targetNodeMatrix = MFnTransform(meshTransformNode.object()).transformation();
-			MFnDagNode groupTransformNode(meshTransformNode.parent(0));
-			if (groupTransformNode.name() != "world")
+			// points have been redistributed between instanced objects
+			if (instanceData.objectIndex != m_instanceData.objectIndex)
 			{
-				MTransformationMatrix groupNodeMatrix = MFnTransform(groupTransformNode.object()).transformation();
-				groupNodeMatrix.setTranslation({ 0., 0., 0. }, MSpace::kObject);
-				MMatrix groupTransform = groupNodeMatrix.asMatrix();
-				MMatrix meshTransform = targetNodeMatrix.asMatrix();
-
-				targetNodeMatrix = meshTransform * groupTransform;
+				GenerateInstances();
 			}
 			else
 			{
-				targetNodeMatrix.setTranslation({ 0., 0., 0. }, MSpace::kObject);
+				UpdateInstanceTransforms(instanceData, false);
 			}
-
-			MMatrix newTransform = targetNodeMatrix.asMatrix();
-			newTransform *= matricesFromMASH.at(i);
-			newTransform *= instancerMatrix.asMatrix();
-
-			instancedFRObject->SetSelfTransform(newTransform);
-			instancedFRObject->ReloadMesh(sampleIdx);
 		}
 	}
 
+	for (Prototype& prototype : m_prototypes)
+	{
+		prototype.mesh->ReloadMesh(sampleIdx);
+	}
+
 	m_instancedObjectsCachedSize = GetInstanceCount();
 
 	return true;
@@ -502,13 +549,9 @@ void InstancerMASH::Freshen(bool shouldCalculateHash)
 {
 	RegisterCallbacks();
 
-	for (auto it = m_instancedObjects.begin(); it != m_instancedObjects.end(); ++it)
+	for (Prototype& prototype : m_prototypes)
 	{
-		for (auto& instancedFRObject : it->second)
-		{
-			instancedFRObject->Rebuild();
-			instancedFRObject->setDirty();
-		}
+		prototype.mesh->Rebuild();
+		prototype.mesh->setDirty();
 	}
 }
-
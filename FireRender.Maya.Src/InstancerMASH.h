@@ -19,20 +19,66 @@ limitations under the License.
 #include <maya/MFnTypedAttribute.h>
 #include <maya/MDoubleArray.h>
 
+#include <cstdint>
+
 // Forward declaration
 class FireRenderMeshMASH;
 
+/**
+	Per point data generated by MASH in structure of arrays form.
+	Rotations are euler angles in degrees (XYZ order), missing arrays are filled with identity values.
+*/
+struct MASHInstanceData
+{
+	std::vector<uint32_t> objectIndex;
+
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+
+	std::vector<float> rotationX;
+	std::vector<float> rotationY;
+	std::vector<float> rotationZ;
+
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+
+	size_t Size(void) const { return objectIndex.size(); }
+	void Resize(size_t count);
+
+	/** Reads MASH output arrays; object indices are clamped by target objects count */
+	bool Read(MFnArrayAttrsData& arrayAttrsData, size_t targetObjectCount);
+
+	/** Sets flag for every point which transform differs from other data. Returns the number of changed points */
+	size_t FindChangedTransforms(const MASHInstanceData& other, std::vector<uint8_t>& outChanged) const;
+
+	/** Builds scale * rotation * translation matrices (3x4, row major) of all points */
+	void BuildMatrices(std::vector<float>& outMatrices) const;
+};
+
 /**
 	Instancer class used to pass generated data from MASH into core.
-	Handles all instanced objects lifecycle.
-	For now supports only one target object, but already retieves all instanced object array
+	Every shape instanced by MASH is translated once (FireRenderMeshMASH prototype),
+	MASH points are rpr instances of prototype shapes which are created in bulk.
+	Only instances with changed MASH data are updated between syncs.
 */
 class InstancerMASH: public FireRenderNode
 {
-	using FireRenderObjectMap = std::map<std::size_t, std::vector<std::shared_ptr<FireRenderMeshMASH>>>;
+	struct Prototype
+	{
+		std::shared_ptr<FireRenderMeshMASH> mesh;
+		std::vector<uint32_t> instanceIds; // MASH points instanced with the prototype shape
+		MMatrix targetMatrix;
+	};
 
-	/** All objects created by instancer */
-	FireRenderObjectMap m_instancedObjects;
+	/** Prototypes of all shapes instanced by MASH */
+	std::vector<Prototype> m_prototypes;
+
+	/** MASH data used for instance transforms on last update */
+	MASHInstanceData m_instanceData;
+	std::vector<float> m_pointMatrices;
+	MMatrix m_instancerMatrix;
 
 	size_t m_instancedObjectsCachedSize;
 
@@ -45,34 +91,12 @@ public:
 	virtual bool ReloadMesh(unsigned int sampleIdx = 0) override;
 
 private:
-	struct MASHContext
-	{
-		// objectIndex and id arrays are filled with doubles instead of ints in maya for some reason.
-		MDoubleArray m_objectIndexArray;
-		MDoubleArray m_idArray;
-		MVectorArray m_positionArray;
-		MVectorArray m_rotationArray;
-		MVectorArray m_scaleArray;
-
-		std::map<size_t, std::vector<MObject>> m_shapesCache;
-		std::vector<std::vector<MUuid>> m_uuidVectors;
-
-		bool m_isValid;
-
-		MASHContext();
-		~MASHContext() {}
-		bool Init(MFnArrayAttrsData& arrayAttrsData, const InstancerMASH* pInstancer);
-		bool IsValid(void) const;
-		bool IsByID(void) const { return m_idArray.length() != 0; }
-		bool IsByParams(void) const;
-	};
-
 	size_t GetInstanceCount(void) const;
 	std::vector<MObject> GetTargetObjects(void) const;
-	std::vector<MMatrix> GetTransformMatrices(void) const;
+	MMatrix GetTargetMatrix(const FireRenderMesh& renderMesh) const;
+	bool ReadInstanceData(MASHInstanceData& outData) const;
 	void GenerateInstances(void);
-	void GenerateInstancesById(MASHContext& mashContext);
-	void GenerateInstancesByParams(MASHContext& mashContext);
+	void UpdateInstanceTransforms(const MASHInstanceData& instanceData, bool forceAll);
+	void ClearInstances(void);
 	bool ShouldBeRecreated(void) const;
 };
-
@@ -0,0 +1,440 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "Logger.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace
+{
+	const char BinaryFileMagic[8] = { 'R', 'P', 'R', 'L', 'O', 'G', 0, 1 };
+
+	const char* LevelNames[] = { "debug", "info", "warning", "error" };
+
+#ifdef LINUX
+	// console output is synchronous, lower levels reach the file sink only
+	const Logger::LevelEnum ConsoleLevel = Logger::LevelWarn;
+#endif
+
+	uint64_t CurrentThreadId()
+	{
+		static thread_local uint64_t id = uint64_t(std::hash<std::thread::id>()(std::this_thread::get_id()));
+		return id;
+	}
+
+	uint64_t CurrentTimeMicroseconds()
+	{
+		return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+	}
+}
+
+/**
+	Bounded multi producer / single consumer queue of fixed size message slots (sequence numbered slots,
+	producers only race on the enqueue position) drained to the file by a background thread.
+	Producers never wait: message is dropped if the buffer is full, longer messages are truncated.
+*/
+class LogRingBuffer
+{
+public:
+	LogRingBuffer(const std::string& path, Logger::SinkFormat format) :
+		m_format(format),
+		m_slots(SlotCount),
+		m_enqueuePos(0),
+		m_dequeuePos(0),
+		m_dropped(0),
+		m_reportedDropped(0),
+		m_wakeRequested(false),
+		m_stop(false)
+	{
+		for (size_t idx = 0; idx < SlotCount; ++idx)
+		{
+			m_slots[idx].sequence.store(idx, std::memory_order_relaxed);
+		}
+
+		std::ios::openmode mode = std::ios::out | std::ios::app;
+		if (m_format == Logger::SinkBinary)
+		{
+			mode |= std::ios::binary;
+		}
+
+		m_stream.open(path, mode);
+
+		if (m_stream && (m_format == Logger::SinkBinary) && (m_stream.tellp() == std::streampos(0)))
+		{
+			m_stream.write(BinaryFileMagic, sizeof(BinaryFileMagic));
+		}
+
+		if (m_stream)
+		{
+			m_writer = std::thread([this]() { WriterProc(); });
+		}
+	}
+
+	~LogRingBuffer()
+	{
+		Stop();
+	}
+
+	bool IsOpen() const { return m_writer.joinable(); }
+
+	// Writes remaining messages and closes the file, messages pushed after that are dropped
+	void Stop()
+	{
+		if (!m_writer.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+			m_stop = true;
+		}
+
+		m_wakeCondition.notify_one();
+		m_writer.join();
+
+		m_stream.close();
+	}
+
+	void Push(Logger::LevelEnum level, const char* message, size_t length)
+	{
+		size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+		Slot* slot = nullptr;
+
+		for (;;)
+		{
+			slot = &m_slots[pos & SlotMask];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t diff = intptr_t(sequence) - intptr_t(pos);
+
+			if (diff == 0)
+			{
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			else
+			{
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+
+		if (length > SlotTextSize)
+		{
+			length = SlotTextSize;
+
+			// don't split UTF-8 sequence, cut before its lead byte
+			while ((length > 0) && ((static_cast<unsigned char>(message[length]) & 0xC0) == 0x80))
+			{
+				--length;
+			}
+		}
+
+		slot->time = CurrentTimeMicroseconds();
+		slot->thread = CurrentThreadId();
+		slot->level = uint32_t(level);
+		slot->length = uint32_t(length);
+		memcpy(slot->text, message, length);
+
+		slot->sequence.store(pos + 1, std::memory_order_release);
+
+		// writer is woken up early on bursts, otherwise it wakes up by timeout
+		if ((pos & WakeWriterMask) == WakeWriterMask)
+		{
+			m_wakeRequested.store(true, std::memory_order_relaxed);
+			m_wakeCondition.notify_one();
+		}
+	}
+
+private:
+	static const size_t SlotCount = 8192; // power of 2
+	static const size_t SlotMask = SlotCount - 1;
+	static const size_t WakeWriterMask = SlotCount / 4 - 1;
+	static const size_t SlotTextSize = 496;
+
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		uint64_t time;
+		uint64_t thread;
+		uint32_t level;
+		uint32_t length;
+		char text[SlotTextSize];
+	};
+
+	void WriterProc()
+	{
+		for (;;)
+		{
+			bool stop = false;
+
+			{
+				std::unique_lock<std::mutex> lock(m_wakeMutex);
+				m_wakeCondition.wait_for(lock, std::chrono::milliseconds(20), [this]() { return m_stop || m_wakeRequested.load(std::memory_order_relaxed); });
+				m_wakeRequested.store(false, std::memory_order_relaxed);
+				stop = m_stop;
+			}
+
+			Drain();
+
+			if (stop)
+				break;
+		}
+
+		m_stream.flush();
+	}
+
+	void Drain()
+	{
+		bool hasWritten = false;
+
+		for (;;)
+		{
+			Slot& slot = m_slots[m_dequeuePos & SlotMask];
+			size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+			if (sequence != m_dequeuePos + 1)
+				break;
+
+			WriteRecord(slot.time, slot.thread, slot.level, slot.text, slot.length);
+
+			slot.sequence.store(m_dequeuePos + SlotCount, std::memory_order_release);
+			++m_dequeuePos;
+
+			hasWritten = true;
+		}
+
+		unsigned long long dropped = m_dropped.load(std::memory_order_relaxed);
+		if (dropped != m_reportedDropped)
+		{
+			std::string message = "Log buffer overflow, " + std::to_string(dropped - m_reportedDropped) + " messages dropped";
+			WriteRecord(CurrentTimeMicroseconds(), CurrentThreadId(), Logger::LevelWarn, message.c_str(), message.size());
+
+			m_reportedDropped = dropped;
+			hasWritten = true;
+		}
+
+		if (hasWritten)
+		{
+			m_stream.flush();
+		}
+	}
+
+	void WriteRecord(uint64_t time, uint64_t thread, uint32_t level, const char* text, size_t length)
+	{
+		if (m_format == Logger::SinkBinary)
+		{
+			uint32_t length32 = uint32_t(length);
+
+			m_stream.write(reinterpret_cast<const char*>(&time), sizeof(time));
+			m_stream.write(reinterpret_cast<const char*>(&thread), sizeof(thread));
+			m_stream.write(reinterpret_cast<const char*>(&level), sizeof(level));
+			m_stream.write(reinterpret_cast<const char*>(&length32), sizeof(length32));
+			m_stream.write(text, length);
+
+			return;
+		}
+
+		// trailing line breaks are part of many messages, they are not needed in the record
+		while ((length > 0) && ((text[length - 1] == '\n') || (text[length - 1] == '\r')))
+		{
+			--length;
+		}
+
+		m_line.clear();
+		m_line += "{\"t\":";
+		m_line += std::to_string(time);
+		m_line += ",\"thread\":";
+		m_line += std::to_string(thread);
+		m_line += ",\"level\":\"";
+		m_line += level < 4 ? LevelNames[level] : "unknown";
+		m_line += "\",\"msg\":\"";
+
+		for (size_t idx = 0; idx < length; ++idx)
+		{
+			char ch = text[idx];
+
+			switch (ch)
+			{
+			case '"': m_line += "\\\""; break;
+			case '\\': m_line += "\\\\"; break;
+			case '\n': m_line += "\\n"; break;
+			case '\r': m_line += "\\r"; break;
+			case '\t': m_line += "\\t"; break;
+			default:
+				if ((unsigned char) ch < 0x20)
+				{
+					char escaped[8];
+					snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int) (unsigned char) ch);
+					m_line += escaped;
+				}
+				else
+				{
+					m_line += ch;
+				}
+			}
+		}
+
+		m_line += "\"}\n";
+		m_stream.write(m_line.data(), m_line.size());
+	}
+
+private:
+	Logger::SinkFormat m_format;
+	std::ofstream m_stream;
+	std::string m_line;
+
+	std::vector<Slot> m_slots;
+	std::atomic<size_t> m_enqueuePos;
+	size_t m_dequeuePos;	// used by the writer thread only
+
+	std::atomic<unsigned long long> m_dropped;
+	unsigned long long m_reportedDropped;
+
+	std::thread m_writer;
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic<bool> m_wakeRequested;
+	bool m_stop;
+};
+
+Logger::Logger() :
+	callbacks(nullptr),
+	sink(nullptr),
+	minLevel(LevelNone),
+	sinkLevel(LevelNone)
+{
+	callbackLists.push_back(std::make_unique<CallbackList>());
+	callbacks.store(callbackLists.back().get());
+}
+
+Logger::~Logger()
+{
+}
+
+char* Logger::ThreadBuffer()
+{
+	static thread_local std::vector<char> buffer(ThreadBufferSize);
+	return buffer.data();
+}
+
+void Logger::Write(LevelEnum level, const char* message, size_t length)
+{
+	Logger& logger = Instance();
+
+#ifdef LINUX
+	// Added for Linux debugging:
+	if (level >= ConsoleLevel)
+	{
+		std::clog << message;
+	}
+#endif
+
+	for (const CallbackEntry& entry : *logger.callbacks.load(std::memory_order_acquire))
+	{
+		if (entry.level <= level)
+			entry.callback(message);
+	}
+
+	if (level >= logger.sinkLevel.load(std::memory_order_relaxed))
+	{
+		if (LogRingBuffer* currentSink = logger.sink.load(std::memory_order_acquire))
+		{
+			currentSink->Push(level, message, length);
+		}
+	}
+}
+
+void Logger::UpdateMinLevel()
+{
+	int level = sinkLevel.load(std::memory_order_relaxed);
+
+	for (const CallbackEntry& entry : *callbacks.load(std::memory_order_relaxed))
+	{
+		if (entry.level < level)
+			level = entry.level;
+	}
+
+	minLevel.store(level, std::memory_order_relaxed);
+}
+
+void Logger::AddCallback(Callback cb, LevelEnum level)
+{
+	Logger& logger = Instance();
+	std::lock_guard<std::mutex> lock(logger.configMutex);
+
+	auto newCallbacks = std::make_unique<CallbackList>(*logger.callbacks.load(std::memory_order_relaxed));
+
+	bool found = false;
+	for (CallbackEntry& entry : *newCallbacks)
+	{
+		if (entry.callback == cb)
+		{
+			entry.level = level;
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		newCallbacks->push_back(CallbackEntry{ cb, level });
+	}
+
+	logger.callbacks.store(newCallbacks.get(), std::memory_order_release);
+	logger.callbackLists.push_back(std::move(newCallbacks));
+
+	logger.UpdateMinLevel();
+}
+
+bool Logger::OpenSink(const std::string& path, SinkFormat format, LevelEnum level)
+{
+	CloseSink();
+
+	auto newSink = std::make_unique<LogRingBuffer>(path, format);
+	if (!newSink->IsOpen())
+		return false;
+
+	Logger& logger = Instance();
+	std::lock_guard<std::mutex> lock(logger.configMutex);
+
+	logger.sink.store(newSink.get(), std::memory_order_release);
+	logger.sinks.push_back(std::move(newSink));
+
+	logger.sinkLevel.store(level, std::memory_order_relaxed);
+	logger.UpdateMinLevel();
+
+	return true;
+}
+
+void Logger::CloseSink()
+{
+	Logger& logger = Instance();
+	std::lock_guard<std::mutex> lock(logger.configMutex);
+
+	LogRingBuffer* currentSink = logger.sink.exchange(nullptr, std::memory_order_acq_rel);
+
+	logger.sinkLevel.store(LevelNone, std::memory_order_relaxed);
+	logger.UpdateMinLevel();
+
+	if (currentSink)
+	{
+		currentSink->Stop();
+	}
+}
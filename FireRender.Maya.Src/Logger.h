@@ -12,11 +12,27 @@ limitations under the License.
 ********************************************************************/
 #pragma once
 #include <cstdio>
-#include <map>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <iostream>
 #include <assert.h>
 
+// Messages of lower levels are removed at compile time (0 - debug, 1 - info, 2 - warning, 3 - error)
+#ifndef RPR_LOG_COMPILED_LEVEL
+#define RPR_LOG_COMPILED_LEVEL 0
+#endif
+
+class LogRingBuffer;
+
+/**
+	Messages are formatted once into a preallocated per thread buffer and passed to callbacks
+	and to the file sink. File sink only copies message into lock-free ring buffer,
+	file is written by a background thread. Disabled levels cost one atomic load.
+*/
 class Logger
 {
 public:
@@ -26,12 +42,43 @@ public:
 		LevelInfo,
 		LevelWarn,
 		LevelError,
+		LevelNone,
+	};
+
+	enum SinkFormat
+	{
+		SinkJsonLines,
+		SinkBinary,
 	};
 
-private:
 	typedef void(*Callback)(const char * sz);
 
-	std::map<Callback, LevelEnum> callbacks;
+private:
+	struct CallbackEntry
+	{
+		Callback callback;
+		LevelEnum level;
+	};
+
+	typedef std::vector<CallbackEntry> CallbackList;
+
+	// Callback list is replaced as a whole when callback is added and sink is replaced when it's reopened,
+	// so messages are written without lock. Previous lists and sinks are kept until the logger is destroyed
+	std::atomic<const CallbackList*> callbacks;
+	std::atomic<LogRingBuffer*> sink;
+	std::vector<std::unique_ptr<CallbackList>> callbackLists;
+	std::vector<std::unique_ptr<LogRingBuffer>> sinks;
+
+	// the lowest level used by callbacks or sink
+	std::atomic<int> minLevel;
+	std::atomic<int> sinkLevel;
+
+	std::mutex configMutex;
+
+	static const size_t ThreadBufferSize = 0x10000;
+
+	Logger();
+	~Logger();
 
 	// single instance
 	static Logger& Instance()
@@ -40,40 +87,44 @@ private:
 		return instance;
 	}
 
+	static char* ThreadBuffer();
+	static void Write(LevelEnum level, const char* message, size_t length);
+	void UpdateMinLevel();
 
 public:
 
-	static void AddCallback(Callback cb, LevelEnum level)
+	static void AddCallback(Callback cb, LevelEnum level);
+
+	// Starts writing messages of given level and above to the file, file is written by a background thread
+	static bool OpenSink(const std::string& path, SinkFormat format, LevelEnum level);
+	static void CloseSink();
+
+	static bool IsEnabled(LevelEnum level)
 	{
-		Instance().callbacks[cb] = level;
+		return level >= Instance().minLevel.load(std::memory_order_relaxed);
 	}
 
 	template <typename... Args>
 	static void Printf(LevelEnum level, const char *format, const Args&... args)
 	{
-		if (!Instance().callbacks.empty())
-		{
-			std::vector<char> buf;
-			buf.resize(0x10000);
-			int written = snprintf(buf.data(), buf.size(), format, args...);
-			assert(written >= 0 && written < buf.size());
-#ifdef LINUX
-			// Added for Linux debugging:
-			std::clog << buf.data();
-#endif
-			for (auto cb : Instance().callbacks)
-			{
-				if (cb.second <= level)
-					cb.first(buf.data());
-			}
-		}
+		if (!IsEnabled(level))
+			return;
+
+		char* buf = ThreadBuffer();
+		int written = snprintf(buf, ThreadBufferSize, format, args...);
+		assert(written >= 0 && size_t(written) < ThreadBufferSize);
+
+		if (written < 0)
+			return;
+
+		Write(level, buf, (size_t(written) < ThreadBufferSize) ? size_t(written) : ThreadBufferSize - 1);
 	}
 };
 
 template <typename... Args>
 inline void DebugPrint(const char *format, const Args&... args)
 {
-#ifdef _DEBUG
+#if RPR_LOG_COMPILED_LEVEL <= 0
 	Logger::Printf(Logger::LevelDebug, format, args...);
 #endif
 }
@@ -81,12 +132,16 @@ inline void DebugPrint(const char *format, const Args&... args)
 template <typename... Args>
 inline void LogPrint(const char *format, const Args&... args)
 {
+#if RPR_LOG_COMPILED_LEVEL <= 1
 	Logger::Printf(Logger::LevelInfo, format, args...);
+#endif
 }
 
 template <typename... Args>
 inline void ErrorPrint(const char *format, const Args&... args)
 {
+#if RPR_LOG_COMPILED_LEVEL <= 3
 	Logger::Printf(Logger::LevelError, format, args...);
+#endif
 }
 
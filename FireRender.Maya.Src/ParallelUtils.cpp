@@ -0,0 +1,241 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "ParallelUtils.h"
+#include "Tracing.h"
+
+#include <algorithm>
+#include <exception>
+#include <cassert>
+
+namespace FireMaya
+{
+
+namespace
+{
+	thread_local bool tlsIsPoolWorker = false;
+
+	// State of single ParallelForRange call shared between the caller and helper tasks
+	struct RangeJob
+	{
+		size_t count = 0;
+		size_t grainSize = 1;
+		size_t chunkCount = 0;
+		const std::function<void(size_t, size_t)>* func = nullptr;
+
+		std::atomic<size_t> nextChunk { 0 };
+		std::atomic<size_t> chunksDone { 0 };
+
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::exception_ptr exception;
+
+		// Claims and executes chunks until all of them are taken
+		void Work()
+		{
+			size_t chunk;
+			while ((chunk = nextChunk.fetch_add(1)) < chunkCount)
+			{
+				size_t begin = chunk * grainSize;
+				size_t end = std::min(begin + grainSize, count);
+
+				try
+				{
+					(*func)(begin, end);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (!exception)
+						exception = std::current_exception();
+				}
+
+				if (chunksDone.fetch_add(1) + 1 == chunkCount)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					condition.notify_all();
+				}
+			}
+		}
+
+		void Wait()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return chunksDone.load() == chunkCount; });
+		}
+	};
+}
+
+WorkerPool::WorkerPool() :
+	m_stopping(false)
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+	Shutdown();
+}
+
+WorkerPool& WorkerPool::Instance()
+{
+	static WorkerPool instance;
+	return instance;
+}
+
+size_t WorkerPool::ThreadCount() const
+{
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+
+	return std::max(1u, hardwareThreads);
+}
+
+bool WorkerPool::IsWorkerThread() const
+{
+	return tlsIsPoolWorker;
+}
+
+void WorkerPool::StartIfNeeded()
+{
+	// m_mutex should be locked by caller
+	if (!m_workers.empty())
+		return;
+
+	m_stopping = false;
+
+	size_t workerCount = std::max<size_t>(1, ThreadCount() - 1);
+	m_workers.reserve(workerCount);
+
+	for (size_t idx = 0; idx < workerCount; ++idx)
+	{
+		m_workers.emplace_back(&WorkerPool::WorkerProc, this);
+	}
+}
+
+void WorkerPool::WorkerProc()
+{
+	tlsIsPoolWorker = true;
+	Trace::SetThreadName("WorkerPool");
+
+	while (true)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+
+			if (m_tasks.empty())
+				break; // stopping and nothing left to do
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		task();
+	}
+
+	tlsIsPoolWorker = false;
+}
+
+std::future<void> WorkerPool::Submit(std::function<void()> func)
+{
+	auto task = std::make_shared<std::packaged_task<void()>>(std::move(func));
+	std::future<void> result = task->get_future();
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		StartIfNeeded();
+
+		m_tasks.emplace_back([task]() { (*task)(); });
+	}
+
+	m_condition.notify_one();
+
+	return result;
+}
+
+void WorkerPool::ParallelForRange(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func)
+{
+	if (count == 0)
+		return;
+
+	grainSize = std::max<size_t>(1, grainSize);
+	size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+	// run serially if there is nothing to split or we are already on the worker (prevents pool starvation)
+	if (chunkCount == 1 || IsWorkerThread() || ThreadCount() == 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	auto job = std::make_shared<RangeJob>();
+	job->count = count;
+	job->grainSize = grainSize;
+	job->chunkCount = chunkCount;
+	job->func = &func;
+
+	size_t helperCount = std::min(chunkCount, ThreadCount()) - 1;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		StartIfNeeded();
+
+		for (size_t idx = 0; idx < helperCount; ++idx)
+		{
+			m_tasks.emplace_back([job]() { job->Work(); });
+		}
+	}
+
+	m_condition.notify_all();
+
+	// calling thread works too
+	job->Work();
+	job->Wait();
+
+	if (job->exception)
+	{
+		std::rethrow_exception(job->exception);
+	}
+}
+
+void WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	ParallelForRange(count, 1, [&func](size_t begin, size_t end)
+	{
+		for (size_t idx = begin; idx < end; ++idx)
+		{
+			func(idx);
+		}
+	});
+}
+
+void WorkerPool::Shutdown()
+{
+	std::vector<std::thread> workers;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		workers.swap(m_workers);
+	}
+
+	m_condition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		if (worker.joinable())
+			worker.join();
+	}
+}
+
+}
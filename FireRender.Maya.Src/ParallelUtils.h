@@ -0,0 +1,74 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <thread>
+#include <atomic>
+
+namespace FireMaya
+{
+
+/** Process wide pool of worker threads for CPU bound work which doesn't touch Maya API
+	(mesh index building, pixel conversions, hashing etc.).
+
+	Maya API calls must stay on the main thread (see FireRenderThread::UseTheThread),
+	so callers are expected to gather all Maya data first and only hand plain data to the pool.
+
+	The calling thread takes part in ParallelFor, so nested ParallelFor calls from the worker threads
+	are safe - they are simply executed serially by the worker.
+*/
+class WorkerPool
+{
+	WorkerPool();
+	~WorkerPool();
+
+public:
+	static WorkerPool& Instance();
+
+	/* Number of threads which can take part in ParallelFor (workers + calling thread) */
+	size_t ThreadCount() const;
+
+	/* Calls func(index) for each index in [0, count), blocks until all items are processed */
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+	/* Splits [0, count) into chunks of grainSize items and calls func(begin, end) for each chunk, blocks until done */
+	void ParallelForRange(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& func);
+
+	/* Queues function to be executed on one of the workers */
+	std::future<void> Submit(std::function<void()> func);
+
+	/* Returns true if caller is one of the pool workers */
+	bool IsWorkerThread() const;
+
+	/* Stops and joins worker threads. Pool will be restarted on next use */
+	void Shutdown();
+
+private:
+	void StartIfNeeded();
+	void WorkerProc();
+
+private:
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()>> m_tasks;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping;
+};
+
+}
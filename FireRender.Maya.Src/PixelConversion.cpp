@@ -0,0 +1,590 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "PixelConversion.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PIXEL_CONVERSION_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// MSVC allows intrinsics of any instruction set, gcc and clang need them enabled per function
+#if defined(PIXEL_CONVERSION_X86) && !defined(_MSC_VER)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+namespace FireMaya
+{
+
+namespace PixelConversion
+{
+
+namespace
+{
+#ifdef PIXEL_CONVERSION_X86
+	struct CpuFeatures
+	{
+		bool ssse3 = false;
+		bool avx2 = false;	// together with F16C
+
+		CpuFeatures()
+		{
+			unsigned int regs1[4] = {};
+			unsigned int regs7[4] = {};
+
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			int maxLeaf = info[0];
+
+			__cpuid(info, 1);
+			memcpy(regs1, info, sizeof(regs1));
+
+			if (maxLeaf >= 7)
+			{
+				__cpuidex(info, 7, 0);
+				memcpy(regs7, info, sizeof(regs7));
+			}
+#else
+			unsigned int maxLeaf = __get_cpuid_max(0, nullptr);
+
+			__cpuid(1, regs1[0], regs1[1], regs1[2], regs1[3]);
+
+			if (maxLeaf >= 7)
+				__cpuid_count(7, 0, regs7[0], regs7[1], regs7[2], regs7[3]);
+#endif
+
+			ssse3 = (regs1[2] & (1u << 9)) != 0;
+
+			bool osxsave = (regs1[2] & (1u << 27)) != 0;
+			bool avx = (regs1[2] & (1u << 28)) != 0;
+			bool f16c = (regs1[2] & (1u << 29)) != 0;
+			bool avx2Flag = (regs7[1] & (1u << 5)) != 0;
+
+			// OS has to save ymm registers on context switch
+			bool ymmEnabled = false;
+			if (osxsave && avx)
+			{
+#ifdef _MSC_VER
+				ymmEnabled = (_xgetbv(0) & 6) == 6;
+#else
+				unsigned int eax, edx;
+				__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+				ymmEnabled = (eax & 6) == 6;
+#endif
+			}
+
+			avx2 = ymmEnabled && avx2Flag && f16c;
+		}
+	};
+
+	const CpuFeatures& Cpu()
+	{
+		static CpuFeatures features;
+		return features;
+	}
+#endif
+
+	// [0, 255] sRGB decode followed by [0, 255] linear, indexed by value + 256 for alpha
+	const float* UInt8Table()
+	{
+		static const std::vector<float> table = []()
+		{
+			std::vector<float> values(512);
+
+			for (int idx = 0; idx < 256; ++idx)
+			{
+				float value = idx / 255.0f;
+
+				values[idx] = (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+				values[idx + 256] = value;
+			}
+
+			return values;
+		}();
+
+		return table.data();
+	}
+
+	bool HasAlpha(unsigned int channels)
+	{
+		return channels == 2 || channels == 4;
+	}
+
+	void HalfToFloatScalar(const uint16_t* src, float* dst, size_t count)
+	{
+		for (size_t idx = 0; idx < count; ++idx)
+			dst[idx] = HalfToFloat(src[idx]);
+	}
+
+	void FloatToHalfScalar(const float* src, uint16_t* dst, size_t count)
+	{
+		for (size_t idx = 0; idx < count; ++idx)
+			dst[idx] = FloatToHalf(src[idx]);
+	}
+
+	void UInt8ToFloatScalar(const uint8_t* src, float* dst, size_t begin, size_t count, unsigned int channels, bool srgbDecode)
+	{
+		const float* table = UInt8Table();
+		bool hasAlpha = HasAlpha(channels);
+
+		for (size_t idx = begin; idx < count; ++idx)
+		{
+			bool linear = !srgbDecode || (hasAlpha && (idx % channels) == channels - 1);
+			dst[idx] = table[src[idx] + (linear ? 256 : 0)];
+		}
+	}
+
+	void DropAlphaScalar(const unsigned char* src, unsigned char* dst, size_t pixelCount, size_t componentSize)
+	{
+		size_t srcPixelSize = componentSize * 4;
+		size_t dstPixelSize = componentSize * 3;
+
+		for (size_t idx = 0; idx < pixelCount; ++idx)
+			memcpy(dst + idx * dstPixelSize, src + idx * srcPixelSize, dstPixelSize);
+	}
+
+	void CopyRGBAScalar(const float* src, const float* alphaSrc, float* dst, size_t idx, size_t pixelCount)
+	{
+		for (; idx < pixelCount; ++idx)
+		{
+			dst[idx * 4 + 0] = src[idx * 4 + 0];
+			dst[idx * 4 + 1] = src[idx * 4 + 1];
+			dst[idx * 4 + 2] = src[idx * 4 + 2];
+			dst[idx * 4 + 3] = alphaSrc[idx * 4];
+		}
+	}
+
+#ifdef PIXEL_CONVERSION_X86
+	TARGET_AVX2 void HalfToFloatAVX2(const uint16_t* src, float* dst, size_t count)
+	{
+		size_t idx = 0;
+
+		for (; idx + 8 <= count; idx += 8)
+		{
+			__m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + idx));
+			_mm256_storeu_ps(dst + idx, _mm256_cvtph_ps(half));
+		}
+
+		HalfToFloatScalar(src + idx, dst + idx, count - idx);
+	}
+
+	TARGET_AVX2 void FloatToHalfAVX2(const float* src, uint16_t* dst, size_t count)
+	{
+		size_t idx = 0;
+
+		for (; idx + 8 <= count; idx += 8)
+		{
+			__m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(src + idx), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + idx), half);
+		}
+
+		FloatToHalfScalar(src + idx, dst + idx, count - idx);
+	}
+
+	TARGET_AVX2 void UInt8ToFloatAVX2(const uint8_t* src, float* dst, size_t count, unsigned int channels, bool srgbDecode)
+	{
+		size_t idx = 0;
+
+		if (srgbDecode)
+		{
+			// 8 lanes cover whole pixels for 1, 2 and 4 channels, so alpha lanes stay at the same positions
+			const float* table = UInt8Table();
+			__m256i alphaOffset = _mm256_setzero_si256();
+
+			if (channels == 2)
+				alphaOffset = _mm256_setr_epi32(0, 256, 0, 256, 0, 256, 0, 256);
+			else if (channels == 4)
+				alphaOffset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+
+			for (; idx + 8 <= count; idx += 8)
+			{
+				__m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + idx)));
+				__m256i indices = _mm256_add_epi32(values, alphaOffset);
+				_mm256_storeu_ps(dst + idx, _mm256_i32gather_ps(table, indices, 4));
+			}
+		}
+		else
+		{
+			const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+
+			for (; idx + 8 <= count; idx += 8)
+			{
+				__m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + idx)));
+				_mm256_storeu_ps(dst + idx, _mm256_mul_ps(_mm256_cvtepi32_ps(values), scale));
+			}
+		}
+
+		UInt8ToFloatScalar(src, dst, idx, count, channels, srgbDecode);
+	}
+
+	// Two pixels per register, red of alpha source is broadcast within its pixel and blended into the last lane
+	TARGET_AVX2 void CopyRGBAAVX2(const float* src, const float* alphaSrc, float* dst, size_t pixelCount)
+	{
+		size_t idx = 0;
+
+		for (; idx + 4 <= pixelCount; idx += 4)
+		{
+			__m256 color0 = _mm256_loadu_ps(src + idx * 4);
+			__m256 color1 = _mm256_loadu_ps(src + idx * 4 + 8);
+			__m256 opacity0 = _mm256_loadu_ps(alphaSrc + idx * 4);
+			__m256 opacity1 = _mm256_loadu_ps(alphaSrc + idx * 4 + 8);
+
+			_mm256_storeu_ps(dst + idx * 4, _mm256_blend_ps(color0, _mm256_shuffle_ps(opacity0, opacity0, 0), 0x88));
+			_mm256_storeu_ps(dst + idx * 4 + 8, _mm256_blend_ps(color1, _mm256_shuffle_ps(opacity1, opacity1, 0), 0x88));
+		}
+
+		CopyRGBAScalar(src, alphaSrc, dst, idx, pixelCount);
+	}
+
+	// SSE2 is always available on x64
+	void CopyRGBASSE2(const float* src, const float* alphaSrc, float* dst, size_t pixelCount)
+	{
+		const __m128 alphaMask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+
+		for (size_t idx = 0; idx < pixelCount; ++idx)
+		{
+			__m128 color = _mm_loadu_ps(src + idx * 4);
+			__m128 opacity = _mm_loadu_ps(alphaSrc + idx * 4);
+			__m128 alpha = _mm_shuffle_ps(opacity, opacity, 0);
+
+			_mm_storeu_ps(dst + idx * 4, _mm_or_ps(_mm_andnot_ps(alphaMask, color), _mm_and_ps(alphaMask, alpha)));
+		}
+	}
+
+	void UInt8ToFloatSSE2(const uint8_t* src, float* dst, size_t count)
+	{
+		const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+		const __m128i zero = _mm_setzero_si128();
+
+		size_t idx = 0;
+
+		for (; idx + 16 <= count; idx += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + idx));
+			__m128i low = _mm_unpacklo_epi8(bytes, zero);
+			__m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+			_mm_storeu_ps(dst + idx, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+			_mm_storeu_ps(dst + idx + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+			_mm_storeu_ps(dst + idx + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+			_mm_storeu_ps(dst + idx + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+		}
+
+		UInt8ToFloatScalar(src, dst, idx, count, 1, false);
+	}
+
+	// Every 16 source bytes are packed into 12 bytes, four of them make exactly three 16 byte stores
+	TARGET_SSSE3 void DropAlphaSSSE3(const unsigned char* src, unsigned char* dst, size_t pixelCount, size_t componentSize)
+	{
+		__m128i mask;
+
+		if (componentSize == 1)
+			mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+		else if (componentSize == 2)
+			mask = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -1, -1, -1, -1);
+		else
+			mask = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, -1, -1, -1, -1);
+
+		size_t pixelsPerBlock = 64 / (componentSize * 4);
+		size_t idx = 0;
+
+		for (; idx + pixelsPerBlock <= pixelCount; idx += pixelsPerBlock)
+		{
+			const __m128i* in = reinterpret_cast<const __m128i*>(src + idx * componentSize * 4);
+			__m128i* out = reinterpret_cast<__m128i*>(dst + idx * componentSize * 3);
+
+			__m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128(in + 0), mask);
+			__m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), mask);
+			__m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), mask);
+			__m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), mask);
+
+			_mm_storeu_si128(out + 0, _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+			_mm_storeu_si128(out + 1, _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+			_mm_storeu_si128(out + 2, _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+		}
+
+		DropAlphaScalar(src + idx * componentSize * 4, dst + idx * componentSize * 3, pixelCount - idx, componentSize);
+	}
+#endif
+}
+
+float HalfToFloat(uint16_t value)
+{
+	uint32_t sign = uint32_t(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+	uint32_t bits;
+
+	if (exponent == 0x1f)
+	{
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else if (mantissa != 0)
+	{
+		// normalize denormal
+		exponent = 113;
+		while ((mantissa & 0x400) == 0)
+		{
+			mantissa <<= 1;
+			--exponent;
+		}
+
+		bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+	}
+	else
+	{
+		bits = sign;
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t absBits = bits & 0x7fffffff;
+
+	if (absBits >= 0x7f800000) // inf or nan
+		return uint16_t(sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0));
+
+	if (absBits >= 0x477ff000) // overflows half range after rounding
+		return uint16_t(sign | 0x7c00);
+
+	if (absBits < 0x38800000) // half denormal or zero
+	{
+		if (absBits < 0x33000000)
+			return uint16_t(sign);
+
+		uint32_t mantissa = (absBits & 0x007fffff) | 0x00800000;
+		uint32_t shift = 126 - (absBits >> 23);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			++half;
+
+		return uint16_t(sign | half);
+	}
+
+	uint32_t half = ((absBits - 0x38000000) >> 13);
+	uint32_t rest = absBits & 0x1fff;
+
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		++half;
+
+	return uint16_t(sign | half);
+}
+
+void HalfToFloat(const uint16_t* src, float* dst, size_t count)
+{
+#ifdef PIXEL_CONVERSION_X86
+	if (Cpu().avx2)
+	{
+		HalfToFloatAVX2(src, dst, count);
+		return;
+	}
+#endif
+
+	HalfToFloatScalar(src, dst, count);
+}
+
+void FloatToHalf(const float* src, uint16_t* dst, size_t count)
+{
+#ifdef PIXEL_CONVERSION_X86
+	if (Cpu().avx2)
+	{
+		FloatToHalfAVX2(src, dst, count);
+		return;
+	}
+#endif
+
+	FloatToHalfScalar(src, dst, count);
+}
+
+void UInt8ToFloat(const uint8_t* src, float* dst, size_t count, unsigned int channels, bool srgbDecode)
+{
+#ifdef PIXEL_CONVERSION_X86
+	if (Cpu().avx2)
+	{
+		UInt8ToFloatAVX2(src, dst, count, channels, srgbDecode);
+		return;
+	}
+
+	if (!srgbDecode)
+	{
+		UInt8ToFloatSSE2(src, dst, count);
+		return;
+	}
+#endif
+
+	UInt8ToFloatScalar(src, dst, 0, count, channels, srgbDecode);
+}
+
+void DropAlpha(const void* src, void* dst, size_t pixelCount, size_t componentSize)
+{
+	const unsigned char* srcBytes = static_cast<const unsigned char*>(src);
+	unsigned char* dstBytes = static_cast<unsigned char*>(dst);
+
+#ifdef PIXEL_CONVERSION_X86
+	if (Cpu().ssse3 && (componentSize == 1 || componentSize == 2 || componentSize == 4))
+	{
+		DropAlphaSSSE3(srcBytes, dstBytes, pixelCount, componentSize);
+		return;
+	}
+#endif
+
+	DropAlphaScalar(srcBytes, dstBytes, pixelCount, componentSize);
+}
+
+void CopyRGBA(const float* src, const float* alphaSrc, float* dst, size_t pixelCount)
+{
+	if (alphaSrc == nullptr)
+	{
+		if (src != dst)
+			memcpy(dst, src, pixelCount * 4 * sizeof(float));
+
+		return;
+	}
+
+#ifdef PIXEL_CONVERSION_X86
+	if (Cpu().avx2)
+	{
+		CopyRGBAAVX2(src, alphaSrc, dst, pixelCount);
+		return;
+	}
+
+	CopyRGBASSE2(src, alphaSrc, dst, pixelCount);
+#else
+	CopyRGBAScalar(src, alphaSrc, dst, 0, pixelCount);
+#endif
+}
+
+bool IsSupported(InstructionSet instructionSet)
+{
+	switch (instructionSet)
+	{
+	case InstructionSetScalar:
+		return true;
+
+#ifdef PIXEL_CONVERSION_X86
+	case InstructionSetSSE2:
+		return true;
+
+	case InstructionSetAVX2:
+		return Cpu().avx2;
+#endif
+
+	default:
+		return false;
+	}
+}
+
+bool CopyRGBA(const float* src, const float* alphaSrc, float* dst, size_t pixelCount, InstructionSet instructionSet)
+{
+	if (!IsSupported(instructionSet))
+		return false;
+
+	switch (instructionSet)
+	{
+#ifdef PIXEL_CONVERSION_X86
+	case InstructionSetSSE2:
+		CopyRGBASSE2(src, alphaSrc, dst, pixelCount);
+		break;
+
+	case InstructionSetAVX2:
+		CopyRGBAAVX2(src, alphaSrc, dst, pixelCount);
+		break;
+#endif
+
+	default:
+		CopyRGBAScalar(src, alphaSrc, dst, 0, pixelCount);
+		break;
+	}
+
+	return true;
+}
+
+bool UInt8ToFloat(const uint8_t* src, float* dst, size_t count, unsigned int channels, bool srgbDecode, InstructionSet instructionSet)
+{
+	if (!IsSupported(instructionSet))
+		return false;
+
+	switch (instructionSet)
+	{
+#ifdef PIXEL_CONVERSION_X86
+	case InstructionSetSSE2:
+		// there is no gather in SSE2, sRGB decode is done by the scalar table lookup
+		if (srgbDecode)
+			UInt8ToFloatScalar(src, dst, 0, count, channels, srgbDecode);
+		else
+			UInt8ToFloatSSE2(src, dst, count);
+		break;
+
+	case InstructionSetAVX2:
+		UInt8ToFloatAVX2(src, dst, count, channels, srgbDecode);
+		break;
+#endif
+
+	default:
+		UInt8ToFloatScalar(src, dst, 0, count, channels, srgbDecode);
+		break;
+	}
+
+	return true;
+}
+
+void FlipRows(void* data, size_t rowPitch, size_t rowCount)
+{
+	if (rowCount < 2)
+		return;
+
+	unsigned char* bytes = static_cast<unsigned char*>(data);
+	std::vector<unsigned char> tempRow(rowPitch);
+
+	for (size_t top = 0, bottom = rowCount - 1; top < bottom; ++top, --bottom)
+	{
+		unsigned char* topRow = bytes + top * rowPitch;
+		unsigned char* bottomRow = bytes + bottom * rowPitch;
+
+		memcpy(tempRow.data(), topRow, rowPitch);
+		memcpy(topRow, bottomRow, rowPitch);
+		memcpy(bottomRow, tempRow.data(), rowPitch);
+	}
+}
+
+}
+
+}
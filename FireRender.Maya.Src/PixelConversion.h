@@ -0,0 +1,67 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FireMaya
+{
+
+/** Pixel conversion kernels used by texture loading, frame caches and framebuffer readback.
+
+	Every kernel has a scalar implementation and x86 SIMD implementations (SSSE3, AVX2 + F16C)
+	which are selected at runtime from the CPU features, so the plugin doesn't require AVX2 to be enabled
+	at compile time. Source and destination buffers must not overlap.
+*/
+namespace PixelConversion
+{
+	enum InstructionSet
+	{
+		InstructionSetScalar,
+		InstructionSetSSE2,
+		InstructionSetAVX2,
+	};
+
+	/* True if the implementation can run on this CPU, scalar one always can */
+	bool IsSupported(InstructionSet instructionSet);
+
+	/* IEEE 754 binary16 <-> binary32, round to nearest even */
+	float HalfToFloat(uint16_t value);
+	uint16_t FloatToHalf(float value);
+
+	void HalfToFloat(const uint16_t* src, float* dst, size_t count);
+	void FloatToHalf(const float* src, uint16_t* dst, size_t count);
+
+	/* 8 bit components to [0, 1] floats. With srgbDecode color channels are converted from sRGB to linear,
+		alpha (last channel of 2 and 4 channel pixels) stays linear */
+	void UInt8ToFloat(const uint8_t* src, float* dst, size_t count, unsigned int channels, bool srgbDecode);
+
+	/* UInt8ToFloat using given implementation. Returns false if it isn't supported */
+	bool UInt8ToFloat(const uint8_t* src, float* dst, size_t count, unsigned int channels, bool srgbDecode, InstructionSet instructionSet);
+
+	/* RGBA -> RGB for pixels with components of 1, 2 (half) or 4 (float) bytes */
+	void DropAlpha(const void* src, void* dst, size_t pixelCount, size_t componentSize);
+
+	/* Copies RGBA float pixels. If alphaSrc is not null (RGBA too), alpha is replaced by its red channel,
+		that is how opacity AOV is merged into color. Unlike other kernels dst may be equal to src */
+	void CopyRGBA(const float* src, const float* alphaSrc, float* dst, size_t pixelCount);
+
+	/* CopyRGBA with alpha source using given implementation, so they can be compared in tests. Returns false if it isn't supported */
+	bool CopyRGBA(const float* src, const float* alphaSrc, float* dst, size_t pixelCount, InstructionSet instructionSet);
+
+	/* Reverses order of rows in place */
+	void FlipRows(void* data, size_t rowPitch, size_t rowCount);
+}
+
+}
@@ -44,6 +44,16 @@ public:
 		return *this;
 	}
 
+	bool operator==(const RenderRegion& other) const
+	{
+		return left == other.left && right == other.right && top == other.top && bottom == other.bottom;
+	}
+
+	bool operator!=(const RenderRegion& other) const
+	{
+		return !(*this == other);
+	}
+
 	// Get the region width.
 	unsigned int getWidth() const
 	{
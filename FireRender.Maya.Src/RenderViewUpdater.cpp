@@ -1,6 +1,22 @@
 #include "RenderViewUpdater.h"
+#include "ParallelUtils.h"
+
+#include <cstring>
+
+namespace
+{
+	// small enough to skip unchanged areas, big enough to keep number of updatePixels calls low
+	const unsigned int TileSize = 64;
+}
 
 std::vector<RV_PIXEL> RenderViewUpdater::m_pixelData;
+std::vector<RV_PIXEL> RenderViewUpdater::m_tileData;
+std::vector<char> RenderViewUpdater::m_dirtyTiles;
+
+bool RenderViewUpdater::m_isValid = false;
+unsigned int RenderViewUpdater::m_validWidth = 0;
+unsigned int RenderViewUpdater::m_validHeight = 0;
+RenderRegion RenderViewUpdater::m_validRegion;
 
 void RenderViewUpdater::EnsureBufferIsAllocated(unsigned int width, unsigned int height)
 {
@@ -10,31 +26,34 @@ void RenderViewUpdater::EnsureBufferIsAllocated(unsigned int width, unsigned int
 	}
 }
 
-void RenderViewUpdater::FlipAndCopyData(
-	RV_PIXEL* inputPixelData, 
+unsigned int RenderViewUpdater::GetSourceRowOffset(
+	unsigned int y,
 	unsigned int srcWidth,
 	unsigned int srcHeight,
 	const RenderRegion& region)
 {
-	//unsigned int dstOffset = 0;
-	unsigned int srcOffset = 0;
+	// Case: region is subarea of bigger buffer
+	if (srcHeight > region.getHeight())
+	{
+		return (y + srcHeight - region.top - 1) * srcWidth + region.left;
+	}
+
+	// Case: region is the whole buffer
+	return y * srcWidth;
+}
 
+void RenderViewUpdater::FlipAndCopyData(
+	const RV_PIXEL* inputPixelData, 
+	unsigned int srcWidth,
+	unsigned int srcHeight,
+	const RenderRegion& region)
+{
 	unsigned int dstWidth = region.getWidth();
 	unsigned int dstHeight = region.getHeight();
 
 	for (unsigned int y = 0; y < dstHeight; ++y)
 	{
-		//dstOffset = y * dstWidth;
-		// Case: region is subarea of bigger buffer
-		if (srcHeight > dstHeight)
-		{
-			srcOffset = (y + srcHeight - region.top - 1) * srcWidth + region.left;
-		}
-		// Case: region is the whole buffer
-		else
-		{
-			srcOffset = y * srcWidth;
-		}
+		unsigned int srcOffset = GetSourceRowOffset(y, srcWidth, srcHeight, region);
 
 		std::copy(&inputPixelData[srcOffset], &inputPixelData[srcOffset + dstWidth], &m_pixelData[(dstHeight - y - 1) * dstWidth]);
 	}
@@ -58,4 +77,177 @@ void RenderViewUpdater::UpdateAndRefreshRegion(
 
 	// Refresh the render view.
 	MRenderView::refresh(region.left, region.right, region.bottom, region.top);
+
+	m_isValid = true;
+	m_validWidth = srcWidth;
+	m_validHeight = srcHeight;
+	m_validRegion = region;
+}
+
+void RenderViewUpdater::Invalidate()
+{
+	m_isValid = false;
+}
+
+void RenderViewUpdater::UploadRect(unsigned int x0, unsigned int x1, unsigned int y0, unsigned int y1, const RenderRegion& region)
+{
+	unsigned int dstWidth = region.getWidth();
+	unsigned int rectWidth = x1 - x0;
+
+	RV_PIXEL* pixels = nullptr;
+
+	// full width rows are contiguous in the flipped copy
+	if (rectWidth == dstWidth)
+	{
+		pixels = &m_pixelData[y0 * dstWidth];
+	}
+	else
+	{
+		m_tileData.resize(rectWidth * (y1 - y0));
+
+		for (unsigned int y = y0; y < y1; ++y)
+		{
+			memcpy(&m_tileData[(y - y0) * rectWidth], &m_pixelData[y * dstWidth + x0], rectWidth * sizeof(RV_PIXEL));
+		}
+
+		pixels = m_tileData.data();
+	}
+
+	MRenderView::updatePixels(
+		region.left + x0, region.left + x1 - 1,
+		region.bottom + y0, region.bottom + y1 - 1,
+		pixels, true);
+}
+
+size_t RenderViewUpdater::UpdateAndRefreshChangedTiles(
+	const RV_PIXEL* pixelData,
+	unsigned int srcWidth,
+	unsigned int srcHeight,
+	const RenderRegion& region)
+{
+	unsigned int dstWidth = region.getWidth();
+	unsigned int dstHeight = region.getHeight();
+	unsigned int tilesX = (dstWidth + TileSize - 1) / TileSize;
+	unsigned int tilesY = (dstHeight + TileSize - 1) / TileSize;
+
+	if (!m_isValid || (m_validWidth != srcWidth) || (m_validHeight != srcHeight) || (m_validRegion != region))
+	{
+		UpdateAndRefreshRegion(const_cast<RV_PIXEL*>(pixelData), srcWidth, srcHeight, region);
+		return tilesX * tilesY;
+	}
+
+	m_dirtyTiles.assign(tilesX * tilesY, 0);
+
+	// Copy changed rows into the flipped copy and mark their tiles, tile rows don't overlap so they run in parallel.
+	// Rows of the copy go bottom up as render view expects
+	FireMaya::WorkerPool::Instance().ParallelFor(tilesY, [&](size_t ty)
+	{
+		unsigned int y0 = static_cast<unsigned int>(ty) * TileSize;
+		unsigned int y1 = (y0 + TileSize < dstHeight) ? y0 + TileSize : dstHeight;
+		char* dirty = &m_dirtyTiles[ty * tilesX];
+
+		for (unsigned int y = y0; y < y1; ++y)
+		{
+			const RV_PIXEL* src = pixelData + GetSourceRowOffset(dstHeight - y - 1, srcWidth, srcHeight, region);
+			RV_PIXEL* dst = &m_pixelData[y * dstWidth];
+
+			for (unsigned int tx = 0; tx < tilesX; ++tx)
+			{
+				unsigned int x0 = tx * TileSize;
+				size_t bytes = ((x0 + TileSize < dstWidth) ? TileSize : dstWidth - x0) * sizeof(RV_PIXEL);
+
+				if (memcmp(src + x0, dst + x0, bytes) != 0)
+				{
+					memcpy(dst + x0, src + x0, bytes);
+					dirty[tx] = 1;
+				}
+			}
+		}
+	});
+
+	size_t uploaded = 0;
+
+	// bounding box of uploaded rects for refresh
+	unsigned int minX = dstWidth, maxX = 0, minY = dstHeight, maxY = 0;
+
+	// consecutive fully changed tile rows are uploaded at once
+	unsigned int runY0 = 0, runY1 = 0;
+
+	auto addToBounds = [&](unsigned int x0, unsigned int x1, unsigned int y0, unsigned int y1)
+	{
+		minX = (x0 < minX) ? x0 : minX;
+		maxX = (x1 > maxX) ? x1 : maxX;
+		minY = (y0 < minY) ? y0 : minY;
+		maxY = (y1 > maxY) ? y1 : maxY;
+	};
+
+	auto flushRun = [&]()
+	{
+		if (runY1 > runY0)
+		{
+			UploadRect(0, dstWidth, runY0, runY1, region);
+			addToBounds(0, dstWidth, runY0, runY1);
+		}
+
+		runY0 = runY1 = 0;
+	};
+
+	for (unsigned int ty = 0; ty < tilesY; ++ty)
+	{
+		const char* dirty = &m_dirtyTiles[ty * tilesX];
+		unsigned int y0 = ty * TileSize;
+		unsigned int y1 = (y0 + TileSize < dstHeight) ? y0 + TileSize : dstHeight;
+
+		unsigned int dirtyCount = 0;
+		for (unsigned int tx = 0; tx < tilesX; ++tx)
+		{
+			dirtyCount += dirty[tx] ? 1 : 0;
+		}
+
+		uploaded += dirtyCount;
+
+		if (dirtyCount == tilesX)
+		{
+			if (runY1 == runY0)
+			{
+				runY0 = y0;
+			}
+
+			runY1 = y1;
+			continue;
+		}
+
+		flushRun();
+
+		// upload spans of neighbour changed tiles
+		for (unsigned int tx = 0; tx < tilesX; )
+		{
+			if (!dirty[tx])
+			{
+				++tx;
+				continue;
+			}
+
+			unsigned int spanBegin = tx;
+			while (tx < tilesX && dirty[tx])
+			{
+				++tx;
+			}
+
+			unsigned int x0 = spanBegin * TileSize;
+			unsigned int x1 = (tx * TileSize < dstWidth) ? tx * TileSize : dstWidth;
+
+			UploadRect(x0, x1, y0, y1, region);
+			addToBounds(x0, x1, y0, y1);
+		}
+	}
+
+	flushRun();
+
+	if (uploaded > 0)
+	{
+		MRenderView::refresh(region.left + minX, region.left + maxX - 1, region.bottom + minY, region.bottom + maxY - 1);
+	}
+
+	return uploaded;
 }
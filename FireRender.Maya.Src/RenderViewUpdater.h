@@ -14,15 +14,41 @@ public:
 		unsigned int srcHeight,
 		const RenderRegion& region);
 
+	// Compares region with the previous upload tile by tile and sends only changed tiles to the render view.
+	// Falls back to UpdateAndRefreshRegion if region or size changed. Returns number of uploaded tiles
+	static size_t UpdateAndRefreshChangedTiles(
+		const RV_PIXEL* pixelData,
+		unsigned int srcWidth,
+		unsigned int srcHeight,
+		const RenderRegion& region);
+
+	// Next UpdateAndRefreshChangedTiles uploads whole region (e.g. render view was cleared)
+	static void Invalidate();
+
 private:
 	static void EnsureBufferIsAllocated(unsigned int width, unsigned int height);
 	static void FlipAndCopyData(
-		RV_PIXEL* inputPixelData,
+		const RV_PIXEL* inputPixelData,
+		unsigned int srcWidth,
+		unsigned int srcHeight,
+		const RenderRegion& region);
+
+	static unsigned int GetSourceRowOffset(
+		unsigned int y,
 		unsigned int srcWidth,
 		unsigned int srcHeight,
 		const RenderRegion& region);
 
+	static void UploadRect(unsigned int x0, unsigned int x1, unsigned int y0, unsigned int y1, const RenderRegion& region);
+
 private:
+	// flipped copy of the last upload, used to find changed tiles
 	static std::vector<RV_PIXEL> m_pixelData;
-};
+	static std::vector<RV_PIXEL> m_tileData;
+	static std::vector<char> m_dirtyTiles;
 
+	static bool m_isValid;
+	static unsigned int m_validWidth;
+	static unsigned int m_validHeight;
+	static RenderRegion m_validRegion;
+};
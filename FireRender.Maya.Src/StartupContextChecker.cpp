@@ -11,70 +11,295 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ********************************************************************/
 #include "StartupContextChecker.h"
+#include "FireRenderThread.h"
+#include "common.h"
 
-bool StartupContextChecker::m_IsMachineLearningDenoiserSupportedOnCPU = false;
-bool StartupContextChecker::m_IsRprSupported = false;
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+using namespace FireMaya;
+
+namespace fs = std::filesystem;
+
+StartupContextChecker::ProbeResult StartupContextChecker::m_Result;
+std::shared_future<void> StartupContextChecker::m_RprChecked;
+std::future<void> StartupContextChecker::m_Probe;
 bool StartupContextChecker::m_WasCheckedBeforeUsage = false;
+bool StartupContextChecker::m_WereErrorsReported = false;
+
+namespace
+{
+	const char* ProbeCacheFileName = "startupProbe.txt";
+
+	// Items posted for the main thread by the probe are executed while main thread waits for it
+	template <class Future>
+	void WaitOnMainThread(const Future& future)
+	{
+		while (future.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready)
+		{
+			FireRenderThread::RunItemsQueuedForTheMainThread();
+		}
+	}
+}
 
 void StartupContextChecker::CheckContexts()
 {
 	m_WasCheckedBeforeUsage = true;
 
+	// Maya API can be used on the main thread only
+	auto createFlags = FireMaya::Options::GetContextDeviceFlags();
+
+	std::string cacheKey = GetCacheKey(createFlags);
+	std::string cachePath = GetCacheFilePath();
+
+	if (ReadCache(cachePath, cacheKey, m_Result))
+	{
+		LogPrint("RPR startup check: result is taken from %s", cachePath.c_str());
+		return;
+	}
+
+	std::string mlModelsFolder;
+#ifdef WIN32
+	MString path;
+	MStatus status = MGlobal::executeCommand("getModulePath -moduleName RadeonProRender", path);
+	mlModelsFolder = (path + "/data/models").asChar();
+#endif
+
+	auto rprChecked = std::make_shared<std::promise<void>>();
+	m_RprChecked = rprChecked->get_future().share();
+
+	m_Probe = std::async(std::launch::async, [createFlags, mlModelsFolder, cacheKey, cachePath, rprChecked]()
+	{
+		try
+		{
+			RunProbe(createFlags, mlModelsFolder, *rprChecked);
+		}
+		catch (...)
+		{
+			if (!m_Result.isRprSupported)
+			{
+				m_Result.rprError = RPR_ERROR_INTERNAL_ERROR;
+			}
+
+			// main thread should not wait forever, promise is already satisfied if context was created
+			try
+			{
+				rprChecked->set_value();
+			}
+			catch (const std::future_error&)
+			{
+			}
+
+			throw;
+		}
+
+		// failed check is stored too, it would fail the same way until devices, drivers or plugin are changed
+		WriteCache(cachePath, cacheKey, m_Result);
+	});
+}
+
+void StartupContextChecker::RunProbe(int createFlags, const std::string& mlModelsFolder, std::promise<void>& rprChecked)
+{
 	//Check rpr context
-	rpr_int res;
+	rpr_int res = RPR_SUCCESS;
 	NorthStarContext rprContext;
 	try
 	{
-		auto createFlags = FireMaya::Options::GetContextDeviceFlags();
 		rprContext.createContextEtc(createFlags, true, &res);
 	}
 	catch (const FireRenderException & e)
 	{
-		FireRenderError(e.code, e.message, true);
+		m_Result.rprError = e.code;
+		m_Result.rprErrorMessage = e.message;
+		rprChecked.set_value();
 		return;
 	}
 
 	if (res != RPR_SUCCESS)
 	{
-		MString msg;
+		m_Result.rprError = res;
 		if (res == RPR_ERROR_INVALID_API_VERSION)
 		{
-			msg = "Please remove all previous versions of plugin if any and make a fresh install";
+			m_Result.rprErrorMessage = "Please remove all previous versions of plugin if any and make a fresh install";
 		}
-		FireRenderError(res, msg, true);
+		rprChecked.set_value();
 		return;
 	}
-	m_IsRprSupported = true;
+
+	m_Result.isRprSupported = true;
+	rprChecked.set_value();
 
 	//Check rif context
 #ifdef WIN32
 	try
 	{
-		auto rifContext = std::make_unique<RifContextCPU>(rprContext.context());
-		std::unique_ptr<RifFilterWrapper> mRifFilter;
-		MString path;
-		MStatus status = MGlobal::executeCommand("getModulePath -moduleName RadeonProRender", path);
-		MString mlModelsFolder = path + "/data/models";
-		auto filter = std::make_unique<RifFilterMlColorOnly>(rifContext.get(), 512, 512, mlModelsFolder.asChar(), true);
+		FireRenderThread::RunOnceProcAndWait([&]()
+		{
+			auto rifContext = std::make_unique<RifContextCPU>(rprContext.context());
+			auto filter = std::make_unique<RifFilterMlColorOnly>(rifContext.get(), 512, 512, mlModelsFolder, true);
+		});
 	}
 	catch (const std::runtime_error & e)
 	{
-		MGlobal::displayWarning(e.what());
+		m_Result.mlDenoiserError = e.what();
 		return;
 	}
 #endif
 
-	m_IsMachineLearningDenoiserSupportedOnCPU = true;
+	m_Result.isMLDenoiserSupportedCPU = true;
+}
+
+void StartupContextChecker::WaitForRprCheck()
+{
+	if (m_RprChecked.valid())
+	{
+		WaitOnMainThread(m_RprChecked);
+	}
+
+	if (!m_Result.isRprSupported && !m_WereErrorsReported)
+	{
+		m_WereErrorsReported = true;
+		FireRenderError(m_Result.rprError, m_Result.rprErrorMessage, true);
+	}
+}
+
+void StartupContextChecker::WaitForProbe()
+{
+	if (m_Probe.valid())
+	{
+		WaitOnMainThread(m_Probe);
+
+		try
+		{
+			m_Probe.get();
+		}
+		catch (...)
+		{
+			DebugPrint("Unknown error running RPR startup check");
+		}
+
+		if (!m_Result.mlDenoiserError.empty())
+		{
+			MGlobal::displayWarning(m_Result.mlDenoiserError.c_str());
+		}
+	}
+}
+
+std::string StartupContextChecker::GetCacheKey(int createFlags)
+{
+	std::ostringstream key;
+
+	key << PLUGIN_VERSION << ';';
+#ifdef RPR_VERSION_MAJOR_MINOR_REVISION
+	key << std::hex << RPR_VERSION_MAJOR_MINOR_REVISION << std::dec << ';';
+#else
+	key << std::hex << RPR_API_VERSION << std::dec << ';';
+#endif
+	key << createFlags;
+
+	for (const HardwareResources::Device& device : HardwareResources::GetAllDevices())
+	{
+		key << ';' << device.name << ',' << device.creationFlag << ',' << int(device.compatibility) << ',' << device.isDriverCompatible;
+	}
+
+	return key.str();
+}
+
+std::string StartupContextChecker::GetCacheFilePath()
+{
+	MString folder = MGlobal::executeCommandStringResult("internalVar -userAppDir");
+	if (folder.length() == 0)
+		return std::string();
+
+	return (fs::u8path((folder + "RadeonProRender").asUTF8()) / ProbeCacheFileName).u8string();
+}
+
+bool StartupContextChecker::ReadCache(const std::string& path, const std::string& key, ProbeResult& result)
+{
+	if (path.empty() || std::getenv("RPR_MAYA_DISABLE_STARTUP_CACHE"))
+		return false;
+
+	std::ifstream stream(fs::u8path(path));
+	if (!stream)
+		return false;
+
+	std::string storedKey;
+	int rprSupported = 0;
+	int mlDenoiserSupportedCPU = 0;
+	rpr_int rprError = RPR_SUCCESS;
+	std::string rprErrorMessage;
+
+	if (!std::getline(stream, storedKey) || (storedKey != key) || !(stream >> rprSupported >> mlDenoiserSupportedCPU >> rprError))
+		return false;
+
+	// rest of the line after a separating space
+	stream.get();
+	std::getline(stream, rprErrorMessage);
+
+	result.isRprSupported = rprSupported != 0;
+	result.isMLDenoiserSupportedCPU = mlDenoiserSupportedCPU != 0;
+	result.rprError = rprError;
+	result.rprErrorMessage = MString(rprErrorMessage.c_str());
+
+	return true;
+}
+
+void StartupContextChecker::WriteCache(const std::string& path, const std::string& key, const ProbeResult& result)
+{
+	if (path.empty())
+		return;
+
+	std::error_code error;
+	fs::create_directories(fs::u8path(path).parent_path(), error);
+
+	// write to the temporary file first so other Maya instances never read partially written file
+	std::string tempPath = path + ".tmp";
+
+	{
+		std::ofstream stream(fs::u8path(tempPath), std::ios::trunc);
+		if (!stream)
+			return;
+
+		std::string rprErrorMessage = result.rprErrorMessage.asChar();
+		std::replace(rprErrorMessage.begin(), rprErrorMessage.end(), '\n', ' ');
+
+		stream << key << '\n' << int(result.isRprSupported) << ' ' << int(result.isMLDenoiserSupportedCPU) << ' ' << result.rprError << ' ' << rprErrorMessage << '\n';
+
+		if (!stream)
+		{
+			stream.close();
+			fs::remove(fs::u8path(tempPath), error);
+			return;
+		}
+	}
+
+	fs::rename(fs::u8path(tempPath), fs::u8path(path), error);
+
+	if (error)
+	{
+		fs::remove(fs::u8path(tempPath), error);
+	}
 }
 
 bool StartupContextChecker::IsRprSupported()
 {
 	assert(m_WasCheckedBeforeUsage);
-	return m_IsRprSupported;
+	WaitForRprCheck();
+	return m_Result.isRprSupported;
+}
+
+bool StartupContextChecker::IsFinished()
+{
+	return !m_Probe.valid() || (m_Probe.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
 }
 
 bool StartupContextChecker::IsMLDenoiserSupportedCPU()
 {
 	assert(m_WasCheckedBeforeUsage);
-	return m_IsMachineLearningDenoiserSupportedOnCPU;
+	WaitForRprCheck();
+	WaitForProbe();
+	return m_Result.isMLDenoiserSupportedCPU;
 }
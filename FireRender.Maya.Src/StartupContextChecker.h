@@ -14,18 +14,53 @@ limitations under the License.
 #include "Context/TahoeContext.h"
 #include <ImageFilter/ImageFilter.h>
 
+#include <future>
+#include <string>
+
 /** 
 	Used to check compatibility with RPR functions.
 	CheckContexts() should be called before accesing other methods.
 	Assuming that if any GPU has support for RPR context -> it has support for ML denoiser.
+
+	Contexts are created on a worker thread, Is*Supported() methods wait for the part of the check they need.
+	Plugin load doesn't wait for the RPR context check, it is waited for by the first scene build.
+	Result is stored in the probe cache file keyed by plugin version, core version and device list (with driver
+	compatibility), so next launches with the same setup do not create contexts at all. Failed check is stored too,
+	its error is reported from the cache; RPR_MAYA_DISABLE_STARTUP_CACHE environment variable forces a new check.
 */
 class StartupContextChecker
 {
-	static bool m_IsRprSupported;
-	static bool m_IsMachineLearningDenoiserSupportedOnCPU;
+	struct ProbeResult
+	{
+		bool isRprSupported = false;
+		bool isMLDenoiserSupportedCPU = false;
+
+		// errors are reported on the main thread
+		rpr_int rprError = RPR_SUCCESS;
+		MString rprErrorMessage;
+		std::string mlDenoiserError;
+	};
+
+	static ProbeResult m_Result;
+	static std::shared_future<void> m_RprChecked;	// not valid if result was read from the cache
+	static std::future<void> m_Probe;
 	static bool m_WasCheckedBeforeUsage;
+	static bool m_WereErrorsReported;
+
+	static void RunProbe(int createFlags, const std::string& mlModelsFolder, std::promise<void>& rprChecked);
+	static void WaitForRprCheck();
+	static void WaitForProbe();
+
+	static std::string GetCacheKey(int createFlags);
+	static std::string GetCacheFilePath();
+	static bool ReadCache(const std::string& path, const std::string& key, ProbeResult& result);
+	static void WriteCache(const std::string& path, const std::string& key, const ProbeResult& result);
+
 public:
 	static void CheckContexts();
 	static bool IsRprSupported();
 	static bool IsMLDenoiserSupportedCPU();
+
+	// true if the check is finished, so Is*Supported() methods don't wait
+	static bool IsFinished();
 };
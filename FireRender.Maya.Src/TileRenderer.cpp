@@ -15,6 +15,86 @@ limitations under the License.
 #include "Context/FireRenderContext.h"
 #include "Math/float2.h"
 
+#include <algorithm>
+#include <cmath>
+
+TileQueue::TileQueue(const TileRenderInfo& info) :
+	m_next(0),
+	m_finished(0)
+{
+	float tilesXf = info.totalWidth / (float)info.tileSizeX;
+	float tilesYf = info.totalHeight / (float)info.tileSizeY;
+
+	m_xTiles = (int) std::ceil(tilesXf);
+	m_yTiles = (int) std::ceil(tilesYf);
+
+	m_tiles.reserve(m_xTiles * m_yTiles);
+
+	int row = 0;
+	for (int yTile = m_yTiles - 1; yTile >= 0; yTile--, row++)
+	{
+		for (int xTile = 0; xTile < m_xTiles; xTile++)
+		{
+			bool reversed = (info.tilesFillType == TileRenderFillType::Snake) && (row % 2 == 1);
+			m_tiles.push_back({ reversed ? m_xTiles - xTile - 1 : xTile, yTile });
+		}
+	}
+
+	if (info.tilesFillType == TileRenderFillType::Spiral)
+	{
+		// rings of tiles around the center, each ring is walked by angle
+		float centerX = 0.5f * (m_xTiles - 1);
+		float centerY = 0.5f * (m_yTiles - 1);
+
+		auto ring = [&](const TileRenderTile& tile)
+		{
+			return std::max(std::fabs(tile.xTile - centerX), std::fabs(tile.yTile - centerY));
+		};
+
+		auto angle = [&](const TileRenderTile& tile)
+		{
+			return std::atan2(tile.yTile - centerY, tile.xTile - centerX);
+		};
+
+		std::stable_sort(m_tiles.begin(), m_tiles.end(), [&](const TileRenderTile& a, const TileRenderTile& b)
+		{
+			float ringA = ring(a);
+			float ringB = ring(b);
+
+			if (ringA != ringB)
+				return ringA < ringB;
+
+			return angle(a) < angle(b);
+		});
+	}
+}
+
+bool TileQueue::Take(TileRenderTile& tile)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_next >= m_tiles.size())
+		return false;
+
+	tile = m_tiles[m_next++];
+	return true;
+}
+
+int TileQueue::Finish()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	++m_finished;
+	return m_tiles.empty() ? 100 : int(100 * m_finished / m_tiles.size());
+}
+
+void TileQueue::Cancel()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_next = m_tiles.size();
+}
+
 TileRenderer::TileRenderer()
 {
 }
@@ -25,11 +105,15 @@ TileRenderer::~TileRenderer()
 
 void TileRenderer::Render(FireRenderContext& renderContext, const TileRenderInfo& info, AOVPixelBuffers& outBuffer, TileRenderingCallback callbackFunc)
 {
-	float tilesXf = info.totalWidth / (float)info.tileSizeX;
-	float tilesYf = info.totalHeight / (float)info.tileSizeY;
+	TileQueue queue(info);
 
-	int xTiles = (int) std::ceil(tilesXf);
-	int yTiles = (int) std::ceil(tilesYf);
+	Render(renderContext, info, queue, outBuffer, callbackFunc);
+}
+
+void TileRenderer::Render(FireRenderContext& renderContext, const TileRenderInfo& info, TileQueue& queue, AOVPixelBuffers& outBuffer, TileRenderingCallback callbackFunc)
+{
+	int xTiles = queue.XTiles();
+	int yTiles = queue.YTiles();
 
 	FireRenderCamera& fireRenderCamera = renderContext.camera();
 	rpr_camera camera = fireRenderCamera.data().Handle();
@@ -63,63 +147,61 @@ void TileRenderer::Render(FireRenderContext& renderContext, const TileRenderInfo
 
 	FireMaya::FitType tileFitType = (FireMaya::FitType) fireRenderCamera.GetPlugValue(imagePlane, "fit", 1);
 
-	int counter = 0;
-	for (int yTile = yTiles - 1; yTile >= 0; yTile--)
+	TileRenderTile tile;
+	while (queue.Take(tile))
 	{
-		for (int xTile = 0; xTile < xTiles; xTile++)
+		int xTile = tile.xTile;
+		int yTile = tile.yTile;
+
+		RenderRegion region;
+
+		region.left = xTile * info.tileSizeX;
+		region.right = std::min(info.totalWidth, region.left + info.tileSizeX) - 1;
+
+		region.bottom = yTile * info.tileSizeY;
+		region.top = std::min(info.totalHeight, region.bottom + info.tileSizeY) - 1;
+
+		float shiftX  = (region.left + 0.5f * ((int)region.getWidth() - (int)info.totalWidth)) / region.getWidth();
+		float shiftY = (region.bottom + 0.5f * ((int)region.getHeight() - (int)info.totalHeight)) / region.getHeight();
+
+		rprCameraSetLensShift(camera, shiftX, shiftY);
+
+		if (fireRenderCamera.isDefaultPerspective())
+		{
+			rprCameraSetSensorSize(camera, sensorSize.x / ((float)info.totalWidth / region.getWidth()),
+				sensorSize.y / ((float)info.totalHeight / region.getHeight()));
+		}
+		else if (fireRenderCamera.isDefaultOrtho())
+		{
+			rprCameraSetOrthoWidth(camera, orthoSize.x / ((float)info.totalWidth / region.getWidth()));
+			rprCameraSetOrthoHeight(camera, orthoSize.y / ((float)info.totalHeight / region.getHeight()));
+		}
+		else
+		{
+			// not implemented;
+			assert(false);
+		}
+
+		// process back plate
+		int yTileIdx = yTiles - yTile - 1;
+
+		int tileWidth = region.right - region.left + 1;
+		int tileHeight = region.top - region.bottom + 1;
+
+		MString colorSpace;
+		frw::Image image = fireRenderCamera.Scope().GetTiledImage(name,
+			info.totalWidth, info.totalHeight,
+			info.tileSizeX, info.tileSizeY,
+			tileWidth, tileHeight,
+			xTiles, yTiles,
+			xTile, yTileIdx,
+			colorSpace, tileFitType);
+		fireRenderCamera.Scene().SetBackgroundImage(image);
+
+		if (!callbackFunc(region, queue.Finish(), outBuffer))
 		{
-			RenderRegion region;
-
-			region.left = xTile * info.tileSizeX;
-			region.right = std::min(info.totalWidth, region.left + info.tileSizeX) - 1;
-
-			region.bottom = yTile * info.tileSizeY;
-			region.top = std::min(info.totalHeight, region.bottom + info.tileSizeY) - 1;
-
-			float shiftX  = (region.left + 0.5f * ((int)region.getWidth() - (int)info.totalWidth)) / region.getWidth();
-			float shiftY = (region.bottom + 0.5f * ((int)region.getHeight() - (int)info.totalHeight)) / region.getHeight();
-
-			rprCameraSetLensShift(camera, shiftX, shiftY);
-
-			if (fireRenderCamera.isDefaultPerspective())
-			{
-				rprCameraSetSensorSize(camera, sensorSize.x / ((float)info.totalWidth / region.getWidth()),
-					sensorSize.y / ((float)info.totalHeight / region.getHeight()));
-			}
-			else if (fireRenderCamera.isDefaultOrtho())
-			{
-				rprCameraSetOrthoWidth(camera, orthoSize.x / ((float)info.totalWidth / region.getWidth()));
-				rprCameraSetOrthoHeight(camera, orthoSize.y / ((float)info.totalHeight / region.getHeight()));
-			}
-			else
-			{
-				// not implemented;
-				assert(false);
-			}
-
-			// process back plate
-			int yTileIdx = yTiles - yTile - 1;
-
-			int tileWidth = region.right - region.left + 1;
-			int tileHeight = region.top - region.bottom + 1;
-
-			MString colorSpace;
-			frw::Image image = fireRenderCamera.Scope().GetTiledImage(name,
-				info.totalWidth, info.totalHeight,
-				info.tileSizeX, info.tileSizeY,
-				tileWidth, tileHeight,
-				xTiles, yTiles,
-				xTile, yTileIdx,
-				colorSpace, tileFitType);
-			fireRenderCamera.Scene().SetBackgroundImage(image);
-
-			counter++;
-			if (!callbackFunc(region, 100 * counter / (xTiles * yTiles), outBuffer))
-			{
-				// to exit the loop
-				xTile = xTiles;
-				yTile = -1; 
-			}
+			// stops other renderers sharing the queue as well
+			queue.Cancel();
 		}
 	}
 
@@ -13,6 +13,8 @@ limitations under the License.
 #pragma once
 
 #include <functional>
+#include <vector>
+#include <mutex>
 
 #include "RenderRegion.h"
 #include "FireRenderAOV.h"
@@ -21,9 +23,9 @@ class FireRenderContext;
 
 enum class TileRenderFillType
 {
-	Normal = 0
-
-	// _TODO Add Different algorithms, i.e spiral etc
+	Normal = 0,	// row by row from the top
+	Snake,		// row by row, direction changes every row so consecutive tiles are always neighbours
+	Spiral		// from the center of the image outwards
 };
 
 struct TileRenderInfo
@@ -37,6 +39,42 @@ struct TileRenderInfo
 	TileRenderFillType tilesFillType;
 };
 
+struct TileRenderTile
+{
+	int xTile;
+	int yTile;	// counted from the bottom of the image
+};
+
+/** Tiles of the image in the render order.
+	Tiles are handed out one by one under the lock, so several renderers (one per render context / device)
+	can share one queue and each tile is rendered exactly once. */
+class TileQueue
+{
+public:
+	explicit TileQueue(const TileRenderInfo& info);
+
+	/* Returns false when all tiles are taken or the queue was cancelled */
+	bool Take(TileRenderTile& tile);
+
+	/* Marks one tile as finished, returns progress in percents */
+	int Finish();
+
+	void Cancel();
+
+	int XTiles() const { return m_xTiles; }
+	int YTiles() const { return m_yTiles; }
+	size_t Count() const { return m_tiles.size(); }
+
+private:
+	std::vector<TileRenderTile> m_tiles;
+	size_t m_next;
+	size_t m_finished;
+	int m_xTiles;
+	int m_yTiles;
+
+	std::mutex m_mutex;
+};
+
 typedef std::function<bool(RenderRegion&, int, AOVPixelBuffers& out)> TileRenderingCallback;
 
 class TileRenderer
@@ -46,5 +84,8 @@ public:
 	~TileRenderer();
 
 	void Render(FireRenderContext& renderContext, const TileRenderInfo& info, AOVPixelBuffers& outBuffer, TileRenderingCallback callbackFunc);
+
+	/* Renders tiles taken from the queue until it is empty, can run for several contexts sharing the queue */
+	void Render(FireRenderContext& renderContext, const TileRenderInfo& info, TileQueue& queue, AOVPixelBuffers& outBuffer, TileRenderingCallback callbackFunc);
 };
 
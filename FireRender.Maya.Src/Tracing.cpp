@@ -0,0 +1,234 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "Tracing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace FireMaya;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const uint32_t NoDetail = UINT32_MAX;
+
+	// 1M zones (32MB) per thread is several minutes of per-node zones on a heavy scene
+	const size_t MaxEventsPerThread = 1 << 20;
+	const size_t MaxDetailBytesPerThread = 16 << 20;
+
+	struct TraceEvent
+	{
+		const char* name;
+		uint32_t detailOffset;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	/** Written by the owning thread, lock is taken only by Start and Save otherwise it's uncontended */
+	struct ThreadBuffer
+	{
+		std::mutex mutex;
+		std::vector<TraceEvent> events;
+		std::string details;	// zero terminated detail strings referenced by offset
+		unsigned long long dropped = 0;
+		std::string name;
+		size_t index = 0;
+	};
+
+	// Buffers of finished threads are kept so their events still can be saved
+	std::mutex s_registryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+
+	thread_local ThreadBuffer* t_buffer = nullptr;
+
+	const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		if (t_buffer == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(s_registryMutex);
+
+			s_buffers.emplace_back(new ThreadBuffer());
+			t_buffer = s_buffers.back().get();
+			t_buffer->index = s_buffers.size();
+		}
+
+		return *t_buffer;
+	}
+
+	void WriteEscaped(std::ostream& out, const char* str)
+	{
+		for (; *str != 0; ++str)
+		{
+			unsigned char c = static_cast<unsigned char>(*str);
+
+			if (c == '"' || c == '\\')
+			{
+				out << '\\' << *str;
+			}
+			else if (c < 0x20)
+			{
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				out << buf;
+			}
+			else
+			{
+				out << *str;
+			}
+		}
+	}
+}
+
+std::atomic<bool> Trace::s_enabled(false);
+
+uint64_t Trace::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+void Trace::AddEvent(const char* name, const char* detail, uint64_t start, uint64_t end)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+
+	if (buffer.events.size() >= MaxEventsPerThread)
+	{
+		buffer.dropped++;
+		return;
+	}
+
+	uint32_t detailOffset = NoDetail;
+	if ((detail != nullptr) && (buffer.details.size() < MaxDetailBytesPerThread))
+	{
+		detailOffset = static_cast<uint32_t>(buffer.details.size());
+		buffer.details.append(detail);
+		buffer.details.push_back('\0');
+	}
+
+	buffer.events.push_back({ name, detailOffset, start, end });
+}
+
+void Trace::Start()
+{
+	std::lock_guard<std::mutex> registryLock(s_registryMutex);
+
+	for (auto& buffer : s_buffers)
+	{
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+
+		buffer->events.clear();
+		buffer->details.clear();
+		buffer->dropped = 0;
+	}
+
+	s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::Stop()
+{
+	s_enabled.store(false, std::memory_order_relaxed);
+}
+
+void Trace::SetThreadName(const char* name)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+
+	buffer.name = name;
+}
+
+bool Trace::Save(const std::string& path)
+{
+	// wide path is used on Windows, so non-ASCII folders work
+	std::ofstream out(fs::u8path(path), std::ios::out | std::ios::trunc);
+	if (!out)
+		return false;
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Maya (Radeon ProRender)\"}}";
+
+	char buf[128];
+
+	std::lock_guard<std::mutex> registryLock(s_registryMutex);
+
+	for (auto& buffer : s_buffers)
+	{
+		// copy events out so recording threads are not blocked by file writing
+		std::vector<TraceEvent> events;
+		std::string details;
+		std::string name;
+		{
+			std::lock_guard<std::mutex> lock(buffer->mutex);
+			events = buffer->events;
+			details = buffer->details;
+			name = buffer->name;
+		}
+
+		if (name.empty())
+			name = "Thread " + std::to_string(buffer->index);
+
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->index << ",\"args\":{\"name\":\"";
+		WriteEscaped(out, name.c_str());
+		out << "\"}}";
+
+		for (const TraceEvent& event : events)
+		{
+			out << ",\n{\"name\":\"";
+			WriteEscaped(out, event.name);
+
+			// timestamps are in microseconds
+			snprintf(buf, sizeof(buf), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f",
+				buffer->index, event.start / 1000.0, (event.end - event.start) / 1000.0);
+			out << buf;
+
+			if (event.detailOffset != NoDetail)
+			{
+				out << ",\"args\":{\"detail\":\"";
+				WriteEscaped(out, details.c_str() + event.detailOffset);
+				out << "\"}";
+			}
+
+			out << "}";
+		}
+	}
+
+	out << "\n]}\n";
+
+	return out.good();
+}
+
+Trace::Statistics Trace::GetStatistics()
+{
+	Statistics stats;
+	stats.enabled = IsEnabled();
+
+	std::lock_guard<std::mutex> registryLock(s_registryMutex);
+	stats.threads = s_buffers.size();
+
+	for (auto& buffer : s_buffers)
+	{
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		stats.events += buffer->events.size();
+		stats.dropped += buffer->dropped;
+	}
+
+	return stats;
+}
@@ -0,0 +1,109 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace FireMaya
+{
+
+/** Scoped timers which can be switched on at runtime (fireRender -profileTrace true) in any build.
+
+	Every thread appends finished zones to its own buffer, buffers are merged only when trace is saved
+	in Chrome trace event format (open in chrome://tracing or https://ui.perfetto.dev).
+	While tracing is off a zone costs one relaxed atomic load.
+*/
+class Trace
+{
+public:
+	struct Statistics
+	{
+		bool enabled = false;
+		unsigned long long events = 0;
+		unsigned long long dropped = 0;	// per thread buffer was full
+		size_t threads = 0;
+	};
+
+	/** Name should be a string literal, optional detail (e.g. node name) is copied when the zone starts,
+		so temporary buffers like MString::asUTF8() can be passed */
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name, const char* detail = nullptr)
+			: m_name(nullptr)
+			, m_hasDetail(false)
+		{
+			if (IsEnabled())
+			{
+				m_name = name;
+				if (detail != nullptr)
+				{
+					m_detail = detail;
+					m_hasDetail = true;
+				}
+				m_start = Now();
+			}
+		}
+
+		~Zone()
+		{
+			if (m_name != nullptr)
+				AddEvent(m_name, m_hasDetail ? m_detail.c_str() : nullptr, m_start, Now());
+		}
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* m_name;
+		std::string m_detail;
+		bool m_hasDetail;
+		uint64_t m_start;
+	};
+
+	static bool IsEnabled()
+	{
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	/** Discards previously collected events and starts recording */
+	static void Start();
+
+	/** Stops recording, collected events are kept until next Start */
+	static void Stop();
+
+	/** Writes collected events as Chrome trace event JSON, can be called while recording. Path is UTF-8 */
+	static bool Save(const std::string& path);
+
+	static Statistics GetStatistics();
+
+	/** Name shown for the calling thread in trace viewer */
+	static void SetThreadName(const char* name);
+
+private:
+	static uint64_t Now();
+	static void AddEvent(const char* name, const char* detail, uint64_t start, uint64_t end);
+
+	static std::atomic<bool> s_enabled;
+};
+
+} // namespace FireMaya
+
+#define RPR_TRACE_CONCAT_IMPL(a, b) a##b
+#define RPR_TRACE_CONCAT(a, b) RPR_TRACE_CONCAT_IMPL(a, b)
+
+// Measures time until the end of current scope
+#define RPR_TRACE_ZONE(name) FireMaya::Trace::Zone RPR_TRACE_CONCAT(traceZone_, __LINE__)(name)
+#define RPR_TRACE_ZONE_DETAIL(name, detail) FireMaya::Trace::Zone RPR_TRACE_CONCAT(traceZone_, __LINE__)(name, detail)
@@ -0,0 +1,147 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "MeshCache.h"
+
+using namespace FireMaya;
+
+MeshCache::MeshCache() :
+	m_byteSize(0),
+	m_byteBudget(DefaultByteBudget),
+	m_hits(0),
+	m_misses(0),
+	m_evictions(0),
+	m_sharedBytes(0),
+	m_instancedShapes(0),
+	m_instancedBytes(0)
+{
+}
+
+MeshCache& MeshCache::Instance()
+{
+	static MeshCache instance;
+	return instance;
+}
+
+MeshTranslator::MeshIndicesPtr MeshCache::Find(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_index.find(key);
+	if (found == m_index.end())
+	{
+		++m_misses;
+		return nullptr;
+	}
+
+	++m_hits;
+	m_sharedBytes += found->second->indices->byteSize();
+	m_entries.splice(m_entries.begin(), m_entries, found->second);
+
+	return found->second->indices;
+}
+
+void MeshCache::Insert(uint64_t key, MeshTranslator::MeshIndicesPtr indices)
+{
+	if (!indices)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_index.find(key);
+	if (found != m_index.end())
+	{
+		// the same geometry was built by another thread meanwhile
+		m_byteSize -= found->second->indices->byteSize();
+		found->second->indices = indices;
+		m_byteSize += indices->byteSize();
+		m_entries.splice(m_entries.begin(), m_entries, found->second);
+	}
+	else
+	{
+		m_entries.push_front(Entry { key, indices });
+		m_index[key] = m_entries.begin();
+		m_byteSize += indices->byteSize();
+	}
+
+	EvictToBudget();
+}
+
+void MeshCache::RecordInstancedShape(size_t byteSize)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	++m_instancedShapes;
+	m_instancedBytes += byteSize;
+}
+
+void MeshCache::EvictToBudget()
+{
+	// m_mutex should be locked by caller
+	while (m_byteSize > m_byteBudget && !m_entries.empty())
+	{
+		const Entry& oldest = m_entries.back();
+
+		m_byteSize -= oldest.indices->byteSize();
+		m_index.erase(oldest.key);
+		m_entries.pop_back();
+
+		++m_evictions;
+	}
+}
+
+void MeshCache::SetByteBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_byteBudget = bytes;
+	EvictToBudget();
+}
+
+void MeshCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_index.clear();
+	m_entries.clear();
+	m_byteSize = 0;
+}
+
+MeshCache::Statistics MeshCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Statistics stats;
+	stats.entryCount = m_entries.size();
+	stats.byteSize = m_byteSize;
+	stats.byteBudget = m_byteBudget;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.evictions = m_evictions;
+	stats.sharedBytes = m_sharedBytes;
+	stats.instancedShapes = m_instancedShapes;
+	stats.instancedBytes = m_instancedBytes;
+
+	return stats;
+}
+
+void MeshCache::ResetStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_hits = 0;
+	m_misses = 0;
+	m_evictions = 0;
+	m_sharedBytes = 0;
+	m_instancedShapes = 0;
+	m_instancedBytes = 0;
+}
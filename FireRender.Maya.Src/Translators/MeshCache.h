@@ -0,0 +1,90 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#pragma once
+
+#include "MeshTranslator.h"
+
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace FireMaya
+{
+	// Process wide cache of translated mesh indices keyed by geometry content (MeshTranslator::CalculateContentKey).
+	// Duplicated or referenced meshes and meshes translated by several contexts (IPR, viewport, production)
+	// build indices once. rpr shapes belong to a single context, so inside a context duplicates
+	// become rpr instances of the first translated shape (see FireRenderContext::FindGeometryShape).
+	// Entries are reference counted: evicted data stays alive until the last user releases it.
+	class MeshCache
+	{
+		MeshCache();
+
+	public:
+		struct Statistics
+		{
+			size_t entryCount = 0;
+			size_t byteSize = 0;
+			size_t byteBudget = 0;
+			unsigned long long hits = 0;
+			unsigned long long misses = 0;
+			unsigned long long evictions = 0;
+			unsigned long long sharedBytes = 0;		// index data taken from cache instead of being built
+			unsigned long long instancedShapes = 0;	// duplicated meshes created as rpr instances
+			unsigned long long instancedBytes = 0;	// index data of the meshes created as instances
+		};
+
+		static const size_t DefaultByteBudget = size_t(1024) * 1024 * 1024;
+
+		static MeshCache& Instance();
+
+		MeshTranslator::MeshIndicesPtr Find(uint64_t key);
+		void Insert(uint64_t key, MeshTranslator::MeshIndicesPtr indices);
+
+		// Called when mesh is created as an instance of the shape with the same geometry
+		void RecordInstancedShape(size_t byteSize);
+
+		void SetByteBudget(size_t bytes);
+
+		void Clear();
+
+		Statistics GetStatistics() const;
+		void ResetStatistics();
+
+	private:
+		struct Entry
+		{
+			uint64_t key;
+			MeshTranslator::MeshIndicesPtr indices;
+		};
+
+		typedef std::list<Entry> EntryList;
+
+		void EvictToBudget();
+
+		EntryList m_entries;	// most recently used first
+		std::unordered_map<uint64_t, EntryList::iterator> m_index;
+
+		size_t m_byteSize;
+		size_t m_byteBudget;
+
+		unsigned long long m_hits;
+		unsigned long long m_misses;
+		unsigned long long m_evictions;
+		unsigned long long m_sharedBytes;
+		unsigned long long m_instancedShapes;
+		unsigned long long m_instancedBytes;
+
+		mutable std::mutex m_mutex;
+	};
+}
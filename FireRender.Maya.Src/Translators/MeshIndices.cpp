@@ -0,0 +1,284 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "SingleShaderMeshTranslator.h"
+#include "ParallelUtils.h"
+#include "Tracing.h"
+
+// Index building part of mesh translation. Works only with topology gathered by MeshPolygonData::Initialize,
+// doesn't call Maya API and is compiled into FireRender.Maya.UnitTests as well
+
+FireMaya::MeshTranslator::MeshPolygonData::MeshPolygonData()
+	: pVertices(nullptr)
+	, countVertices(0)
+	, pNormals(nullptr)
+	, countNormals(0)
+	, triangleVertexIndicesCount(0)
+	, motionSamplesCount(0)
+	, haveDeformation(false)
+	, fullName("")
+	, vertexColorsCount(0)
+	, contentKey(0)
+	, m_isInitialized(false)
+	, m_hasTopology(false)
+{
+}
+
+void FireMaya::MeshTranslator::MeshIndices::clear()
+{
+	// swap with empty vectors to actually release memory
+	std::vector<int>().swap(faceVertexIndices);
+	std::vector<int>().swap(faceNormalIndices);
+	std::vector<std::vector<int>>().swap(uvIndices);
+	std::vector<int>().swap(numFaceVertices);
+	std::vector<int>().swap(faceMaterialIndices);
+	std::vector<MColor>().swap(vertexColors);
+	std::vector<int>().swap(colorVertexIndices);
+}
+
+size_t FireMaya::MeshTranslator::MeshIndices::byteSize() const
+{
+	size_t size = sizeof(int) * (faceVertexIndices.size() + faceNormalIndices.size() + numFaceVertices.size() +
+		faceMaterialIndices.size() + colorVertexIndices.size());
+
+	for (const std::vector<int>& uvSetIndices : uvIndices)
+	{
+		size += sizeof(int) * uvSetIndices.size();
+	}
+
+	return size + sizeof(MColor) * vertexColors.size();
+}
+
+namespace
+{
+	// number of polygons processed by one task of BuildIndices
+	const size_t PolygonChunkSize = 16384;
+
+	// position of polygon chunk in flat Maya arrays and in output rpr arrays
+	struct PolygonChunkOffsets
+	{
+		size_t vertexOffset = 0;		// polygonVertexIds, polygonNormalIds, faceVertexColors
+		size_t triangleOffset = 0;		// polygonTriangleOffsets
+		size_t faceOffset = 0;			// numFaceVertices, faceMaterialIndices
+		size_t faceVertexOffset = 0;	// faceVertexIndices, faceNormalIndices, uvIndices
+		std::vector<size_t> uvOffsets;	// polygonUVIds
+
+		void Add(const PolygonChunkOffsets& other)
+		{
+			vertexOffset += other.vertexOffset;
+			triangleOffset += other.triangleOffset;
+			faceOffset += other.faceOffset;
+			faceVertexOffset += other.faceVertexOffset;
+
+			for (size_t currentChannelUV = 0; currentChannelUV < uvOffsets.size(); ++currentChannelUV)
+			{
+				uvOffsets[currentChannelUV] += other.uvOffsets[currentChannelUV];
+			}
+		}
+	};
+}
+
+void FireMaya::SingleShaderMeshTranslator::BuildIndices(const MeshTranslator::MeshPolygonData& meshData, MeshTranslator::MeshIndices& indices)
+{
+	indices.clear();
+
+	const size_t polygonCount = meshData.polygonVertexCounts.size();
+	const size_t uvSetCount = meshData.polygonUVCounts.size();
+	const size_t chunkCount = (polygonCount + PolygonChunkSize - 1) / PolygonChunkSize;
+
+	auto chunkEnd = [polygonCount](size_t chunkIdx)
+	{
+		size_t end = (chunkIdx + 1) * PolygonChunkSize;
+		return end < polygonCount ? end : polygonCount;
+	};
+
+	// Polygons are split into chunks which are processed in parallel.
+	// First pass counts how much every chunk reads and writes, so the second one can fill
+	// pre-sized output arrays without synchronization. Result is the same as of the serial walk.
+	std::vector<PolygonChunkOffsets> chunks(chunkCount + 1);
+	for (PolygonChunkOffsets& chunk : chunks)
+	{
+		chunk.uvOffsets.assign(uvSetCount, 0);
+	}
+
+	FireMaya::WorkerPool& workerPool = FireMaya::WorkerPool::Instance();
+
+	// sizes are stored shifted by one chunk and then accumulated into offsets
+	workerPool.ParallelFor(chunkCount, [&](size_t chunkIdx)
+	{
+		PolygonChunkOffsets& sizes = chunks[chunkIdx + 1];
+
+		for (size_t polygonIdx = chunkIdx * PolygonChunkSize; polygonIdx < chunkEnd(chunkIdx); ++polygonIdx)
+		{
+			const size_t polygonVertexCount = meshData.polygonVertexCounts[polygonIdx];
+			const size_t polygonTriangleCount = meshData.polygonTriangleCounts[polygonIdx];
+
+			sizes.vertexOffset += polygonVertexCount;
+			sizes.triangleOffset += 3 * polygonTriangleCount;
+
+			if (polygonVertexCount == 4) // quads are passed to rpr as they are
+			{
+				sizes.faceOffset += 1;
+				sizes.faceVertexOffset += 4;
+			}
+			else
+			{
+				sizes.faceOffset += polygonTriangleCount;
+				sizes.faceVertexOffset += 3 * polygonTriangleCount;
+			}
+
+			for (size_t currentChannelUV = 0; currentChannelUV < uvSetCount; ++currentChannelUV)
+			{
+				sizes.uvOffsets[currentChannelUV] += meshData.polygonUVCounts[currentChannelUV][polygonIdx];
+			}
+		}
+	});
+
+	for (size_t chunkIdx = 1; chunkIdx <= chunkCount; ++chunkIdx)
+	{
+		chunks[chunkIdx].Add(chunks[chunkIdx - 1]);
+	}
+
+	const PolygonChunkOffsets& totals = chunks[chunkCount];
+
+	indices.faceVertexIndices.resize(totals.faceVertexOffset);
+	indices.faceNormalIndices.resize(totals.faceVertexOffset);
+	indices.numFaceVertices.resize(totals.faceOffset);
+	indices.faceMaterialIndices.resize(totals.faceOffset);
+
+	indices.uvIndices.resize(uvSetCount);
+	for (std::vector<int>& uvIndices : indices.uvIndices)
+	{
+		uvIndices.resize(totals.faceVertexOffset);
+	}
+
+	workerPool.ParallelFor(chunkCount, [&](size_t chunkIdx)
+	{
+		// offsets of current polygon, advanced while walking the chunk
+		PolygonChunkOffsets offsets = chunks[chunkIdx];
+
+		for (size_t polygonIdx = chunkIdx * PolygonChunkSize; polygonIdx < chunkEnd(chunkIdx); ++polygonIdx)
+		{
+			const int polygonVertexCount = meshData.polygonVertexCounts[polygonIdx];
+			const int polygonTriangleCount = meshData.polygonTriangleCounts[polygonIdx];
+			const int shaderId = polygonIdx < meshData.polygonMaterialIds.size() ? meshData.polygonMaterialIds[polygonIdx] : 0;
+
+			auto addVertex = [&](int localIdx)
+			{
+				indices.faceVertexIndices[offsets.faceVertexOffset] = meshData.polygonVertexIds[offsets.vertexOffset + localIdx];
+				indices.faceNormalIndices[offsets.faceVertexOffset] = meshData.polygonNormalIds[offsets.vertexOffset + localIdx];
+
+				for (size_t currentChannelUV = 0; currentChannelUV < uvSetCount; ++currentChannelUV)
+				{
+					// in case if uv coordinate not assigned to polygon set it index to 0
+					int uvIndex = 0;
+					if (meshData.polygonUVCounts[currentChannelUV][polygonIdx] > localIdx)
+					{
+						uvIndex = meshData.polygonUVIds[currentChannelUV][offsets.uvOffsets[currentChannelUV] + localIdx];
+					}
+
+					indices.uvIndices[currentChannelUV][offsets.faceVertexOffset] = uvIndex;
+				}
+
+				++offsets.faceVertexOffset;
+			};
+
+			if (polygonVertexCount == 4) // this is quad
+			{
+				indices.numFaceVertices[offsets.faceOffset] = 4;
+				indices.faceMaterialIndices[offsets.faceOffset] = shaderId;
+				++offsets.faceOffset;
+
+				for (int localIdx = 0; localIdx < 4; ++localIdx)
+				{
+					addVertex(localIdx);
+				}
+			}
+			else
+			{
+				for (int triangleIdx = 0; triangleIdx < polygonTriangleCount; ++triangleIdx)
+				{
+					indices.numFaceVertices[offsets.faceOffset] = 3;
+					indices.faceMaterialIndices[offsets.faceOffset] = shaderId;
+					++offsets.faceOffset;
+
+					for (int idx = 0; idx < 3; ++idx)
+					{
+						addVertex(meshData.polygonTriangleOffsets[offsets.triangleOffset + 3 * triangleIdx + idx]);
+					}
+				}
+			}
+
+			offsets.vertexOffset += polygonVertexCount;
+			offsets.triangleOffset += 3 * (size_t) polygonTriangleCount;
+
+			for (size_t currentChannelUV = 0; currentChannelUV < uvSetCount; ++currentChannelUV)
+			{
+				offsets.uvOffsets[currentChannelUV] += meshData.polygonUVCounts[currentChannelUV][polygonIdx];
+			}
+		}
+	});
+
+	// vertex colors are per vertex, shared vertices take color of the last polygon as in Maya iterator order
+	indices.vertexColors.resize(meshData.vertexColorsCount);
+	indices.colorVertexIndices.resize(meshData.vertexColorsCount);
+
+	if (!meshData.faceVertexColors.empty())
+	{
+		for (size_t faceVertexIdx = 0; faceVertexIdx < meshData.polygonVertexIds.size(); ++faceVertexIdx)
+		{
+			int globalVertexIndex = meshData.polygonVertexIds[faceVertexIdx];
+			if ((size_t) globalVertexIndex < indices.vertexColors.size())
+			{
+				indices.vertexColors[globalVertexIndex] = meshData.faceVertexColors[faceVertexIdx];
+				indices.colorVertexIndices[globalVertexIndex] = globalVertexIndex;
+			}
+		}
+	}
+}
+
+void FireMaya::MeshTranslator::SortFacesByMaterial(
+	const std::vector<int>& faceMaterialIndices,
+	size_t materialCount,
+	std::vector<int>& outFaceIds,
+	std::vector<size_t>& outMaterialOffsets)
+{
+	outMaterialOffsets.assign(materialCount + 1, 0);
+
+	// faces with invalid material index are skipped
+	for (int materialIdx : faceMaterialIndices)
+	{
+		if (materialIdx >= 0 && (size_t) materialIdx < materialCount)
+		{
+			++outMaterialOffsets[materialIdx + 1];
+		}
+	}
+
+	for (size_t materialIdx = 1; materialIdx <= materialCount; ++materialIdx)
+	{
+		outMaterialOffsets[materialIdx] += outMaterialOffsets[materialIdx - 1];
+	}
+
+	outFaceIds.resize(outMaterialOffsets[materialCount]);
+
+	std::vector<size_t> cursors(outMaterialOffsets.begin(), outMaterialOffsets.end() - 1);
+
+	for (size_t faceIdx = 0; faceIdx < faceMaterialIndices.size(); ++faceIdx)
+	{
+		int materialIdx = faceMaterialIndices[faceIdx];
+
+		if (materialIdx >= 0 && (size_t) materialIdx < materialCount)
+		{
+			outFaceIds[cursors[materialIdx]++] = (int) faceIdx;
+		}
+	}
+}
@@ -22,32 +22,25 @@ limitations under the License.
 #include <maya/MFloatPointArray.h>
 #include <maya/MFloatVectorArray.h>
 #include <maya/MFloatArray.h>
+#include <maya/MIntArray.h>
+#include <maya/MColorArray.h>
 #include <maya/MPointArray.h>
 #include <maya/MItMeshPolygon.h>
 #include <maya/MSelectionList.h>
 #include <maya/MAnimControl.h>
+#include <maya/MDGContext.h>
+#include <maya/MPlug.h>
+
+#if MAYA_API_VERSION >= 20180000
+#include <maya/MDGContextGuard.h>
+#endif
 
 #include <unordered_map>
 
 #include "SingleShaderMeshTranslator.h"
-#include "MultipleShaderMeshTranslator.h"
-
-#ifdef OPTIMIZATION_CLOCK
-#include <chrono>
-#endif
-
-FireMaya::MeshTranslator::MeshPolygonData::MeshPolygonData()
-	: pVertices(nullptr)
-	, countVertices(0)
-	, pNormals(nullptr)
-	, countNormals(0)
-	, triangleVertexIndicesCount(0)
-	, motionSamplesCount(0)
-	, haveDeformation(false)
-	, fullName("")
-	, m_isInitialized(false)
-{
-}
+#include "MeshCache.h"
+#include "FireRenderObjects.h"
+#include "Tracing.h"
 
 void ChangeCurrentTimeAndUpdateMesh(MFnMesh& fnMesh, const MTime& time, MString fullDagPath)
 {
@@ -158,6 +151,118 @@ void FireMaya::MeshTranslator::MeshPolygonData::clear()
 	uvCoords.clear();
 	sizeCoords.clear();
 	puvCoords.clear();
+
+	m_hasTopology = false;
+	polygonVertexCounts.clear();
+	polygonVertexIds.clear();
+	polygonNormalIds.clear();
+	polygonTriangleCounts.clear();
+	polygonTriangleOffsets.clear();
+	polygonMaterialIds.clear();
+	polygonUVCounts.clear();
+	polygonUVIds.clear();
+	faceVertexColors.clear();
+	vertexColorsCount = 0;
+
+	indices.reset();
+	contentKey = 0;
+}
+
+void CopyMayaArray(const MIntArray& from, std::vector<int>& to)
+{
+	to.resize(from.length());
+
+	if (from.length() > 0)
+	{
+		from.get(to.data());
+	}
+}
+
+void CopyMayaArray(const MColorArray& from, std::vector<MColor>& to)
+{
+	to.resize(from.length());
+
+	for (unsigned int idx = 0; idx < from.length(); ++idx)
+	{
+		to[idx] = from[idx];
+	}
+}
+
+bool FireMaya::MeshTranslator::MeshPolygonData::GatherTopology(MFnMesh& fnMesh)
+{
+	MAIN_THREAD_ONLY;
+
+	MStatus mstatus;
+
+	MIntArray counts;
+	MIntArray ids;
+
+	mstatus = fnMesh.getVertices(counts, ids);
+	if (MStatus::kSuccess != mstatus)
+		return false;
+
+	CopyMayaArray(counts, polygonVertexCounts);
+	CopyMayaArray(ids, polygonVertexIds);
+
+	mstatus = fnMesh.getNormalIds(counts, ids);
+	if (MStatus::kSuccess != mstatus)
+		return false;
+
+	CopyMayaArray(ids, polygonNormalIds);
+
+	// triangulation with indices relative to polygon (used for non-quad polygons)
+	mstatus = fnMesh.getTriangleOffsets(counts, ids);
+	if (MStatus::kSuccess != mstatus)
+		return false;
+
+	CopyMayaArray(counts, polygonTriangleCounts);
+	CopyMayaArray(ids, polygonTriangleOffsets);
+
+	unsigned int uvSetCount = uvSetNames.length();
+	polygonUVCounts.resize(uvSetCount);
+	polygonUVIds.resize(uvSetCount);
+
+	for (unsigned int currentChannelUV = 0; currentChannelUV < uvSetCount; ++currentChannelUV)
+	{
+		// faces without uv coordinates assigned have 0 in counts array
+		mstatus = fnMesh.getAssignedUVs(counts, ids, &uvSetNames[currentChannelUV]);
+
+		if (MStatus::kSuccess == mstatus)
+		{
+			CopyMayaArray(counts, polygonUVCounts[currentChannelUV]);
+			CopyMayaArray(ids, polygonUVIds[currentChannelUV]);
+		}
+		else
+		{
+			polygonUVCounts[currentChannelUV].assign(polygonVertexCounts.size(), 0);
+			polygonUVIds[currentChannelUV].clear();
+		}
+	}
+
+	CopyMayaArray(faceMaterialIndices, polygonMaterialIds);
+
+	MColorArray vtxColors;
+	fnMesh.getVertexColors(vtxColors);
+	vertexColorsCount = vtxColors.length();
+
+	faceVertexColors.clear();
+	if (vertexColorsCount > 0)
+	{
+		MColorArray colors;
+		mstatus = fnMesh.getFaceVertexColors(colors);
+
+		if ((MStatus::kSuccess == mstatus) && (colors.length() == polygonVertexIds.size()))
+		{
+			CopyMayaArray(colors, faceVertexColors);
+		}
+	}
+
+	shapeName = fnMesh.name().asChar();
+
+	m_hasTopology = true;
+	indices.reset();
+
+	return true;
 }
 
 bool FireMaya::MeshTranslator::MeshPolygonData::Initialize(MFnMesh& fnMesh, unsigned int deformationFrameCount, MString fullDagPath)
@@ -221,11 +326,14 @@ bool FireMaya::MeshTranslator::MeshPolygonData::Initialize(MFnMesh& fnMesh, unsi
 		ReadDeformationFrame(fnMesh, 0);
 	}
 
-	// get triangle count (max possible count; this number is used for reserve only)
-	MIntArray triangleCounts; // basically number of triangles in polygons; size of array equal to number of polygons in mesh
-	MIntArray triangleVertices; // indices of points in triangles (3 indices per triangle)
-	mstatus = fnMesh.getTriangles(triangleCounts, triangleVertices);
-	triangleVertexIndicesCount = triangleVertices.length();
+	// reads topology and triangulation for the translation stage
+	if (!GatherTopology(fnMesh))
+	{
+		return false;
+	}
+
+	// max possible count; this number is used for reserve only
+	triangleVertexIndicesCount = polygonTriangleOffsets.size();
 
 	m_isInitialized = true;
 	return true;
@@ -238,23 +346,100 @@ bool FireMaya::MeshTranslator::MeshPolygonData::ReadDeformationFrame(MFnMesh& fn
 		return true;
 	}
 
-	size_t floatsVertexOneFrame = 3 * countVertices;
-	size_t floatsNormalOneFrame = 3 * countNormals;
+	// deformers changing topology can't be blurred
+	if ((size_t(fnMesh.numVertices()) != countVertices) || (size_t(fnMesh.numNormals()) != countNormals))
+	{
+		return false;
+	}
+
 	MStatus status;
 
-	const float* pData = fnMesh.getRawPoints(&status);
+	const float* points = fnMesh.getRawPoints(&status);
 	assert(MStatus::kSuccess == status);
-	assert(arrVertices.size() >= floatsVertexOneFrame * currentDeformationFrame);
-	std::copy(pData, pData + floatsVertexOneFrame, arrVertices.data() + floatsVertexOneFrame * currentDeformationFrame);
 
-	pData = fnMesh.getRawNormals(&status);
+	const float* normals = fnMesh.getRawNormals(&status);
 	assert(MStatus::kSuccess == status);
-	assert(arrNormals.size() >= floatsNormalOneFrame * currentDeformationFrame);
-	std::copy(pData, pData + floatsNormalOneFrame, arrNormals.data() + floatsNormalOneFrame * currentDeformationFrame);
+
+	StoreDeformationFrame(currentDeformationFrame, points, normals);
 
 	return true;
 }
 
+void FireMaya::MeshTranslator::MeshPolygonData::StoreDeformationFrame(unsigned int currentDeformationFrame, const float* points, const float* normals)
+{
+	size_t floatsVertexOneFrame = 3 * countVertices;
+	size_t floatsNormalOneFrame = 3 * countNormals;
+
+	assert(arrVertices.size() >= floatsVertexOneFrame * (currentDeformationFrame + 1));
+	std::copy(points, points + floatsVertexOneFrame, arrVertices.data() + floatsVertexOneFrame * currentDeformationFrame);
+
+	assert(arrNormals.size() >= floatsNormalOneFrame * (currentDeformationFrame + 1));
+	std::copy(normals, normals + floatsNormalOneFrame, arrNormals.data() + floatsNormalOneFrame * currentDeformationFrame);
+}
+
+uint64_t FireMaya::MeshTranslator::MeshPolygonData::CalculateDeformationKey(const std::string& uuid) const
+{
+	HashValue hash;
+
+	hash << countVertices;
+	hash << countNormals;
+	hash.Append(uuid.data(), int(uuid.size()));
+
+	// the first frame is read at the current time, sub-frame samples are expected to be the same while it doesn't change
+	hash.Append(arrVertices.data(), int(3 * countVertices));
+	hash.Append(arrNormals.data(), int(3 * countNormals));
+
+	return uint64_t(size_t(hash));
+}
+
+bool FireMaya::MeshTranslator::EvaluateDeformationSample(const MObject& originalObject, const MTime& time, const MeshPolygonData& meshPolygonData, DeformationSample& outSample)
+{
+	MAIN_THREAD_ONLY;
+
+	// outMesh has neither smoothed nor tessellated geometry
+	if (!originalObject.hasFn(MFn::kMesh) || !meshPolygonData.smoothedObject.isNull() || !meshPolygonData.tesselatedObject.isNull())
+		return false;
+
+	MStatus status;
+	MFnDependencyNode nodeFn(originalObject);
+
+	MPlug outMeshPlug = nodeFn.findPlug("outMesh", false, &status);
+	if (MStatus::kSuccess != status)
+		return false;
+
+	MDGContext dgContext(time);
+
+#if MAYA_API_VERSION >= 20180000
+	{
+		MDGContextGuard contextGuard(dgContext);
+		outSample.meshData = outMeshPlug.asMObject(&status);
+	}
+#else
+	status = outMeshPlug.getValue(outSample.meshData, dgContext);
+#endif
+
+	if ((MStatus::kSuccess != status) || outSample.meshData.isNull())
+		return false;
+
+	MFnMesh fnMesh(outSample.meshData, &status);
+	if (MStatus::kSuccess != status)
+		return false;
+
+	// deformers changing topology can't be blurred
+	if ((size_t(fnMesh.numVertices()) != meshPolygonData.countVertices) || (size_t(fnMesh.numNormals()) != meshPolygonData.countNormals))
+		return false;
+
+	outSample.points = fnMesh.getRawPoints(&status);
+	if (MStatus::kSuccess != status)
+		return false;
+
+	outSample.normals = fnMesh.getRawNormals(&status);
+	if (MStatus::kSuccess != status)
+		return false;
+
+	return (outSample.points != nullptr) && (outSample.normals != nullptr);
+}
+
 bool FireMaya::MeshTranslator::PreProcessMesh(
 	MeshPolygonData& outMeshPolygonData,
 	const frw::Context& context,
@@ -264,6 +449,7 @@ bool FireMaya::MeshTranslator::PreProcessMesh(
 	MString fullDagPath /*= ""*/)
 {
 	MAIN_THREAD_ONLY;
+	RPR_TRACE_ZONE_DETAIL("MeshTranslator::PreProcessMesh", fullDagPath.asUTF8());
 
 	MStatus mayaStatus;
 
@@ -351,6 +537,12 @@ bool FireMaya::MeshTranslator::PreProcessMesh(
 		);
 	}
 
+	if (!successfullyProcessed && (currentDeformationFrame != 0))
+	{
+		// the first frame is kept
+		return false;
+	}
+
 	if (!successfullyProcessed)
 	{
 		std::string nodeName = fnMesh.name().asChar();
@@ -382,6 +574,7 @@ frw::Shape FireMaya::MeshTranslator::TranslateMesh(
 	std::vector<int>& outFaceMaterialIndices,
 	unsigned int deformationFrameCount, MString fullDagPath)
 {
+	RPR_TRACE_ZONE_DETAIL("MeshTranslator::TranslateMesh", meshPolygonData.fullName.asUTF8());
 	DebugPrint("TranslateMesh: %s", meshPolygonData.fullName.asUTF8());
 
 	outFaceMaterialIndices.clear();
@@ -400,18 +593,39 @@ frw::Shape FireMaya::MeshTranslator::TranslateMesh(
 		object = meshPolygonData.smoothedObject;
 	}
 
-	MFnMesh fnMesh(object, &mayaStatus);
-	if (MStatus::kSuccess != mayaStatus)
+	// translate mesh
+	frw::Shape outShape;
+
+	if (meshPolygonData.HasTopology())
 	{
-		mayaStatus.perror("MFnMesh constructor");
+		// indices are usually built on worker threads during FireRenderContext::Freshen
+		if (!meshPolygonData.HasIndices())
+		{
+			BuildIndices(meshPolygonData);
+		}
+
+		SingleShaderMeshTranslator::TranslateMesh(context, outShape, meshPolygonData, outFaceMaterialIndices);
 	}
+	else
+	{
+		MFnMesh fnMesh(object, &mayaStatus);
+		if (MStatus::kSuccess != mayaStatus)
+		{
+			mayaStatus.perror("MFnMesh constructor");
+		}
 
-	// translate mesh
-	frw::Shape outShape;
-	SingleShaderMeshTranslator::TranslateMesh(
-		context, fnMesh, outShape, meshPolygonData, meshPolygonData.faceMaterialIndices, outFaceMaterialIndices
-	);
+		SingleShaderMeshTranslator::TranslateMesh(
+			context, fnMesh, outShape, meshPolygonData, meshPolygonData.faceMaterialIndices, outFaceMaterialIndices
+		);
+	}
 
+	RemoveTemporaryMeshes(meshPolygonData, originalObject);
+
+	return outShape;
+}
+
+void FireMaya::MeshTranslator::RemoveTemporaryMeshes(MeshPolygonData& meshPolygonData, const MObject& originalObject)
+{
 	// Now remove any temporary mesh we created.
 	MFnDagNode node(originalObject);
 	if (!meshPolygonData.tesselatedObject.isNull())
@@ -425,8 +639,73 @@ frw::Shape FireMaya::MeshTranslator::TranslateMesh(
 		RemoveSmoothedTemporaryMesh(node, meshPolygonData.smoothedObject);
 		meshPolygonData.smoothedObject = MObject();
 	}
+}
 
-	return outShape;
+bool FireMaya::MeshTranslator::BuildIndices(MeshPolygonData& meshPolygonData)
+{
+	RPR_TRACE_ZONE("MeshTranslator::BuildIndices");
+
+	if (!meshPolygonData.IsInitialized() || !meshPolygonData.HasTopology())
+	{
+		return false;
+	}
+
+	if (meshPolygonData.HasIndices())
+	{
+		return true;
+	}
+
+	meshPolygonData.contentKey = CalculateContentKey(meshPolygonData);
+
+	MeshCache& meshCache = MeshCache::Instance();
+	meshPolygonData.indices = meshCache.Find(meshPolygonData.contentKey);
+
+	if (!meshPolygonData.indices)
+	{
+		auto indices = std::make_shared<MeshIndices>();
+		SingleShaderMeshTranslator::BuildIndices(meshPolygonData, *indices);
+
+		meshCache.Insert(meshPolygonData.contentKey, indices);
+		meshPolygonData.indices = indices;
+	}
+
+	return true;
+}
+
+uint64_t FireMaya::MeshTranslator::CalculateContentKey(const MeshPolygonData& meshPolygonData)
+{
+	HashValue hash;
+
+	// counts go first so arrays of different meshes can't be mixed up
+	hash << meshPolygonData.GetTotalVertexCount();
+	hash << meshPolygonData.GetTotalNormalCount();
+	hash << meshPolygonData.GetPolygonCount();
+	hash << meshPolygonData.motionSamplesCount;
+	hash << meshPolygonData.vertexColorsCount;
+
+	hash.Append(meshPolygonData.GetVertices(), int(meshPolygonData.GetTotalVertexCount() * 3));
+	hash.Append(meshPolygonData.GetNormals(), int(meshPolygonData.GetTotalNormalCount() * 3));
+	hash.Append(meshPolygonData.polygonVertexCounts.data(), int(meshPolygonData.polygonVertexCounts.size()));
+	hash.Append(meshPolygonData.polygonVertexIds.data(), int(meshPolygonData.polygonVertexIds.size()));
+	hash.Append(meshPolygonData.polygonNormalIds.data(), int(meshPolygonData.polygonNormalIds.size()));
+	hash.Append(meshPolygonData.polygonTriangleOffsets.data(), int(meshPolygonData.polygonTriangleOffsets.size()));
+	hash.Append(meshPolygonData.polygonMaterialIds.data(), int(meshPolygonData.polygonMaterialIds.size()));
+
+	for (size_t currentChannelUV = 0; currentChannelUV < meshPolygonData.polygonUVCounts.size(); ++currentChannelUV)
+	{
+		hash.Append(meshPolygonData.polygonUVCounts[currentChannelUV].data(), int(meshPolygonData.polygonUVCounts[currentChannelUV].size()));
+		hash.Append(meshPolygonData.polygonUVIds[currentChannelUV].data(), int(meshPolygonData.polygonUVIds[currentChannelUV].size()));
+	}
+
+	for (const std::vector<Float2>& uvCoords : meshPolygonData.uvCoords)
+	{
+		hash << uvCoords.size();
+		hash.Append(uvCoords.data(), int(uvCoords.size()));
+	}
+
+	hash.Append(meshPolygonData.faceVertexColors.data(), int(meshPolygonData.faceVertexColors.size()));
+
+	return uint64_t(size_t(hash));
 }
 
 frw::Shape FireMaya::MeshTranslator::TranslateMesh(
@@ -436,10 +715,7 @@ frw::Shape FireMaya::MeshTranslator::TranslateMesh(
 	unsigned int deformationFrameCount, MString fullDagPath)
 {
 	MAIN_THREAD_ONLY;
-
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-#endif
+	RPR_TRACE_ZONE("MeshTranslator::TranslateMesh");
 
 	MStatus mayaStatus;
 
@@ -491,13 +767,12 @@ frw::Shape FireMaya::MeshTranslator::TranslateMesh(
 		return outShape;
 	}
 
-	// get number of materials used in this mesh
-	MIntArray faceMaterialIndices;
-	int materialCount = GetFaceMaterials(fnMesh, faceMaterialIndices);
-
 	// get common data from mesh
 	MeshPolygonData meshPolygonData;
 
+	// get number of materials used in this mesh
+	meshPolygonData.materialCount = GetFaceMaterials(fnMesh, meshPolygonData.faceMaterialIndices);
+
 	/// for tesselated or smoothed mesh disable deformation MB for now
 	bool successfullyInitialized = meshPolygonData.Initialize(fnMesh, object != originalObject ? 0 : deformationFrameCount, fullDagPath);
 	if (!successfullyInitialized)
@@ -508,15 +783,10 @@ frw::Shape FireMaya::MeshTranslator::TranslateMesh(
 		return outShape;
 	}
 
+	// indices are built from topology arrays read by Initialize
 	outFaceMaterialIndices.clear();
-	SingleShaderMeshTranslator::TranslateMesh(
-		context, fnMesh, outShape, meshPolygonData, faceMaterialIndices, outFaceMaterialIndices
-	);
-
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point fin = std::chrono::steady_clock::now();
-	std::chrono::milliseconds elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(fin - start);
-#endif
+	BuildIndices(meshPolygonData);
+	SingleShaderMeshTranslator::TranslateMesh(context, outShape, meshPolygonData, outFaceMaterialIndices);
 
 	// Now remove any temporary mesh we created.
 	if (!tessellated.isNull())
@@ -528,12 +798,6 @@ frw::Shape FireMaya::MeshTranslator::TranslateMesh(
 		RemoveSmoothedTemporaryMesh(node, smoothed);
 	}
 
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point fin = std::chrono::steady_clock::now();
-	std::chrono::milliseconds elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(fin - start);
-	FireRenderContext::inTranslateMesh += elapsed.count();
-#endif
-
 	return outShape;
 }
 
@@ -794,6 +1058,7 @@ MObject FireMaya::MeshTranslator::TessellateNurbsSurface(const MObject& object,
 
 MObject FireMaya::MeshTranslator::GetSmoothedObjectIfNecessary(const MObject& originalObject, MStatus& mstatus)
 {
+	RPR_TRACE_ZONE("MeshTranslator::GetSmoothedObjectIfNecessary");
 	MFnDagNode node(originalObject);
 
 	DebugPrint("TranslateMesh: %s", node.fullPathName().asUTF8());
@@ -830,9 +1095,7 @@ MObject FireMaya::MeshTranslator::GetSmoothedObjectIfNecessary(const MObject& or
 
 MObject FireMaya::MeshTranslator::GetTesselatedObjectIfNecessary(const MObject& originalObject, MStatus& mstatus)
 {
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-#endif
+	RPR_TRACE_ZONE("MeshTranslator::GetTesselatedObjectIfNecessary");
 	MFnDagNode node(originalObject);
 
 	DebugPrint("TranslateMesh: %s", node.fullPathName().asUTF8());
@@ -859,13 +1122,6 @@ MObject FireMaya::MeshTranslator::GetTesselatedObjectIfNecessary(const MObject&
 		}
 	}
 
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point fin = std::chrono::steady_clock::now();
-	std::chrono::microseconds elapsed = std::chrono::duration_cast<std::chrono::microseconds>(fin - start);
-
-	FireRenderContext::getTessellatedObj += elapsed.count();
-#endif
-
 	return tessellated;
 }
 
@@ -875,9 +1131,7 @@ void FireMaya::MeshTranslator::RemoveTesselatedTemporaryMesh(const MFnDagNode& n
 	MObject parent = node.parent(0);
 	FireRenderThread::RunProcOnMainThread([&]
 	{
-#ifdef OPTIMIZATION_CLOCK
-		std::chrono::steady_clock::time_point start_del = std::chrono::steady_clock::now();
-#endif
+		RPR_TRACE_ZONE("MeshTranslator::RemoveTesselatedTemporaryMesh");
 		MFnDagNode parentNode(parent, &mayaStatus);
 		if (MStatus::kSuccess == mayaStatus)
 		{
@@ -893,12 +1147,6 @@ void FireMaya::MeshTranslator::RemoveTesselatedTemporaryMesh(const MFnDagNode& n
 		{
 			MGlobal::deleteNode(tessellated);
 		}
-
-#ifdef OPTIMIZATION_CLOCK
-		std::chrono::steady_clock::time_point fin_del = std::chrono::steady_clock::now();
-		std::chrono::microseconds elapsed_del = std::chrono::duration_cast<std::chrono::microseconds>(fin_del - start_del);
-		FireRenderContext::deleteNodes += elapsed_del.count();
-#endif
 	});
 }
 
@@ -906,21 +1154,13 @@ void FireMaya::MeshTranslator::RemoveSmoothedTemporaryMesh(const MFnDagNode& nod
 {
 	FireRenderThread::RunProcOnMainThread([&]
 		{
-#ifdef OPTIMIZATION_CLOCK
-			std::chrono::steady_clock::time_point start_del = std::chrono::steady_clock::now();
-#endif
+			RPR_TRACE_ZONE("MeshTranslator::RemoveSmoothedTemporaryMesh");
 			MFnDagNode shapeNode(smoothed);
 			assert(shapeNode.parentCount() == 1);
 			MObject parent = shapeNode.parent(0);
 			assert(!parent.isNull());
 
 			MGlobal::deleteNode(parent);
-
-#ifdef OPTIMIZATION_CLOCK
-			std::chrono::steady_clock::time_point fin_del = std::chrono::steady_clock::now();
-			std::chrono::microseconds elapsed_del = std::chrono::duration_cast<std::chrono::microseconds>(fin_del - start_del);
-			FireRenderContext::deleteNodes += elapsed_del.count();
-#endif
 		});
 }
 
@@ -14,17 +14,66 @@ limitations under the License.
 
 #include "frWrap.h"
 #include "FireRenderUtils.h"
+#include "MotionSampleCache.h"
 
 #include <maya/MItMeshPolygon.h>
 #include <maya/MObject.h>
+#include <maya/MColor.h>
+#include <maya/MTime.h>
 #include <vector>
+#include <string>
 #include <unordered_map>
+#include <memory>
+#include <cstdint>
 
 namespace FireMaya
 {
 	class MeshTranslator
 	{
 	public:
+		// meshes with more polygons are worth splitting between worker threads during BuildIndices
+		static const size_t LargeMeshPolygonCount = 500000;
+
+		// rpr index arrays for single shape mesh (built by SingleShaderMeshTranslator::BuildIndices)
+		struct MeshIndices
+		{
+			// indices of vertexes (3 indices for each triangle, 4 for quads)
+			std::vector<int> faceVertexIndices;
+
+			// indices of normals (parallel to faceVertexIndices)
+			std::vector<int> faceNormalIndices;
+
+			// indices of UV coordinates, one vector per uv set
+			std::vector<std::vector<int>> uvIndices;
+
+			// number of vertices for each output face (3 or 4)
+			std::vector<int> numFaceVertices;
+
+			// shader index for each output face
+			std::vector<int> faceMaterialIndices;
+
+			std::vector<MColor> vertexColors;
+			std::vector<int> colorVertexIndices;
+
+			void clear(void);
+
+			size_t byteSize(void) const;
+		};
+
+		// Indices are immutable once built, so they can be shared between meshes and contexts (see MeshCache)
+		typedef std::shared_ptr<const MeshIndices> MeshIndicesPtr;
+
+		// Deformation motion blur sample read on the main thread, either taken from MotionSampleCache or evaluated
+		// by EvaluateDeformationSample. Then points and normals point into Maya mesh data kept alive by meshData,
+		// so the sample should be destroyed on the main thread
+		struct DeformationSample
+		{
+			MotionSampleCache::MeshSamplePtr cached;
+			MObject meshData;
+			const float* points = nullptr;
+			const float* normals = nullptr;
+		};
+
 		struct MeshPolygonData
 		{
 		public:
@@ -54,13 +103,41 @@ namespace FireMaya
 			MObject tesselatedObject;
 			MObject smoothedObject;
 
+			// Mesh topology read from Maya on the main thread during Initialize.
+			// Allows to build rpr indices without Maya API calls (i.e. on worker threads)
+			std::vector<int> polygonVertexCounts;
+			std::vector<int> polygonVertexIds;
+			std::vector<int> polygonNormalIds;
+			std::vector<int> polygonTriangleCounts;
+			std::vector<int> polygonTriangleOffsets; // indices are relative to polygon
+			std::vector<int> polygonMaterialIds;
+			std::vector<std::vector<int>> polygonUVCounts; // one vector per uv set
+			std::vector<std::vector<int>> polygonUVIds;
+			std::vector<MColor> faceVertexColors;
+			size_t vertexColorsCount;
+			std::string shapeName;
+
+			// Filled by translation stage, consumed by TranslateMesh
+			MeshIndicesPtr indices;
+
+			// Hash of the geometry content (points, normals, topology, uvs, colors, materials), set by BuildIndices.
+			// Duplicated geometry has the same key regardless of the node it comes from
+			uint64_t contentKey;
+
 			MeshPolygonData();
 
 			// Initializes mesh and returns error status
 			bool Initialize(MFnMesh& fnMesh, unsigned int deformationFrameCount, MString fullDagPath);
 			bool ReadDeformationFrame(MFnMesh& fnMesh, unsigned int currentDeformationFrame);
+
+			// Copies countVertices points and countNormals normals into deformation frame, doesn't call Maya API
+			void StoreDeformationFrame(unsigned int currentDeformationFrame, const float* points, const float* normals);
+
+			// Key of deformation samples in MotionSampleCache, depends on the node and the content of the first frame
+			uint64_t CalculateDeformationKey(const std::string& uuid) const;
 			bool ProcessDeformationFrameCount(MFnMesh& fnMesh, MString fullDagPath);
 
+			size_t GetPolygonCount() const { return polygonVertexCounts.size(); }
 			size_t GetTotalVertexCount() const { return std::max(arrVertices.size() / 3, countVertices); }
 			size_t GetTotalNormalCount() const { return std::max(arrNormals.size() / 3, countNormals); }
 
@@ -68,62 +145,53 @@ namespace FireMaya
 			const float* GetNormals() const { return arrNormals.size() > 0 ? arrNormals.data() : pNormals; }
 
 			bool IsInitialized(void) const { return m_isInitialized; }
+			bool HasTopology(void) const { return m_hasTopology; }
+			bool HasIndices(void) const { return indices != nullptr; }
 
 			// free memory
 			void clear(void);
 
+		private:
+			// reads topology arrays with MFnMesh bulk getters
+			bool GatherTopology(MFnMesh& fnMesh);
+
 		private:
 			const float* pVertices;
 			const float* pNormals;
 
 			bool m_isInitialized;
+			bool m_hasTopology;
 		};
 
-		struct MeshIdxDictionary
-		{
-			// output coords of vertices
-			std::vector<Float3> vertexCoords;
-
-			// output coords of normals
-			std::vector<Float3> normalCoords;
-
-			// output coords of uv's
-			std::vector<Float2> uvSubmeshCoords[2];
-
-			// output indices of vertexes (3 indices for each triangle)
-			std::vector<int> vertexCoordsIndices;
-
-			// output indices of normals (3 indices for each triangle)
-			std::vector<int> normalIndices;
-
-			// table to convert global index of vertex (index of vertex in pVertices array) to one in vertexCoords
-			// - local to submesh
-			std::unordered_map<int, int> vertexCoordsIndicesGlobalToDictionary;
+		static bool PreProcessMesh(MeshPolygonData& outMeshPolygonData, const frw::Context& context, const MObject& originalObject, unsigned int deformationFrameCount = 0, unsigned int currentDeformationFrame = 0, MString fullDagPath = "");
+		static frw::Shape TranslateMesh(MeshPolygonData& meshPolygonData, const frw::Context& context, const MObject& originalObject, std::vector<int>& outFaceMaterialIndices, unsigned int deformationFrameCount = 0, MString fullDagPath = "");
 
-			// table to convert global index of normal (index of normal in pNormals array) to one in vertexCoords
-			// - local to submesh
-			std::unordered_map<int, int> normalCoordIdxGlobal2Local;
+		// Builds rpr indices from pre-processed mesh data or takes them from MeshCache if the same geometry was translated before.
+		// Doesn't call Maya API, thus can be called from worker threads
+		static bool BuildIndices(MeshPolygonData& meshPolygonData);
 
-			// table to convert global index of uv coord (index of coord in uvIndices array) to one in normalCoords
-			// - local to submesh
-			std::unordered_map<int, int> uvCoordIdxGlobal2Local[2]; // size is always 1 or 2
+		// Calculates MeshPolygonData::contentKey from gathered data
+		static uint64_t CalculateContentKey(const MeshPolygonData& meshPolygonData);
 
-			// output indices of UV coordinates (3 indices for each triangle)
-			// up to 2 UV channels is supported, thus vector of vectors
-			std::vector<int> uvIndices[2];
+		// Evaluates mesh at given time through DG context, current time isn't changed. Fails if topology differs
+		// from the first frame or mesh isn't read from outMesh as it is (smoothed, tessellated or not a mesh),
+		// then the sample is read by PreProcessMesh at the sample time. Main thread only
+		static bool EvaluateDeformationSample(const MObject& originalObject, const MTime& time, const MeshPolygonData& meshPolygonData, DeformationSample& outSample);
 
-			// Indices of colored vertices
-			std::map<int, int> colorVertexIndices;
-
-			// Colors corresponding to vertices
-			std::map<int, MColor> vertexColors;
-		};
-
-		static bool PreProcessMesh(MeshPolygonData& outMeshPolygonData, const frw::Context& context, const MObject& originalObject, unsigned int deformationFrameCount = 0, unsigned int currentDeformationFrame = 0, MString fullDagPath = "");
-		static frw::Shape TranslateMesh(MeshPolygonData& meshPolygonData, const frw::Context& context, const MObject& originalObject, std::vector<int>& outFaceMaterialIndices, unsigned int deformationFrameCount = 0, MString fullDagPath = "");
+		// Removes smoothed or tessellated meshes created by PreProcessMesh
+		static void RemoveTemporaryMeshes(MeshPolygonData& meshPolygonData, const MObject& originalObject);
 
 		static frw::Shape TranslateMesh(const frw::Context& context, const MObject& originalObject, std::vector<int>& outFaceMaterialIndices, unsigned int deformationFrameCount = 0, MString fullDagPath="");
 
+		// Groups faces by material with counting sort (order of faces inside material is kept):
+		// faces of material m are outFaceIds[outMaterialOffsets[m]] ... outFaceIds[outMaterialOffsets[m + 1] - 1]
+		static void SortFacesByMaterial(
+			const std::vector<int>& faceMaterialIndices,
+			size_t materialCount,
+			std::vector<int>& outFaceIds,
+			std::vector<size_t>& outMaterialOffsets
+		);
+
 	private:
 
 		static MObject GenerateSmoothMesh(const MObject& object, const MObject& parent, MStatus& status);
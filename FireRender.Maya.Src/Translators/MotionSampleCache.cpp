@@ -0,0 +1,315 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "MotionSampleCache.h"
+#include "HashValue.h"
+#include "FireRenderThread.h"
+
+#include <maya/MPlug.h>
+#include <maya/MDGContext.h>
+#include <maya/MAnimControl.h>
+#include <maya/MFnMatrixData.h>
+#include <maya/MUuid.h>
+
+#if MAYA_API_VERSION >= 20180000
+#include <maya/MDGContextGuard.h>
+#endif
+
+using namespace FireMaya;
+
+MotionSampleCache::MotionSampleCache() :
+	m_baseTime(0.0),
+	m_hasBaseTime(false),
+	m_syncDepth(0),
+	m_byteSize(0),
+	m_byteBudget(DefaultByteBudget),
+	m_hits(0),
+	m_misses(0),
+	m_evaluatedSamples(0),
+	m_invalidatedSamples(0),
+	m_matrixHits(0),
+	m_matrixEvaluations(0)
+{
+}
+
+MotionSampleCache& MotionSampleCache::Instance()
+{
+	static MotionSampleCache instance;
+	return instance;
+}
+
+MTime MotionSampleCache::GetEvaluationTime()
+{
+#if MAYA_API_VERSION >= 20180000
+	MTime contextTime;
+	const MDGContext& context = MDGContext::current();
+
+	if (!context.isNormal() && (context.getTime(contextTime) == MStatus::kSuccess))
+		return contextTime;
+#endif
+
+	return MAnimControl::currentTime();
+}
+
+MTime MotionSampleCache::GetMotionEndTime(const MTime& currentTime)
+{
+	MTime nextTime = currentTime;
+
+	if (currentTime != MAnimControl::maxTime())
+	{
+		nextTime++;
+	}
+
+	return nextTime;
+}
+
+MTime MotionSampleCache::GetSampleTime(const MTime& currentTime, unsigned int sampleIdx, unsigned int sampleCount)
+{
+	if (sampleCount < 2)
+		return currentTime;
+
+	MTime endTime = GetMotionEndTime(currentTime);
+	double step = (endTime.value() - currentTime.value()) / (sampleCount - 1);
+
+	// the last sample is exactly the end time, so its matrices are shared with transform and camera blur
+	if (sampleIdx + 1 >= sampleCount)
+		return endTime;
+
+	return MTime(currentTime.value() + step * sampleIdx, currentTime.unit());
+}
+
+uint64_t MotionSampleCache::MakeKey(uint64_t key, const MTime& time)
+{
+	HashValue hash(static_cast<size_t>(key));
+	hash << time.as(MTime::kSeconds);
+
+	return uint64_t(size_t(hash));
+}
+
+uint64_t MotionSampleCache::MakeNodeKey(const std::string& uuid)
+{
+	HashValue hash;
+	hash.Append(uuid.data(), int(uuid.size()));
+
+	return uint64_t(size_t(hash));
+}
+
+void MotionSampleCache::ClearMeshSamples()
+{
+	m_meshSamples.clear();
+	m_nodeSamples.clear();
+	m_byteSize = 0;
+}
+
+void MotionSampleCache::BeginSync(const MTime& baseTime)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_syncDepth++ > 0)
+		return;
+
+	// scene could be changed since the previous sync
+	m_matrices.clear();
+
+	double seconds = baseTime.as(MTime::kSeconds);
+	if (!m_hasBaseTime || (seconds != m_baseTime))
+	{
+		ClearMeshSamples();
+		m_baseTime = seconds;
+		m_hasBaseTime = true;
+	}
+}
+
+void MotionSampleCache::EndSync()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_syncDepth > 0 && --m_syncDepth == 0)
+	{
+		m_matrices.clear();
+	}
+}
+
+MotionSampleCache::MeshSamplePtr MotionSampleCache::FindMeshSample(uint64_t key, const MTime& time)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_meshSamples.find(MakeKey(key, time));
+	if (found == m_meshSamples.end())
+	{
+		++m_misses;
+		return nullptr;
+	}
+
+	++m_hits;
+	return found->second;
+}
+
+void MotionSampleCache::InsertMeshSample(const std::string& uuid, uint64_t key, const MTime& time, MeshSamplePtr sample)
+{
+	if (!sample)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	++m_evaluatedSamples;
+
+	// samples of one frame only are kept, so instead of eviction samples above the budget are not cached
+	if (m_byteSize + sample->byteSize() > m_byteBudget)
+		return;
+
+	uint64_t sampleKey = MakeKey(key, time);
+
+	MeshSamplePtr& entry = m_meshSamples[sampleKey];
+	if (entry)
+	{
+		m_byteSize -= entry->byteSize();
+	}
+	else
+	{
+		m_nodeSamples[MakeNodeKey(uuid)].push_back(sampleKey);
+	}
+
+	entry = sample;
+	m_byteSize += sample->byteSize();
+}
+
+void MotionSampleCache::InvalidateNode(const std::string& uuid)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto found = m_nodeSamples.find(MakeNodeKey(uuid));
+	if (found == m_nodeSamples.end())
+		return;
+
+	for (uint64_t sampleKey : found->second)
+	{
+		auto sample = m_meshSamples.find(sampleKey);
+		if (sample == m_meshSamples.end())
+			continue;
+
+		m_byteSize -= sample->second->byteSize();
+		m_meshSamples.erase(sample);
+		++m_invalidatedSamples;
+	}
+
+	m_nodeSamples.erase(found);
+}
+
+bool MotionSampleCache::GetWorldMatrix(const MFnDependencyNode& nodeFn, unsigned int dagPathIndex, const MTime& time, MMatrix& outMatrix)
+{
+	MAIN_THREAD_ONLY;
+
+	HashValue hash;
+	hash << dagPathIndex;
+	std::string uuid = nodeFn.uuid().asString().asChar();
+	hash.Append(uuid.data(), int(uuid.size()));
+	uint64_t key = MakeKey(uint64_t(size_t(hash)), time);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		auto found = m_matrices.find(key);
+		if (found != m_matrices.end())
+		{
+			++m_matrixHits;
+			outMatrix = found->second;
+			return true;
+		}
+	}
+
+	MPlug matrixPlug = nodeFn.findPlug("worldMatrix");
+
+	if (matrixPlug.isNull())
+		return false;
+
+	matrixPlug = matrixPlug.elementByLogicalIndex(dagPathIndex);
+
+	MDGContext dgContext(time);
+	MObject val;
+
+#if MAYA_API_VERSION >= 20180000
+	{
+		MDGContextGuard contextGuard(dgContext);
+		val = matrixPlug.asMObject();
+	}
+#else
+	matrixPlug.getValue(val, dgContext);
+#endif
+
+	if (val.isNull())
+		return false;
+
+	outMatrix = MFnMatrixData(val).matrix();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	++m_matrixEvaluations;
+
+	if (m_syncDepth > 0)
+	{
+		m_matrices[key] = outMatrix;
+	}
+
+	return true;
+}
+
+void MotionSampleCache::SetByteBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_byteBudget = bytes;
+
+	if (m_byteSize > m_byteBudget)
+	{
+		ClearMeshSamples();
+	}
+}
+
+void MotionSampleCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	ClearMeshSamples();
+	m_matrices.clear();
+	m_hasBaseTime = false;
+}
+
+MotionSampleCache::Statistics MotionSampleCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Statistics stats;
+	stats.entryCount = m_meshSamples.size();
+	stats.byteSize = m_byteSize;
+	stats.byteBudget = m_byteBudget;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.evaluatedSamples = m_evaluatedSamples;
+	stats.invalidatedSamples = m_invalidatedSamples;
+	stats.matrixHits = m_matrixHits;
+	stats.matrixEvaluations = m_matrixEvaluations;
+
+	return stats;
+}
+
+void MotionSampleCache::ResetStatistics()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_hits = 0;
+	m_misses = 0;
+	m_evaluatedSamples = 0;
+	m_invalidatedSamples = 0;
+	m_matrixHits = 0;
+	m_matrixEvaluations = 0;
+}
@@ -0,0 +1,134 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#pragma once
+
+#include <maya/MTime.h>
+#include <maya/MMatrix.h>
+#include <maya/MFnDependencyNode.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+namespace FireMaya
+{
+	// Motion blur samples evaluated at sub-frame times through MDGContext, so current time is never changed.
+	// Deformation samples are kept for one base frame and reused when the same frame is synced again
+	// (key includes node, sample time and content of the base frame, see MeshPolygonData::CalculateDeformationKey).
+	// Samples of a node are dropped when the node is dirty, see InvalidateNode.
+	// World matrices are shared between deformation, transform and camera blur inside a scene sync.
+	class MotionSampleCache
+	{
+		MotionSampleCache();
+
+	public:
+		struct MeshSample
+		{
+			std::vector<float> points;
+			std::vector<float> normals;
+
+			size_t byteSize(void) const { return (points.size() + normals.size()) * sizeof(float); }
+		};
+
+		typedef std::shared_ptr<const MeshSample> MeshSamplePtr;
+
+		struct Statistics
+		{
+			size_t entryCount = 0;
+			size_t byteSize = 0;
+			size_t byteBudget = 0;
+			unsigned long long hits = 0;
+			unsigned long long misses = 0;
+			unsigned long long evaluatedSamples = 0;	// mesh samples evaluated through DG context
+			unsigned long long invalidatedSamples = 0;	// dropped by InvalidateNode
+			unsigned long long matrixHits = 0;
+			unsigned long long matrixEvaluations = 0;
+		};
+
+		// Keeps sync scope open until the end of the block, see BeginSync
+		class SyncScope
+		{
+		public:
+			explicit SyncScope(const MTime& baseTime) { Instance().BeginSync(baseTime); }
+			~SyncScope() { Instance().EndSync(); }
+
+			SyncScope(const SyncScope&) = delete;
+			SyncScope& operator=(const SyncScope&) = delete;
+		};
+
+		static const size_t DefaultByteBudget = size_t(1024) * 1024 * 1024;
+
+		static MotionSampleCache& Instance();
+
+		// Time the scene is read at: time of the current DG context if the scene is evaluated through
+		// MDGContextGuard (viewport cache prewarm), current time otherwise
+		static MTime GetEvaluationTime();
+
+		// End of motion blur interval: the next frame unless current frame is the last one. The same for all kinds of blur
+		static MTime GetMotionEndTime(const MTime& currentTime);
+
+		// Time of deformation sample, samples are evenly spread from currentTime to GetMotionEndTime
+		static MTime GetSampleTime(const MTime& currentTime, unsigned int sampleIdx, unsigned int sampleCount);
+
+		// Matrices are cached only inside sync scope. Mesh samples of other base frames are dropped
+		void BeginSync(const MTime& baseTime);
+		void EndSync();
+
+		MeshSamplePtr FindMeshSample(uint64_t key, const MTime& time);
+		void InsertMeshSample(const std::string& uuid, uint64_t key, const MTime& time, MeshSamplePtr sample);
+
+		// Drops samples of the node with given uuid. Expressions, cache files or time offsets can change
+		// sub-frame samples while the base frame stays the same, so it's called from the node dirty callback
+		void InvalidateNode(const std::string& uuid);
+
+		// Returns world matrix of given instance at given time, main thread only
+		bool GetWorldMatrix(const MFnDependencyNode& nodeFn, unsigned int dagPathIndex, const MTime& time, MMatrix& outMatrix);
+
+		void SetByteBudget(size_t bytes);
+
+		void Clear();
+
+		Statistics GetStatistics() const;
+		void ResetStatistics();
+
+	private:
+		static uint64_t MakeKey(uint64_t key, const MTime& time);
+		static uint64_t MakeNodeKey(const std::string& uuid);
+
+		void ClearMeshSamples();
+
+		std::unordered_map<uint64_t, MeshSamplePtr> m_meshSamples;
+		// keys of m_meshSamples entries of every node
+		std::unordered_map<uint64_t, std::vector<uint64_t>> m_nodeSamples;
+		std::unordered_map<uint64_t, MMatrix> m_matrices;
+
+		double m_baseTime;
+		bool m_hasBaseTime;
+		int m_syncDepth;
+
+		size_t m_byteSize;
+		size_t m_byteBudget;
+
+		unsigned long long m_hits;
+		unsigned long long m_misses;
+		unsigned long long m_evaluatedSamples;
+		unsigned long long m_invalidatedSamples;
+		unsigned long long m_matrixHits;
+		unsigned long long m_matrixEvaluations;
+
+		mutable std::mutex m_mutex;
+	};
+}
@@ -11,6 +11,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ********************************************************************/
 #include "SingleShaderMeshTranslator.h"
+#include "Tracing.h"
 
 void FireMaya::SingleShaderMeshTranslator::TranslateMesh(
 	const frw::Context& context,
@@ -20,6 +21,8 @@ void FireMaya::SingleShaderMeshTranslator::TranslateMesh(
 	const MIntArray& faceMaterialIndices,
 	std::vector<int>& outFaceMaterialIndices)
 {
+	RPR_TRACE_ZONE("SingleShaderMeshTranslator::TranslateMesh");
+
 	// output indices of vertexes (3 indices for each triangle, 4 for quads)
 	std::vector<int> faceVertexIndices;
 	faceVertexIndices.reserve(meshData.triangleVertexIndicesCount);
@@ -53,15 +56,9 @@ void FireMaya::SingleShaderMeshTranslator::TranslateMesh(
 
 	// iterate through mesh
 
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point start_AddPolygon = std::chrono::steady_clock::now();
-#endif
 	MeshIndicesData data(faceVertexIndices, faceNormalIndices, uvIndices, vertexColors, colorVertexIndices, numFaceVertices);
 	for (auto it = MItMeshPolygon(fnMesh.object()); !it.isDone(); it.next())
 	{
-#ifdef OPTIMIZATION_CLOCK
-		std::chrono::steady_clock::time_point start_inner_AddPolygon = std::chrono::steady_clock::now();
-#endif
 		AddPolygonSingleShader(
 			it, 
 			meshData.uvSetNames, 
@@ -69,20 +66,46 @@ void FireMaya::SingleShaderMeshTranslator::TranslateMesh(
 			faceMaterialIndices,
 			outFaceMaterialIndices
 		);
+	}
 
-#ifdef OPTIMIZATION_CLOCK
-		std::chrono::steady_clock::time_point fin_inner_AddPolygon = std::chrono::steady_clock::now();
-		std::chrono::microseconds elapsed_inner_AddPolygon = std::chrono::duration_cast<std::chrono::microseconds>(fin_inner_AddPolygon - start_inner_AddPolygon);
+	CreateRPRMesh(context, outShape, meshData,
+		faceVertexIndices, faceNormalIndices, uvIndices, numFaceVertices, vertexColors, colorVertexIndices,
+		fnMesh.name().asChar());
+}
 
-		FireRenderContext::timeInInnerAddPolygon += elapsed_inner_AddPolygon.count();
-#endif
-	}
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point fin_AddPolygon = std::chrono::steady_clock::now();
-	std::chrono::milliseconds elapsed_AddPolygon = std::chrono::duration_cast<std::chrono::milliseconds>(fin_AddPolygon - start_AddPolygon);
-	FireRenderContext::overallAddPolygon += elapsed_AddPolygon.count();
+void FireMaya::SingleShaderMeshTranslator::TranslateMesh(
+	const frw::Context& context,
+	frw::Shape& outShape,
+	MeshTranslator::MeshPolygonData& meshData,
+	std::vector<int>& outFaceMaterialIndices)
+{
+	assert(meshData.HasIndices());
+
+	// indices may be shared with other meshes of the same geometry (see MeshCache), keep meshData alive until mesh is created
+	MeshTranslator::MeshIndicesPtr indicesPtr = meshData.indices;
+	const MeshTranslator::MeshIndices& indices = *indicesPtr;
 
-#endif
+	outFaceMaterialIndices = indices.faceMaterialIndices;
+
+	CreateRPRMesh(context, outShape, meshData,
+		indices.faceVertexIndices, indices.faceNormalIndices, indices.uvIndices, indices.numFaceVertices,
+		indices.vertexColors, indices.colorVertexIndices,
+		meshData.shapeName.c_str());
+}
+
+void FireMaya::SingleShaderMeshTranslator::CreateRPRMesh(
+	const frw::Context& context,
+	frw::Shape& outShape,
+	MeshTranslator::MeshPolygonData& meshData,
+	const std::vector<int>& faceVertexIndices,
+	const std::vector<int>& faceNormalIndices,
+	const std::vector<std::vector<int>>& uvIndices,
+	const std::vector<int>& numFaceVertices,
+	const std::vector<MColor>& vertexColors,
+	const std::vector<int>& colorVertexIndices,
+	const char* meshName)
+{
+	unsigned int uvSetCount = (unsigned int) uvIndices.size();
 
 	// auxiliary array for passing data to RPR
 	std::vector<const rpr_int*>	puvIndices;
@@ -102,9 +125,7 @@ void FireMaya::SingleShaderMeshTranslator::TranslateMesh(
 	}
 
 	// create mesh in RPR
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-#endif
+	RPR_TRACE_ZONE("SingleShaderMeshTranslator::CreateRPRMesh");
 
 	rpr_mesh_info mesh_properties[16] = { 0 };
 
@@ -123,7 +144,7 @@ void FireMaya::SingleShaderMeshTranslator::TranslateMesh(
 		faceVertexIndices.data(), sizeof(rpr_int),
 		faceNormalIndices.data(), sizeof(rpr_int),
 		puvIndices.data(), texIndexStride.data(),
-		numFaceVertices.data(), numFaceVertices.size(), mesh_properties, fnMesh.name().asChar());
+		numFaceVertices.data(), numFaceVertices.size(), mesh_properties, meshName);
 
 	if (!vertexColors.empty())
 	{
@@ -131,12 +152,6 @@ void FireMaya::SingleShaderMeshTranslator::TranslateMesh(
 	}
 
 	meshData.clear();
-
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point fin = std::chrono::steady_clock::now();
-	std::chrono::milliseconds elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(fin - start);
-	FireRenderContext::overallCreateMeshEx += elapsed.count();
-#endif
 }
 
 void FireMaya::SingleShaderMeshTranslator::ProcessIndexesSimplified(
@@ -190,10 +205,6 @@ void FireMaya::SingleShaderMeshTranslator::AddPolygonSingleShader(
 {
 	MStatus mayaStatus;
 
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point start_Vtx = std::chrono::steady_clock::now();
-#endif
-
 	// get indices of vertexes of polygon
 	// - these are indices of verts of polygon, not triangles!!!
 	MIntArray vertices;
@@ -239,12 +250,6 @@ void FireMaya::SingleShaderMeshTranslator::AddPolygonSingleShader(
 		for (unsigned int idx = 0; idx < trianglesVertexList.length() / 3; ++idx)
 			idxData.numFaceVertices.push_back(3);
 
-#ifdef OPTIMIZATION_CLOCK
-		std::chrono::steady_clock::time_point fin_1GetData = std::chrono::steady_clock::now();
-		std::chrono::nanoseconds elapsed_1GetData = std::chrono::duration_cast<std::chrono::nanoseconds>(fin_1GetData - start_Vtx);
-		FireRenderContext::timeGetDataFromMaya += elapsed_1GetData.count();
-#endif
-
 		// write indices of triangles in mesh into output triangle indices array
 		for (unsigned int globalVertexIndex = 0; globalVertexIndex < trianglesVertexList.length(); ++globalVertexIndex)
 		{
@@ -294,13 +299,6 @@ void FireMaya::SingleShaderMeshTranslator::AddPolygonSingleShader(
 			outFaceMaterialIndices.push_back(shaderId);
 		}
 	}
-
-#ifdef OPTIMIZATION_CLOCK
-	std::chrono::steady_clock::time_point fin_Vtx = std::chrono::steady_clock::now();
-	std::chrono::nanoseconds elapsed_Vtxp = std::chrono::duration_cast<std::chrono::nanoseconds>(fin_Vtx - start_Vtx);
-
-	FireRenderContext::translateData += elapsed_Vtxp.count();
-#endif
 }
 
 void FireMaya::SingleShaderMeshTranslator::FillIndicesUV(
@@ -324,15 +322,7 @@ void FireMaya::SingleShaderMeshTranslator::FillIndicesUV(
 
 			const MString& name = uvSetNames[currentChannelUV];
 
-#ifdef OPTIMIZATION_CLOCK
-			std::chrono::steady_clock::time_point start_3GetData = std::chrono::steady_clock::now();
-#endif
 			MStatus status = meshPolygonIterator.getUVIndex(it->second, uvIndex, &name);
-#ifdef OPTIMIZATION_CLOCK
-			std::chrono::steady_clock::time_point fin_3GetData = std::chrono::steady_clock::now();
-			std::chrono::nanoseconds elapsed_3GetData = std::chrono::duration_cast<std::chrono::nanoseconds>(fin_3GetData - start_3GetData);
-			FireRenderContext::timeGetDataFromMaya += elapsed_3GetData.count();
-#endif
 
 			if (status == MStatus::kSuccess)
 			{
@@ -359,15 +349,7 @@ void FireMaya::SingleShaderMeshTranslator::FillNormalsIndices(
 		auto it = vertexIdxGlobalToLocal.find(trianglesVertexList[globalVertexIndex]);
 		assert(it != vertexIdxGlobalToLocal.end());
 
-#ifdef OPTIMIZATION_CLOCK
-		std::chrono::steady_clock::time_point start_2GetData = std::chrono::steady_clock::now();
-#endif
 		unsigned int normalIndex = meshPolygonIterator.normalIndex(it->second);
-#ifdef OPTIMIZATION_CLOCK
-		std::chrono::steady_clock::time_point fin_2GetData = std::chrono::steady_clock::now();
-		std::chrono::nanoseconds elapsed_2GetData = std::chrono::duration_cast<std::chrono::nanoseconds>(fin_2GetData - start_2GetData);
-		FireRenderContext::timeGetDataFromMaya += elapsed_2GetData.count();
-#endif
 
 		outNormalIndices.push_back(normalIndex);
 	}
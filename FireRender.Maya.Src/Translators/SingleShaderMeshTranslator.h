@@ -29,7 +29,31 @@ namespace FireMaya
 			std::vector<int>& outFaceMaterialIndices
 		);
 
+		/** Creates mesh from indices prepared by BuildIndices */
+		static void TranslateMesh(
+			const frw::Context& context,
+			frw::Shape& outShape,
+			MeshTranslator::MeshPolygonData& meshPolygonData,
+			std::vector<int>& outFaceMaterialIndices
+		);
+
+		/** Builds rpr indices from gathered topology. Doesn't call Maya API */
+		static void BuildIndices(const MeshTranslator::MeshPolygonData& meshPolygonData, MeshTranslator::MeshIndices& outIndices);
+
 	private:
+		static void CreateRPRMesh(
+			const frw::Context& context,
+			frw::Shape& outShape,
+			MeshTranslator::MeshPolygonData& meshData,
+			const std::vector<int>& faceVertexIndices,
+			const std::vector<int>& faceNormalIndices,
+			const std::vector<std::vector<int>>& uvIndices,
+			const std::vector<int>& numFaceVertices,
+			const std::vector<MColor>& vertexColors,
+			const std::vector<int>& colorVertexIndices,
+			const char* meshName
+		);
+
 		struct MeshIndicesData
 		{
 			std::vector<int>& triangleVertexIndices;
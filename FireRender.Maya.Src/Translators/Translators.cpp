@@ -49,6 +49,7 @@ limitations under the License.
 #include "FireRenderGlobals.h"
 #include "FireRenderMath.h"
 #include "FireRenderThread.h"
+#include "MotionSampleCache.h"
 
 #include "PhysicalLightAttributes.h"
 #include "PhysicalLightGeometryUtility.h"
@@ -274,25 +275,13 @@ namespace FireMaya
 
 	void GetMatrixForTheNextFrame(const MFnDependencyNode& nodeFn, float matrixFloats[4][4], unsigned int dagPathIndex)
 	{
-		MTime nextTime = MAnimControl::currentTime();
-		MTime maxTime = MAnimControl::maxTime();
+		// the same sample is used by deformation blur, see FireRenderContext::ReadDeformationSamples
+		MTime nextTime = MotionSampleCache::GetMotionEndTime(MotionSampleCache::GetEvaluationTime());
 
-		if (MAnimControl::currentTime() != maxTime)
-		{
-			nextTime++;
-		}
-
-		MDGContext dgcontext(nextTime);
-		MObject val;
-		MPlug matrixPlug = nodeFn.findPlug("worldMatrix");
-
-		if (matrixPlug.isNull())
+		MMatrix nextFrameMatrix;
+		if (!MotionSampleCache::Instance().GetWorldMatrix(nodeFn, dagPathIndex, nextTime, nextFrameMatrix))
 			return;
 
-		matrixPlug = matrixPlug.elementByLogicalIndex(dagPathIndex);
-		matrixPlug.getValue(val, dgcontext);
-		MMatrix nextFrameMatrix = MFnMatrixData(val).matrix();
-
 		ScaleMatrixFromCmToMFloats(nextFrameMatrix, matrixFloats);
 	}
 
@@ -310,18 +299,12 @@ namespace FireMaya
 		MMatrix matrix = inMatrix;
 		matrix *= scaleM;
 
-		MTime nextTime = MAnimControl::currentTime();
-		MTime maxTime = MAnimControl::maxTime();
+		MTime currentTime = MotionSampleCache::GetEvaluationTime();
+		MTime nextTime = MotionSampleCache::GetMotionEndTime(currentTime);
 
-		if (MAnimControl::currentTime() != maxTime)
+		MMatrix nextFrameMatrix;
+		if ((nextTime != currentTime) && MotionSampleCache::Instance().GetWorldMatrix(nodeFn, dagPathIndex, nextTime, nextFrameMatrix))
 		{
-			nextTime++;
-			MDGContext dgcontext(nextTime);
-			MObject val;
-			MPlug matrixPlug = nodeFn.findPlug("worldMatrix");
-			matrixPlug = matrixPlug.elementByLogicalIndex(dagPathIndex);
-			matrixPlug.getValue(val, dgcontext);
-			MMatrix nextFrameMatrix = MFnMatrixData(val).matrix();
 			if (nextFrameMatrix != matrix)
 			{
 				MMatrix nextMatrix = nextFrameMatrix;
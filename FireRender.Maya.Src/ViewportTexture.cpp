@@ -15,7 +15,7 @@ ViewportTexture::~ViewportTexture()
 	Release();
 }
 
-MStatus ViewportTexture::UpdateTexture(float* externalData /* = nullptr*/)
+MStatus ViewportTexture::UpdateTexture(const float* externalData /* = nullptr*/)
 {
 	if (m_texture != nullptr)
 	{
@@ -101,7 +101,7 @@ void ViewportTexture::Release()
 	}
 }
 
-void ViewportTexture::SetPixelData(std::vector<float> vecData)
+void ViewportTexture::SwapPixelData(std::vector<float>& vecData)
 {
-	m_pixels = std::move(vecData);
+	m_pixels.swap(vecData);
 }
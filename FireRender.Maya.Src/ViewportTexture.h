@@ -10,7 +10,7 @@ public:
 	~ViewportTexture();
 
 	// only from main thread
-	MStatus UpdateTexture(float* externalData = nullptr);
+	MStatus UpdateTexture(const float* externalData = nullptr);
 
 	void Resize(unsigned int width, unsigned int height);
 
@@ -19,7 +19,8 @@ public:
 	MTexture* GetTexture() const{ return m_texture; }
 
 	float* GetPixelData() { return m_pixels.data(); }
-	void SetPixelData(std::vector<float> vecData);
+	// vecData receives previous pixels, so both buffers stay allocated
+	void SwapPixelData(std::vector<float>& vecData);
 
 private:
 	void ClearPixels();
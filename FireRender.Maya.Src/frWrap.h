@@ -1304,6 +1304,37 @@ namespace frw
 			checkStatus(status);
 			return format.num_components == 4;
 		}
+
+		// Reads back pixels stored in the image. Returns false if image has no own pixels (UDIM master image etc.)
+		size_t GetDataSize() const
+		{
+			size_t dataSize = 0;
+
+			if (rprImageGetInfo(Handle(), RPR_IMAGE_DATA_SIZEBYTE, sizeof(dataSize), &dataSize, NULL) != RPR_SUCCESS)
+				return 0;
+
+			return dataSize;
+		}
+
+		bool GetPixels(rpr_image_format& format, rpr_image_desc& desc, std::vector<unsigned char>& pixels) const
+		{
+			if (!data().m_udimsMap.empty())
+				return false;
+
+			size_t dataSize = 0;
+
+			if (rprImageGetInfo(Handle(), RPR_IMAGE_FORMAT, sizeof(format), &format, NULL) != RPR_SUCCESS ||
+				rprImageGetInfo(Handle(), RPR_IMAGE_DESC, sizeof(desc), &desc, NULL) != RPR_SUCCESS ||
+				rprImageGetInfo(Handle(), RPR_IMAGE_DATA_SIZEBYTE, sizeof(dataSize), &dataSize, NULL) != RPR_SUCCESS ||
+				dataSize == 0)
+			{
+				return false;
+			}
+
+			pixels.resize(dataSize);
+
+			return rprImageGetInfo(Handle(), RPR_IMAGE_DATA, dataSize, pixels.data(), NULL) == RPR_SUCCESS;
+		}
 	};
 
 	class PointLight : public Light
@@ -17,6 +17,8 @@ limitations under the License.
 #include <maya/MGlobal.h>
 #include <maya/MStatus.h>
 #include <maya/MSceneMessage.h>
+#include <maya/MAnimMessage.h>
+#include <maya/MTimerMessage.h>
 #include <maya/MFileIO.h>
 #include <maya/MNodeClass.h>
 
@@ -35,6 +37,7 @@ limitations under the License.
 #include "FireMaterialViewRenderer.h"
 #include "FireRenderGlobals.h"
 #include "FireRenderCmd.h"
+#include "Tracing.h"
 #include "FireRenderLocationCmd.h"
 #include "EnableSaveIntermediateCmd.h"
 #include "FireRenderIBL.h"
@@ -94,9 +97,11 @@ limitations under the License.
 #include <maya/MNodeClass.h>
 
 #include "FireRenderThread.h"
+#include "ParallelUtils.h"
 
 #include "GLTFTranslator.h"
 #include "StartupContextChecker.h"
+#include "Translators/MotionSampleCache.h"
 
 #ifdef _WIN32
 #pragma warning( disable : 4091 )
@@ -115,6 +120,10 @@ MCallbackId beforeOpenSceneCallback;
 
 MCallbackId mayaExitingCallback;
 
+MCallbackId animCurveEditedCallback;
+
+MCallbackId startupCheckCallback = 0;
+
 #ifdef _WIN32
 static LPTOP_LEVEL_EXCEPTION_FILTER pTopLevelExceptionFilter = nullptr;
 
@@ -182,6 +191,41 @@ void NewSceneBasicSetup(void* data)
 {
 	MGlobal::executeCommand("source \"common.mel\"; checkRPRGlobalsNode(); workingUnitsScriptJobSetup();");
 	MGlobal::executeCommand("source \"AERPRToonMaterialTemplate.mel\"; ConvertLegacyLightLinkedAttribute();");
+
+	MotionSampleCache::Instance().Clear();
+}
+
+// Cached sub-frame samples are validated by the content of the current frame only, so animation edits drop them
+void animCurveEdited(MObjectArray& editedCurves, void* data)
+{
+	MotionSampleCache::Instance().Clear();
+}
+
+// Passes ML denoiser support to the render settings UI
+void setMLDenoiserSupportedCPU()
+{
+	bool supported = StartupContextChecker::IsMLDenoiserSupportedCPU();
+	if (!supported)
+	{
+		MGlobal::displayWarning("Machine learning denoiser is not supported by current CPU");
+	}
+
+	MGlobal::executeCommand(MString("setMlDenoiserSupportedCPU(") + int(supported) + ")");
+
+	// denoiser type menu could be already created
+	MGlobal::executeCommand("if (`menuItem -exists RPR_MLItem`) onFireRenderEffectsSelected();");
+}
+
+// Plugin load doesn't wait for the startup check, UI gets the ML denoiser support when it is finished
+void startupCheckTimer(float elapsedTime, float lastTime, void* clientData)
+{
+	if (!StartupContextChecker::IsFinished())
+		return;
+
+	MMessage::removeCallback(startupCheckCallback);
+	startupCheckCallback = 0;
+
+	setMLDenoiserSupportedCPU();
 }
 
 void swapToDefaultRenderOverride(void* data) {
@@ -218,6 +262,7 @@ void mayaExiting(void* data)
 	FireRenderCmd::cleanUp();
 
 	FireRenderThread::RunTheThread(false);
+	WorkerPool::Instance().Shutdown();
 	std::this_thread::yield();
 }
 
@@ -321,6 +366,36 @@ void InfoCallback(const char *sz)
 	MGlobal::displayInfo(sz);
 }
 
+// Log file is written in background: RPR_MAYA_LOG_FILE sets the path (".jsonl" files are JSON lines, others are binary),
+// RPR_MAYA_LOG_LEVEL sets the lowest written level (debug, info, warning or error; debug by default)
+void OpenLogFile()
+{
+	const char* path = std::getenv("RPR_MAYA_LOG_FILE");
+	if (!path || !*path)
+		return;
+
+	Logger::LevelEnum level = Logger::LevelDebug;
+	if (const char* levelName = std::getenv("RPR_MAYA_LOG_LEVEL"))
+	{
+		std::string name(levelName);
+
+		if (name == "info")
+			level = Logger::LevelInfo;
+		else if (name == "warning")
+			level = Logger::LevelWarn;
+		else if (name == "error")
+			level = Logger::LevelError;
+	}
+
+	std::string pathString(path);
+	bool isJson = (pathString.size() >= 6) && (pathString.compare(pathString.size() - 6, 6, ".jsonl") == 0);
+
+	if (!Logger::OpenSink(pathString, isJson ? Logger::SinkJsonLines : Logger::SinkBinary, level))
+	{
+		MGlobal::displayWarning(MString("Unable to open log file ") + path);
+	}
+}
+
 class FireRenderRenderPass : public MPxNode {
 public:
 
@@ -587,7 +662,10 @@ MStatus initializePlugin(MObject obj)
 	// Added for Linux:
 	Logger::AddCallback(InfoCallback, Logger::LevelInfo);
 
+	OpenLogFile();
+
 	FireMaya::gMainThreadId = std::this_thread::get_id();
+	FireMaya::Trace::SetThreadName("Maya main");
 	FireRenderThread::RunTheThread(true);
 
 #ifdef OSMac_
@@ -606,7 +684,12 @@ MStatus initializePlugin(MObject obj)
 
 #ifdef NT_PLUGIN
 
+#ifdef _DEBUG
 	Logger::AddCallback(DebugCallback, Logger::LevelDebug);
+#else
+	// debug messages are compiled in, but are written only to the log file in release builds
+	Logger::AddCallback(DebugCallback, Logger::LevelInfo);
+#endif
 
 	if (auto path = std::getenv("FR_TRACE_OUTPUT"))
 	{
@@ -647,16 +730,8 @@ MStatus initializePlugin(MObject obj)
 
 	glewInit();
 
+	// RPR context check keeps running in background, it is waited for by the first render (FireRenderContext::buildScene)
 	StartupContextChecker::CheckContexts();
-	if (!StartupContextChecker::IsRprSupported())
-	{
-		return MStatus::kFailure;
-	}
-
-	if (!StartupContextChecker::IsMLDenoiserSupportedCPU())
-	{
-		MGlobal::displayWarning("Machine learning denoiser is not supported by current CPU");
-	}
 
 	CHECK_MSTATUS(plugin.registerNode("RadeonProRenderGlobals", FireRenderGlobals::FRTypeID(),
 		FireRenderGlobals::creator,
@@ -778,11 +853,21 @@ MStatus initializePlugin(MObject obj)
 	openSceneCallback = MSceneMessage::addCallback(MSceneMessage::kAfterOpen, NewSceneBasicSetup, NULL, &status);
 	CHECK_MSTATUS(status);
 
-	auto mlDenoiserSupportedCPU = static_cast<int>(StartupContextChecker::IsMLDenoiserSupportedCPU());
-	MString mlSupportCPU = MString(std::to_string(mlDenoiserSupportedCPU).c_str());
+	animCurveEditedCallback = MAnimMessage::addAnimCurveEditedCallback(animCurveEdited, NULL, &status);
+	CHECK_MSTATUS(status);
 
-	MString registerCmd = MString("registerFireRender(" + mlSupportCPU + ")");
-	MGlobal::executeCommand(registerCmd);
+	// ML denoiser is assumed to be supported until the startup check says otherwise
+	MGlobal::executeCommand("registerFireRender(1)");
+
+	if (StartupContextChecker::IsFinished())
+	{
+		setMLDenoiserSupportedCPU();
+	}
+	else
+	{
+		startupCheckCallback = MTimerMessage::addTimerCallback(0.25f, startupCheckTimer, nullptr, &status);
+		CHECK_MSTATUS(status);
+	}
 
 	MGlobal::executeCommand("setupFireRenderNodeClassification()");
 
@@ -1034,6 +1119,7 @@ MStatus uninitializePlugin(MObject obj)
 
 	FireRenderViewportManager::instance().clear();
 	FireRenderThread::RunTheThread(false);
+	WorkerPool::Instance().Shutdown();
 	std::this_thread::yield();
 
 	CHECK_MSTATUS(plugin.deregisterCommand("fireRender"));
@@ -1104,6 +1190,14 @@ MStatus uninitializePlugin(MObject obj)
 	MMessage::removeCallback(beforeNewSceneCallback);
 	MMessage::removeCallback(beforeOpenSceneCallback);
 
+	MMessage::removeCallback(animCurveEditedCallback);
+
+	if (startupCheckCallback != 0)
+	{
+		MMessage::removeCallback(startupCheckCallback);
+		startupCheckCallback = 0;
+	}
+
 	// Delete the viewport render override.
 	FireRenderOverride::deleteInstance();
 
@@ -1124,5 +1218,7 @@ MStatus uninitializePlugin(MObject obj)
 	RPRRelease();
 #endif
 
+	Logger::CloseSink();
+
 	return status;
 }
@@ -0,0 +1,205 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "stdafx.h"
+#include "../FireRender.Maya.Src/FireRenderThread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FireMaya;
+
+namespace fireRenderUnitTests
+{
+	TEST_CLASS(FireRenderThreadTests)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		// Stands in for a viewport context: scene changes bump the version and call Wake,
+		// "keep running" item renders a frame when it sees a new version and reports idle otherwise
+		struct MockContext
+		{
+			std::atomic<unsigned int> version{ 0 };
+			std::atomic<bool> stopRequested{ false };
+			std::atomic<bool> stopped{ false };
+
+			std::atomic<unsigned int> renderedVersion{ 0 };	// written by RPR thread only
+
+			std::mutex mutex;
+			std::vector<Clock::time_point> changeTimes;
+			std::vector<double> latenciesMs;
+
+			void Change()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					changeTimes.push_back(Clock::now());
+					version++;
+				}
+
+				FireRenderThread::Wake();
+			}
+
+			bool RenderPass(std::chrono::microseconds frameTime)
+			{
+				if (stopRequested)
+				{
+					stopped = true;
+					return false;
+				}
+
+				unsigned int currentVersion = version;
+				unsigned int previousVersion = renderedVersion;
+				if (currentVersion == previousVersion)
+				{
+					FireRenderThread::ReportIdle();
+					return true;
+				}
+
+				std::this_thread::sleep_for(frameTime);
+
+				// latency of every change picked up by this frame
+				auto frameTimePoint = Clock::now();
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					for (unsigned int changeIdx = previousVersion; changeIdx < currentVersion; ++changeIdx)
+					{
+						latenciesMs.push_back(std::chrono::duration<double, std::milli>(frameTimePoint - changeTimes[changeIdx]).count());
+					}
+				}
+
+				renderedVersion = currentVersion;
+				return true;
+			}
+		};
+
+		static double Percentile(std::vector<double> values, double fraction)
+		{
+			std::sort(values.begin(), values.end());
+			return values[std::min(values.size() - 1, size_t(fraction * values.size()))];
+		}
+
+		static void RunStress(int changeCount, int maxGapUs, std::chrono::microseconds frameTime, const char* label)
+		{
+			FireMaya::gMainThreadId = std::this_thread::get_id();
+
+			MockContext mockContext;
+			FireRenderThread::KeepRunning([&mockContext, frameTime]() { return mockContext.RenderPass(frameTime); });
+
+			// changes land at any point of the render pass, also right between the idle check and the wait
+			std::mt19937 random(12345);
+			std::uniform_int_distribution<int> gapUs(0, maxGapUs);
+
+			for (int changeIdx = 0; changeIdx < changeCount; ++changeIdx)
+			{
+				mockContext.Change();
+				std::this_thread::sleep_for(std::chrono::microseconds(gapUs(random)));
+			}
+
+			// last change must be rendered without waiting for the idle poll timeout
+			auto waitStart = Clock::now();
+			while (mockContext.version != mockContext.renderedVersion)
+			{
+				Assert::IsTrue(Clock::now() - waitStart < std::chrono::seconds(5), L"last change was never rendered");
+				std::this_thread::yield();
+			}
+
+			auto stopStart = Clock::now();
+			mockContext.stopRequested = true;
+			FireRenderThread::Wake();
+			// the same wait FireRenderViewport::stop does, predicate is called under the queue lock
+			FireRenderThread::WaitOnMainThreadUntil([&mockContext]() { return mockContext.stopped.load(); });
+			double stopMs = std::chrono::duration<double, std::milli>(Clock::now() - stopStart).count();
+
+			std::vector<double> latencies;
+			{
+				std::lock_guard<std::mutex> lock(mockContext.mutex);
+				latencies = mockContext.latenciesMs;
+			}
+
+			Assert::AreEqual(size_t(changeCount), latencies.size());
+
+			double maxLatency = *std::max_element(latencies.begin(), latencies.end());
+
+			std::string message = std::string(label) + ": change -> frame p50 " + std::to_string(Percentile(latencies, 0.5)) +
+				" ms, p99 " + std::to_string(Percentile(latencies, 0.99)) + " ms, max " + std::to_string(maxLatency) +
+				" ms, stop " + std::to_string(stopMs) + " ms";
+			Logger::WriteMessage(message.c_str());
+
+			// lost wake would leave the change waiting for the 100 ms idle poll
+			Assert::IsTrue(maxLatency < 75.0, L"change waited for idle timeout");
+			Assert::IsTrue(stopMs < 75.0, L"stop waited for idle timeout");
+		}
+
+	public:
+		TEST_METHOD(WakeIsNotLostWhileGoingIdle)
+		{
+			// back to back changes racing with item reporting idle
+			RunStress(5000, 50, std::chrono::microseconds(0), "WakeIsNotLostWhileGoingIdle");
+		}
+
+		TEST_METHOD(ChangeToFrameLatency)
+		{
+			// viewport-like pace: 1 ms frames, changes every few ms
+			RunStress(500, 5000, std::chrono::microseconds(1000), "ChangeToFrameLatency");
+		}
+
+		TEST_METHOD(MainThreadWaitDoesNotSpinOnKeepRunningItems)
+		{
+			FireMaya::gMainThreadId = std::this_thread::get_id();
+
+			// like production render pump: stays in the main thread queue until the render is done
+			std::atomic<bool> pumpStopped{ false };
+			std::atomic<unsigned int> pumpCount{ 0 };
+			FireRenderThread::KeepRunningOnMainThread([&pumpStopped, &pumpCount]()
+			{
+				pumpCount++;
+				return !pumpStopped;
+			});
+
+			// the same wait as when main thread waits for RPR thread to stop rendering
+			std::atomic<bool> done{ false };
+			std::thread worker([&done]()
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(300));
+				done = true;
+			});
+
+			FireRenderThread::WaitOnMainThreadUntil([&done]() { return done.load(); });
+			worker.join();
+
+			unsigned int runsDuringWait = pumpCount;
+
+			pumpStopped = true;
+			FireRenderThread::RunItemsQueuedForTheMainThread();
+
+			Logger::WriteMessage(("MainThreadWaitDoesNotSpinOnKeepRunningItems: pump ran " + std::to_string(runsDuringWait) + " times during the wait").c_str());
+
+			// item is run again on every wait timeout, not in a loop
+			Assert::IsTrue(runsDuringWait >= 1);
+			Assert::IsTrue(runsDuringWait <= 10, L"main thread wait is spinning");
+		}
+
+		TEST_CLASS_CLEANUP(StopRprThread)
+		{
+			// worker thread has to be joined before static destructors run
+			FireRenderThread::RunTheThread(false);
+		}
+	};
+}
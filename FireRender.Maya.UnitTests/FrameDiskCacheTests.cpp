@@ -0,0 +1,173 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "stdafx.h"
+#include "../FireRender.Maya.Src/FrameDiskCache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FireMaya;
+
+namespace fs = std::filesystem;
+
+namespace fireRenderUnitTests
+{
+	TEST_CLASS(FrameDiskCacheTests)
+	{
+		static constexpr int FrameWidth = 3;
+		static constexpr int FrameHeight = 2;
+		static constexpr size_t FrameFileSize = 32 + FrameWidth * FrameHeight * 4 * sizeof(float);	// header and float pixels
+
+		static std::string Directory(const char* name)
+		{
+			fs::path path = fs::temp_directory_path() / "RprFrameDiskCacheTests" / name;
+
+			std::error_code error;
+			fs::remove_all(path, error);
+
+			return path.u8string();
+		}
+
+		static size_t CountFiles(const std::string& directory)
+		{
+			size_t count = 0;
+
+			std::error_code error;
+			for (const fs::directory_entry& entry : fs::directory_iterator(fs::u8path(directory), error))
+			{
+				count += entry.is_regular_file(error) ? 1 : 0;
+			}
+
+			return count;
+		}
+
+		static StoredFrame MakeFrame(float base)
+		{
+			StoredFrame frame(FrameWidth, FrameHeight);
+
+			float* pixels = frame.data();
+			for (size_t idx = 0; idx < frame.ComponentCount(); ++idx)
+			{
+				pixels[idx] = base + float(idx);
+			}
+
+			return frame;
+		}
+
+		static bool SameBits(const StoredFrame& a, const StoredFrame& b)
+		{
+			return (a.IsCompact() == b.IsCompact()) && (a.byteSize() == b.byteSize()) &&
+				(memcmp(a.RawData(), b.RawData(), a.byteSize()) == 0);
+		}
+
+	public:
+		TEST_METHOD(RoundTrip)
+		{
+			std::string directory = Directory("RoundTrip");
+
+			StoredFrame floatFrame = MakeFrame(1.0f);
+			StoredFrame halfFrame = MakeFrame(100.0f);
+			halfFrame.Compact();
+
+			{
+				FrameDiskCache cache;
+				cache.SetDirectory(directory);
+
+				cache.Save(1, FrameWidth, FrameHeight, floatFrame);
+				cache.Save(2, FrameWidth, FrameHeight, halfFrame);
+
+				StoredFrame loaded;
+				Assert::IsTrue(cache.Load(1, FrameWidth, FrameHeight, loaded));
+				Assert::IsTrue(SameBits(floatFrame, loaded));
+
+				// the same key at another resolution is another frame
+				Assert::IsFalse(cache.Load(1, FrameWidth, FrameHeight + 1, loaded));
+			}
+
+			// next session indexes frames stored by the previous one
+			FrameDiskCache cache;
+			cache.SetDirectory(directory);
+
+			Assert::AreEqual(size_t(2), cache.GetStatistics().fileCount);
+
+			StoredFrame loaded;
+			Assert::IsTrue(cache.Load(2, FrameWidth, FrameHeight, loaded));
+			Assert::IsTrue(SameBits(halfFrame, loaded));
+
+			Assert::IsTrue(cache.Load(1, FrameWidth, FrameHeight, loaded));
+			Assert::IsTrue(SameBits(floatFrame, loaded));
+
+			cache.Clear();
+			Assert::AreEqual(size_t(0), CountFiles(directory));
+		}
+
+		TEST_METHOD(EvictsOnSizeCap)
+		{
+			std::string directory = Directory("EvictsOnSizeCap");
+
+			FrameDiskCache cache;
+			cache.SetDirectory(directory);
+			cache.SetByteBudget(2 * FrameFileSize + FrameFileSize / 2);
+
+			cache.Save(1, FrameWidth, FrameHeight, MakeFrame(1.0f));
+			cache.Save(2, FrameWidth, FrameHeight, MakeFrame(2.0f));
+
+			// loading frame 1 makes frame 2 the least recently used one
+			StoredFrame loaded;
+			Assert::IsTrue(cache.Load(1, FrameWidth, FrameHeight, loaded));
+
+			cache.Save(3, FrameWidth, FrameHeight, MakeFrame(3.0f));
+
+			Assert::IsTrue(cache.Contains(1, FrameWidth, FrameHeight));
+			Assert::IsFalse(cache.Contains(2, FrameWidth, FrameHeight));
+			Assert::IsTrue(cache.Contains(3, FrameWidth, FrameHeight));
+
+			FrameDiskCache::Statistics stats = cache.GetStatistics();
+			Assert::AreEqual(size_t(2), stats.fileCount);
+			Assert::AreEqual(2 * FrameFileSize, stats.byteSize);
+			Assert::AreEqual(1ull, stats.evictions);
+			Assert::AreEqual(size_t(2), CountFiles(directory));
+
+			// lower cap removes files too
+			cache.SetByteBudget(FrameFileSize);
+			Assert::AreEqual(size_t(1), CountFiles(directory));
+			Assert::IsTrue(cache.Contains(3, FrameWidth, FrameHeight));
+
+			cache.Clear();
+		}
+
+		TEST_METHOD(DamagedFileIsDropped)
+		{
+			std::string directory = Directory("DamagedFileIsDropped");
+
+			FrameDiskCache cache;
+			cache.SetDirectory(directory);
+			cache.Save(1, FrameWidth, FrameHeight, MakeFrame(1.0f));
+
+			for (const fs::directory_entry& entry : fs::directory_iterator(fs::u8path(directory)))
+			{
+				std::ofstream stream(entry.path(), std::ios::binary | std::ios::trunc);
+				stream << "damaged";
+			}
+
+			StoredFrame loaded;
+			Assert::IsFalse(cache.Load(1, FrameWidth, FrameHeight, loaded));
+			Assert::IsFalse(cache.Contains(1, FrameWidth, FrameHeight));
+			Assert::AreEqual(size_t(0), CountFiles(directory));
+		}
+	};
+}
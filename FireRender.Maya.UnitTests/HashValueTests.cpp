@@ -0,0 +1,137 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "stdafx.h"
+#include "../FireRender.Maya.Src/HashValue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace fireRenderUnitTests
+{
+	// State hashes are used as persistent disk cache keys, so HashValue must stay bit exact with XXH64
+	TEST_CLASS(HashValueTests)
+	{
+		static uint64_t Hash(const char* text, size_t seed = 0)
+		{
+			HashValue hash(seed);
+			hash.Append(text, int(strlen(text)));
+			return uint64_t(size_t(hash));
+		}
+
+		// byte-at-a-time hash HashValue used before XXH64, kept for the benchmark
+		static size_t HashBytesPrevious(const unsigned char* p, size_t n, size_t ret)
+		{
+			const size_t BigDumbPrime = 0x1fffffffffffffff;
+
+			for (size_t i = 0; i < n; i++)
+				ret = (ret >> 17 | ret << 47) ^ ((p[i] + i + 1 + ret) * BigDumbPrime);
+
+			return ret;
+		}
+
+		template <class Function>
+		static double MegabytesPerSecond(size_t size, Function function)
+		{
+			// at least 64 MB are hashed, so small sizes are timed over many calls
+			size_t repeatCount = std::max(size_t(1), (size_t(64) << 20) / size);
+
+			auto start = std::chrono::steady_clock::now();
+			for (size_t repeat = 0; repeat < repeatCount; ++repeat)
+			{
+				function(repeat);
+			}
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			return double(size) * repeatCount / seconds / (1 << 20);
+		}
+
+	public:
+		TEST_METHOD(KnownVectors)
+		{
+			// reference values of XXH64 with seed 0
+			Assert::AreEqual(uint64_t(0xEF46DB3751D8E999ULL), Hash(""));
+			Assert::AreEqual(uint64_t(0xD24EC4F1A98C6E5BULL), Hash("a"));
+			Assert::AreEqual(uint64_t(0x44BC2CF5AD770999ULL), Hash("abc"));
+
+			// longer than 32 bytes, goes through the 4 lane loop
+			Assert::AreEqual(uint64_t(0xFBCEA83C8A378BF1ULL), Hash("Nobody inspects the spammish repetition"));
+		}
+
+		TEST_METHOD(AppendChainsSeed)
+		{
+			HashValue chained;
+			chained << 1 << 2;
+
+			HashValue first;
+			first << 1;
+
+			HashValue second = HashValue(size_t(first));
+			second << 2;
+
+			Assert::IsTrue(chained == second);
+			Assert::IsTrue(chained != first);
+		}
+
+		TEST_METHOD(BenchmarkHashThroughput)
+		{
+			// a few attribute values, a matrix, small and big mesh arrays
+			const size_t sizes[] = { 8, 64, 1024, 64 * 1024, 4 * 1024 * 1024 };
+
+			std::vector<unsigned char> data(sizes[4]);
+			for (size_t idx = 0; idx < data.size(); ++idx)
+			{
+				data[idx] = (unsigned char) (idx * 31 + 7);
+			}
+
+			std::string message = "Hash throughput, MB/s:";
+			size_t sink = 0;
+
+			for (size_t size : sizes)
+			{
+				double previous = MegabytesPerSecond(size, [&](size_t repeat)
+				{
+					sink += HashBytesPrevious(data.data(), size, repeat);
+				});
+
+				double current = MegabytesPerSecond(size, [&](size_t repeat)
+				{
+					HashValue hash(repeat);
+					hash.Append(data.data(), int(size));
+					sink += size_t(hash);
+				});
+
+				message += " " + std::to_string(size) + " bytes: byte-at-a-time " + std::to_string(size_t(previous)) +
+					", XXH64 " + std::to_string(size_t(current)) + ";";
+			}
+
+			Logger::WriteMessage(message.c_str());
+
+			// keeps hashing from being optimized out
+			Assert::IsTrue(sink != 0);
+		}
+
+		TEST_METHOD(NullItemsHashLength)
+		{
+			// null arrays hash their byte size
+			HashValue empty;
+			empty.Append(static_cast<const float*>(nullptr), 4);
+
+			Assert::IsTrue(empty != HashValue());
+		}
+	};
+}
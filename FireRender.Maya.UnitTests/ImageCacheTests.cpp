@@ -0,0 +1,210 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "stdafx.h"
+#include "../FireRender.Maya.Src/ImageCache.h"
+
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FireMaya;
+
+namespace fireRenderUnitTests
+{
+	TEST_CLASS(ImageCacheTests)
+	{
+		static constexpr size_t ImageByteSize = 100;
+
+		// room for 4 images, every image is exactly at the single entry limit
+		static constexpr size_t Budget = ImageByteSize * ImageCache::MaxEntryBudgetShare;
+
+		static ImageDataPtr MakeImage(size_t byteSize = ImageByteSize)
+		{
+			auto imageData = std::make_shared<ImageData>();
+			imageData->pixels.resize(byteSize);
+
+			return imageData;
+		}
+
+		// file names which don't exist, their keys don't depend on modification time
+		static std::string Key(int idx)
+		{
+			return ImageCache::MakeKey("missing_texture_" + std::to_string(idx) + ".png", "sRGB");
+		}
+
+		static ImageCache& ResetCache(size_t budget = Budget)
+		{
+			ImageCache& cache = ImageCache::Instance();
+			cache.Clear();
+			cache.SetByteBudget(budget);
+			cache.ResetStatistics();
+
+			return cache;
+		}
+
+	public:
+		TEST_METHOD(EvictsLeastRecentlyUsed)
+		{
+			ImageCache& cache = ResetCache();
+
+			for (int idx = 0; idx < 4; ++idx)
+				cache.Insert(Key(idx), MakeImage(), 1.0);
+
+			// image 0 is used again, so image 1 is the oldest one
+			Assert::IsTrue(cache.Find(Key(0)) != nullptr);
+			cache.Insert(Key(4), MakeImage(), 1.0);
+
+			Assert::IsTrue(cache.Find(Key(1)) == nullptr);
+			for (int idx : { 0, 2, 3, 4 })
+				Assert::IsTrue(cache.Find(Key(idx)) != nullptr);
+
+			ImageCache::Statistics stats = cache.GetStatistics();
+			Assert::AreEqual(size_t(4), stats.entryCount);
+			Assert::AreEqual(Budget, stats.byteSize);
+			Assert::AreEqual(1ull, stats.evictions);
+		}
+
+		TEST_METHOD(BudgetIsEnforced)
+		{
+			ImageCache& cache = ResetCache();
+
+			// bigger than the single entry share of the budget
+			Assert::IsFalse(cache.CanStore(ImageByteSize + 1));
+			cache.Insert(Key(0), MakeImage(ImageByteSize + 1), 1.0);
+			Assert::IsTrue(cache.Find(Key(0)) == nullptr);
+			Assert::AreEqual(1ull, cache.GetStatistics().rejected);
+
+			for (int idx = 0; idx < 10; ++idx)
+				cache.Insert(Key(idx), MakeImage(), 1.0);
+
+			Assert::AreEqual(Budget, cache.GetStatistics().byteSize);
+
+			// lower budget evicts the oldest images
+			cache.SetByteBudget(Budget / 2);
+
+			ImageCache::Statistics stats = cache.GetStatistics();
+			Assert::AreEqual(Budget / 2, stats.byteSize);
+			Assert::IsTrue(cache.Find(Key(9)) != nullptr);
+			Assert::IsTrue(cache.Find(Key(7)) == nullptr);
+		}
+
+		TEST_METHOD(PinnedImageIsKeptUntilFound)
+		{
+			ImageCache& cache = ResetCache();
+
+			cache.Insert(Key(0), MakeImage(), 1.0, true);
+			for (int idx = 1; idx < 6; ++idx)
+				cache.Insert(Key(idx), MakeImage(), 1.0);
+
+			Assert::AreEqual(ImageByteSize, cache.GetStatistics().pinnedByteSize);
+
+			// found image is consumed and can be evicted again
+			Assert::IsTrue(cache.Find(Key(0)) != nullptr);
+			Assert::AreEqual(size_t(0), cache.GetStatistics().pinnedByteSize);
+
+			for (int idx = 6; idx < 10; ++idx)
+				cache.Insert(Key(idx), MakeImage(), 1.0);
+
+			Assert::IsTrue(cache.Find(Key(0)) == nullptr);
+			Assert::AreEqual(Budget, cache.GetStatistics().byteSize);
+		}
+
+		TEST_METHOD(PrefetchOverBudgetPinsAtMostBudget)
+		{
+			ImageCache& cache = ResetCache();
+
+			// prefetch tasks insert decoded images pinned, twice as many as the budget holds
+			for (int idx = 0; idx < 8; ++idx)
+				cache.Insert(Key(idx), MakeImage(), 1.0, true);
+
+			ImageCache::Statistics stats = cache.GetStatistics();
+			Assert::AreEqual(Budget, stats.pinnedByteSize);
+			Assert::AreEqual(Budget, stats.byteSize);
+
+			// images pinned first are kept
+			for (int idx = 0; idx < 4; ++idx)
+				Assert::IsTrue(cache.Find(Key(idx)) != nullptr);
+		}
+
+		TEST_METHOD(PrefetchPinsCachedImages)
+		{
+			ImageCache& cache = ResetCache();
+
+			std::vector<ImagePrefetchRequest> requests;
+			for (int idx = 0; idx < 4; ++idx)
+			{
+				cache.Insert(Key(idx), MakeImage(), 1.0);
+				requests.push_back({ "missing_texture_" + std::to_string(idx) + ".png", "sRGB" });
+			}
+
+			// all images are decoded already, nothing is queued
+			Assert::IsTrue(cache.Prefetch(requests).empty());
+			Assert::AreEqual(Budget, cache.GetStatistics().pinnedByteSize);
+
+			// lower budget releases pins of the least recently used images first
+			cache.SetByteBudget(Budget / 2);
+
+			ImageCache::Statistics stats = cache.GetStatistics();
+			Assert::AreEqual(Budget / 2, stats.pinnedByteSize);
+			Assert::AreEqual(Budget / 2, stats.byteSize);
+			Assert::IsTrue(cache.Find(Key(3)) != nullptr);
+
+			// next prefetch releases pins left by the previous one
+			cache.Prefetch({});
+			Assert::AreEqual(size_t(0), cache.GetStatistics().pinnedByteSize);
+		}
+
+		TEST_METHOD(RowsAreStoredBottomFirst)
+		{
+			// 2x3 single channel image, each row filled with its index counted from the top
+			ImageData imageData;
+			imageData.format.num_components = 1;
+			imageData.format.type = RPR_COMPONENT_TYPE_UINT8;
+			imageData.desc.image_width = 2;
+			imageData.desc.image_height = 3;
+			imageData.desc.image_row_pitch = 2;
+			imageData.pixels = { 2, 2, 1, 1, 0, 0 };
+
+			Assert::AreEqual(size_t(4), imageData.RowOffset(0));
+			Assert::AreEqual(size_t(2), imageData.RowOffset(1));
+			Assert::AreEqual(size_t(0), imageData.RowOffset(2));
+
+			for (unsigned int y = 0; y < imageData.desc.image_height; ++y)
+			{
+				const unsigned char* row = imageData.pixels.data() + imageData.RowOffset(y);
+
+				Assert::AreEqual(int(y), int(row[0]));
+				Assert::AreEqual(int(y), int(row[1]));
+			}
+		}
+
+		TEST_METHOD(RowOffsetUsesRowPitch)
+		{
+			// rows padded to 4 bytes
+			ImageData imageData;
+			imageData.desc.image_width = 3;
+			imageData.desc.image_height = 2;
+			imageData.desc.image_row_pitch = 4;
+
+			Assert::AreEqual(size_t(4), imageData.RowOffset(0));
+			Assert::AreEqual(size_t(0), imageData.RowOffset(1));
+		}
+
+		TEST_CLASS_CLEANUP(RestoreBudget)
+		{
+			// cache is process wide
+			ImageCache::Instance().Clear();
+			ImageCache::Instance().SetByteBudget(ImageCache::DefaultByteBudget);
+		}
+	};
+}
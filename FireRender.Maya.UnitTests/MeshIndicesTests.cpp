@@ -0,0 +1,258 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "stdafx.h"
+#include "SingleShaderMeshTranslator.h"
+
+#include <chrono>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FireMaya;
+
+namespace fireRenderUnitTests
+{
+	TEST_CLASS(MeshIndicesTests)
+	{
+		// Synthetic topology in the form gathered by MeshPolygonData::Initialize.
+		// Polygons cycle through quads, triangles and pentagons, every 10th polygon has no uvs
+		static void MakeMesh(size_t polygonCount, MeshTranslator::MeshPolygonData& meshData)
+		{
+			const int vertexCount = int(polygonCount) + 5;
+
+			meshData.polygonUVCounts.resize(1);
+			meshData.polygonUVIds.resize(1);
+
+			int normalId = 0;
+			int uvId = 0;
+
+			for (size_t polygonIdx = 0; polygonIdx < polygonCount; ++polygonIdx)
+			{
+				const int polygonVertexCount = (polygonIdx % 3 == 0) ? 4 : (polygonIdx % 3 == 1) ? 3 : 5;
+				const int polygonTriangleCount = polygonVertexCount - 2;
+
+				meshData.polygonVertexCounts.push_back(polygonVertexCount);
+				meshData.polygonTriangleCounts.push_back(polygonTriangleCount);
+				meshData.polygonMaterialIds.push_back(int(polygonIdx % 4));
+
+				for (int localIdx = 0; localIdx < polygonVertexCount; ++localIdx)
+				{
+					meshData.polygonVertexIds.push_back(int((polygonIdx * 7 + localIdx) % vertexCount));
+					meshData.polygonNormalIds.push_back(normalId++);
+
+					float value = float(localIdx) / polygonVertexCount;
+					meshData.faceVertexColors.push_back(MColor(value, float(polygonIdx % 5), 1.0f - value, 1.0f));
+				}
+
+				// fan triangulation, offsets are relative to the polygon
+				for (int triangleIdx = 0; triangleIdx < polygonTriangleCount; ++triangleIdx)
+				{
+					meshData.polygonTriangleOffsets.push_back(0);
+					meshData.polygonTriangleOffsets.push_back(triangleIdx + 1);
+					meshData.polygonTriangleOffsets.push_back(triangleIdx + 2);
+				}
+
+				int polygonUVCount = (polygonIdx % 10 == 0) ? 0 : polygonVertexCount;
+				meshData.polygonUVCounts[0].push_back(polygonUVCount);
+
+				for (int localIdx = 0; localIdx < polygonUVCount; ++localIdx)
+				{
+					meshData.polygonUVIds[0].push_back(uvId++);
+				}
+			}
+
+			meshData.vertexColorsCount = size_t(vertexCount);
+		}
+
+		// Walks polygons one by one, in the same way as the MItMeshPolygon path did
+		static void BuildIndicesSerial(const MeshTranslator::MeshPolygonData& meshData, MeshTranslator::MeshIndices& indices)
+		{
+			size_t vertexOffset = 0;
+			size_t triangleOffset = 0;
+			size_t uvOffset = 0;
+
+			indices.uvIndices.resize(1);
+			indices.vertexColors.resize(meshData.vertexColorsCount);
+			indices.colorVertexIndices.resize(meshData.vertexColorsCount);
+
+			for (size_t polygonIdx = 0; polygonIdx < meshData.polygonVertexCounts.size(); ++polygonIdx)
+			{
+				const int polygonVertexCount = meshData.polygonVertexCounts[polygonIdx];
+				const int polygonUVCount = meshData.polygonUVCounts[0][polygonIdx];
+
+				auto addVertex = [&](int localIdx)
+				{
+					indices.faceVertexIndices.push_back(meshData.polygonVertexIds[vertexOffset + localIdx]);
+					indices.faceNormalIndices.push_back(meshData.polygonNormalIds[vertexOffset + localIdx]);
+					indices.uvIndices[0].push_back(polygonUVCount > localIdx ? meshData.polygonUVIds[0][uvOffset + localIdx] : 0);
+				};
+
+				if (polygonVertexCount == 4)
+				{
+					indices.numFaceVertices.push_back(4);
+					indices.faceMaterialIndices.push_back(meshData.polygonMaterialIds[polygonIdx]);
+
+					for (int localIdx = 0; localIdx < 4; ++localIdx)
+						addVertex(localIdx);
+				}
+				else
+				{
+					for (int triangleIdx = 0; triangleIdx < meshData.polygonTriangleCounts[polygonIdx]; ++triangleIdx)
+					{
+						indices.numFaceVertices.push_back(3);
+						indices.faceMaterialIndices.push_back(meshData.polygonMaterialIds[polygonIdx]);
+
+						for (int idx = 0; idx < 3; ++idx)
+							addVertex(meshData.polygonTriangleOffsets[triangleOffset + 3 * triangleIdx + idx]);
+					}
+				}
+
+				for (int localIdx = 0; localIdx < polygonVertexCount; ++localIdx)
+				{
+					int vertexIdx = meshData.polygonVertexIds[vertexOffset + localIdx];
+					indices.vertexColors[vertexIdx] = meshData.faceVertexColors[vertexOffset + localIdx];
+					indices.colorVertexIndices[vertexIdx] = vertexIdx;
+				}
+
+				vertexOffset += polygonVertexCount;
+				triangleOffset += 3 * size_t(meshData.polygonTriangleCounts[polygonIdx]);
+				uvOffset += polygonUVCount;
+			}
+		}
+
+		static void AssertSameIndices(const MeshTranslator::MeshIndices& expected, const MeshTranslator::MeshIndices& actual)
+		{
+			Assert::IsTrue(expected.faceVertexIndices == actual.faceVertexIndices, L"faceVertexIndices");
+			Assert::IsTrue(expected.faceNormalIndices == actual.faceNormalIndices, L"faceNormalIndices");
+			Assert::IsTrue(expected.uvIndices == actual.uvIndices, L"uvIndices");
+			Assert::IsTrue(expected.numFaceVertices == actual.numFaceVertices, L"numFaceVertices");
+			Assert::IsTrue(expected.faceMaterialIndices == actual.faceMaterialIndices, L"faceMaterialIndices");
+			Assert::IsTrue(expected.colorVertexIndices == actual.colorVertexIndices, L"colorVertexIndices");
+
+			Assert::AreEqual(expected.vertexColors.size(), actual.vertexColors.size());
+			for (size_t idx = 0; idx < expected.vertexColors.size(); ++idx)
+			{
+				const MColor& a = expected.vertexColors[idx];
+				const MColor& b = actual.vertexColors[idx];
+				Assert::IsTrue(a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a, L"vertexColors");
+			}
+		}
+
+		static void CheckPolygonCount(size_t polygonCount)
+		{
+			MeshTranslator::MeshPolygonData meshData;
+			MakeMesh(polygonCount, meshData);
+
+			MeshTranslator::MeshIndices expected;
+			BuildIndicesSerial(meshData, expected);
+
+			MeshTranslator::MeshIndices actual;
+			SingleShaderMeshTranslator::BuildIndices(meshData, actual);
+
+			AssertSameIndices(expected, actual);
+		}
+
+	public:
+		TEST_METHOD(SmallMeshMatchesSerialWalk)
+		{
+			CheckPolygonCount(1);
+			CheckPolygonCount(7);
+			CheckPolygonCount(100);
+		}
+
+		TEST_METHOD(ChunkedMeshMatchesSerialWalk)
+		{
+			// several polygon chunks, the last one incomplete
+			CheckPolygonCount(3 * 16384 + 11);
+		}
+
+		TEST_METHOD(EmptyMesh)
+		{
+			MeshTranslator::MeshPolygonData meshData;
+
+			MeshTranslator::MeshIndices indices;
+			SingleShaderMeshTranslator::BuildIndices(meshData, indices);
+
+			Assert::IsTrue(indices.faceVertexIndices.empty());
+			Assert::IsTrue(indices.numFaceVertices.empty());
+		}
+
+		TEST_METHOD(SortFacesByMaterialKeepsFaceOrder)
+		{
+			// material 1 is unused, -1 and 5 are out of range and skipped
+			std::vector<int> faceMaterialIndices = { 2, 0, 2, -1, 3, 0, 5, 2 };
+
+			std::vector<int> faceIds;
+			std::vector<size_t> materialOffsets;
+			MeshTranslator::SortFacesByMaterial(faceMaterialIndices, 4, faceIds, materialOffsets);
+
+			std::vector<size_t> expectedOffsets = { 0, 2, 2, 5, 6 };
+			std::vector<int> expectedFaceIds = { 1, 5, 0, 2, 7, 4 };
+
+			Assert::IsTrue(expectedOffsets == materialOffsets);
+			Assert::IsTrue(expectedFaceIds == faceIds);
+		}
+
+		TEST_METHOD(SortFacesByMaterialMatchesPerMaterialScan)
+		{
+			const size_t materialCount = 7;
+
+			MeshTranslator::MeshPolygonData meshData;
+			MakeMesh(50000, meshData);
+
+			MeshTranslator::MeshIndices indices;
+			SingleShaderMeshTranslator::BuildIndices(meshData, indices);
+
+			std::vector<int> faceIds;
+			std::vector<size_t> materialOffsets;
+			MeshTranslator::SortFacesByMaterial(indices.faceMaterialIndices, materialCount, faceIds, materialOffsets);
+
+			// the scan FireRenderMesh::ProcessMesh did for every shading engine before
+			for (size_t materialIdx = 0; materialIdx < materialCount; ++materialIdx)
+			{
+				std::vector<int> expected;
+				for (size_t faceIdx = 0; faceIdx < indices.faceMaterialIndices.size(); ++faceIdx)
+				{
+					if (indices.faceMaterialIndices[faceIdx] == int(materialIdx))
+						expected.push_back(int(faceIdx));
+				}
+
+				std::vector<int> actual(faceIds.begin() + materialOffsets[materialIdx], faceIds.begin() + materialOffsets[materialIdx + 1]);
+				Assert::IsTrue(expected == actual);
+			}
+		}
+
+		TEST_METHOD(BenchmarkFacesPerSecond)
+		{
+			const size_t polygonCount = 2000000;
+
+			MeshTranslator::MeshPolygonData meshData;
+			MakeMesh(polygonCount, meshData);
+
+			auto start = std::chrono::steady_clock::now();
+			MeshTranslator::MeshIndices serial;
+			BuildIndicesSerial(meshData, serial);
+			double serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			MeshTranslator::MeshIndices chunked;
+			SingleShaderMeshTranslator::BuildIndices(meshData, chunked);
+			double chunkedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			AssertSameIndices(serial, chunked);
+
+			std::string message = "BuildIndices: serial " + std::to_string(size_t(polygonCount / serialSeconds)) +
+				" faces/s, chunked " + std::to_string(size_t(polygonCount / chunkedSeconds)) + " faces/s";
+			Logger::WriteMessage(message.c_str());
+		}
+	};
+}
@@ -0,0 +1,162 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "stdafx.h"
+#include "../FireRender.Maya.Src/Translators/MotionSampleCache.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FireMaya;
+
+namespace fireRenderUnitTests
+{
+	TEST_CLASS(MotionSampleCacheTests)
+	{
+		static const unsigned int SampleCount = 3;
+
+		static MotionSampleCache::MeshSamplePtr MakeSample(size_t vertexCount)
+		{
+			auto sample = std::make_shared<MotionSampleCache::MeshSample>();
+			sample->points.assign(3 * vertexCount, 1.0f);
+			sample->normals.assign(3 * vertexCount, 0.0f);
+
+			return sample;
+		}
+
+		static MTime SampleTime(unsigned int sampleIdx)
+		{
+			return MTime(1.0 + 0.5 * sampleIdx, MTime::kFilm);
+		}
+
+		// deformation key is made of uuid and base frame content, sample count is fixed here
+		static void InsertNode(MotionSampleCache& cache, const std::string& uuid, uint64_t key, size_t vertexCount)
+		{
+			for (unsigned int sampleIdx = 1; sampleIdx < SampleCount; ++sampleIdx)
+			{
+				cache.InsertMeshSample(uuid, key, SampleTime(sampleIdx), MakeSample(vertexCount));
+			}
+		}
+
+		static bool HasSamples(MotionSampleCache& cache, uint64_t key)
+		{
+			for (unsigned int sampleIdx = 1; sampleIdx < SampleCount; ++sampleIdx)
+			{
+				if (!cache.FindMeshSample(key, SampleTime(sampleIdx)))
+					return false;
+			}
+
+			return true;
+		}
+
+		static MotionSampleCache& ResetCache()
+		{
+			MotionSampleCache& cache = MotionSampleCache::Instance();
+			cache.SetByteBudget(MotionSampleCache::DefaultByteBudget);
+			cache.Clear();
+			cache.ResetStatistics();
+
+			return cache;
+		}
+
+	public:
+		TEST_METHOD(InvalidateNodeDropsOnlyItsSamples)
+		{
+			MotionSampleCache& cache = ResetCache();
+
+			InsertNode(cache, "nodeA", 1, 100);
+			InsertNode(cache, "nodeB", 2, 10);
+
+			cache.InvalidateNode("nodeA");
+
+			Assert::IsFalse(HasSamples(cache, 1));
+			Assert::IsTrue(HasSamples(cache, 2));
+
+			MotionSampleCache::Statistics stats = cache.GetStatistics();
+			Assert::AreEqual(size_t(SampleCount - 1), stats.entryCount);
+			Assert::AreEqual((SampleCount - 1) * MakeSample(10)->byteSize(), stats.byteSize);
+			Assert::AreEqual((unsigned long long) (SampleCount - 1), stats.invalidatedSamples);
+		}
+
+		TEST_METHOD(SamplesAreCachedAgainAfterInvalidate)
+		{
+			MotionSampleCache& cache = ResetCache();
+
+			InsertNode(cache, "nodeA", 1, 100);
+			cache.InvalidateNode("nodeA");
+
+			// node was edited, so next sync evaluates and stores its samples again under the same key
+			InsertNode(cache, "nodeA", 1, 100);
+			Assert::IsTrue(HasSamples(cache, 1));
+
+			cache.InvalidateNode("nodeA");
+			Assert::IsFalse(HasSamples(cache, 1));
+			Assert::AreEqual(size_t(0), cache.GetStatistics().byteSize);
+		}
+
+		TEST_METHOD(InvalidateUnknownNode)
+		{
+			MotionSampleCache& cache = ResetCache();
+
+			InsertNode(cache, "nodeA", 1, 100);
+			cache.InvalidateNode("nodeB");
+
+			Assert::IsTrue(HasSamples(cache, 1));
+			Assert::AreEqual(0ull, cache.GetStatistics().invalidatedSamples);
+		}
+
+		TEST_METHOD(BenchmarkInvalidateNode)
+		{
+			// scene with many small deforming meshes, every one of them gets dirty
+			const size_t nodeCount = 20000;
+
+			MotionSampleCache& cache = ResetCache();
+
+			std::vector<std::string> uuids;
+			for (size_t nodeIdx = 0; nodeIdx < nodeCount; ++nodeIdx)
+			{
+				uuids.push_back("node" + std::to_string(nodeIdx));
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			for (size_t nodeIdx = 0; nodeIdx < nodeCount; ++nodeIdx)
+			{
+				InsertNode(cache, uuids[nodeIdx], nodeIdx + 1, 8);
+			}
+			double insertSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			for (size_t nodeIdx = 0; nodeIdx < nodeCount; ++nodeIdx)
+			{
+				Assert::IsTrue(HasSamples(cache, nodeIdx + 1));
+			}
+			double findSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			for (size_t nodeIdx = 0; nodeIdx < nodeCount; ++nodeIdx)
+			{
+				cache.InvalidateNode(uuids[nodeIdx]);
+			}
+			double invalidateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			Assert::AreEqual(size_t(0), cache.GetStatistics().entryCount);
+
+			size_t sampleCount = nodeCount * (SampleCount - 1);
+			std::string message = "MotionSampleCache: insert " + std::to_string(size_t(insertSeconds * 1e9 / sampleCount)) +
+				" ns/sample, find " + std::to_string(size_t(findSeconds * 1e9 / sampleCount)) +
+				" ns/sample, invalidate " + std::to_string(size_t(invalidateSeconds * 1e9 / nodeCount)) + " ns/node";
+			Logger::WriteMessage(message.c_str());
+		}
+	};
+}
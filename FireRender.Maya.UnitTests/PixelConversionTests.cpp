@@ -0,0 +1,419 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "stdafx.h"
+#include "../FireRender.Maya.Src/PixelConversion.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FireMaya;
+
+namespace fireRenderUnitTests
+{
+	const PixelConversion::InstructionSet SimdSets[] = { PixelConversion::InstructionSetSSE2, PixelConversion::InstructionSetAVX2 };
+
+	TEST_CLASS(PixelConversionTests)
+	{
+		static const size_t GuardSize = 16;
+		static constexpr float GuardValue = -12345.0f;
+
+		static const char* Name(PixelConversion::InstructionSet instructionSet)
+		{
+			switch (instructionSet)
+			{
+			case PixelConversion::InstructionSetSSE2: return "SSE2";
+			case PixelConversion::InstructionSetAVX2: return "AVX2";
+			default: return "scalar";
+			}
+		}
+
+		// Every component is distinct, so a lane taken from the wrong pixel or channel is noticed
+		static std::vector<float> MakePixels(size_t pixelCount, float base)
+		{
+			std::vector<float> pixels(pixelCount * 4);
+			for (size_t idx = 0; idx < pixels.size(); ++idx)
+			{
+				pixels[idx] = base + float(idx) * 0.25f;
+			}
+
+			return pixels;
+		}
+
+		// Output starts one float after the allocation, so it isn't 16 or 32 byte aligned,
+		// and is followed by guard values to catch writes past the last pixel
+		static std::vector<float> Convert(const std::vector<float>& color, const std::vector<float>& opacity, size_t pixelCount, PixelConversion::InstructionSet instructionSet)
+		{
+			std::vector<float> output(1 + pixelCount * 4 + GuardSize, GuardValue);
+
+			Assert::IsTrue(PixelConversion::CopyRGBA(color.data(), opacity.data(), output.data() + 1, pixelCount, instructionSet));
+
+			Assert::AreEqual(GuardValue, output[0]);
+			for (size_t idx = 1 + pixelCount * 4; idx < output.size(); ++idx)
+			{
+				Assert::AreEqual(GuardValue, output[idx]);
+			}
+
+			return std::vector<float>(output.begin() + 1, output.begin() + 1 + pixelCount * 4);
+		}
+
+		static bool SameBits(const std::vector<float>& a, const std::vector<float>& b)
+		{
+			return (a.size() == b.size()) && (memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0);
+		}
+
+		static uint32_t FloatBits(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		static float BitsFloat(uint32_t bits)
+		{
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		static std::vector<uint8_t> MakeBytes(size_t count)
+		{
+			std::vector<uint8_t> bytes(count);
+			for (size_t idx = 0; idx < count; ++idx)
+			{
+				bytes[idx] = uint8_t(idx * 7 + idx / 256);
+			}
+
+			return bytes;
+		}
+
+		static float SrgbToLinear(uint8_t value)
+		{
+			float normalized = value / 255.0f;
+			return (normalized <= 0.04045f) ? normalized / 12.92f : std::pow((normalized + 0.055f) / 1.055f, 2.4f);
+		}
+
+		static void BenchmarkFrame(const char* name, size_t width, size_t height)
+		{
+			const size_t pixelCount = width * height;
+			const int repeatCount = 3;
+
+			std::vector<float> color = MakePixels(pixelCount, 1.0f);
+			std::vector<float> opacity = MakePixels(pixelCount, -1000.0f);
+			std::vector<float> output(pixelCount * 4);
+			std::vector<uint16_t> half(pixelCount * 4);
+			std::vector<uint8_t> bytes = MakeBytes(pixelCount * 4);
+
+			auto measure = [&](auto&& convert)
+			{
+				auto start = std::chrono::steady_clock::now();
+				for (int repeat = 0; repeat < repeatCount; ++repeat)
+				{
+					convert();
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				return std::to_string(size_t(seconds * 1e3 / repeatCount)) + " ms";
+			};
+
+			std::string message = std::string(name) + " frame:";
+			message += " CopyRGBA " + measure([&]() { PixelConversion::CopyRGBA(color.data(), opacity.data(), output.data(), pixelCount); });
+			message += ", FloatToHalf " + measure([&]() { PixelConversion::FloatToHalf(color.data(), half.data(), half.size()); });
+			message += ", HalfToFloat " + measure([&]() { PixelConversion::HalfToFloat(half.data(), output.data(), half.size()); });
+			message += ", DropAlpha " + measure([&]() { PixelConversion::DropAlpha(color.data(), output.data(), pixelCount, sizeof(float)); });
+			message += ", UInt8ToFloat sRGB " + measure([&]() { PixelConversion::UInt8ToFloat(bytes.data(), output.data(), bytes.size(), 4, true); });
+			message += ", FlipRows " + measure([&]() { PixelConversion::FlipRows(color.data(), width * 4 * sizeof(float), height); });
+
+			Logger::WriteMessage(message.c_str());
+		}
+
+	public:
+		TEST_METHOD(CopyRGBAMatchesScalarOnOddWidths)
+		{
+			// widths around the 1 and 4 pixel steps of the SIMD loops
+			const size_t widths[] = { 1, 3, 5, 7, 9, 15, 17, 33, 127, 1021 };
+			const size_t rowCount = 3;
+
+			for (size_t width : widths)
+			{
+				size_t pixelCount = width * rowCount;
+
+				std::vector<float> color = MakePixels(pixelCount, 1.0f);
+				std::vector<float> opacity = MakePixels(pixelCount, -1000.0f);
+
+				std::vector<float> expected = Convert(color, opacity, pixelCount, PixelConversion::InstructionSetScalar);
+
+				for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+				{
+					Assert::AreEqual(color[pixel * 4], expected[pixel * 4]);
+					Assert::AreEqual(opacity[pixel * 4], expected[pixel * 4 + 3]);
+				}
+
+				for (PixelConversion::InstructionSet instructionSet : SimdSets)
+				{
+					if (!PixelConversion::IsSupported(instructionSet))
+					{
+						Logger::WriteMessage((std::string(Name(instructionSet)) + " is not supported, skipped").c_str());
+						continue;
+					}
+
+					std::vector<float> actual = Convert(color, opacity, pixelCount, instructionSet);
+					Assert::IsTrue(SameBits(expected, actual), (L"width " + std::to_wstring(width)).c_str());
+				}
+			}
+		}
+
+		TEST_METHOD(CopyRGBAInPlace)
+		{
+			const size_t pixelCount = 17;
+
+			std::vector<float> color = MakePixels(pixelCount, 1.0f);
+			std::vector<float> opacity = MakePixels(pixelCount, -1000.0f);
+
+			std::vector<float> expected = color;
+			PixelConversion::CopyRGBA(expected.data(), opacity.data(), expected.data(), pixelCount, PixelConversion::InstructionSetScalar);
+
+			for (PixelConversion::InstructionSet instructionSet : SimdSets)
+			{
+				std::vector<float> actual = color;
+				if (!PixelConversion::CopyRGBA(actual.data(), opacity.data(), actual.data(), pixelCount, instructionSet))
+					continue;
+
+				Assert::IsTrue(SameBits(expected, actual));
+			}
+		}
+
+		TEST_METHOD(HalfSpecialValues)
+		{
+			// 1 + 2^-11 is exactly halfway between two halves, ties go to the even mantissa
+			Assert::AreEqual(uint16_t(0x3c00), PixelConversion::FloatToHalf(BitsFloat(0x3f801000)));
+			Assert::AreEqual(uint16_t(0x3c02), PixelConversion::FloatToHalf(BitsFloat(0x3f803000)));
+			Assert::AreEqual(uint16_t(0x3c01), PixelConversion::FloatToHalf(BitsFloat(0x3f801001)));
+
+			// denormals: the smallest one, halfway below it rounds to zero, the largest one
+			Assert::AreEqual(uint16_t(0x0001), PixelConversion::FloatToHalf(std::ldexp(1.0f, -24)));
+			Assert::AreEqual(uint16_t(0x0000), PixelConversion::FloatToHalf(std::ldexp(1.0f, -25)));
+			Assert::AreEqual(uint16_t(0x0002), PixelConversion::FloatToHalf(std::ldexp(3.0f, -25)));
+			Assert::AreEqual(std::ldexp(1.0f, -24), PixelConversion::HalfToFloat(uint16_t(0x0001)));
+			Assert::AreEqual(std::ldexp(1023.0f, -24), PixelConversion::HalfToFloat(uint16_t(0x03ff)));
+			Assert::AreEqual(0x80000000u, FloatBits(PixelConversion::HalfToFloat(uint16_t(0x8000))));
+
+			// overflow and infinities
+			Assert::AreEqual(uint16_t(0x7bff), PixelConversion::FloatToHalf(65504.0f));
+			Assert::AreEqual(uint16_t(0x7c00), PixelConversion::FloatToHalf(65520.0f));
+			Assert::AreEqual(uint16_t(0xfc00), PixelConversion::FloatToHalf(-INFINITY));
+			Assert::IsTrue(std::isinf(PixelConversion::HalfToFloat(uint16_t(0x7c00))));
+
+			// NaN stays NaN both ways
+			uint16_t nan = PixelConversion::FloatToHalf(NAN);
+			Assert::AreEqual(uint16_t(0x7c00), uint16_t(nan & 0x7c00));
+			Assert::AreNotEqual(uint16_t(0), uint16_t(nan & 0x3ff));
+			Assert::IsTrue(std::isnan(PixelConversion::HalfToFloat(nan)));
+		}
+
+		TEST_METHOD(HalfArraysMatchScalar)
+		{
+			// every half value, odd count, so the SIMD loop tail is converted too
+			std::vector<uint16_t> halves(0x10000 + 3);
+			for (size_t idx = 0; idx < halves.size(); ++idx)
+			{
+				halves[idx] = uint16_t(idx);
+			}
+
+			std::vector<float> floats(halves.size());
+			PixelConversion::HalfToFloat(halves.data(), floats.data(), halves.size());
+
+			std::vector<uint16_t> roundTrip(halves.size());
+			PixelConversion::FloatToHalf(floats.data(), roundTrip.data(), floats.size());
+
+			for (size_t idx = 0; idx < halves.size(); ++idx)
+			{
+				float expected = PixelConversion::HalfToFloat(halves[idx]);
+
+				if (std::isnan(expected))
+				{
+					Assert::IsTrue(std::isnan(floats[idx]));
+					continue;
+				}
+
+				Assert::AreEqual(FloatBits(expected), FloatBits(floats[idx]));
+				Assert::AreEqual(halves[idx], roundTrip[idx]);
+			}
+
+			// values between halves, including ties and denormals
+			std::vector<float> values;
+			for (uint32_t bits = 0x33000000; bits < 0x47800000; bits += 0x0000a001)
+			{
+				values.push_back(BitsFloat(bits));
+				values.push_back(-BitsFloat(bits | 0x1000));
+			}
+
+			std::vector<uint16_t> converted(values.size());
+			PixelConversion::FloatToHalf(values.data(), converted.data(), values.size());
+
+			for (size_t idx = 0; idx < values.size(); ++idx)
+			{
+				Assert::AreEqual(PixelConversion::FloatToHalf(values[idx]), converted[idx]);
+			}
+		}
+
+		TEST_METHOD(DropAlphaMatchesScalar)
+		{
+			const size_t componentSizes[] = { 1, 2, 4 };
+			const size_t pixelCounts[] = { 1, 3, 4, 5, 15, 16, 17, 1021 };
+
+			for (size_t componentSize : componentSizes)
+			{
+				for (size_t pixelCount : pixelCounts)
+				{
+					std::vector<uint8_t> src = MakeBytes(pixelCount * 4 * componentSize);
+					std::vector<uint8_t> expected(pixelCount * 3 * componentSize);
+
+					for (size_t pixel = 0; pixel < pixelCount; ++pixel)
+					{
+						memcpy(&expected[pixel * 3 * componentSize], &src[pixel * 4 * componentSize], 3 * componentSize);
+					}
+
+					std::vector<uint8_t> actual(expected.size() + GuardSize, 0xcd);
+					PixelConversion::DropAlpha(src.data(), actual.data(), pixelCount, componentSize);
+
+					std::wstring message = L"component size " + std::to_wstring(componentSize) + L", pixels " + std::to_wstring(pixelCount);
+					Assert::IsTrue(memcmp(expected.data(), actual.data(), expected.size()) == 0, message.c_str());
+
+					for (size_t idx = expected.size(); idx < actual.size(); ++idx)
+					{
+						Assert::AreEqual(uint8_t(0xcd), actual[idx], message.c_str());
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(FlipRowsReversesRows)
+		{
+			const size_t rowPitch = 13;
+			const size_t rowCounts[] = { 0, 1, 2, 5, 6 };
+
+			for (size_t rowCount : rowCounts)
+			{
+				std::vector<uint8_t> rows = MakeBytes(rowPitch * rowCount);
+				std::vector<uint8_t> flipped = rows;
+
+				PixelConversion::FlipRows(flipped.data(), rowPitch, rowCount);
+
+				for (size_t row = 0; row < rowCount; ++row)
+				{
+					Assert::IsTrue(memcmp(&rows[row * rowPitch], &flipped[(rowCount - 1 - row) * rowPitch], rowPitch) == 0);
+				}
+
+				PixelConversion::FlipRows(flipped.data(), rowPitch, rowCount);
+				Assert::IsTrue(rows == flipped);
+			}
+		}
+
+		TEST_METHOD(UInt8ToFloatMatchesScalar)
+		{
+			const PixelConversion::InstructionSet allSets[] = { PixelConversion::InstructionSetScalar, SimdSets[0], SimdSets[1] };
+			const size_t counts[] = { 1, 7, 8, 9, 16, 17, 255, 1021 };
+
+			for (unsigned int channels = 1; channels <= 4; ++channels)
+			{
+				for (bool srgbDecode : { false, true })
+				{
+					for (size_t count : counts)
+					{
+						size_t componentCount = count * channels;
+						std::vector<uint8_t> src = MakeBytes(componentCount);
+
+						std::vector<float> expected(componentCount);
+						for (size_t idx = 0; idx < componentCount; ++idx)
+						{
+							bool alpha = (channels == 2 || channels == 4) && (idx % channels) == channels - 1;
+							expected[idx] = (srgbDecode && !alpha) ? SrgbToLinear(src[idx]) : src[idx] / 255.0f;
+						}
+
+						for (PixelConversion::InstructionSet instructionSet : allSets)
+						{
+							std::vector<float> actual(componentCount + GuardSize, GuardValue);
+							if (!PixelConversion::UInt8ToFloat(src.data(), actual.data(), componentCount, channels, srgbDecode, instructionSet))
+								continue;
+
+							std::string name = Name(instructionSet);
+							std::wstring message = L"channels " + std::to_wstring(channels) + L", sRGB " + std::to_wstring(srgbDecode) +
+								L", count " + std::to_wstring(count) + L", " + std::wstring(name.begin(), name.end());
+
+							for (size_t idx = 0; idx < componentCount; ++idx)
+							{
+								Assert::AreEqual(expected[idx], actual[idx], 1e-6f, message.c_str());
+							}
+
+							for (size_t idx = componentCount; idx < actual.size(); ++idx)
+							{
+								Assert::AreEqual(GuardValue, actual[idx], message.c_str());
+							}
+						}
+					}
+				}
+			}
+
+			// the dispatching version gives the same result as the scalar one
+			std::vector<uint8_t> src = MakeBytes(1021 * 4);
+			std::vector<float> expected(src.size());
+			std::vector<float> actual(src.size());
+
+			PixelConversion::UInt8ToFloat(src.data(), expected.data(), src.size(), 4, true, PixelConversion::InstructionSetScalar);
+			PixelConversion::UInt8ToFloat(src.data(), actual.data(), src.size(), 4, true);
+			Assert::IsTrue(SameBits(expected, actual));
+		}
+
+		TEST_METHOD(BenchmarkFrameConversions)
+		{
+			BenchmarkFrame("4K", 3840, 2160);
+			BenchmarkFrame("8K", 7680, 4320);
+		}
+
+		TEST_METHOD(BenchmarkCopyRGBA)
+		{
+			// odd sized frame, so the scalar tail is included
+			const size_t pixelCount = 1921 * 1081;
+			const int repeatCount = 20;
+
+			std::vector<float> color = MakePixels(pixelCount, 1.0f);
+			std::vector<float> opacity = MakePixels(pixelCount, -1000.0f);
+			std::vector<float> output(pixelCount * 4);
+
+			const PixelConversion::InstructionSet allSets[] = { PixelConversion::InstructionSetScalar, SimdSets[0], SimdSets[1] };
+
+			std::string message = "CopyRGBA:";
+
+			for (PixelConversion::InstructionSet instructionSet : allSets)
+			{
+				if (!PixelConversion::IsSupported(instructionSet))
+					continue;
+
+				auto start = std::chrono::steady_clock::now();
+				for (int repeat = 0; repeat < repeatCount; ++repeat)
+				{
+					PixelConversion::CopyRGBA(color.data(), opacity.data(), output.data(), pixelCount, instructionSet);
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				message += std::string(" ") + Name(instructionSet) + " " + std::to_string(size_t(pixelCount * repeatCount / seconds / 1e6)) + " Mpixels/s";
+			}
+
+			Logger::WriteMessage(message.c_str());
+		}
+	};
+}
@@ -0,0 +1,149 @@
+/**********************************************************************
+Copyright 2020 Advanced Micro Devices, Inc
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+********************************************************************/
+#include "stdafx.h"
+#include "../FireRender.Maya.Src/FireRenderTextureCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace FireMaya;
+
+namespace fireRenderUnitTests
+{
+	TEST_CLASS(TextureCacheTests)
+	{
+		static constexpr int FrameWidth = 2;
+		static constexpr int FrameHeight = 2;
+		static constexpr size_t FrameByteSize = FrameWidth * FrameHeight * 4 * sizeof(float);
+
+		// the same sequence viewport uses: look up, render into the frame if it is new, store
+		static StoredFrame& Render(TextureCache& cache, const char* key, float value)
+		{
+			StoredFrame& frame = cache[key];
+			if (frame.Resize(FrameWidth, FrameHeight))
+			{
+				float* pixels = frame.data();
+				for (size_t idx = 0; idx < frame.ComponentCount(); ++idx)
+				{
+					pixels[idx] = value;
+				}
+			}
+
+			cache.Store(key);
+
+			return frame;
+		}
+
+	public:
+		TEST_METHOD(EvictsLeastRecentlyUsedAtByteBudget)
+		{
+			TextureCache cache;
+			cache.SetByteBudget(3 * FrameByteSize);
+
+			Render(cache, "a", 1.0f);
+			Render(cache, "b", 2.0f);
+			Render(cache, "c", 3.0f);
+
+			// "a" is used again, so "b" becomes the oldest one
+			Render(cache, "a", 1.0f);
+			Render(cache, "d", 4.0f);
+
+			Assert::IsTrue(cache.Contains("a"));
+			Assert::IsFalse(cache.Contains("b"));
+			Assert::IsTrue(cache.Contains("c"));
+			Assert::IsTrue(cache.Contains("d"));
+
+			TextureCache::Statistics stats = cache.GetStatistics();
+			Assert::AreEqual(size_t(3), stats.entryCount);
+			Assert::AreEqual(3 * FrameByteSize, stats.byteSize);
+			Assert::AreEqual(1ull, stats.evictions);
+			Assert::AreEqual(1ull, stats.hits);
+			Assert::AreEqual(4ull, stats.misses);
+		}
+
+		TEST_METHOD(LowerBudgetEvictsOldestEntries)
+		{
+			TextureCache cache;
+
+			Render(cache, "a", 1.0f);
+			Render(cache, "b", 2.0f);
+			Render(cache, "c", 3.0f);
+
+			cache.SetByteBudget(FrameByteSize + 1);
+
+			Assert::IsFalse(cache.Contains("a"));
+			Assert::IsFalse(cache.Contains("b"));
+			Assert::IsTrue(cache.Contains("c"));
+			Assert::AreEqual(FrameByteSize, cache.GetStatistics().byteSize);
+		}
+
+		TEST_METHOD(MostRecentEntryIsNeverEvicted)
+		{
+			TextureCache cache;
+			cache.SetByteBudget(FrameByteSize / 2);
+
+			StoredFrame& frame = Render(cache, "a", 1.0f);
+
+			Assert::IsTrue(cache.Contains("a"));
+			Assert::AreEqual(1.0f, frame.data()[0]);
+
+			Render(cache, "b", 2.0f);
+
+			Assert::IsFalse(cache.Contains("a"));
+			Assert::IsTrue(cache.Contains("b"));
+			Assert::AreEqual(size_t(1), cache.GetStatistics().entryCount);
+		}
+
+		TEST_METHOD(LookupAfterReinsert)
+		{
+			TextureCache cache;
+			cache.SetByteBudget(2 * FrameByteSize);
+
+			Render(cache, "a", 1.0f);
+			Render(cache, "b", 2.0f);
+			Render(cache, "c", 3.0f);
+			Assert::IsFalse(cache.Contains("a"));
+
+			// evicted key is rendered again, index has to point to the new entry
+			Render(cache, "a", 5.0f);
+			Assert::IsFalse(cache.Contains("b"));
+
+			StoredFrame& frame = cache["a"];
+			Assert::IsFalse(frame.Resize(FrameWidth, FrameHeight));
+			Assert::AreEqual(5.0f, frame.data()[0]);
+
+			Assert::AreEqual(3.0f, cache["c"].data()[0]);
+			Assert::AreEqual(2 * FrameByteSize, cache.GetStatistics().byteSize);
+		}
+
+		TEST_METHOD(HalfStorageCountsCompactedSize)
+		{
+			TextureCache cache;
+			cache.SetStorageMode(TextureCache::StorageHalf);
+			cache.SetByteBudget(2 * FrameByteSize);
+
+			// half float frames take half of the space, so 4 of them fit
+			Render(cache, "a", 1.0f);
+			Render(cache, "b", 2.0f);
+			Render(cache, "c", 3.0f);
+			Render(cache, "d", 0.5f);
+
+			TextureCache::Statistics stats = cache.GetStatistics();
+			Assert::AreEqual(size_t(4), stats.entryCount);
+			Assert::AreEqual(2 * FrameByteSize, stats.byteSize);
+			Assert::AreEqual(0ull, stats.evictions);
+
+			std::vector<float> scratch;
+			Assert::IsTrue(cache["d"].IsCompact());
+			Assert::AreEqual(0.5f, cache["d"].Pixels(scratch)[0]);
+		}
+	};
+}